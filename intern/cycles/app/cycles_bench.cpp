@@ -0,0 +1,372 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Benchmark
+ *
+ * Renders XML scenes in the background and writes timings and memory usage as
+ * JSON, to track performance of scene synchronization, BVH building and
+ * rendering over time. */
+
+#include <stdio.h>
+
+#include "device/device.h"
+#include "render/buffers.h"
+#include "render/camera.h"
+#include "render/scene.h"
+#include "render/session.h"
+#include "render/stats.h"
+
+#include "util/util_args.h"
+#include "util/util_foreach.h"
+#include "util/util_guarded_allocator.h"
+#include "util/util_logging.h"
+#include "util/util_path.h"
+#include "util/util_string.h"
+#include "util/util_system.h"
+#include "util/util_time.h"
+#include "util/util_version.h"
+
+#include "app/cycles_xml.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct Options {
+  vector<string> filepaths;
+  int width, height;
+  int repeat;
+  SceneParams scene_params;
+  SessionParams session_params;
+  string output_path;
+} options;
+
+/* Results of rendering a scene once. */
+struct BenchResult {
+  double load_time;
+  double sync_time;
+  double bvh_build_time;
+  double render_time;
+  double samples_per_second;
+  size_t mem_peak;
+  size_t geometry_mem;
+  size_t texture_mem;
+  vector<NamedTimeEntry> update_times;
+};
+
+static string json_escape(const string &str)
+{
+  string result;
+
+  foreach (char c, str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    }
+    else if ((unsigned char)c < 0x20) {
+      result += string_printf("\\u%04x", (int)c);
+    }
+    else {
+      result += c;
+    }
+  }
+
+  return result;
+}
+
+static void bench_update_times(SceneUpdateStats *update_stats, BenchResult &result)
+{
+  const struct {
+    const char *name;
+    UpdateTimeStats *stats;
+  } categories[] = {
+      {"geometry", &update_stats->geometry},
+      {"image", &update_stats->image},
+      {"light", &update_stats->light},
+      {"object", &update_stats->object},
+      {"background", &update_stats->background},
+      {"bake", &update_stats->bake},
+      {"camera", &update_stats->camera},
+      {"film", &update_stats->film},
+      {"integrator", &update_stats->integrator},
+      {"osl", &update_stats->osl},
+      {"particles", &update_stats->particles},
+      {"svm", &update_stats->svm},
+      {"tables", &update_stats->tables},
+  };
+
+  for (const auto &category : categories) {
+    result.update_times.push_back(
+        NamedTimeEntry(category.name, category.stats->times.total_time));
+  }
+
+  /* Object and scene BVH builds are recorded with the geometry update. */
+  const NamedTimeStats &geometry_times = update_stats->geometry.times;
+  result.bvh_build_time = geometry_times.get_time("device_update (build object BVHs)") +
+                          geometry_times.get_time("device_update (build scene BVH)");
+
+  result.sync_time = update_stats->scene.times.total_time;
+}
+
+static BenchResult bench_render(const string &filepath)
+{
+  BenchResult result;
+
+  Session *session = new Session(options.session_params);
+  Scene *scene = new Scene(options.scene_params, session->device);
+  scene->enable_update_stats();
+
+  /* Read XML */
+  double load_start = time_dt();
+  xml_read_file(scene, filepath.c_str());
+  result.load_time = time_dt() - load_start;
+
+  /* Camera width/height override? */
+  if (!(options.width == 0 || options.height == 0)) {
+    scene->camera->width = options.width;
+    scene->camera->height = options.height;
+  }
+  scene->camera->compute_auto_viewplane();
+
+  BufferParams buffer_params;
+  buffer_params.width = scene->camera->width;
+  buffer_params.height = scene->camera->height;
+  buffer_params.full_width = scene->camera->width;
+  buffer_params.full_height = scene->camera->height;
+
+  /* Render */
+  session->scene = scene;
+  session->reset(buffer_params, options.session_params.samples);
+  session->start();
+  session->wait();
+
+  double total_time, render_time;
+  session->progress.get_time(total_time, render_time);
+  result.render_time = render_time;
+
+  const uint64_t pixel_samples = (uint64_t)buffer_params.width * buffer_params.height *
+                                 options.session_params.samples;
+  result.samples_per_second = (render_time > 0.0) ? pixel_samples / render_time : 0.0;
+
+  /* Statistics */
+  bench_update_times(scene->update_stats, result);
+
+  RenderStats render_stats;
+  session->collect_statistics(&render_stats);
+  result.geometry_mem = render_stats.mesh.geometry.total_size;
+  result.texture_mem = render_stats.image.textures.total_size;
+  result.mem_peak = session->stats.mem_peak;
+
+  /* Also frees the scene. */
+  delete session;
+
+  return result;
+}
+
+static string bench_result_json(const BenchResult &result)
+{
+  string json = "{";
+
+  json += string_printf("\"load_time\": %f, ", result.load_time);
+  json += string_printf("\"sync_time\": %f, ", result.sync_time);
+  json += string_printf("\"bvh_build_time\": %f, ", result.bvh_build_time);
+  json += string_printf("\"render_time\": %f, ", result.render_time);
+  json += string_printf("\"samples_per_second\": %f, ", result.samples_per_second);
+  json += string_printf("\"mem_peak\": %zu, ", result.mem_peak);
+  json += string_printf("\"geometry_mem\": %zu, ", result.geometry_mem);
+  json += string_printf("\"texture_mem\": %zu, ", result.texture_mem);
+
+  json += "\"update_times\": {";
+  for (size_t i = 0; i < result.update_times.size(); i++) {
+    json += string_printf("%s\"%s\": %f",
+                          (i == 0) ? "" : ", ",
+                          result.update_times[i].name.c_str(),
+                          result.update_times[i].time);
+  }
+  json += "}}";
+
+  return json;
+}
+
+static bool bench_run()
+{
+  string json = "{\n";
+
+  json += string_printf("  \"version\": \"%s\",\n", CYCLES_VERSION_STRING);
+  json += string_printf("  \"device\": \"%s\",\n",
+                        json_escape(options.session_params.device.description).c_str());
+  json += string_printf("  \"cpu\": \"%s\",\n", json_escape(system_cpu_brand_string()).c_str());
+  json += string_printf("  \"threads\": %d,\n", options.session_params.threads);
+  json += string_printf("  \"samples\": %d,\n", options.session_params.samples);
+  json += "  \"scenes\": [\n";
+
+  for (size_t i = 0; i < options.filepaths.size(); i++) {
+    const string &filepath = options.filepaths[i];
+
+    json += "    {\n";
+    json += string_printf("      \"file\": \"%s\",\n", json_escape(filepath).c_str());
+    json += "      \"runs\": [\n";
+
+    for (int run = 0; run < options.repeat; run++) {
+      fprintf(stderr,
+              "Rendering %s (%d/%d)\n",
+              path_filename(filepath).c_str(),
+              run + 1,
+              options.repeat);
+
+      BenchResult result = bench_render(filepath);
+
+      json += "        " + bench_result_json(result);
+      json += (run + 1 < options.repeat) ? ",\n" : "\n";
+    }
+
+    json += "      ]\n";
+    json += (i + 1 < options.filepaths.size()) ? "    },\n" : "    }\n";
+  }
+
+  json += "  ],\n";
+  json += string_printf("  \"host_mem_peak\": %zu\n", util_guarded_get_mem_peak());
+  json += "}\n";
+
+  if (options.output_path.empty()) {
+    printf("%s", json.c_str());
+    return true;
+  }
+
+  FILE *f = path_fopen(options.output_path, "wb");
+  if (!f) {
+    fprintf(stderr, "Failed to write %s\n", options.output_path.c_str());
+    return false;
+  }
+
+  fwrite(json.data(), 1, json.size(), f);
+  fclose(f);
+
+  return true;
+}
+
+static int files_parse(int argc, const char *argv[])
+{
+  for (int i = 0; i < argc; i++)
+    options.filepaths.push_back(argv[i]);
+
+  return 0;
+}
+
+static void options_parse(int argc, const char **argv)
+{
+  options.width = 0;
+  options.height = 0;
+  options.repeat = 1;
+  options.session_params.samples = 16;
+
+  string devicename = "CPU";
+  bool help = false, debug = false;
+
+  ArgParse ap;
+
+  ap.options("Usage: cycles_bench [options] file.xml [file.xml ...]",
+             "%*",
+             files_parse,
+             "",
+             "--device %s",
+             &devicename,
+             "Device to use",
+             "--samples %d",
+             &options.session_params.samples,
+             "Number of samples to render",
+             "--threads %d",
+             &options.session_params.threads,
+             "CPU Rendering Threads",
+             "--width %d",
+             &options.width,
+             "Override image width in pixels",
+             "--height %d",
+             &options.height,
+             "Override image height in pixels",
+             "--tile-width %d",
+             &options.session_params.tile_size.x,
+             "Tile width in pixels",
+             "--tile-height %d",
+             &options.session_params.tile_size.y,
+             "Tile height in pixels",
+             "--repeat %d",
+             &options.repeat,
+             "Number of times to render every scene",
+             "--output %s",
+             &options.output_path,
+             "File path to write JSON results to, instead of standard output",
+#ifdef WITH_CYCLES_LOGGING
+             "--debug",
+             &debug,
+             "Enable debug logging",
+#endif
+             "--help",
+             &help,
+             "Print help message",
+             NULL);
+
+  if (ap.parse(argc, argv) < 0) {
+    fprintf(stderr, "%s\n", ap.geterror().c_str());
+    ap.usage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (debug) {
+    util_logging_start();
+  }
+
+  if (help || options.filepaths.empty()) {
+    ap.usage();
+    exit(EXIT_SUCCESS);
+  }
+
+  /* Render final quality in background, like a render farm would. */
+  options.scene_params.shadingsystem = SHADINGSYSTEM_SVM;
+  options.scene_params.background = true;
+  options.session_params.background = true;
+  options.session_params.progressive = false;
+
+  /* find matching device */
+  DeviceType device_type = Device::type_from_string(devicename.c_str());
+  vector<DeviceInfo> devices = Device::available_devices(DEVICE_MASK(device_type));
+
+  if (devices.empty()) {
+    fprintf(stderr, "Unknown device: %s\n", devicename.c_str());
+    exit(EXIT_FAILURE);
+  }
+  else if (options.session_params.samples <= 0) {
+    fprintf(stderr, "Invalid number of samples: %d\n", options.session_params.samples);
+    exit(EXIT_FAILURE);
+  }
+  else if (options.repeat <= 0) {
+    fprintf(stderr, "Invalid number of repeats: %d\n", options.repeat);
+    exit(EXIT_FAILURE);
+  }
+
+  options.session_params.device = devices.front();
+}
+
+CCL_NAMESPACE_END
+
+using namespace ccl;
+
+int main(int argc, const char **argv)
+{
+  util_logging_init(argv[0]);
+  path_init();
+  options_parse(argc, argv);
+
+  return bench_run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Merge
+ *
+ * Merges multilayer EXR renders of the same frame, for example renders of
+ * different sample ranges written by the standalone executable or Blender.
+ * Passes are averaged weighted by the number of samples of every render. */
+
+#include <stdio.h>
+
+#include "render/merge.h"
+
+#include "util/util_args.h"
+#include "util/util_logging.h"
+#include "util/util_path.h"
+#include "util/util_string.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct Options {
+  vector<string> input;
+  string output;
+} options;
+
+static int files_parse(int argc, const char *argv[])
+{
+  for (int i = 0; i < argc; i++)
+    options.input.push_back(argv[i]);
+
+  return 0;
+}
+
+static void options_parse(int argc, const char **argv)
+{
+  bool help = false;
+
+  ArgParse ap;
+
+  ap.options("Usage: cycles_merge [options] --output file.exr file.exr [file.exr ...]",
+             "%*",
+             files_parse,
+             "",
+             "--output %s",
+             &options.output,
+             "File path to write merged image to, may be one of the input files",
+             "--help",
+             &help,
+             "Print help message",
+             NULL);
+
+  if (ap.parse(argc, argv) < 0) {
+    fprintf(stderr, "%s\n", ap.geterror().c_str());
+    ap.usage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (help || options.input.empty()) {
+    ap.usage();
+    exit(EXIT_SUCCESS);
+  }
+  else if (options.output.empty()) {
+    fprintf(stderr, "No output file path specified\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static bool merge_run()
+{
+  ImageMerger merger;
+  merger.input = options.input;
+  merger.output = options.output;
+
+  if (!merger.run()) {
+    fprintf(stderr, "%s\n", merger.error.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+CCL_NAMESPACE_END
+
+using namespace ccl;
+
+int main(int argc, const char **argv)
+{
+  util_logging_init(argv[0]);
+  path_init();
+  options_parse(argc, argv);
+
+  return merge_run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -19,9 +19,11 @@
 #include "device/device.h"
 #include "render/buffers.h"
 #include "render/camera.h"
+#include "render/film.h"
 #include "render/integrator.h"
 #include "render/scene.h"
 #include "render/session.h"
+#include "render/tile_writer.h"
 
 #include "util/util_args.h"
 #include "util/util_foreach.h"
@@ -54,8 +56,35 @@ struct Options {
   bool quiet;
   bool show_help, interactive, pause;
   string output_path;
+  int range_start_sample, range_num_samples;
+  bool denoising_passes;
 } options;
 
+/* Render passes written to multilayer EXR output, to merge renders of sample
+ * ranges afterwards. Finished tiles are streamed to the file, so the full
+ * frame is never in memory. */
+
+static const char *OUTPUT_LAYER_NAME = "View Layer";
+
+struct OutputPass {
+  string name;
+  const char *channels;
+  /* Offset of denoising data passes, -1 for regular render passes. */
+  int denoising_offset;
+};
+
+static struct {
+  vector<OutputPass> passes;
+  int num_channels;
+  TileImageWriter writer;
+} output;
+
+static bool output_use_passes()
+{
+  return string_endswith(options.output_path, ".exr") ||
+         string_endswith(options.output_path, ".EXR");
+}
+
 static void session_print(const string &str)
 {
   /* print with carriage return to overwrite previous */
@@ -113,6 +142,126 @@ static bool write_render(const uchar *pixels, int w, int h, int channels)
   return true;
 }
 
+static void output_add_pass(const string &name, const char *channels, int denoising_offset = -1)
+{
+  OutputPass pass;
+  pass.name = name;
+  pass.channels = channels;
+  pass.denoising_offset = denoising_offset;
+  output.passes.push_back(pass);
+  output.num_channels += strlen(channels);
+}
+
+static void output_passes_init(Scene *scene)
+{
+  vector<Pass> passes;
+  Pass::add(PASS_COMBINED, passes, "Combined");
+  Pass::add(PASS_DEPTH, passes, "Depth");
+
+  output.passes.clear();
+  output.num_channels = 0;
+  output_add_pass("Combined", "RGBA");
+  output_add_pass("Depth", "Z");
+
+  if (scene->film->use_adaptive_sampling &&
+      scene->integrator->sampling_pattern == SAMPLING_PATTERN_PMJ) {
+    Pass::add(PASS_ADAPTIVE_AUX_BUFFER, passes);
+    Pass::add(PASS_SAMPLE_COUNT, passes, "Debug Sample Count");
+    output_add_pass("Debug Sample Count", "X");
+  }
+
+  /* Unfiltered denoising data, these are averages over samples that can be merged exactly.
+   * Denoising is then done on the merged image. */
+  if (options.denoising_passes) {
+    output_add_pass("Noisy Image", "RGBA", DENOISING_PASS_PREFILTERED_COLOR);
+    output_add_pass("Denoising Normal", "XYZ", DENOISING_PASS_PREFILTERED_NORMAL);
+    output_add_pass("Denoising Albedo", "RGB", DENOISING_PASS_PREFILTERED_ALBEDO);
+    output_add_pass("Denoising Depth", "Z", DENOISING_PASS_PREFILTERED_DEPTH);
+  }
+
+  scene->film->denoising_data_pass = options.denoising_passes;
+  scene->film->denoising_prefiltered_pass = false;
+  scene->film->tag_passes_update(scene, passes);
+  scene->film->tag_update(scene);
+}
+
+/* Write passes of a finished tile to the output image. */
+static void output_write_tile(RenderTile &rtile)
+{
+  RenderBuffers *buffers = rtile.buffers;
+
+  if (!buffers->copy_from_device()) {
+    return;
+  }
+
+  /* Buffers only contain the samples of the rendered range. */
+  const int sample = rtile.sample - options.session->tile_manager.range_start_sample;
+  const float exposure = options.session->scene->film->exposure;
+
+  vector<float> pixels(rtile.w * rtile.h * 4);
+  vector<float> tile_pixels(rtile.w * rtile.h * output.num_channels);
+  int channel_offset = 0;
+
+  foreach (const OutputPass &pass, output.passes) {
+    const int components = strlen(pass.channels);
+
+    bool read = (pass.denoising_offset == -1) ?
+                    buffers->get_pass_rect(pass.name, exposure, sample, components, &pixels[0]) :
+                    buffers->get_denoising_pass_rect(
+                        pass.denoising_offset, exposure, sample, components, &pixels[0]);
+    if (!read) {
+      memset(&pixels[0], 0, pixels.size() * sizeof(float));
+    }
+
+    /* Interleave passes. */
+    float *out = &tile_pixels[channel_offset];
+    const float *in = &pixels[0];
+    for (int i = 0; i < rtile.w * rtile.h; i++, out += output.num_channels, in += components) {
+      memcpy(out, in, sizeof(float) * components);
+    }
+
+    channel_offset += components;
+  }
+
+  if (!output.writer.write_tile(rtile.x, rtile.y, rtile.w, rtile.h, &tile_pixels[0])) {
+    options.session->progress.set_error(output.writer.error);
+  }
+}
+
+static bool output_open()
+{
+  string msg = string_printf("Writing image %s", options.output_path.c_str());
+  session_print(msg);
+
+  /* Channels are named like in multilayer EXR files written by Blender. */
+  ImageSpec spec(options.width, options.height, output.num_channels, TypeDesc::FLOAT);
+  spec.channelnames.clear();
+  foreach (const OutputPass &pass, output.passes) {
+    for (const char *channel = pass.channels; *channel; channel++) {
+      spec.channelnames.push_back(
+          string_printf("%s.%s.%c", OUTPUT_LAYER_NAME, pass.name.c_str(), *channel));
+    }
+  }
+  spec.alpha_channel = -1;
+  spec.z_channel = -1;
+
+  /* Number of samples, to weight renders of sample ranges when merging. */
+  const int samples = options.session->tile_manager.get_num_effective_samples();
+  spec.attribute(string_printf("cycles.%s.samples", OUTPUT_LAYER_NAME),
+                 TypeDesc::STRING,
+                 string_printf("%d", samples));
+  spec.attribute(string_printf("cycles.%s.range_start_sample", OUTPUT_LAYER_NAME),
+                 TypeDesc::STRING,
+                 string_printf("%d", options.session->tile_manager.range_start_sample));
+
+  if (!output.writer.open(options.output_path, spec)) {
+    fprintf(stderr, "%s\n", output.writer.error.c_str());
+    return false;
+  }
+
+  return true;
+}
+
 static BufferParams &session_buffer_params()
 {
   static BufferParams buffer_params;
@@ -121,6 +270,12 @@ static BufferParams &session_buffer_params()
   buffer_params.full_width = options.width;
   buffer_params.full_height = options.height;
 
+  if (options.scene && output_use_passes()) {
+    buffer_params.passes = options.scene->passes;
+    buffer_params.denoising_data_pass = options.scene->film->denoising_data_pass;
+    buffer_params.denoising_prefiltered_pass = options.scene->film->denoising_prefiltered_pass;
+  }
+
   return buffer_params;
 }
 
@@ -147,7 +302,9 @@ static void scene_init()
 
 static void session_init()
 {
-  options.session_params.write_render_cb = write_render;
+  if (!output_use_passes()) {
+    options.session_params.write_render_cb = write_render;
+  }
   options.session = new Session(options.session_params);
 
   if (options.session_params.background && !options.quiet)
@@ -161,13 +318,46 @@ static void session_init()
   scene_init();
   options.session->scene = options.scene;
 
+  if (output_use_passes()) {
+    output_passes_init(options.scene);
+    options.session->write_render_tile_cb = function_bind(&output_write_tile, _1);
+  }
+
+  /* Render a range of the samples, with the same sample pattern as rendering all at once. */
+  if (options.range_start_sample != 0 || options.range_num_samples != -1) {
+    const int num_samples = options.session_params.samples;
+    const int range_start_sample = min(options.range_start_sample, num_samples - 1);
+    const int range_num_samples = (options.range_num_samples == -1) ?
+                                      num_samples - range_start_sample :
+                                      min(options.range_num_samples,
+                                          num_samples - range_start_sample);
+
+    options.scene->integrator->start_sample = range_start_sample;
+    options.scene->integrator->tag_update(options.scene);
+
+    options.session->tile_manager.range_start_sample = range_start_sample;
+    options.session->tile_manager.range_num_samples = range_num_samples;
+  }
+
   options.session->reset(session_buffer_params(), options.session_params.samples);
+
+  if (output_use_passes() && !output_open()) {
+    exit(EXIT_FAILURE);
+  }
+
   options.session->start();
 }
 
 static void session_exit()
 {
   if (options.session) {
+    if (output_use_passes()) {
+      options.session->wait();
+      if (!output.writer.close()) {
+        fprintf(stderr, "%s\n", output.writer.error.c_str());
+      }
+    }
+
     delete options.session;
     options.session = NULL;
   }
@@ -369,7 +559,11 @@ static void options_parse(int argc, const char **argv)
   options.height = 0;
   options.filepath = "";
   options.session = NULL;
+  options.scene = NULL;
   options.quiet = false;
+  options.range_start_sample = 0;
+  options.range_num_samples = -1;
+  options.denoising_passes = false;
 
   /* device names */
   string device_names = "";
@@ -414,9 +608,19 @@ static void options_parse(int argc, const char **argv)
              "--samples %d",
              &options.session_params.samples,
              "Number of samples to render",
+             "--range-start-sample %d",
+             &options.range_start_sample,
+             "First sample to render, to split a render over processes by samples",
+             "--range-num-samples %d",
+             &options.range_num_samples,
+             "Number of samples to render from the first sample, all remaining by default",
              "--output %s",
              &options.output_path,
-             "File path to write output image",
+             "File path to write output image, .exr files contain render passes that "
+             "renders of sample ranges can be merged from",
+             "--denoising-passes",
+             &options.denoising_passes,
+             "Write denoising data passes to .exr output",
              "--threads %d",
              &options.session_params.threads,
              "CPU Rendering Threads",
@@ -493,8 +697,12 @@ static void options_parse(int argc, const char **argv)
   options.session_params.background = true;
 #endif
 
-  /* Use progressive rendering */
-  options.session_params.progressive = true;
+  /* Use progressive rendering, except for render passes that are written per tile. Those are
+   * rendered from top to bottom, in the order rows are written to the file. */
+  options.session_params.progressive = !output_use_passes();
+  if (output_use_passes()) {
+    options.session_params.tile_order = TILE_TOP_TO_BOTTOM;
+  }
 
   /* find matching device */
   DeviceType device_type = Device::type_from_string(devicename.c_str());
@@ -502,7 +710,13 @@ static void options_parse(int argc, const char **argv)
 
   bool device_available = false;
   if (!devices.empty()) {
-    options.session_params.device = devices.front();
+    /* Render on all servers together. */
+    options.session_params.device = (device_type == DEVICE_NETWORK && devices.size() > 1) ?
+                                        Device::get_multi_device(
+                                            devices,
+                                            options.session_params.threads,
+                                            options.session_params.background) :
+                                        devices.front();
     device_available = true;
   }
 
@@ -526,6 +740,19 @@ static void options_parse(int argc, const char **argv)
     fprintf(stderr, "Invalid number of samples: %d\n", options.session_params.samples);
     exit(EXIT_FAILURE);
   }
+  else if (options.range_start_sample < 0 ||
+           options.range_start_sample >= max(options.session_params.samples, 1)) {
+    fprintf(stderr, "Invalid range start sample: %d\n", options.range_start_sample);
+    exit(EXIT_FAILURE);
+  }
+  else if (options.range_num_samples == 0 || options.range_num_samples < -1) {
+    fprintf(stderr, "Invalid number of range samples: %d\n", options.range_num_samples);
+    exit(EXIT_FAILURE);
+  }
+  else if (output_use_passes() && !options.session_params.background) {
+    fprintf(stderr, "Writing render passes to .exr output requires --background\n");
+    exit(EXIT_FAILURE);
+  }
   else if (options.filepath == "") {
     fprintf(stderr, "No file path specified\n");
     exit(EXIT_FAILURE);
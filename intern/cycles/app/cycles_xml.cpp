@@ -26,6 +26,7 @@
 #include "render/camera.h"
 #include "render/film.h"
 #include "render/graph.h"
+#include "render/hair.h"
 #include "render/integrator.h"
 #include "render/light.h"
 #include "render/mesh.h"
@@ -376,6 +377,14 @@ static void xml_read_background(XMLReadState &state, xml_node node)
 
 /* Mesh */
 
+static void xml_add_object(Scene *scene, Geometry *geom, const Transform &tfm)
+{
+  Object *object = new Object();
+  object->geometry = geom;
+  object->tfm = tfm;
+  scene->objects.push_back(object);
+}
+
 static Mesh *xml_add_mesh(Scene *scene, const Transform &tfm)
 {
   /* create mesh */
@@ -383,10 +392,7 @@ static Mesh *xml_add_mesh(Scene *scene, const Transform &tfm)
   scene->geometry.push_back(mesh);
 
   /* create object*/
-  Object *object = new Object();
-  object->geometry = mesh;
-  object->tfm = tfm;
-  scene->objects.push_back(object);
+  xml_add_object(scene, mesh, tfm);
 
   return mesh;
 }
@@ -397,6 +403,12 @@ static void xml_read_mesh(const XMLReadState &state, xml_node node)
   Mesh *mesh = xml_add_mesh(state.scene, state.tfm);
   mesh->used_shaders.push_back(state.shader);
 
+  /* name for instancing */
+  string name;
+  if (xml_read_string(&name, node, "name")) {
+    mesh->name = ustring(name);
+  }
+
   /* read state */
   int shader = 0;
   bool smooth = state.smooth;
@@ -533,6 +545,89 @@ static void xml_read_mesh(const XMLReadState &state, xml_node node)
   }
 }
 
+/* Hair */
+
+static void xml_read_hair(const XMLReadState &state, xml_node node)
+{
+  /* read keys and curves, radius is either one value for all keys or one per key */
+  vector<float3> P;
+  vector<float> radius;
+  vector<int> nkeys;
+
+  xml_read_float3_array(P, node, "P");
+  xml_read_float_array(radius, node, "radius");
+  xml_read_int_array(nkeys, node, "nkeys");
+
+  int num_keys = 0;
+  for (size_t i = 0; i < nkeys.size(); i++) {
+    if (nkeys[i] < 1) {
+      fprintf(stderr, "Hair curve %d has no keys.\n", (int)i);
+      return;
+    }
+    num_keys += nkeys[i];
+  }
+
+  if (num_keys != (int)P.size()) {
+    fprintf(stderr, "Hair has %d keys, but curves use %d keys.\n", (int)P.size(), num_keys);
+    return;
+  }
+
+  if (radius.size() > 1 && radius.size() != P.size()) {
+    fprintf(stderr, "Hair has %d keys, but %d radii.\n", (int)P.size(), (int)radius.size());
+    return;
+  }
+
+  /* add hair */
+  Hair *hair = new Hair();
+  state.scene->geometry.push_back(hair);
+  xml_add_object(state.scene, hair, state.tfm);
+
+  hair->used_shaders.push_back(state.shader);
+
+  /* name for instancing */
+  string name;
+  if (xml_read_string(&name, node, "name")) {
+    hair->name = ustring(name);
+  }
+
+  hair->reserve_curves(nkeys.size(), P.size());
+
+  if (radius.empty()) {
+    radius.push_back(0.01f);
+  }
+
+  for (size_t i = 0; i < P.size(); i++) {
+    hair->add_curve_key(P[i], (radius.size() == P.size()) ? radius[i] : radius[0]);
+  }
+
+  int first_key = 0;
+  for (size_t i = 0; i < nkeys.size(); i++) {
+    hair->add_curve(first_key, 0);
+    first_key += nkeys[i];
+  }
+}
+
+/* Instance */
+
+static void xml_read_instance(const XMLReadState &state, xml_node node)
+{
+  /* add object for previously read geometry with the given name */
+  string name;
+  if (!xml_read_string(&name, node, "geometry")) {
+    fprintf(stderr, "Instance without geometry.\n");
+    return;
+  }
+
+  foreach (Geometry *geom, state.scene->geometry) {
+    if (geom->name == name) {
+      xml_add_object(state.scene, geom, state.tfm);
+      return;
+    }
+  }
+
+  fprintf(stderr, "Unknown geometry \"%s\".\n", name.c_str());
+}
+
 /* Light */
 
 static void xml_read_light(XMLReadState &state, xml_node node)
@@ -632,6 +727,12 @@ static void xml_read_scene(XMLReadState &state, xml_node scene_node)
     else if (string_iequals(node.name(), "mesh")) {
       xml_read_mesh(state, node);
     }
+    else if (string_iequals(node.name(), "hair")) {
+      xml_read_hair(state, node);
+    }
+    else if (string_iequals(node.name(), "instance")) {
+      xml_read_instance(state, node);
+    }
     else if (string_iequals(node.name(), "light")) {
       xml_read_light(state, node);
     }
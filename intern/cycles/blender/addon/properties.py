@@ -397,6 +397,12 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         min=0.0, max=1.0,
         default=0.01,
     )
+    use_light_tree: BoolProperty(
+        name="Light Tree",
+        description="Pick point, spot and area lights based on their estimated contribution at the shading point, "
+        "rather than uniformly (faster convergence in scenes with many lights)",
+        default=False,
+    )
 
     use_adaptive_sampling: BoolProperty(
         name="Use Adaptive Sampling",
@@ -687,6 +693,11 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         description="Use special type BVH optimized for hair (uses more ram but renders faster)",
         default=True,
     )
+    debug_use_compressed_bvh: BoolProperty(
+        name="Use Compressed BVH",
+        description="Store BVH nodes with quantized bounds (uses less memory but renders slower)",
+        default=False,
+    )
     debug_bvh_time_steps: IntProperty(
         name="BVH Time Steps",
         description="Split BVH primitives by this number of time steps to speed up render time in cost of memory",
@@ -800,6 +811,19 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         items=enum_texture_limit
     )
 
+    use_texture_cache: BoolProperty(
+        name="Texture Cache",
+        description="Load image texture tiles and mipmap levels on demand while rendering, "
+        "instead of loading full images into memory (CPU only)",
+        default=False,
+    )
+    texture_cache_size: IntProperty(
+        name="Cache Size",
+        description="Maximum memory used by the texture cache, in megabytes",
+        min=64, max=1048576,
+        default=2048,
+    )
+
     ao_bounces: IntProperty(
         name="AO Bounces",
         default=0,
@@ -832,6 +856,11 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
         default='EMBREE',
     )
     debug_use_cpu_split_kernel: BoolProperty(name="Split Kernel", default=False)
+    debug_use_cpu_ray_packets: BoolProperty(
+        name="Ray Packets",
+        description="Trace camera rays of neighboring pixels together, for coherent BVH traversal",
+        default=False,
+    )
 
     debug_use_cuda_adaptive_compile: BoolProperty(name="Adaptive Compile", default=False)
     debug_use_cuda_split_kernel: BoolProperty(name="Split Kernel", default=False)
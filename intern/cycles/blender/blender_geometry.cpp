@@ -15,6 +15,7 @@
  * limitations under the License.
  */
 
+#include "render/bake.h"
 #include "render/curves.h"
 #include "render/hair.h"
 #include "render/mesh.h"
@@ -25,6 +26,8 @@
 #include "blender/blender_util.h"
 
 #include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_md5.h"
 #include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
@@ -42,6 +45,51 @@ static Geometry::Type determine_geom_type(BL::Object &b_ob, bool use_particle_ha
   return Geometry::MESH;
 }
 
+/* Hash of everything that is synced into the mesh, to find identical meshes that can be
+ * shared. Empty for meshes that are not worth or not safe to share. */
+static string mesh_content_hash(Mesh *mesh)
+{
+  if (mesh->num_triangles() == 0 || mesh->subdivision_type != Mesh::SUBDIVISION_NONE) {
+    return "";
+  }
+
+  MD5Hash md5;
+  mesh->hash(md5);
+
+  foreach (Shader *shader, mesh->used_shaders) {
+    md5.append((uint8_t *)&shader, sizeof(shader));
+  }
+
+  foreach (const Attribute &attr, mesh->attributes.attributes) {
+    if (attr.element == ATTR_ELEMENT_VOXEL) {
+      return "";
+    }
+
+    md5.append(attr.name.string());
+    md5.append((uint8_t *)&attr.std, sizeof(attr.std));
+    md5.append((uint8_t *)&attr.type, sizeof(attr.type));
+    md5.append((uint8_t *)&attr.element, sizeof(attr.element));
+    md5.append((uint8_t *)&attr.flags, sizeof(attr.flags));
+    if (attr.buffer.size()) {
+      md5.append((uint8_t *)&attr.buffer[0], attr.buffer.size());
+    }
+  }
+
+  return md5.get_hex();
+}
+
+static size_t mesh_memory_size(Mesh *mesh)
+{
+  size_t size = mesh->triangles.size() * sizeof(int) + mesh->verts.size() * sizeof(float3) +
+                mesh->shader.size() * sizeof(int) + mesh->smooth.size() * sizeof(bool);
+
+  foreach (const Attribute &attr, mesh->attributes.attributes) {
+    size += attr.buffer.size();
+  }
+
+  return size;
+}
+
 Geometry *BlenderSync::sync_geometry(BL::Depsgraph &b_depsgraph,
                                      BL::Object &b_ob,
                                      BL::Object &b_ob_instance,
@@ -107,6 +155,32 @@ Geometry *BlenderSync::sync_geometry(BL::Depsgraph &b_depsgraph,
     sync = geometry_map.update(geom, b_key_id);
   }
 
+  const bool use_deduplicate = use_geometry_deduplicate();
+
+  auto sync_func = [=]() mutable {
+    if (progress.get_cancel())
+      return;
+
+    progress.set_sync_status("Synchronizing object", b_ob.name());
+
+    if (geom_type == Geometry::HAIR) {
+      Hair *hair = static_cast<Hair *>(geom);
+      sync_hair(b_depsgraph, b_ob, hair, used_shaders);
+    }
+    else if (geom_type == Geometry::VOLUME) {
+      Volume *volume = static_cast<Volume *>(geom);
+      sync_volume(b_ob, volume, used_shaders);
+    }
+    else {
+      Mesh *mesh = static_cast<Mesh *>(geom);
+      sync_mesh(b_depsgraph, b_ob, mesh, used_shaders);
+
+      string hash = (use_deduplicate) ? mesh_content_hash(mesh) : "";
+      thread_scoped_lock lock(geometry_hash_mutex);
+      geometry_hash[geom] = hash;
+    }
+  };
+
   if (!sync) {
     /* If transform was applied to geometry, need full update. */
     if (object_updated && geom->transform_applied) {
@@ -129,6 +203,10 @@ Geometry *BlenderSync::sync_geometry(BL::Depsgraph &b_depsgraph,
       }
 
       if (!attribute_recalc) {
+        /* Contents of a shared duplicate may have to be restored after all objects are synced. */
+        if (geometry_duplicates.find(geom) != geometry_duplicates.end()) {
+          geometry_duplicates_sync[geom] = sync_func;
+        }
         return geom;
       }
     }
@@ -138,26 +216,6 @@ Geometry *BlenderSync::sync_geometry(BL::Depsgraph &b_depsgraph,
 
   geom->name = ustring(b_ob_data.name().c_str());
 
-  auto sync_func = [=]() mutable {
-    if (progress.get_cancel())
-      return;
-
-    progress.set_sync_status("Synchronizing object", b_ob.name());
-
-    if (geom_type == Geometry::HAIR) {
-      Hair *hair = static_cast<Hair *>(geom);
-      sync_hair(b_depsgraph, b_ob, hair, used_shaders);
-    }
-    else if (geom_type == Geometry::VOLUME) {
-      Volume *volume = static_cast<Volume *>(geom);
-      sync_volume(b_ob, volume, used_shaders);
-    }
-    else {
-      Mesh *mesh = static_cast<Mesh *>(geom);
-      sync_mesh(b_depsgraph, b_ob, mesh, used_shaders);
-    }
-  };
-
   /* Defer the actual geometry sync to the task_pool for multithreading */
   if (task_pool) {
     task_pool->push(sync_func);
@@ -221,4 +279,130 @@ void BlenderSync::sync_geometry_motion(BL::Depsgraph &b_depsgraph,
   }
 }
 
+bool BlenderSync::use_geometry_deduplicate()
+{
+  /* Motion is synced per object into its geometry and baking needs the exact geometry of the
+   * object, neither works with geometry shared between different datablocks. */
+  return scene->need_motion() == Scene::MOTION_NONE && !scene->bake_manager->get_baking();
+}
+
+void BlenderSync::sync_geometry_deduplicate()
+{
+  const bool use_deduplicate = use_geometry_deduplicate();
+
+  set<Geometry *> geometry_used;
+  for (const pair<const GeometryKey, Geometry *> &iter : geometry_map.key_to_scene_data()) {
+    geometry_used.insert(iter.second);
+  }
+
+  for (map<Geometry *, string>::iterator it = geometry_hash.begin(); it != geometry_hash.end();) {
+    if (geometry_used.find(it->first) == geometry_used.end()) {
+      it = geometry_hash.erase(it);
+    }
+    else {
+      it++;
+    }
+  }
+
+  /* Restore contents of duplicates when the geometry they share was removed or synced again,
+   * since it may no longer be identical. Duplicates that were synced again are no longer
+   * cleared either. */
+  TaskPool task_pool;
+  set<Geometry *> geometry_shared;
+
+  for (map<Geometry *, Geometry *>::iterator it = geometry_duplicates.begin();
+       it != geometry_duplicates.end();) {
+    Geometry *geom = it->first;
+    Geometry *shared = it->second;
+
+    if (geometry_used.find(geom) == geometry_used.end() ||
+        geometry_synced.find(geom) != geometry_synced.end()) {
+      it = geometry_duplicates.erase(it);
+    }
+    else if (!use_deduplicate || geometry_used.find(shared) == geometry_used.end() ||
+             geometry_synced.find(shared) != geometry_synced.end()) {
+      map<Geometry *, function<void()>>::iterator jt = geometry_duplicates_sync.find(geom);
+      if (jt != geometry_duplicates_sync.end()) {
+        geometry_synced.insert(geom);
+        task_pool.push(std::move(jt->second));
+      }
+      it = geometry_duplicates.erase(it);
+    }
+    else {
+      geometry_shared.insert(shared);
+      it++;
+    }
+  }
+
+  task_pool.wait_work();
+  geometry_duplicates_sync.clear();
+
+  if (use_deduplicate) {
+    /* Find identical meshes, keeping geometry that was shared already first so its BVH does not
+     * have to be built again. Transformed meshes were modified after computing the hash. */
+    map<string, Geometry *> geometry_by_hash;
+    size_t num_duplicates = 0;
+    size_t mem_duplicates = 0;
+
+    for (int shared_pass = 1; shared_pass >= 0; shared_pass--) {
+      for (const pair<Geometry *const, string> &iter : geometry_hash) {
+        Geometry *geom = iter.first;
+        const bool is_shared = geometry_shared.find(geom) != geometry_shared.end();
+
+        if (iter.second.empty() || geom->transform_applied || is_shared != (shared_pass == 1) ||
+            geometry_duplicates.find(geom) != geometry_duplicates.end()) {
+          continue;
+        }
+
+        map<string, Geometry *>::iterator it = geometry_by_hash.find(iter.second);
+        if (it == geometry_by_hash.end()) {
+          geometry_by_hash[iter.second] = geom;
+          continue;
+        }
+
+        /* Free contents of the duplicate, keeping shaders so it is not synced again. */
+        Mesh *mesh = static_cast<Mesh *>(geom);
+        vector<Shader *> used_shaders = mesh->used_shaders;
+
+        num_duplicates++;
+        mem_duplicates += mesh_memory_size(mesh);
+
+        mesh->clear();
+        mesh->used_shaders = used_shaders;
+        mesh->tag_update(scene, true);
+
+        geometry_duplicates[geom] = it->second;
+      }
+    }
+
+    if (num_duplicates) {
+      VLOG(1) << "Deduplicated " << num_duplicates << " meshes, saving "
+              << string_human_readable_size(mem_duplicates) << ".";
+    }
+  }
+
+  /* Point objects to the geometry they share, and update them when it changes. */
+  map<Object *, Geometry *> object_shared;
+
+  foreach (Object *object, scene->objects) {
+    Geometry *shared = NULL;
+
+    map<Geometry *, Geometry *>::iterator it = geometry_duplicates.find(object->geometry);
+    if (it != geometry_duplicates.end()) {
+      shared = it->second;
+      object->geometry = shared;
+      object_shared[object] = shared;
+    }
+
+    map<Object *, Geometry *>::iterator jt = object_shared_geometry.find(object);
+    Geometry *prev_shared = (jt != object_shared_geometry.end()) ? jt->second : NULL;
+
+    if (shared != prev_shared || (shared && shared->need_update)) {
+      object->tag_update(scene);
+    }
+  }
+
+  object_shared_geometry.swap(object_shared);
+}
+
 CCL_NAMESPACE_END
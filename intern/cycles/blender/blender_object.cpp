@@ -359,6 +359,7 @@ void BlenderSync::sync_objects(BL::Depsgraph &b_depsgraph,
     /* prepare for sync */
     light_map.pre_sync();
     geometry_map.pre_sync();
+    geometry_duplicates_sync.clear();
     object_map.pre_sync();
     particle_system_map.pre_sync();
     motion_times.clear();
@@ -434,6 +435,9 @@ void BlenderSync::sync_objects(BL::Depsgraph &b_depsgraph,
     geometry_map.post_sync(scene);
     object_map.post_sync(scene);
     particle_system_map.post_sync(scene);
+
+    /* Share identical geometry, after removed geometry and objects were deleted. */
+    sync_geometry_deduplicate();
   }
 
   if (motion)
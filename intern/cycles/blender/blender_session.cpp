@@ -225,7 +225,6 @@ void BlenderSession::reset_session(BL::BlendData &b_data, BL::Depsgraph &b_depsg
   }
 
   session->progress.reset();
-  scene->reset();
 
   session->tile_manager.set_tile_order(session_params.tile_order);
 
@@ -234,14 +233,16 @@ void BlenderSession::reset_session(BL::BlendData &b_data, BL::Depsgraph &b_depsg
    */
   session->stats.mem_peak = session->stats.mem_used;
 
-  /* There is no single depsgraph to use for the entire render.
-   * See note on create_session().
-   */
-  /* sync object should be re-created */
-  sync = new BlenderSync(b_engine, b_data, b_scene, scene, !background, session->progress);
-
   BL::SpaceView3D b_null_space_view3d(PointerRNA_NULL);
   BL::RegionView3D b_null_region_view3d(PointerRNA_NULL);
+
+  /* With persistent data the scene from the previous render is kept, and the dependency
+   * graph is kept by Blender as well. Only sync the datablocks it tagged as updated since
+   * the previous render, for example the ones animated between frames.
+   */
+  if (!is_new_session) {
+    sync->sync_recalc(b_depsgraph, b_null_space_view3d);
+  }
   BufferParams buffer_params = BlenderSync::get_buffer_params(b_render,
                                                               b_null_space_view3d,
                                                               b_null_region_view3d,
@@ -1102,7 +1103,7 @@ void BlenderSession::update_resumable_tile_manager(int num_samples)
 
   /* Make sure we don't overshoot. */
   if (rounded_range_start_sample + rounded_range_num_samples > num_samples) {
-    rounded_range_num_samples = num_samples - rounded_range_num_samples;
+    rounded_range_num_samples = num_samples - rounded_range_start_sample;
   }
 
   VLOG(1) << "Samples range start is " << range_start_sample << ", "
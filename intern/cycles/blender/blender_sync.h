@@ -28,8 +28,10 @@
 #include "render/scene.h"
 #include "render/session.h"
 
+#include "util/util_function.h"
 #include "util/util_map.h"
 #include "util/util_set.h"
+#include "util/util_thread.h"
 #include "util/util_transform.h"
 #include "util/util_vector.h"
 
@@ -189,6 +191,9 @@ class BlenderSync {
                             bool use_particle_hair,
                             TaskPool *task_pool);
 
+  bool use_geometry_deduplicate();
+  void sync_geometry_deduplicate();
+
   /* Light */
   void sync_light(BL::Object &b_parent,
                   int persistent_id[OBJECT_PERSISTENT_ID_SIZE],
@@ -228,6 +233,17 @@ class BlenderSync {
   id_map<ParticleSystemKey, ParticleSystem> particle_system_map;
   set<Geometry *> geometry_synced;
   set<Geometry *> geometry_motion_synced;
+
+  /* Identical meshes from different datablocks share a single geometry. Content hashes of
+   * synced meshes, empty if the mesh can not be shared. */
+  map<Geometry *, string> geometry_hash;
+  thread_mutex geometry_hash_mutex;
+  /* Duplicates whose contents were cleared, and the geometry they share instead. */
+  map<Geometry *, Geometry *> geometry_duplicates;
+  /* Skipped sync of duplicates, to restore them if the shared geometry changes. */
+  map<Geometry *, function<void()>> geometry_duplicates_sync;
+  /* Shared geometry objects were using after the previous sync. */
+  map<Object *, Geometry *> object_shared_geometry;
   set<float> motion_times;
   void *world_map;
   bool world_recalc;
@@ -92,7 +92,12 @@ int BVHStackEntry::encodeIdx() const
 BVH::BVH(const BVHParams &params_,
          const vector<Geometry *> &geometry_,
          const vector<Object *> &objects_)
-    : params(params_), geometry(geometry_), objects(objects_)
+    : params(params_),
+      geometry(geometry_),
+      objects(objects_),
+      top_level_nodes_size(0),
+      top_level_leaf_nodes_size(0),
+      top_level_prims_size(0)
 {
 }
 
@@ -190,6 +195,50 @@ void BVH::refit(Progress &progress)
 
   progress.set_substatus("Refitting BVH nodes");
   refit_nodes();
+
+  /* Instance BVHs are updated separately, merge them again. */
+  if (params.top_level) {
+    pack_instances(top_level_nodes_size, top_level_leaf_nodes_size);
+  }
+}
+
+template<typename T> static void array_truncate(array<T> &data, size_t size)
+{
+  /* Copy into a new array, so the memory of the discarded part is freed. */
+  array<T> truncated;
+  if (size > 0) {
+    truncated.resize(size);
+    memcpy((void *)truncated.data(), data.data(), sizeof(T) * size);
+  }
+  data.steal_data(truncated);
+}
+
+void BVH::discard_instances()
+{
+  assert(params.top_level);
+
+  /* Undo the offsets added when merging instances, refit expects indices local to the
+   * geometry like the builder outputs. */
+  for (size_t i = 0; i < top_level_prims_size; i++) {
+    if (pack.prim_index[i] != -1) {
+      pack.prim_index[i] -= objects[pack.prim_object[i]]->geometry->prim_offset;
+    }
+  }
+
+  array_truncate(pack.nodes, top_level_nodes_size);
+  array_truncate(pack.leaf_nodes, top_level_leaf_nodes_size);
+  array_truncate(pack.prim_index, top_level_prims_size);
+  array_truncate(pack.prim_type, top_level_prims_size);
+  array_truncate(pack.prim_object, top_level_prims_size);
+  if (pack.prim_time.size()) {
+    array_truncate(pack.prim_time, top_level_prims_size);
+  }
+
+  /* Fully recomputed on refit. */
+  pack.prim_visibility.clear();
+  pack.prim_tri_index.clear();
+  pack.prim_tri_verts.clear();
+  pack.object_node.clear();
 }
 
 void BVH::refit_primitives(int start, int end, BoundBox &bbox, uint &visibility)
@@ -209,8 +258,7 @@ void BVH::refit_primitives(int start, int end, BoundBox &bbox, uint &visibility)
       if (pack.prim_type[prim] & PRIMITIVE_ALL_CURVE) {
         /* Curves. */
         const Hair *hair = static_cast<const Hair *>(ob->geometry);
-        int prim_offset = (params.top_level) ? hair->prim_offset : 0;
-        Hair::Curve curve = hair->get_curve(pidx - prim_offset);
+        Hair::Curve curve = hair->get_curve(pidx);
         int k = PRIMITIVE_UNPACK_SEGMENT(pack.prim_type[prim]);
 
         curve.bounds_grow(k, &hair->curve_keys[0], &hair->curve_radius[0], bbox);
@@ -232,8 +280,7 @@ void BVH::refit_primitives(int start, int end, BoundBox &bbox, uint &visibility)
       else {
         /* Triangles. */
         const Mesh *mesh = static_cast<const Mesh *>(ob->geometry);
-        int prim_offset = (params.top_level) ? mesh->prim_offset : 0;
-        Mesh::Triangle triangle = mesh->get_triangle(pidx - prim_offset);
+        Mesh::Triangle triangle = mesh->get_triangle(pidx);
         const float3 *vpos = &mesh->verts[0];
 
         triangle.bounds_grow(vpos, bbox);
@@ -323,6 +370,10 @@ void BVH::pack_primitives()
 
 void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
 {
+  top_level_nodes_size = nodes_size;
+  top_level_leaf_nodes_size = leaf_nodes_size;
+  top_level_prims_size = pack.prim_index.size();
+
   /* Adjust primitive index to point to the triangle in the global array, for
    * geometry with transform applied and already in the top level BVH.
    */
@@ -488,6 +539,10 @@ void BVH::pack_instances(size_t nodes_size, size_t leaf_nodes_size)
           nsize = BVH_UNALIGNED_NODE_SIZE;
           nsize_bbox = 0;
         }
+        else if (bvh_nodes[i].x & PATH_RAY_NODE_COMPRESSED) {
+          nsize = BVH_COMPRESSED_NODE_SIZE;
+          nsize_bbox = 0;
+        }
         else {
           nsize = BVH_NODE_SIZE;
           nsize_bbox = 0;
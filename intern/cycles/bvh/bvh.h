@@ -102,11 +102,20 @@ class BVH {
 
   void refit(Progress &progress);
 
+  /* Remove the instance BVHs merged into a top level BVH from the packed arrays,
+   * keeping only the data needed to refit it. Instances are merged again on refit. */
+  void discard_instances();
+
  protected:
   BVH(const BVHParams &params,
       const vector<Geometry *> &geometry,
       const vector<Object *> &objects);
 
+  /* Size of the top level part of the packed arrays, before instances are merged in. */
+  size_t top_level_nodes_size;
+  size_t top_level_leaf_nodes_size;
+  size_t top_level_prims_size;
+
   /* Refit range of primitives. */
   void refit_primitives(int start, int end, BoundBox &bbox, uint &visibility);
 
@@ -23,6 +23,8 @@
 #include "bvh/bvh_node.h"
 #include "bvh/bvh_unaligned.h"
 
+#include "util/util_tbb.h"
+
 CCL_NAMESPACE_BEGIN
 
 BVH2::BVH2(const BVHParams &params_,
@@ -74,13 +76,24 @@ void BVH2::pack_aligned_inner(const BVHStackEntry &e,
                               const BVHStackEntry &e0,
                               const BVHStackEntry &e1)
 {
-  pack_aligned_node(e.idx,
-                    e0.node->bounds,
-                    e1.node->bounds,
-                    e0.encodeIdx(),
-                    e1.encodeIdx(),
-                    e0.node->visibility,
-                    e1.node->visibility);
+  if (params.use_compressed_nodes) {
+    pack_compressed_node(e.idx,
+                         e0.node->bounds,
+                         e1.node->bounds,
+                         e0.encodeIdx(),
+                         e1.encodeIdx(),
+                         e0.node->visibility,
+                         e1.node->visibility);
+  }
+  else {
+    pack_aligned_node(e.idx,
+                      e0.node->bounds,
+                      e1.node->bounds,
+                      e0.encodeIdx(),
+                      e1.encodeIdx(),
+                      e0.node->visibility,
+                      e1.node->visibility);
+  }
 }
 
 void BVH2::pack_aligned_node(int idx,
@@ -96,8 +109,10 @@ void BVH2::pack_aligned_node(int idx,
   assert(c1 < 0 || c1 < pack.nodes.size());
 
   int4 data[BVH_NODE_SIZE] = {
-      make_int4(
-          visibility0 & ~PATH_RAY_NODE_UNALIGNED, visibility1 & ~PATH_RAY_NODE_UNALIGNED, c0, c1),
+      make_int4(visibility0 & ~(PATH_RAY_NODE_UNALIGNED | PATH_RAY_NODE_COMPRESSED),
+                visibility1 & ~(PATH_RAY_NODE_UNALIGNED | PATH_RAY_NODE_COMPRESSED),
+                c0,
+                c1),
       make_int4(__float_as_int(b0.min.x),
                 __float_as_int(b1.min.x),
                 __float_as_int(b0.max.x),
@@ -115,6 +130,84 @@ void BVH2::pack_aligned_node(int idx,
   memcpy(&pack.nodes[idx], data, sizeof(int4) * BVH_NODE_SIZE);
 }
 
+/* Smallest power of two exponent for the quantization scale, so that 255 steps cover
+ * the extent of the parent bounds. The range is that of normalized floats. */
+static int bvh_quantize_exponent(const float extent)
+{
+  int exponent;
+  frexpf(extent / 255.0f, &exponent);
+  return clamp(exponent, -126, 127);
+}
+
+/* Quantize conservatively, rounding the lower bounds down and the upper bounds up,
+ * including the rounding of the dequantization in the kernel. */
+uint bvh_quantize_lower(const float value, const float origin, const float scale)
+{
+  float q = clamp(floorf((value - origin) / scale), 0.0f, 255.0f);
+  while (q > 0.0f && origin + q * scale > value) {
+    q -= 1.0f;
+  }
+  return (uint)q;
+}
+
+uint bvh_quantize_upper(const float value, const float origin, const float scale)
+{
+  float q = clamp(ceilf((value - origin) / scale), 0.0f, 255.0f);
+  while (q < 255.0f && origin + q * scale < value) {
+    q += 1.0f;
+  }
+  return (uint)q;
+}
+
+void BVH2::pack_compressed_node(int idx,
+                                const BoundBox &b0,
+                                const BoundBox &b1,
+                                int c0,
+                                int c1,
+                                uint visibility0,
+                                uint visibility1)
+{
+  assert(idx + BVH_COMPRESSED_NODE_SIZE <= pack.nodes.size());
+  assert(c0 < 0 || c0 < pack.nodes.size());
+  assert(c1 < 0 || c1 < pack.nodes.size());
+
+  /* Child bounds are stored relative to the parent bounds. */
+  BoundBox bounds = merge(b0, b1);
+  if (!bounds.valid()) {
+    bounds = BoundBox(make_float3(0.0f, 0.0f, 0.0f));
+  }
+  const float3 origin = bounds.min;
+  const float3 extent = bounds.max - bounds.min;
+
+  uint exponents = 0;
+  uint quantized[3];
+  for (int axis = 0; axis < 3; axis++) {
+    const int exponent = bvh_quantize_exponent(extent[axis]);
+    const float scale = ldexpf(1.0f, exponent);
+    exponents |= (uint)(exponent + 127) << (axis * 8);
+
+    /* Same order as the bounds of aligned nodes. */
+    quantized[axis] = bvh_quantize_lower(b0.min[axis], origin[axis], scale) |
+                      (bvh_quantize_lower(b1.min[axis], origin[axis], scale) << 8) |
+                      (bvh_quantize_upper(b0.max[axis], origin[axis], scale) << 16) |
+                      (bvh_quantize_upper(b1.max[axis], origin[axis], scale) << 24);
+  }
+
+  int4 data[BVH_COMPRESSED_NODE_SIZE] = {
+      make_int4((visibility0 & ~PATH_RAY_NODE_UNALIGNED) | PATH_RAY_NODE_COMPRESSED,
+                (visibility1 & ~PATH_RAY_NODE_UNALIGNED) | PATH_RAY_NODE_COMPRESSED,
+                c0,
+                c1),
+      make_int4(__float_as_int(origin.x),
+                __float_as_int(origin.y),
+                __float_as_int(origin.z),
+                (int)exponents),
+      make_int4((int)quantized[0], (int)quantized[1], (int)quantized[2], 0),
+  };
+
+  memcpy(&pack.nodes[idx], data, sizeof(int4) * BVH_COMPRESSED_NODE_SIZE);
+}
+
 void BVH2::pack_unaligned_inner(const BVHStackEntry &e,
                                 const BVHStackEntry &e0,
                                 const BVHStackEntry &e1)
@@ -147,8 +240,9 @@ void BVH2::pack_unaligned_node(int idx,
   float4 data[BVH_UNALIGNED_NODE_SIZE];
   Transform space0 = BVHUnaligned::compute_node_transform(bounds0, aligned_space0);
   Transform space1 = BVHUnaligned::compute_node_transform(bounds1, aligned_space1);
-  data[0] = make_float4(__int_as_float(visibility0 | PATH_RAY_NODE_UNALIGNED),
-                        __int_as_float(visibility1 | PATH_RAY_NODE_UNALIGNED),
+  data[0] = make_float4(
+      __int_as_float((visibility0 & ~PATH_RAY_NODE_COMPRESSED) | PATH_RAY_NODE_UNALIGNED),
+      __int_as_float((visibility1 & ~PATH_RAY_NODE_COMPRESSED) | PATH_RAY_NODE_UNALIGNED),
                         __int_as_float(c0),
                         __int_as_float(c1));
 
@@ -168,14 +262,16 @@ void BVH2::pack_nodes(const BVHNode *root)
   const size_t num_leaf_nodes = root->getSubtreeSize(BVH_STAT_LEAF_COUNT);
   assert(num_leaf_nodes <= num_nodes);
   const size_t num_inner_nodes = num_nodes - num_leaf_nodes;
+  const int aligned_node_size = (params.use_compressed_nodes) ? BVH_COMPRESSED_NODE_SIZE :
+                                                                BVH_NODE_SIZE;
   size_t node_size;
   if (params.use_unaligned_nodes) {
     const size_t num_unaligned_nodes = root->getSubtreeSize(BVH_STAT_UNALIGNED_INNER_COUNT);
     node_size = (num_unaligned_nodes * BVH_UNALIGNED_NODE_SIZE) +
-                (num_inner_nodes - num_unaligned_nodes) * BVH_NODE_SIZE;
+                (num_inner_nodes - num_unaligned_nodes) * aligned_node_size;
   }
   else {
-    node_size = num_inner_nodes * BVH_NODE_SIZE;
+    node_size = num_inner_nodes * aligned_node_size;
   }
   /* Resize arrays */
   pack.nodes.clear();
@@ -198,7 +294,7 @@ void BVH2::pack_nodes(const BVHNode *root)
   }
   else {
     stack.push_back(BVHStackEntry(root, nextNodeIdx));
-    nextNodeIdx += root->has_unaligned() ? BVH_UNALIGNED_NODE_SIZE : BVH_NODE_SIZE;
+    nextNodeIdx += root->has_unaligned() ? BVH_UNALIGNED_NODE_SIZE : aligned_node_size;
   }
 
   while (stack.size()) {
@@ -220,7 +316,7 @@ void BVH2::pack_nodes(const BVHNode *root)
         else {
           idx[i] = nextNodeIdx;
           nextNodeIdx += e.node->get_child(i)->has_unaligned() ? BVH_UNALIGNED_NODE_SIZE :
-                                                                 BVH_NODE_SIZE;
+                                                                 aligned_node_size;
         }
       }
 
@@ -235,16 +331,18 @@ void BVH2::pack_nodes(const BVHNode *root)
   pack.root_index = (root->is_leaf()) ? -1 : 0;
 }
 
+/* Children of inner nodes above this depth are refitted in parallel. Deeper down there are
+ * enough subtrees to keep all threads busy. */
+static const int BVH2_REFIT_PARALLEL_DEPTH = 8;
+
 void BVH2::refit_nodes()
 {
-  assert(!params.top_level);
-
   BoundBox bbox = BoundBox::empty;
   uint visibility = 0;
-  refit_node(0, (pack.root_index == -1) ? true : false, bbox, visibility);
+  refit_node(0, (pack.root_index == -1) ? true : false, 0, bbox, visibility);
 }
 
-void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
+void BVH2::refit_node(int idx, bool leaf, int depth, BoundBox &bbox, uint &visibility)
 {
   if (leaf) {
     /* refit leaf node */
@@ -253,7 +351,13 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     const int c0 = data[0].x;
     const int c1 = data[0].y;
 
-    BVH::refit_primitives(c0, c1, bbox, visibility);
+    if (c0 < 0) {
+      /* Object instance in top level BVH. */
+      BVH::refit_primitives(~c0, ~c0 + 1, bbox, visibility);
+    }
+    else {
+      BVH::refit_primitives(c0, c1, bbox, visibility);
+    }
 
     /* TODO(sergey): De-duplicate with pack_leaf(). */
     float4 leaf_data[BVH_NODE_LEAF_SIZE];
@@ -264,24 +368,35 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     memcpy(&pack.leaf_nodes[idx], leaf_data, sizeof(float4) * BVH_NODE_LEAF_SIZE);
   }
   else {
-    assert(idx + BVH_NODE_SIZE <= pack.nodes.size());
+    assert(idx + BVH_COMPRESSED_NODE_SIZE <= pack.nodes.size());
 
     const int4 *data = &pack.nodes[idx];
     const bool is_unaligned = (data[0].x & PATH_RAY_NODE_UNALIGNED) != 0;
+    const bool is_compressed = (data[0].x & PATH_RAY_NODE_COMPRESSED) != 0;
     const int c0 = data[0].z;
     const int c1 = data[0].w;
     /* refit inner node, set bbox from children */
     BoundBox bbox0 = BoundBox::empty, bbox1 = BoundBox::empty;
     uint visibility0 = 0, visibility1 = 0;
 
-    refit_node((c0 < 0) ? -c0 - 1 : c0, (c0 < 0), bbox0, visibility0);
-    refit_node((c1 < 0) ? -c1 - 1 : c1, (c1 < 0), bbox1, visibility1);
+    if (depth < BVH2_REFIT_PARALLEL_DEPTH) {
+      parallel_invoke(
+          [&] { refit_node((c0 < 0) ? -c0 - 1 : c0, (c0 < 0), depth + 1, bbox0, visibility0); },
+          [&] { refit_node((c1 < 0) ? -c1 - 1 : c1, (c1 < 0), depth + 1, bbox1, visibility1); });
+    }
+    else {
+      refit_node((c0 < 0) ? -c0 - 1 : c0, (c0 < 0), depth + 1, bbox0, visibility0);
+      refit_node((c1 < 0) ? -c1 - 1 : c1, (c1 < 0), depth + 1, bbox1, visibility1);
+    }
 
     if (is_unaligned) {
       Transform aligned_space = transform_identity();
       pack_unaligned_node(
           idx, aligned_space, aligned_space, bbox0, bbox1, c0, c1, visibility0, visibility1);
     }
+    else if (is_compressed) {
+      pack_compressed_node(idx, bbox0, bbox1, c0, c1, visibility0, visibility1);
+    }
     else {
       pack_aligned_node(idx, bbox0, bbox1, c0, c1, visibility0, visibility1);
     }
@@ -37,6 +37,11 @@ class Progress;
 #define BVH_NODE_SIZE 4
 #define BVH_NODE_LEAF_SIZE 1
 #define BVH_UNALIGNED_NODE_SIZE 7
+#define BVH_COMPRESSED_NODE_SIZE 3
+
+/* Quantize a bound of a child node relative to the parent origin, for compressed nodes. */
+uint bvh_quantize_lower(const float value, const float origin, const float scale);
+uint bvh_quantize_upper(const float value, const float origin, const float scale);
 
 /* BVH2
  *
@@ -69,6 +74,13 @@ class BVH2 : public BVH {
                          int c1,
                          uint visibility0,
                          uint visibility1);
+  void pack_compressed_node(int idx,
+                            const BoundBox &b0,
+                            const BoundBox &b1,
+                            int c0,
+                            int c1,
+                            uint visibility0,
+                            uint visibility1);
 
   void pack_unaligned_inner(const BVHStackEntry &e,
                             const BVHStackEntry &e0,
@@ -85,7 +97,7 @@ class BVH2 : public BVH {
 
   /* refit */
   void refit_nodes() override;
-  void refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility);
+  void refit_node(int idx, bool leaf, int depth, BoundBox &bbox, uint &visibility);
 };
 
 CCL_NAMESPACE_END
@@ -74,6 +74,12 @@ class BVHParams {
    */
   bool use_unaligned_nodes;
 
+  /* Store aligned inner nodes with child bounds quantized to 8 bits relative
+   * to the parent bounds, to reduce memory usage.
+   * Only used for BVH2.
+   */
+  bool use_compressed_nodes;
+
   /* Split time range to this number of steps and create leaf node for each
    * of this time steps.
    *
@@ -115,6 +121,7 @@ class BVHParams {
     top_level = false;
     bvh_layout = BVH_LAYOUT_BVH2;
     use_unaligned_nodes = false;
+    use_compressed_nodes = false;
 
     num_motion_curve_steps = 0;
     num_motion_triangle_steps = 0;
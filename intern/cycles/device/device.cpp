@@ -399,7 +399,9 @@ Device *Device::create(DeviceInfo &info, Stats &stats, Profiler &profiler, bool
 #endif
 #ifdef WITH_NETWORK
     case DEVICE_NETWORK:
-      device = device_network_create(info, stats, profiler, "127.0.0.1");
+      /* Identifier is "NETWORK_" followed by the server address. */
+      device = device_network_create(
+          info, stats, profiler, info.id.c_str() + strlen("NETWORK_"));
       break;
 #endif
 #ifdef WITH_OPENCL
@@ -192,10 +192,13 @@ class CPUDevice : public Device {
 #endif
 
   bool use_split_kernel;
+  bool use_ray_packets;
 
   DeviceRequestedFeatures requested_features;
 
   KernelFunctions<void (*)(KernelGlobals *, float *, int, int, int, int, int)> path_trace_kernel;
+  KernelFunctions<void (*)(KernelGlobals *, float *, int, int, int, int, int, int)>
+      path_trace_packet_kernel;
   KernelFunctions<void (*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)>
       convert_to_half_float_kernel;
   KernelFunctions<void (*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)>
@@ -282,6 +285,7 @@ class CPUDevice : public Device {
         texture_info(this, "__texture_info", MEM_GLOBAL),
 #define REGISTER_KERNEL(name) name##_kernel(KERNEL_FUNCTIONS(name))
         REGISTER_KERNEL(path_trace),
+        REGISTER_KERNEL(path_trace_packet),
         REGISTER_KERNEL(convert_to_half_float),
         REGISTER_KERNEL(convert_to_byte),
         REGISTER_KERNEL(shader),
@@ -316,6 +320,10 @@ class CPUDevice : public Device {
     if (use_split_kernel) {
       VLOG(1) << "Will be using split kernel.";
     }
+    use_ray_packets = DebugFlags().cpu.ray_packets;
+    if (use_ray_packets) {
+      VLOG(1) << "Will be tracing camera rays in packets.";
+    }
     need_texture_info = false;
 
 #define REGISTER_SPLIT_KERNEL(name) \
@@ -888,6 +896,11 @@ class CPUDevice : public Device {
 
   void adaptive_sampling_post(const RenderTile &tile, KernelGlobals *kg)
   {
+    /* Samples are counted from the start of the rendered sample range. */
+    const int range_start_sample = kernel_data.integrator.start_sample;
+    const float sample = tile.sample - range_start_sample;
+    const float start_sample = tile.start_sample - range_start_sample;
+
     float *render_buffer = (float *)tile.buffer;
     for (int y = tile.y; y < tile.y + tile.h; y++) {
       for (int x = tile.x; x < tile.x + tile.w; x++) {
@@ -895,14 +908,14 @@ class CPUDevice : public Device {
         ccl_global float *buffer = render_buffer + index * kernel_data.film.pass_stride;
         if (buffer[kernel_data.film.pass_sample_count] < 0.0f) {
           buffer[kernel_data.film.pass_sample_count] = -buffer[kernel_data.film.pass_sample_count];
-          float sample_multiplier = tile.sample / max((float)tile.start_sample + 1.0f,
-                                                      buffer[kernel_data.film.pass_sample_count]);
+          float sample_multiplier = sample / max(start_sample + 1.0f,
+                                                 buffer[kernel_data.film.pass_sample_count]);
           if (sample_multiplier != 1.0f) {
             kernel_adaptive_post_adjust(kg, buffer, sample_multiplier);
           }
         }
         else {
-          kernel_adaptive_post_adjust(kg, buffer, tile.sample / (tile.sample - 1.0f));
+          kernel_adaptive_post_adjust(kg, buffer, sample / (sample - 1.0f));
         }
       }
     }
@@ -932,7 +945,17 @@ class CPUDevice : public Device {
           break;
       }
 
-      if (tile.task == RenderTile::PATH_TRACE) {
+      if (tile.task == RenderTile::PATH_TRACE && use_ray_packets && !use_coverage) {
+        /* Trace camera rays of neighboring pixels in a row together. */
+        for (int y = tile.y; y < tile.y + tile.h; y++) {
+          for (int x = tile.x; x < tile.x + tile.w; x += BVH_PACKET_SIZE) {
+            const int num_pixels = min(BVH_PACKET_SIZE, tile.x + tile.w - x);
+            path_trace_packet_kernel()(
+                kg, render_buffer, sample, x, y, num_pixels, tile.offset, tile.stride);
+          }
+        }
+      }
+      else if (tile.task == RenderTile::PATH_TRACE) {
         for (int y = tile.y; y < tile.y + tile.h; y++) {
           for (int x = tile.x; x < tile.x + tile.w; x++) {
             if (use_coverage) {
@@ -168,6 +168,8 @@ device_texture::device_texture(Device *device,
     case IMAGE_DATA_TYPE_BYTE:
     case IMAGE_DATA_TYPE_NANOVDB_FLOAT:
     case IMAGE_DATA_TYPE_NANOVDB_FLOAT3:
+    case IMAGE_DATA_TYPE_SPARSE_FLOAT:
+    case IMAGE_DATA_TYPE_SPARSE_FLOAT4:
       data_type = TYPE_UCHAR;
       data_elements = 1;
       break;
@@ -19,7 +19,6 @@
 
 #include "device/device.h"
 #include "device/device_intern.h"
-#include "device/device_network.h"
 
 #include "render/buffers.h"
 
@@ -27,7 +26,6 @@
 #include "util/util_list.h"
 #include "util/util_logging.h"
 #include "util/util_map.h"
-#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -117,20 +115,6 @@ class MultiDevice : public Device {
         }
       }
     }
-
-#ifdef WITH_NETWORK
-    /* try to add network devices */
-    ServerDiscovery discovery(true);
-    time_sleep(1.0);
-
-    vector<string> servers = discovery.get_server_list();
-
-    foreach (string &server, servers) {
-      Device *device = device_network_create(info, stats, profiler, server.c_str());
-      if (device)
-        devices.push_back(SubDevice(device));
-    }
-#endif
   }
 
   ~MultiDevice()
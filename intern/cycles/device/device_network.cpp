@@ -20,6 +20,10 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_set.h"
+#include "util/util_thread.h"
+#include "util/util_time.h"
+#include "util/util_unique_ptr.h"
 
 #if defined(WITH_NETWORK)
 
@@ -36,11 +40,40 @@ typedef vector<RenderTile> TileList;
 static TileList::iterator tile_list_find(TileList &tile_list, RenderTile &tile)
 {
   for (TileList::iterator it = tile_list.begin(); it != tile_list.end(); ++it)
-    if (tile.x == it->x && tile.y == it->y && tile.start_sample == it->start_sample)
+    if (tile.x == it->x && tile.y == it->y && tile.start_sample == it->start_sample &&
+        tile.buffer == it->buffer)
       return it;
   return tile_list.end();
 }
 
+/* Index of the first float of a row of a tile in its render buffer. */
+static size_t tile_row_index(const RenderTile &tile, int y, int pass_stride)
+{
+  return (size_t)(tile.offset + tile.x + (tile.y + y) * tile.stride) * pass_stride;
+}
+
+/* Network device addresses are "host[:port]", split them into host and port. */
+static void network_address_split(const string &address, string &host, string &port)
+{
+  size_t pos = address.rfind(':');
+
+  if (pos == string::npos) {
+    host = address;
+    port = string_printf("%d", SERVER_PORT);
+  }
+  else {
+    host = address.substr(0, pos);
+    port = address.substr(pos + 1);
+  }
+}
+
+/* Client side of a render server connection.
+ *
+ * Every server renders the tiles it acquires independently and pushes the
+ * results back when releasing them, so multiple network devices can render in
+ * parallel as sub-devices of a multi device. While a task runs, a service
+ * thread is the only reader of the socket and answers the tile requests of the
+ * server, other calls only send. */
 class NetworkDevice : public Device {
  public:
   boost::asio::io_service io_service;
@@ -50,37 +83,47 @@ class NetworkDevice : public Device {
 
   thread_mutex rpc_lock;
 
+  /* Thread serving tile requests of the server while a task runs. */
+  thread *task_thread;
+
+  /* Tiles acquired by the server, and the render buffers that tile results are
+   * written to directly when the server releases them. */
+  thread_mutex tile_lock;
+  TileList the_tiles;
+  set<device_ptr> tile_buffers;
+
   virtual bool show_samples() const
   {
     return false;
   }
 
   NetworkDevice(DeviceInfo &info, Stats &stats, Profiler &profiler, const char *address)
-      : Device(info, stats, profiler, true), socket(io_service)
+      : Device(info, stats, profiler, true), socket(io_service), task_thread(NULL)
   {
-    error_func = NetworkError();
-    stringstream portstr;
-    portstr << SERVER_PORT;
+    string host, port;
+    network_address_split(address, host, port);
 
     tcp::resolver resolver(io_service);
-    tcp::resolver::query query(address, portstr.str());
-    tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
+    tcp::resolver::query query(host, port);
+    boost::system::error_code error = boost::asio::error::host_not_found;
+    tcp::resolver::iterator endpoint_iterator = resolver.resolve(query, error);
     tcp::resolver::iterator end;
 
-    boost::system::error_code error = boost::asio::error::host_not_found;
     while (error && endpoint_iterator != end) {
       socket.close();
       socket.connect(*endpoint_iterator++, error);
     }
 
     if (error)
-      error_func.network_error(error.message());
+      error_func.network_error(string_printf("%s: %s", address, error.message().c_str()));
 
     mem_counter = 0;
   }
 
   ~NetworkDevice()
   {
+    task_wait();
+
     RPCSend snd(socket, &error_func, "stop");
     snd.write();
   }
@@ -90,6 +133,13 @@ class NetworkDevice : public Device {
     return BVH_LAYOUT_BVH2;
   }
 
+  const string &error_message()
+  {
+    if (error_func.have_error() && error_msg.empty())
+      error_msg = error_func.error_message();
+    return error_msg;
+  }
+
   void mem_alloc(device_memory &mem)
   {
     if (mem.name) {
@@ -100,7 +150,7 @@ class NetworkDevice : public Device {
 
     thread_scoped_lock lock(rpc_lock);
 
-    mem.device_pointer = ++mem_counter;
+    mem_pointer_assign(mem);
 
     RPCSend snd(socket, &error_func, "mem_alloc");
     snd.add(mem);
@@ -111,6 +161,8 @@ class NetworkDevice : public Device {
   {
     thread_scoped_lock lock(rpc_lock);
 
+    mem_pointer_assign(mem);
+
     RPCSend snd(socket, &error_func, "mem_copy_to");
 
     snd.add(mem);
@@ -120,6 +172,15 @@ class NetworkDevice : public Device {
 
   void mem_copy_from(device_memory &mem, int y, int w, int h, int elem)
   {
+    {
+      /* Render results were already written to the buffer on tile release. */
+      thread_scoped_lock tile_buffers_lock(tile_lock);
+      if (tile_buffers.find(mem.device_pointer) != tile_buffers.end())
+        return;
+    }
+
+    /* Only valid while no task is running, replies are read by the service
+     * thread otherwise. */
     thread_scoped_lock lock(rpc_lock);
 
     size_t data_size = mem.memory_size();
@@ -141,6 +202,8 @@ class NetworkDevice : public Device {
   {
     thread_scoped_lock lock(rpc_lock);
 
+    mem_pointer_assign(mem);
+
     RPCSend snd(socket, &error_func, "mem_zero");
 
     snd.add(mem);
@@ -150,6 +213,11 @@ class NetworkDevice : public Device {
   void mem_free(device_memory &mem)
   {
     if (mem.device_pointer) {
+      {
+        thread_scoped_lock tile_buffers_lock(tile_lock);
+        tile_buffers.erase(mem.device_pointer);
+      }
+
       thread_scoped_lock lock(rpc_lock);
 
       RPCSend snd(socket, &error_func, "mem_free");
@@ -158,6 +226,8 @@ class NetworkDevice : public Device {
       snd.write();
 
       mem.device_pointer = 0;
+      stats.mem_free(mem.device_size);
+      mem.device_size = 0;
     }
   }
 
@@ -183,13 +253,10 @@ class NetworkDevice : public Device {
     thread_scoped_lock lock(rpc_lock);
 
     RPCSend snd(socket, &error_func, "load_kernels");
-    snd.add(requested_features.experimental);
-    snd.add(requested_features.max_closure);
-    snd.add(requested_features.max_nodes_group);
-    snd.add(requested_features.nodes_features);
+    snd.add(requested_features);
     snd.write();
 
-    bool result;
+    bool result = false;
     RPCReceive rcv(socket, &error_func);
     rcv.read(result);
 
@@ -198,6 +265,9 @@ class NetworkDevice : public Device {
 
   void task_add(DeviceTask &task)
   {
+    /* Finish serving the previous task first. */
+    task_wait();
+
     thread_scoped_lock lock(rpc_lock);
 
     the_task = task;
@@ -205,89 +275,142 @@ class NetworkDevice : public Device {
     RPCSend snd(socket, &error_func, "task_add");
     snd.add(task);
     snd.write();
+
+    /* The server starts rendering right away and notifies when done. */
+    RPCSend snd_wait(socket, &error_func, "task_wait");
+    snd_wait.write();
+
+    task_thread = new thread(function_bind(&NetworkDevice::task_run, this));
   }
 
   void task_wait()
   {
-    thread_scoped_lock lock(rpc_lock);
+    if (task_thread) {
+      task_thread->join();
+      delete task_thread;
+      task_thread = NULL;
+    }
+  }
 
-    RPCSend snd(socket, &error_func, "task_wait");
+  void task_cancel()
+  {
+    thread_scoped_lock lock(rpc_lock);
+    RPCSend snd(socket, &error_func, "task_cancel");
     snd.write();
+  }
 
-    lock.unlock();
+  int get_split_task_count(DeviceTask &)
+  {
+    return 1;
+  }
 
-    TileList the_tiles;
+ protected:
+  /* Assign a client side pointer to memory on first use, the server maps it to
+   * its own allocation. */
+  void mem_pointer_assign(device_memory &mem)
+  {
+    if (!mem.device_pointer) {
+      mem.device_pointer = ++mem_counter;
+    }
+    else {
+      stats.mem_free(mem.device_size);
+    }
+
+    mem.device_size = mem.memory_size();
+    stats.mem_alloc(mem.device_size);
+  }
 
-    /* todo: run this threaded for connecting to multiple clients */
+  void task_run()
+  {
     for (;;) {
       if (error_func.have_error())
         break;
 
-      RenderTile tile;
-
-      lock.lock();
       RPCReceive rcv(socket, &error_func);
 
       if (rcv.name == "acquire_tile") {
-        lock.unlock();
-
-        /* todo: watch out for recursive calls! */
-        if (the_task.acquire_tile(this, tile)) { /* write return as bool */
-          the_tiles.push_back(tile);
-
-          lock.lock();
+        uint tile_types;
+        rcv.read(tile_types);
+
+        RenderTile tile;
+        if (the_task.acquire_tile(this, tile, tile_types)) {
+          /* Remember the tile to release it, and the pass stride of its buffer
+           * so the server knows the layout of the results to send back. */
+          int pass_stride = tile.buffers->params.get_passes_size();
+
+          {
+            thread_scoped_lock tile_buffers_lock(tile_lock);
+            the_tiles.push_back(tile);
+            tile_buffers.insert(tile.buffer);
+          }
+
+          thread_scoped_lock lock(rpc_lock);
           RPCSend snd(socket, &error_func, "acquire_tile");
           snd.add(tile);
+          snd.add(pass_stride);
           snd.write();
-          lock.unlock();
         }
         else {
-          lock.lock();
+          thread_scoped_lock lock(rpc_lock);
           RPCSend snd(socket, &error_func, "acquire_tile_none");
           snd.write();
-          lock.unlock();
         }
       }
       else if (rcv.name == "release_tile") {
+        RenderTile tile;
+        int pass_stride;
         rcv.read(tile);
-        lock.unlock();
+        rcv.read(pass_stride);
+
+        /* Rows are written with the geometry of the acquired tile, so a peer can't write
+         * outside of the render buffer. */
+        RenderTile acquired;
+        {
+          thread_scoped_lock tile_buffers_lock(tile_lock);
+          TileList::iterator it = tile_list_find(the_tiles, tile);
+          if (it != the_tiles.end()) {
+            acquired = *it;
+            the_tiles.erase(it);
+          }
+        }
 
-        TileList::iterator it = tile_list_find(the_tiles, tile);
-        if (it != the_tiles.end()) {
-          tile.buffers = it->buffers;
-          the_tiles.erase(it);
+        if (acquired.buffers == NULL) {
+          error_func.network_error("Network receive error: release of unknown tile");
+          break;
         }
 
-        assert(tile.buffers != NULL);
+        if (tile.w != acquired.w || tile.h != acquired.h || tile.offset != acquired.offset ||
+            tile.stride != acquired.stride ||
+            pass_stride != acquired.buffers->params.get_passes_size()) {
+          error_func.network_error("Network receive error: released tile doesn't match");
+          break;
+        }
 
-        the_task.release_tile(tile);
+        tile.w = acquired.w;
+        tile.h = acquired.h;
+        tile.offset = acquired.offset;
+        tile.stride = acquired.stride;
+        tile.buffers = acquired.buffers;
+        pass_stride = acquired.buffers->params.get_passes_size();
+
+        /* Read results straight into the render buffer, row by row. */
+        float *buffer = (float *)tile.buffers->buffer.host_pointer;
+        for (int y = 0; y < tile.h; y++) {
+          rcv.read_buffer(buffer + tile_row_index(tile, y, pass_stride),
+                          sizeof(float) * tile.w * pass_stride);
+        }
 
-        lock.lock();
-        RPCSend snd(socket, &error_func, "release_tile");
-        snd.write();
-        lock.unlock();
+        if (the_task.update_progress_sample) {
+          the_task.update_progress_sample((long)tile.w * tile.h * tile.num_samples, tile.sample);
+        }
+        the_task.release_tile(tile);
       }
       else if (rcv.name == "task_wait_done") {
-        lock.unlock();
         break;
       }
-      else
-        lock.unlock();
     }
   }
 
-  void task_cancel()
-  {
-    thread_scoped_lock lock(rpc_lock);
-    RPCSend snd(socket, &error_func, "task_cancel");
-    snd.write();
-  }
-
-  int get_split_task_count(DeviceTask &)
-  {
-    return 1;
-  }
-
  private:
   NetworkError error_func;
 };
@@ -302,26 +425,49 @@ Device *device_network_create(DeviceInfo &info,
 
 void device_network_info(vector<DeviceInfo> &devices)
 {
-  DeviceInfo info;
+  /* Servers are listed as "host[:port]" separated by commas. Discovery on the
+   * local network blocks for a while, so it is only done when requested. */
+  vector<string> servers;
+  const char *servers_env = getenv("CYCLES_NETWORK_SERVERS");
 
-  info.type = DEVICE_NETWORK;
-  info.description = "Network Device";
-  info.id = "NETWORK";
-  info.num = 0;
+  if (servers_env) {
+    string_split(servers, servers_env, ", ");
+  }
+  else if (getenv("CYCLES_NETWORK_DISCOVER")) {
+    ServerDiscovery discovery(true);
+    time_sleep(1.0);
+    servers = discovery.get_server_list();
+  }
+
+  if (servers.empty()) {
+    servers.push_back("127.0.0.1");
+  }
+
+  for (size_t i = 0; i < servers.size(); i++) {
+    DeviceInfo info;
 
-  /* todo: get this info from device */
-  info.has_volume_decoupled = false;
-  info.has_adaptive_stop_per_sample = false;
-  info.has_osl = false;
-  info.denoisers = DENOISER_NONE;
+    info.type = DEVICE_NETWORK;
+    info.description = "Network Device (" + servers[i] + ")";
+    info.id = "NETWORK_" + servers[i];
+    info.num = i;
 
-  devices.push_back(info);
+    /* todo: get this info from device */
+    info.has_volume_decoupled = false;
+    info.has_adaptive_stop_per_sample = false;
+    info.has_osl = false;
+    info.denoisers = DENOISER_NONE;
+
+    devices.push_back(info);
+  }
 }
 
+/* Server side of a client connection.
+ *
+ * The listening thread keeps receiving calls from the client while a task
+ * renders, and hands replies to tile requests over to the render threads.
+ * Sends from the different threads are serialized with the send lock. */
 class DeviceServer {
  public:
-  thread_mutex rpc_lock;
-
   void network_error(const string &message)
   {
     error_func.network_error(message);
@@ -333,34 +479,41 @@ class DeviceServer {
   }
 
   DeviceServer(Device *device_, tcp::socket &socket_)
-      : device(device_), socket(socket_), stop(false), blocked_waiting(false)
+      : device(device_), socket(socket_), stop(false), cancel(false), wait_thread(NULL)
   {
-    error_func = NetworkError();
+  }
+
+  ~DeviceServer()
+  {
+    task_wait_join();
   }
 
   void listen()
   {
     /* receive remote function calls */
-    for (;;) {
-      listen_step();
+    while (!stop && !have_error()) {
+      RPCReceive rcv(socket, &error_func);
 
-      if (stop)
-        break;
+      if (rcv.name == "stop")
+        stop = true;
+      else if (!have_error())
+        process(rcv);
     }
-  }
-
- protected:
-  void listen_step()
-  {
-    thread_scoped_lock lock(rpc_lock);
-    RPCReceive rcv(socket, &error_func);
 
-    if (rcv.name == "stop")
+    /* Wake up render threads waiting for tiles, and finish the task. */
+    {
+      thread_scoped_lock queue_lock(acquire_queue_mutex);
       stop = true;
-    else
-      process(rcv, lock);
+      acquire_queue_cond.notify_all();
+    }
+
+    if (have_error())
+      device->task_cancel();
+
+    task_wait_join();
   }
 
+ protected:
   /* create a memory buffer for a device buffer and insert it into mem_data */
   DataVector &data_vector_insert(device_ptr client_pointer, size_t data_size)
   {
@@ -401,48 +554,91 @@ class DeviceServer {
     assert(mapins.second);
   }
 
-  device_ptr device_ptr_from_client_pointer(device_ptr client_pointer)
+  void pointer_mapping_erase(device_ptr client_pointer)
   {
     PtrMap::iterator i = ptr_map.find(client_pointer);
     assert(i != ptr_map.end());
-    return i->second;
+
+    /* erase the reverse mapping */
+    PtrMap::iterator irev = ptr_imap.find(i->second);
+    assert(irev != ptr_imap.end());
+    ptr_imap.erase(irev);
+
+    /* erase the mapping */
+    ptr_map.erase(i);
   }
 
-  device_ptr device_ptr_from_client_pointer_erase(device_ptr client_pointer)
+  device_ptr device_ptr_from_client_pointer(device_ptr client_pointer)
   {
     PtrMap::iterator i = ptr_map.find(client_pointer);
     assert(i != ptr_map.end());
+    return i->second;
+  }
 
-    device_ptr result = i->second;
-
-    /* erase the mapping */
-    ptr_map.erase(i);
+  device_ptr device_ptr_from_client_pointer_erase(device_ptr client_pointer)
+  {
+    device_ptr result = device_ptr_from_client_pointer(client_pointer);
 
-    /* erase the reverse mapping */
-    PtrMap::iterator irev = ptr_imap.find(result);
-    assert(irev != ptr_imap.end());
-    ptr_imap.erase(irev);
+    pointer_mapping_erase(client_pointer);
 
     /* erase the data vector */
     DataMap::iterator idata = mem_data.find(client_pointer);
     assert(idata != mem_data.end());
     mem_data.erase(idata);
 
+    buffer_pass_stride.erase(client_pointer);
+
     return result;
   }
 
-  /* note that the lock must be already acquired upon entry.
-   * This is necessary because the caller often peeks at
-   * the header and delegates control to here when it doesn't
-   * specifically handle the current RPC.
-   * The lock must be unlocked before returning */
-  void process(RPCReceive &rcv, thread_scoped_lock &lock)
+  /* Point memory received from the client to the host side data buffer and
+   * real device pointer. The data buffer is allocated on first use, and memory
+   * changing size is freed on the device to be allocated again. Returns true
+   * if the memory has to be allocated on the device. */
+  bool mem_from_client(network_device_memory &mem, device_ptr client_pointer)
+  {
+    size_t data_size = mem.memory_size();
+    DataMap::iterator i = mem_data.find(client_pointer);
+
+    if (i == mem_data.end()) {
+      DataVector &data_v = data_vector_insert(client_pointer, data_size);
+      mem.host_pointer = (data_size) ? (void *)&data_v[0] : NULL;
+      mem.device_pointer = 0;
+      return true;
+    }
+
+    DataVector &data_v = i->second;
+    mem.host_pointer = (data_v.size()) ? (void *)&data_v[0] : NULL;
+    mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
+    mem.device_size = data_v.size();
+
+    if (data_v.size() == data_size) {
+      return false;
+    }
+
+    device->mem_free(mem);
+    pointer_mapping_erase(client_pointer);
+
+    data_v.resize(data_size);
+    mem.host_pointer = (data_size) ? (void *)&data_v[0] : NULL;
+    mem.device_pointer = 0;
+    return true;
+  }
+
+  void send_locked(RPCSend &snd)
+  {
+    thread_scoped_lock lock(send_mutex);
+    snd.write();
+  }
+
+  void process(RPCReceive &rcv)
   {
     if (rcv.name == "mem_alloc") {
       string name;
       network_device_memory mem(device);
       rcv.read(mem, name);
-      lock.unlock();
+
+      thread_scoped_lock lock(mem_mutex);
 
       /* Allocate host side data buffer. */
       size_t data_size = mem.memory_size();
@@ -450,6 +646,7 @@ class DeviceServer {
 
       DataVector &data_v = data_vector_insert(client_pointer, data_size);
       mem.host_pointer = (data_size) ? (void *)&(data_v[0]) : 0;
+      mem.device_pointer = 0;
 
       /* Perform the allocation on the actual device. */
       device->mem_alloc(mem);
@@ -461,32 +658,19 @@ class DeviceServer {
       string name;
       network_device_memory mem(device);
       rcv.read(mem, name);
-      lock.unlock();
-
-      size_t data_size = mem.memory_size();
-      device_ptr client_pointer = mem.device_pointer;
 
-      if (client_pointer) {
-        /* Lookup existing host side data buffer. */
-        DataVector &data_v = data_vector_find(client_pointer);
-        mem.host_pointer = (void *)&data_v[0];
+      thread_scoped_lock lock(mem_mutex);
 
-        /* Translate the client pointer to a real device pointer. */
-        mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
-      }
-      else {
-        /* Allocate host side data buffer. */
-        DataVector &data_v = data_vector_insert(client_pointer, data_size);
-        mem.host_pointer = (data_size) ? (void *)&(data_v[0]) : 0;
-      }
+      device_ptr client_pointer = mem.device_pointer;
+      bool allocate = mem_from_client(mem, client_pointer);
 
       /* Copy data from network into memory buffer. */
-      rcv.read_buffer((uint8_t *)mem.host_pointer, data_size);
+      rcv.read_buffer((uint8_t *)mem.host_pointer, mem.memory_size());
 
       /* Copy the data from the memory buffer to the device buffer. */
       device->mem_copy_to(mem);
 
-      if (!client_pointer) {
+      if (allocate) {
         /* Store a mapping to/from client_pointer and real device pointer. */
         pointer_mapping_insert(client_pointer, mem.device_pointer);
       }
@@ -502,49 +686,35 @@ class DeviceServer {
       rcv.read(h);
       rcv.read(elem);
 
+      thread_scoped_lock lock(mem_mutex);
+
       device_ptr client_pointer = mem.device_pointer;
       mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
 
       DataVector &data_v = data_vector_find(client_pointer);
-
-      mem.host_pointer = (device_ptr) & (data_v[0]);
+      mem.host_pointer = (void *)&(data_v[0]);
 
       device->mem_copy_from(mem, y, w, h, elem);
 
-      size_t data_size = mem.memory_size();
-
       RPCSend snd(socket, &error_func, "mem_copy_from");
+      thread_scoped_lock send_lock(send_mutex);
       snd.write();
-      snd.write_buffer((uint8_t *)mem.host_pointer, data_size);
-      lock.unlock();
+      snd.write_buffer((uint8_t *)mem.host_pointer, mem.memory_size());
     }
     else if (rcv.name == "mem_zero") {
       string name;
       network_device_memory mem(device);
       rcv.read(mem, name);
-      lock.unlock();
-
-      size_t data_size = mem.memory_size();
-      device_ptr client_pointer = mem.device_pointer;
 
-      if (client_pointer) {
-        /* Lookup existing host side data buffer. */
-        DataVector &data_v = data_vector_find(client_pointer);
-        mem.host_pointer = (void *)&data_v[0];
+      thread_scoped_lock lock(mem_mutex);
 
-        /* Translate the client pointer to a real device pointer. */
-        mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
-      }
-      else {
-        /* Allocate host side data buffer. */
-        DataVector &data_v = data_vector_insert(client_pointer, data_size);
-        mem.host_pointer = (void *) ? (device_ptr) & (data_v[0]) : 0;
-      }
+      device_ptr client_pointer = mem.device_pointer;
+      bool allocate = mem_from_client(mem, client_pointer);
 
       /* Zero memory. */
       device->mem_zero(mem);
 
-      if (!client_pointer) {
+      if (allocate) {
         /* Store a mapping to/from client_pointer and real device pointer. */
         pointer_mapping_insert(client_pointer, mem.device_pointer);
       }
@@ -552,15 +722,19 @@ class DeviceServer {
     else if (rcv.name == "mem_free") {
       string name;
       network_device_memory mem(device);
-
       rcv.read(mem, name);
-      lock.unlock();
 
-      device_ptr client_pointer = mem.device_pointer;
+      thread_scoped_lock lock(mem_mutex);
 
-      mem.device_pointer = device_ptr_from_client_pointer_erase(client_pointer);
+      device_ptr client_pointer = mem.device_pointer;
+      DataVector &data_v = data_vector_find(client_pointer);
+      mem.host_pointer = (data_v.size()) ? (void *)&data_v[0] : NULL;
+      mem.device_size = data_v.size();
+      mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
 
       device->mem_free(mem);
+
+      device_ptr_from_client_pointer_erase(client_pointer);
     }
     else if (rcv.name == "const_copy_to") {
       string name_string;
@@ -571,137 +745,138 @@ class DeviceServer {
 
       vector<char> host_vector(size);
       rcv.read_buffer(&host_vector[0], size);
-      lock.unlock();
 
       device->const_copy_to(name_string.c_str(), &host_vector[0], size);
     }
     else if (rcv.name == "load_kernels") {
       DeviceRequestedFeatures requested_features;
-      rcv.read(requested_features.experimental);
-      rcv.read(requested_features.max_closure);
-      rcv.read(requested_features.max_nodes_group);
-      rcv.read(requested_features.nodes_features);
+      rcv.read(requested_features);
 
       bool result;
       result = device->load_kernels(requested_features);
       RPCSend snd(socket, &error_func, "load_kernels");
       snd.add(result);
-      snd.write();
-      lock.unlock();
+      send_locked(snd);
     }
     else if (rcv.name == "task_add") {
       DeviceTask task;
 
       rcv.read(task);
-      lock.unlock();
 
-      if (task.buffer)
-        task.buffer = device_ptr_from_client_pointer(task.buffer);
+      {
+        thread_scoped_lock lock(mem_mutex);
 
-      if (task.rgba_half)
-        task.rgba_half = device_ptr_from_client_pointer(task.rgba_half);
+        if (task.buffer)
+          task.buffer = device_ptr_from_client_pointer(task.buffer);
 
-      if (task.rgba_byte)
-        task.rgba_byte = device_ptr_from_client_pointer(task.rgba_byte);
+        if (task.rgba_half)
+          task.rgba_half = device_ptr_from_client_pointer(task.rgba_half);
 
-      if (task.shader_input)
-        task.shader_input = device_ptr_from_client_pointer(task.shader_input);
+        if (task.rgba_byte)
+          task.rgba_byte = device_ptr_from_client_pointer(task.rgba_byte);
 
-      if (task.shader_output)
-        task.shader_output = device_ptr_from_client_pointer(task.shader_output);
+        if (task.shader_input)
+          task.shader_input = device_ptr_from_client_pointer(task.shader_input);
 
-      task.acquire_tile = function_bind(&DeviceServer::task_acquire_tile, this, _1, _2);
+        if (task.shader_output)
+          task.shader_output = device_ptr_from_client_pointer(task.shader_output);
+      }
+
+      task.acquire_tile = function_bind(&DeviceServer::task_acquire_tile, this, _1, _2, _3);
       task.release_tile = function_bind(&DeviceServer::task_release_tile, this, _1);
-      task.update_progress_sample = function_bind(&DeviceServer::task_update_progress_sample,
-                                                  this);
+      task.update_progress_sample = function_bind(
+          &DeviceServer::task_update_progress_sample, this, _1, _2);
       task.update_tile_sample = function_bind(&DeviceServer::task_update_tile_sample, this, _1);
       task.get_cancel = function_bind(&DeviceServer::task_get_cancel, this);
 
+      cancel = false;
       device->task_add(task);
     }
     else if (rcv.name == "task_wait") {
-      lock.unlock();
-
-      blocked_waiting = true;
-      device->task_wait();
-      blocked_waiting = false;
-
-      lock.lock();
-      RPCSend snd(socket, &error_func, "task_wait_done");
-      snd.write();
-      lock.unlock();
+      /* Wait in a separate thread, so this one can keep receiving tiles. */
+      task_wait_join();
+      wait_thread = new thread(function_bind(&DeviceServer::task_wait, this));
     }
     else if (rcv.name == "task_cancel") {
-      lock.unlock();
+      cancel = true;
       device->task_cancel();
     }
-    else if (rcv.name == "acquire_tile") {
-      AcquireEntry entry;
-      entry.name = rcv.name;
-      rcv.read(entry.tile);
-      acquire_queue.push_back(entry);
-      lock.unlock();
-    }
-    else if (rcv.name == "acquire_tile_none") {
-      AcquireEntry entry;
-      entry.name = rcv.name;
-      acquire_queue.push_back(entry);
-      lock.unlock();
-    }
-    else if (rcv.name == "release_tile") {
+    else if (rcv.name == "acquire_tile" || rcv.name == "acquire_tile_none") {
       AcquireEntry entry;
-      entry.name = rcv.name;
+      entry.acquired = (rcv.name == "acquire_tile");
+      entry.pass_stride = 0;
+
+      if (entry.acquired) {
+        rcv.read(entry.tile);
+        rcv.read(entry.pass_stride);
+      }
+
+      thread_scoped_lock queue_lock(acquire_queue_mutex);
       acquire_queue.push_back(entry);
-      lock.unlock();
+      acquire_queue_cond.notify_one();
     }
     else {
       cout << "Error: unexpected RPC receive call \"" + rcv.name + "\"\n";
-      lock.unlock();
     }
   }
 
-  bool task_acquire_tile(Device *, RenderTile &tile)
+  void task_wait()
   {
-    thread_scoped_lock acquire_lock(acquire_mutex);
+    device->task_wait();
 
-    bool result = false;
+    RPCSend snd(socket, &error_func, "task_wait_done");
+    send_locked(snd);
+  }
 
-    RPCSend snd(socket, &error_func, "acquire_tile");
-    snd.write();
+  void task_wait_join()
+  {
+    if (wait_thread) {
+      wait_thread->join();
+      delete wait_thread;
+      wait_thread = NULL;
+    }
+  }
 
-    do {
-      if (blocked_waiting)
-        listen_step();
+  bool task_acquire_tile(Device *, RenderTile &tile, uint tile_types)
+  {
+    /* One request at a time, so replies arrive in the order of requests. */
+    thread_scoped_lock acquire_lock(acquire_mutex);
 
-      /* todo: avoid busy wait loop */
-      thread_scoped_lock lock(rpc_lock);
+    {
+      RPCSend snd(socket, &error_func, "acquire_tile");
+      snd.add(tile_types);
+      send_locked(snd);
+    }
 
-      if (!acquire_queue.empty()) {
-        AcquireEntry entry = acquire_queue.front();
-        acquire_queue.pop_front();
+    AcquireEntry entry;
+    {
+      thread_scoped_lock queue_lock(acquire_queue_mutex);
+      while (acquire_queue.empty() && !stop && !have_error()) {
+        acquire_queue_cond.wait(queue_lock);
+      }
 
-        if (entry.name == "acquire_tile") {
-          tile = entry.tile;
+      if (acquire_queue.empty())
+        return false;
 
-          if (tile.buffer)
-            tile.buffer = ptr_map[tile.buffer];
+      entry = acquire_queue.front();
+      acquire_queue.pop_front();
+    }
 
-          result = true;
-          break;
-        }
-        else if (entry.name == "acquire_tile_none") {
-          break;
-        }
-        else {
-          cout << "Error: unexpected acquire RPC receive call \"" + entry.name + "\"\n";
-        }
-      }
-    } while (acquire_queue.empty() && !stop && !have_error());
+    if (!entry.acquired)
+      return false;
 
-    return result;
+    tile = entry.tile;
+
+    if (tile.buffer) {
+      thread_scoped_lock lock(mem_mutex);
+      buffer_pass_stride[tile.buffer] = entry.pass_stride;
+      tile.buffer = device_ptr_from_client_pointer(tile.buffer);
+    }
+
+    return true;
   }
 
-  void task_update_progress_sample()
+  void task_update_progress_sample(long, int)
   {
     ; /* skip */
   }
@@ -711,67 +886,66 @@ class DeviceServer {
     ; /* skip */
   }
 
+  /* Send the rendered tile back to the client without waiting for a reply.
+   * Render buffers are read from the host side data buffer, which the CPU
+   * device renders into directly. */
   void task_release_tile(RenderTile &tile)
   {
-    thread_scoped_lock acquire_lock(acquire_mutex);
-
-    if (tile.buffer)
-      tile.buffer = ptr_imap[tile.buffer];
+    const float *buffer;
+    int pass_stride;
 
     {
-      thread_scoped_lock lock(rpc_lock);
-      RPCSend snd(socket, &error_func, "release_tile");
-      snd.add(tile);
-      snd.write();
-      lock.unlock();
-    }
+      thread_scoped_lock lock(mem_mutex);
 
-    do {
-      if (blocked_waiting)
-        listen_step();
-
-      /* todo: avoid busy wait loop */
-      thread_scoped_lock lock(rpc_lock);
+      tile.buffer = ptr_imap[tile.buffer];
+      buffer = (const float *)&data_vector_find(tile.buffer)[0];
+      pass_stride = buffer_pass_stride[tile.buffer];
+    }
 
-      if (!acquire_queue.empty()) {
-        AcquireEntry entry = acquire_queue.front();
-        acquire_queue.pop_front();
+    RPCSend snd(socket, &error_func, "release_tile");
+    snd.add(tile);
+    snd.add(pass_stride);
 
-        if (entry.name == "release_tile") {
-          lock.unlock();
-          break;
-        }
-        else {
-          cout << "Error: unexpected release RPC receive call \"" + entry.name + "\"\n";
-        }
-      }
-    } while (acquire_queue.empty() && !stop);
+    thread_scoped_lock send_lock(send_mutex);
+    snd.write();
+    for (int y = 0; y < tile.h; y++) {
+      snd.write_buffer(buffer + tile_row_index(tile, y, pass_stride),
+                       sizeof(float) * tile.w * pass_stride);
+    }
   }
 
   bool task_get_cancel()
   {
-    return false;
+    return cancel || stop || have_error();
   }
 
   /* properties */
   Device *device;
   tcp::socket &socket;
 
-  /* mapping of remote to local pointer */
+  /* mapping of remote to local pointer, and pass stride of render buffers by
+   * client pointer */
+  thread_mutex mem_mutex;
   PtrMap ptr_map;
   PtrMap ptr_imap;
   DataMap mem_data;
+  map<device_ptr, int> buffer_pass_stride;
 
   struct AcquireEntry {
-    string name;
+    bool acquired;
     RenderTile tile;
+    int pass_stride;
   };
 
+  thread_mutex send_mutex;
   thread_mutex acquire_mutex;
+  thread_mutex acquire_queue_mutex;
+  thread_condition_variable acquire_queue_cond;
   list<AcquireEntry> acquire_queue;
 
-  bool stop;
-  bool blocked_waiting;
+  std::atomic<bool> stop;
+  std::atomic<bool> cancel;
+  thread *wait_thread;
 
  private:
   NetworkError error_func;
@@ -779,19 +953,34 @@ class DeviceServer {
   /* todo: free memory and device (osl) on network error */
 };
 
-void Device::server_run()
+void Device::server_run(int port)
 {
   try {
-    /* starts thread that responds to discovery requests */
-    ServerDiscovery discovery;
+    /* Starts thread that responds to discovery requests, only servers on the
+     * default port can be discovered. */
+    unique_ptr<ServerDiscovery> discovery;
+    if (port == SERVER_PORT) {
+      try {
+        discovery.reset(new ServerDiscovery());
+      }
+      catch (exception &e) {
+        fprintf(stderr, "Network server discovery disabled: %s\n", e.what());
+      }
+    }
+
+    boost::asio::io_service io_service;
+    tcp::acceptor acceptor(io_service);
+    tcp::endpoint endpoint(tcp::v4(), port);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    acceptor.bind(endpoint);
+    acceptor.listen();
 
     for (;;) {
       /* accept connection */
-      boost::asio::io_service io_service;
-      tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
-
       tcp::socket socket(io_service);
       acceptor.accept(socket);
+      socket.set_option(tcp::no_delay(true));
 
       string remote_address = socket.remote_endpoint().address().to_string();
       printf("Connected to remote client at: %s\n", remote_address.c_str());
@@ -26,13 +26,19 @@
 #  include <boost/array.hpp>
 #  include <boost/asio.hpp>
 #  include <boost/bind.hpp>
+#  include <boost/serialization/binary_object.hpp>
 #  include <boost/serialization/vector.hpp>
 #  include <boost/thread.hpp>
 
+#  include <atomic>
 #  include <deque>
 #  include <iostream>
 #  include <sstream>
 
+#  include "device/device.h"
+#  include "device/device_memory.h"
+#  include "device/device_task.h"
+
 #  include "render/buffers.h"
 
 #  include "util/util_foreach.h"
@@ -40,6 +46,7 @@
 #  include "util/util_map.h"
 #  include "util/util_param.h"
 #  include "util/util_string.h"
+#  include "util/util_thread.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -64,23 +71,29 @@ typedef boost::archive::binary_oarchive o_archive;
 typedef boost::archive::binary_iarchive i_archive;
 #  endif
 
-/* Serialization of device memory */
+/* Serialization of device memory, with texture info for image textures. */
 
-class network_device_memory : public device_memory {
+class network_device_memory : public device_texture {
  public:
-  network_device_memory(Device *device) : device_memory(device, "", MEM_READ_ONLY)
+  network_device_memory(Device *device)
+      : device_texture(
+            device, "", 0, IMAGE_DATA_TYPE_FLOAT, INTERPOLATION_NONE, EXTENSION_REPEAT)
   {
+    type = MEM_READ_ONLY;
   }
 
   ~network_device_memory()
   {
+    /* Memory is owned by the server, not freed with this descriptor. */
     device_pointer = 0;
+    host_pointer = 0;
   };
 
   vector<char> local_data;
 };
 
-/* Common netowrk error function / object for both DeviceNetwork and DeviceServer*/
+/* Common netowrk error function / object for both DeviceNetwork and DeviceServer,
+ * errors may be reported from multiple threads. */
 class NetworkError {
  public:
   NetworkError()
@@ -95,18 +108,26 @@ class NetworkError {
 
   void network_error(const string &message)
   {
+    thread_scoped_lock lock(error_mutex);
     error = message;
     error_count += 1;
   }
 
   bool have_error()
   {
-    return true ? error_count > 0 : false;
+    return error_count > 0;
+  }
+
+  string error_message()
+  {
+    thread_scoped_lock lock(error_mutex);
+    return error;
   }
 
  private:
+  thread_mutex error_mutex;
   string error;
-  int error_count;
+  std::atomic<int> error_count;
 };
 
 /* Remote procedure call Send */
@@ -118,7 +139,6 @@ class RPCSend {
   {
     archive &name_;
     error_func = e;
-    fprintf(stderr, "rpc send %s\n", name.c_str());
   }
 
   ~RPCSend()
@@ -130,8 +150,12 @@ class RPCSend {
     archive &mem.data_type &mem.data_elements &mem.data_size;
     archive &mem.data_width &mem.data_height &mem.data_depth &mem.device_pointer;
     archive &mem.type &string(mem.name);
-    archive &mem.interpolation &mem.extension;
-    archive &mem.device_pointer;
+
+    if (mem.type == MEM_TEXTURE) {
+      device_texture &tex = (device_texture &)mem;
+      archive &tex.slot;
+      archive &boost::serialization::make_binary_object(&tex.info, sizeof(tex.info));
+    }
   }
 
   template<typename T> void add(const T &data)
@@ -146,18 +170,34 @@ class RPCSend {
     archive &task.rgba_byte &task.rgba_half &task.buffer &task.sample &task.num_samples;
     archive &task.offset &task.stride;
     archive &task.shader_input &task.shader_output &task.shader_eval_type;
-    archive &task.shader_x &task.shader_w;
-    archive &task.need_finish_queue;
+    archive &task.shader_filter &task.shader_x &task.shader_w;
+    archive &task.tile_types &task.pass_stride;
+    archive &task.need_finish_queue &task.integrator_branched;
+    archive &task.adaptive_sampling.use &task.adaptive_sampling.adaptive_step;
+    archive &task.adaptive_sampling.min_samples;
   }
 
   void add(const RenderTile &tile)
   {
-    archive &tile.x &tile.y &tile.w &tile.h;
+    int task = (int)tile.task;
+    archive &task &tile.x &tile.y &tile.w &tile.h;
     archive &tile.start_sample &tile.num_samples &tile.sample;
-    archive &tile.resolution &tile.offset &tile.stride;
+    archive &tile.resolution &tile.offset &tile.stride &tile.tile_index;
     archive &tile.buffer;
   }
 
+  void add(const DeviceRequestedFeatures &features)
+  {
+    archive &features.experimental &features.max_nodes_group &features.nodes_features;
+    archive &features.use_hair &features.use_hair_thick;
+    archive &features.use_object_motion &features.use_camera_motion;
+    archive &features.use_baking &features.use_subsurface &features.use_volume;
+    archive &features.use_integrator_branched &features.use_patch_evaluation;
+    archive &features.use_transparent &features.use_shadow_tricks &features.use_principled;
+    archive &features.use_denoising &features.use_shader_raytrace;
+    archive &features.use_true_displacement &features.use_background_light;
+  }
+
   void write()
   {
     boost::system::error_code error;
@@ -186,7 +226,7 @@ class RPCSend {
     sent = true;
   }
 
-  void write_buffer(void *buffer, size_t size)
+  void write_buffer(const void *buffer, size_t size)
   {
     boost::system::error_code error;
 
@@ -246,7 +286,6 @@ class RPCReceive {
           archive = new i_archive(*archive_stream);
 
           *archive &name;
-          fprintf(stderr, "rpc receive %s\n", name.c_str());
         }
         else {
           error_func->network_error("Network receive error: data size doesn't match header");
@@ -272,8 +311,11 @@ class RPCReceive {
     *archive &mem.data_type &mem.data_elements &mem.data_size;
     *archive &mem.data_width &mem.data_height &mem.data_depth &mem.device_pointer;
     *archive &mem.type &name;
-    *archive &mem.interpolation &mem.extension;
-    *archive &mem.device_pointer;
+
+    if (mem.type == MEM_TEXTURE) {
+      *archive &mem.slot;
+      *archive &boost::serialization::make_binary_object(&mem.info, sizeof(mem.info));
+    }
 
     mem.name = name.c_str();
     mem.host_pointer = 0;
@@ -310,22 +352,39 @@ class RPCReceive {
     *archive &task.rgba_byte &task.rgba_half &task.buffer &task.sample &task.num_samples;
     *archive &task.offset &task.stride;
     *archive &task.shader_input &task.shader_output &task.shader_eval_type;
-    *archive &task.shader_x &task.shader_w;
-    *archive &task.need_finish_queue;
+    *archive &task.shader_filter &task.shader_x &task.shader_w;
+    *archive &task.tile_types &task.pass_stride;
+    *archive &task.need_finish_queue &task.integrator_branched;
+    *archive &task.adaptive_sampling.use &task.adaptive_sampling.adaptive_step;
+    *archive &task.adaptive_sampling.min_samples;
 
     task.type = (DeviceTask::Type)type;
   }
 
   void read(RenderTile &tile)
   {
-    *archive &tile.x &tile.y &tile.w &tile.h;
+    int task;
+    *archive &task &tile.x &tile.y &tile.w &tile.h;
     *archive &tile.start_sample &tile.num_samples &tile.sample;
-    *archive &tile.resolution &tile.offset &tile.stride;
+    *archive &tile.resolution &tile.offset &tile.stride &tile.tile_index;
     *archive &tile.buffer;
 
+    tile.task = (RenderTile::Task)task;
     tile.buffers = NULL;
   }
 
+  void read(DeviceRequestedFeatures &features)
+  {
+    *archive &features.experimental &features.max_nodes_group &features.nodes_features;
+    *archive &features.use_hair &features.use_hair_thick;
+    *archive &features.use_object_motion &features.use_camera_motion;
+    *archive &features.use_baking &features.use_subsurface &features.use_volume;
+    *archive &features.use_integrator_branched &features.use_patch_evaluation;
+    *archive &features.use_transparent &features.use_shadow_tricks &features.use_principled;
+    *archive &features.use_denoising &features.use_shader_raytrace;
+    *archive &features.use_true_displacement &features.use_background_light;
+  }
+
   string name;
 
  protected:
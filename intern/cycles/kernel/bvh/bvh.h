@@ -236,6 +236,10 @@ ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
 #endif   /* __KERNEL_OPTIX__ */
 }
 
+#if defined(__KERNEL_CPU__)
+#  include "kernel/bvh/bvh_packet.h"
+#endif
+
 #ifdef __BVH_LOCAL__
 ccl_device_intersect bool scene_intersect_local(KernelGlobals *kg,
                                                 const Ray *ray,
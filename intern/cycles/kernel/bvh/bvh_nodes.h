@@ -28,23 +28,88 @@ ccl_device_forceinline Transform bvh_unaligned_node_fetch_space(KernelGlobals *k
   return space;
 }
 
-ccl_device_forceinline int bvh_aligned_node_intersect(KernelGlobals *kg,
-                                                      const float3 P,
-                                                      const float3 idir,
-                                                      const float t,
-                                                      const int node_addr,
-                                                      const uint visibility,
-                                                      float dist[2])
+/* Compressed nodes store the child bounds quantized to 8 bits, relative to the
+ * parent bounds with a power of two scale per axis. The bytes for each axis are in
+ * the same order as the full precision bounds of aligned nodes. */
+ccl_device_forceinline void bvh_compressed_node_fetch_bounds(KernelGlobals *kg,
+                                                             const int node_addr,
+                                                             float4 *node0,
+                                                             float4 *node1,
+                                                             float4 *node2)
 {
+  const float4 origin = kernel_tex_fetch(__bvh_nodes, node_addr + 1);
+  const float4 quantized = kernel_tex_fetch(__bvh_nodes, node_addr + 2);
 
-  /* fetch node data */
-#ifdef __VISIBILITY_FLAG__
-  float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr + 0);
+  /* Biased exponents, shifted into the exponent bits of a float. */
+  const uint exponents = __float_as_uint(origin.w);
+  const float scale_x = __uint_as_float((exponents & 0xff) << 23);
+  const float scale_y = __uint_as_float(((exponents >> 8) & 0xff) << 23);
+  const float scale_z = __uint_as_float(((exponents >> 16) & 0xff) << 23);
+
+#if defined(__KERNEL_SSE2__) && defined(__KERNEL_SSE__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i q = _mm_castps_si128(quantized.m128);
+  const __m128i q_xy = _mm_unpacklo_epi8(q, zero);
+  const __m128i q_zw = _mm_unpackhi_epi8(q, zero);
+
+  *node0 = float4(_mm_add_ps(
+      _mm_set1_ps(origin.x),
+      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(q_xy, zero)), _mm_set1_ps(scale_x))));
+  *node1 = float4(_mm_add_ps(
+      _mm_set1_ps(origin.y),
+      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(q_xy, zero)), _mm_set1_ps(scale_y))));
+  *node2 = float4(_mm_add_ps(
+      _mm_set1_ps(origin.z),
+      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(q_zw, zero)), _mm_set1_ps(scale_z))));
+#else
+  const uint qx = __float_as_uint(quantized.x);
+  const uint qy = __float_as_uint(quantized.y);
+  const uint qz = __float_as_uint(quantized.z);
+
+  *node0 = make_float4(origin.x + (float)(qx & 0xff) * scale_x,
+                       origin.x + (float)((qx >> 8) & 0xff) * scale_x,
+                       origin.x + (float)((qx >> 16) & 0xff) * scale_x,
+                       origin.x + (float)(qx >> 24) * scale_x);
+  *node1 = make_float4(origin.y + (float)(qy & 0xff) * scale_y,
+                       origin.y + (float)((qy >> 8) & 0xff) * scale_y,
+                       origin.y + (float)((qy >> 16) & 0xff) * scale_y,
+                       origin.y + (float)(qy >> 24) * scale_y);
+  *node2 = make_float4(origin.z + (float)(qz & 0xff) * scale_z,
+                       origin.z + (float)((qz >> 8) & 0xff) * scale_z,
+                       origin.z + (float)((qz >> 16) & 0xff) * scale_z,
+                       origin.z + (float)(qz >> 24) * scale_z);
 #endif
-  float4 node0 = kernel_tex_fetch(__bvh_nodes, node_addr + 1);
-  float4 node1 = kernel_tex_fetch(__bvh_nodes, node_addr + 2);
-  float4 node2 = kernel_tex_fetch(__bvh_nodes, node_addr + 3);
+}
 
+/* Fetch the bounds of both children of an aligned node, in the layout of full
+ * precision nodes. */
+ccl_device_forceinline void bvh_aligned_node_fetch_bounds(KernelGlobals *kg,
+                                                          const int node_addr,
+                                                          const float4 cnodes,
+                                                          float4 *node0,
+                                                          float4 *node1,
+                                                          float4 *node2)
+{
+  if (__float_as_uint(cnodes.x) & PATH_RAY_NODE_COMPRESSED) {
+    bvh_compressed_node_fetch_bounds(kg, node_addr, node0, node1, node2);
+  }
+  else {
+    *node0 = kernel_tex_fetch(__bvh_nodes, node_addr + 1);
+    *node1 = kernel_tex_fetch(__bvh_nodes, node_addr + 2);
+    *node2 = kernel_tex_fetch(__bvh_nodes, node_addr + 3);
+  }
+}
+
+ccl_device_forceinline int bvh_aligned_node_intersect_bounds(const float3 P,
+                                                             const float3 idir,
+                                                             const float t,
+                                                             const float4 cnodes,
+                                                             const float4 node0,
+                                                             const float4 node1,
+                                                             const float4 node2,
+                                                             const uint visibility,
+                                                             float dist[2])
+{
   /* intersect ray against child nodes */
   float c0lox = (node0.x - P.x) * idir.x;
   float c0hix = (node0.z - P.x) * idir.x;
@@ -76,6 +141,23 @@ ccl_device_forceinline int bvh_aligned_node_intersect(KernelGlobals *kg,
 #endif
 }
 
+ccl_device_forceinline int bvh_aligned_node_intersect(KernelGlobals *kg,
+                                                      const float3 P,
+                                                      const float3 idir,
+                                                      const float t,
+                                                      const int node_addr,
+                                                      const uint visibility,
+                                                      float dist[2])
+{
+  /* fetch node data */
+  float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr + 0);
+  float4 node0, node1, node2;
+  bvh_aligned_node_fetch_bounds(kg, node_addr, cnodes, &node0, &node1, &node2);
+
+  return bvh_aligned_node_intersect_bounds(
+      P, idir, t, cnodes, node0, node1, node2, visibility, dist);
+}
+
 ccl_device_forceinline bool bvh_unaligned_node_intersect_child(KernelGlobals *kg,
                                                                const float3 P,
                                                                const float3 dir,
@@ -0,0 +1,288 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Packet BVH traversal
+ *
+ * Traverses the BVH2 with a packet of coherent rays, such as camera rays of
+ * neighboring pixels. Every node is fetched once and tested against all rays
+ * of the packet, and the packet visits children together with a mask of the
+ * rays that intersected them. Primitives are intersected one ray at a time.
+ *
+ * Motion blur is not supported, in that case scene_intersect_packet() falls
+ * back to tracing rays one at a time. */
+
+typedef struct BVHPacketStackItem {
+  int node_addr;
+  uint mask;
+} BVHPacketStackItem;
+
+ccl_device_noinline void bvh_intersect_packet(KernelGlobals *kg,
+                                              const Ray *rays,
+                                              Intersection *isects,
+                                              const uint visibility,
+                                              const int num_rays)
+{
+  kernel_assert(num_rays <= BVH_PACKET_SIZE);
+
+  /* Ray parameters, transformed into object space for instances. */
+  float3 P[BVH_PACKET_SIZE];
+  float3 dir[BVH_PACKET_SIZE];
+  float3 idir[BVH_PACKET_SIZE];
+
+  uint mask = 0;
+  for (int i = 0; i < num_rays; i++) {
+    Intersection *isect = &isects[i];
+    isect->t = rays[i].t;
+    isect->u = 0.0f;
+    isect->v = 0.0f;
+    isect->prim = PRIM_NONE;
+    isect->object = OBJECT_NONE;
+    BVH_DEBUG_INIT();
+
+    if (scene_intersect_valid(&rays[i])) {
+      P[i] = rays[i].P;
+      dir[i] = bvh_clamp_direction(rays[i].D);
+      idir[i] = bvh_inverse_direction(dir[i]);
+      mask |= (1 << i);
+    }
+  }
+
+  /* Traversal stack, with the mask of rays to visit each node with. */
+  BVHPacketStackItem traversal_stack[BVH_STACK_SIZE];
+  traversal_stack[0].node_addr = ENTRYPOINT_SENTINEL;
+  traversal_stack[0].mask = 0;
+
+  int stack_ptr = 0;
+  int node_addr = (mask) ? kernel_data.bvh.root : ENTRYPOINT_SENTINEL;
+  int object = OBJECT_NONE;
+
+  while (node_addr != ENTRYPOINT_SENTINEL) {
+    do {
+      /* traverse internal nodes */
+      while (node_addr >= 0 && node_addr != ENTRYPOINT_SENTINEL) {
+        const float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr + 0);
+        uint mask0 = 0, mask1 = 0;
+        int num_both = 0, num_closest_child1 = 0;
+
+#ifdef __KERNEL_DEBUG__
+        /* Count the node for every ray that visits it, as in single ray traversal. */
+        for (int i = 0; i < num_rays; i++) {
+          if (mask & (1 << i)) {
+            Intersection *isect = &isects[i];
+            BVH_DEBUG_NEXT_NODE();
+          }
+        }
+#endif
+
+        if (__float_as_uint(cnodes.x) & PATH_RAY_NODE_UNALIGNED) {
+          for (int i = 0; i < num_rays; i++) {
+            if (mask & (1 << i)) {
+              float dist[2];
+              const int traverse_mask = bvh_unaligned_node_intersect(
+                  kg, P[i], dir[i], idir[i], isects[i].t, node_addr, visibility, dist);
+              mask0 |= (traverse_mask & 1) << i;
+              mask1 |= ((traverse_mask >> 1) & 1) << i;
+              if (traverse_mask == 3) {
+                num_both++;
+                num_closest_child1 += (dist[1] < dist[0]) ? 1 : 0;
+              }
+            }
+          }
+        }
+        else {
+          /* Fetch node once for all rays. */
+          float4 node0, node1, node2;
+          bvh_aligned_node_fetch_bounds(kg, node_addr, cnodes, &node0, &node1, &node2);
+
+          for (int i = 0; i < num_rays; i++) {
+            if (mask & (1 << i)) {
+              float dist[2];
+              const int traverse_mask = bvh_aligned_node_intersect_bounds(
+                  P[i], idir[i], isects[i].t, cnodes, node0, node1, node2, visibility, dist);
+              mask0 |= (traverse_mask & 1) << i;
+              mask1 |= ((traverse_mask >> 1) & 1) << i;
+              if (traverse_mask == 3) {
+                num_both++;
+                num_closest_child1 += (dist[1] < dist[0]) ? 1 : 0;
+              }
+            }
+          }
+        }
+
+        int node_addr_child0 = __float_as_int(cnodes.z);
+        int node_addr_child1 = __float_as_int(cnodes.w);
+
+        if (mask0 && mask1) {
+          /* Both children were intersected, visit the one closest for most rays first
+           * and push the other. */
+          if (num_closest_child1 * 2 > num_both) {
+            int tmp_addr = node_addr_child0;
+            node_addr_child0 = node_addr_child1;
+            node_addr_child1 = tmp_addr;
+            uint tmp_mask = mask0;
+            mask0 = mask1;
+            mask1 = tmp_mask;
+          }
+
+          ++stack_ptr;
+          kernel_assert(stack_ptr < BVH_STACK_SIZE);
+          traversal_stack[stack_ptr].node_addr = node_addr_child1;
+          traversal_stack[stack_ptr].mask = mask1;
+
+          node_addr = node_addr_child0;
+          mask = mask0;
+        }
+        else if (mask0) {
+          node_addr = node_addr_child0;
+          mask = mask0;
+        }
+        else if (mask1) {
+          node_addr = node_addr_child1;
+          mask = mask1;
+        }
+        else {
+          /* Neither child was intersected. */
+          node_addr = traversal_stack[stack_ptr].node_addr;
+          mask = traversal_stack[stack_ptr].mask;
+          --stack_ptr;
+        }
+      }
+
+      /* if node is leaf, fetch primitive list */
+      if (node_addr < 0) {
+        float4 leaf = kernel_tex_fetch(__bvh_leaf_nodes, (-node_addr - 1));
+        int prim_addr = __float_as_int(leaf.x);
+
+        if (prim_addr >= 0) {
+          const int prim_addr2 = __float_as_int(leaf.y);
+          const uint type = __float_as_int(leaf.w);
+          const uint leaf_mask = mask;
+
+          /* pop */
+          node_addr = traversal_stack[stack_ptr].node_addr;
+          mask = traversal_stack[stack_ptr].mask;
+          --stack_ptr;
+
+          /* primitive intersection */
+          for (int i = 0; i < num_rays; i++) {
+            if (!(leaf_mask & (1 << i))) {
+              continue;
+            }
+#ifdef __KERNEL_DEBUG__
+            isects[i].num_intersections += prim_addr2 - prim_addr;
+#endif
+
+            switch (type & PRIMITIVE_ALL) {
+              case PRIMITIVE_TRIANGLE: {
+                for (int addr = prim_addr; addr < prim_addr2; addr++) {
+                  kernel_assert(kernel_tex_fetch(__prim_type, addr) == type);
+                  triangle_intersect(kg, &isects[i], P[i], dir[i], visibility, object, addr);
+                }
+                break;
+              }
+#ifdef __HAIR__
+              case PRIMITIVE_CURVE_THICK:
+              case PRIMITIVE_CURVE_RIBBON: {
+                for (int addr = prim_addr; addr < prim_addr2; addr++) {
+                  const uint curve_type = kernel_tex_fetch(__prim_type, addr);
+                  kernel_assert((curve_type & PRIMITIVE_ALL) == (type & PRIMITIVE_ALL));
+                  curve_intersect(kg,
+                                  &isects[i],
+                                  P[i],
+                                  dir[i],
+                                  visibility,
+                                  object,
+                                  addr,
+                                  rays[i].time,
+                                  curve_type);
+                }
+                break;
+              }
+#endif /* __HAIR__ */
+            }
+          }
+        }
+        else {
+          /* instance push */
+          object = kernel_tex_fetch(__prim_object, -prim_addr - 1);
+
+          for (int i = 0; i < num_rays; i++) {
+            if (mask & (1 << i)) {
+              Intersection *isect = &isects[i];
+              isect->t = bvh_instance_push(
+                  kg, object, &rays[i], &P[i], &dir[i], &idir[i], isect->t);
+              BVH_DEBUG_NEXT_INSTANCE();
+            }
+          }
+
+          /* Remember which rays to transform back on instance pop. */
+          ++stack_ptr;
+          kernel_assert(stack_ptr < BVH_STACK_SIZE);
+          traversal_stack[stack_ptr].node_addr = ENTRYPOINT_SENTINEL;
+          traversal_stack[stack_ptr].mask = mask;
+
+          node_addr = kernel_tex_fetch(__object_node, object);
+        }
+      }
+    } while (node_addr != ENTRYPOINT_SENTINEL);
+
+    if (stack_ptr >= 0) {
+      kernel_assert(object != OBJECT_NONE);
+
+      /* instance pop, the mask is the one of the sentinel */
+      for (int i = 0; i < num_rays; i++) {
+        if (mask & (1 << i)) {
+          isects[i].t = bvh_instance_pop(
+              kg, object, &rays[i], &P[i], &dir[i], &idir[i], isects[i].t);
+        }
+      }
+
+      object = OBJECT_NONE;
+      node_addr = traversal_stack[stack_ptr].node_addr;
+      mask = traversal_stack[stack_ptr].mask;
+      --stack_ptr;
+    }
+  }
+}
+
+/* Intersect a packet of rays with the scene, with the same result as calling
+ * scene_intersect() for every ray. */
+ccl_device_intersect void scene_intersect_packet(KernelGlobals *kg,
+                                                 const Ray *rays,
+                                                 const uint visibility,
+                                                 Intersection *isects,
+                                                 const int num_rays)
+{
+  PROFILING_INIT(kg, PROFILING_INTERSECT);
+
+  bool use_packet = (num_rays > 1);
+#ifdef __EMBREE__
+  use_packet = use_packet && !kernel_data.bvh.scene;
+#endif
+#ifdef __OBJECT_MOTION__
+  use_packet = use_packet && !kernel_data.bvh.have_motion;
+#endif
+
+  if (use_packet) {
+    bvh_intersect_packet(kg, rays, isects, visibility, num_rays);
+  }
+  else {
+    for (int i = 0; i < num_rays; i++) {
+      isects[i].prim = PRIM_NONE;
+      scene_intersect(kg, &rays[i], visibility, &isects[i]);
+    }
+  }
+}
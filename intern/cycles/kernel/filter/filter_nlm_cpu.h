@@ -19,6 +19,14 @@ CCL_NAMESPACE_BEGIN
 #define load4_a(buf, ofs) (*((float4 *)((buf) + (ofs))))
 #define load4_u(buf, ofs) load_float4((buf) + (ofs))
 
+/* With AVX, eight pixels are processed at a time where possible. Rows are only aligned to four
+ * pixels, so loads and stores are unaligned. The eight pixel loops run while the second half
+ * starts inside the rect, so they touch exactly the same pixels as the four pixel loops. */
+#ifdef __KERNEL_AVX__
+#  define load8_u(buf, ofs) avxf(_mm256_loadu_ps((buf) + (ofs)))
+#  define store8_u(buf, ofs, val) _mm256_storeu_ps((buf) + (ofs), (val).m256)
+#endif
+
 ccl_device_inline void kernel_filter_nlm_calc_difference(int dx,
                                                          int dy,
                                                          const float *ccl_restrict weight_image,
@@ -42,7 +50,32 @@ ccl_device_inline void kernel_filter_nlm_calc_difference(int dx,
   for (int y = rect.y; y < rect.w; y++) {
     int idx_p = y * stride + aligned_lowx;
     int idx_q = (y + dy) * stride + aligned_lowx + dx + frame_offset;
-    for (int x = aligned_lowx; x < rect.z; x += 4, idx_p += 4, idx_q += 4) {
+    int x = aligned_lowx;
+#ifdef __KERNEL_AVX__
+    for (; x + 4 < rect.z; x += 8, idx_p += 8, idx_q += 8) {
+      avxf diff = avxf(0.0f);
+      avxf scale_fac;
+      if (scale_image) {
+        scale_fac = min(max(load8_u(scale_image, idx_p) / load8_u(scale_image, idx_q),
+                            avxf(0.25f)),
+                        avxf(4.0f));
+      }
+      else {
+        scale_fac = avxf(1.0f);
+      }
+      for (int c = 0, chan_ofs = 0; c < numChannels; c++, chan_ofs += channel_offset) {
+        avxf color_p = load8_u(weight_image, idx_p + chan_ofs);
+        avxf color_q = scale_fac * load8_u(weight_image, idx_q + chan_ofs);
+        avxf cdiff = color_p - color_q;
+        avxf var_p = load8_u(variance_image, idx_p + chan_ofs);
+        avxf var_q = (scale_fac * scale_fac) * load8_u(variance_image, idx_q + chan_ofs);
+        diff = diff + (cdiff * cdiff - a * (var_p + min(var_p, var_q))) /
+                          (avxf(1e-8f) + k_2 * (var_p + var_q));
+      }
+      store8_u(difference_image, idx_p, diff * avxf(1.0f / numChannels));
+    }
+#endif
+    for (; x < rect.z; x += 4, idx_p += 4, idx_q += 4) {
       float4 diff = make_float4(0.0f);
       float4 scale_fac;
       if (scale_image) {
@@ -79,7 +112,15 @@ ccl_device_inline void kernel_filter_nlm_blur(
       load4_a(out_image, y * stride + x) = make_float4(0.0f);
     }
     for (int y1 = low; y1 < high; y1++) {
-      for (int x = aligned_lowx; x < rect.z; x += 4) {
+      int x = aligned_lowx;
+#ifdef __KERNEL_AVX__
+      for (; x + 4 < rect.z; x += 8) {
+        store8_u(out_image,
+                 y * stride + x,
+                 load8_u(out_image, y * stride + x) + load8_u(difference_image, y1 * stride + x));
+      }
+#endif
+      for (; x < rect.z; x += 4) {
         load4_a(out_image, y * stride + x) += load4_a(difference_image, y1 * stride + x);
       }
     }
@@ -90,6 +131,21 @@ ccl_device_inline void kernel_filter_nlm_blur(
   }
 }
 
+ccl_device_inline void nlm_blur_horizontal_add4(const float *ccl_restrict difference_image,
+                                                float *out_image,
+                                                int idx,
+                                                int x,
+                                                int dx,
+                                                int4 lowx4,
+                                                int4 highx4)
+{
+  int4 x4 = make_int4(x) + make_int4(0, 1, 2, 3);
+  int4 active = (x4 >= lowx4) & (x4 < highx4);
+
+  float4 diff = load4_u(difference_image, idx + dx);
+  load4_a(out_image, idx) += mask(active, diff);
+}
+
 ccl_device_inline void nlm_blur_horizontal(
     const float *ccl_restrict difference_image, float *out_image, int4 rect, int stride, int f)
 {
@@ -101,17 +157,28 @@ ccl_device_inline void nlm_blur_horizontal(
   }
 
   for (int dx = -f; dx <= f; dx++) {
-    aligned_lowx = round_down(rect.x - min(0, dx), 4);
+    int lowx = rect.x - min(0, dx);
+    aligned_lowx = round_down(lowx, 4);
     int highx = rect.z - max(0, dx);
-    int4 lowx4 = make_int4(rect.x - min(0, dx));
-    int4 highx4 = make_int4(rect.z - max(0, dx));
+    int4 lowx4 = make_int4(lowx);
+    int4 highx4 = make_int4(highx);
     for (int y = rect.y; y < rect.w; y++) {
-      for (int x = aligned_lowx; x < highx; x += 4) {
-        int4 x4 = make_int4(x) + make_int4(0, 1, 2, 3);
-        int4 active = (x4 >= lowx4) & (x4 < highx4);
-
-        float4 diff = load4_u(difference_image, y * stride + x + dx);
-        load4_a(out_image, y * stride + x) += mask(active, diff);
+      int x = aligned_lowx;
+#ifdef __KERNEL_AVX__
+      /* Masking is only needed at the ends of the range. */
+      if (x < lowx && x < highx) {
+        nlm_blur_horizontal_add4(
+            difference_image, out_image, y * stride + x, x, dx, lowx4, highx4);
+        x += 4;
+      }
+      for (; x + 8 <= highx; x += 8) {
+        int idx = y * stride + x;
+        store8_u(out_image, idx, load8_u(out_image, idx) + load8_u(difference_image, idx + dx));
+      }
+#endif
+      for (; x < highx; x += 4) {
+        nlm_blur_horizontal_add4(
+            difference_image, out_image, y * stride + x, x, dx, lowx4, highx4);
       }
     }
   }
@@ -250,5 +317,9 @@ ccl_device_inline void kernel_filter_nlm_normalize(float *out_image,
 
 #undef load4_a
 #undef load4_u
+#ifdef __KERNEL_AVX__
+#  undef load8_u
+#  undef store8_u
+#endif
 
 CCL_NAMESPACE_END
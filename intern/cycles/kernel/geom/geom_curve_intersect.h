@@ -538,24 +538,12 @@ ccl_device_inline float4 ribbon_to_ray_space(const float3 ray_space[3],
   return make_float4(dot(ray_space[0], P), dot(ray_space[1], P), dot(ray_space[2], P), P4.w);
 }
 
-ccl_device_inline bool ribbon_intersect(const float3 ray_org,
-                                        const float3 ray_dir,
-                                        const float ray_tfar,
-                                        const int N,
-                                        float4 curve[4],
-                                        Intersection *isect)
+/* Intersect N flat segments of a curve in ray space, returning the first hit along the curve. */
+ccl_device_inline bool ribbon_intersect_segments(const float4 curve[4],
+                                                 const int N,
+                                                 const float eps,
+                                                 Intersection *isect)
 {
-  /* Transform control points into ray space. */
-  float3 ray_space[3];
-  ribbon_ray_space(ray_dir, ray_space);
-
-  curve[0] = ribbon_to_ray_space(ray_space, ray_org, curve[0]);
-  curve[1] = ribbon_to_ray_space(ray_space, ray_org, curve[1]);
-  curve[2] = ribbon_to_ray_space(ray_space, ray_org, curve[2]);
-  curve[3] = ribbon_to_ray_space(ray_space, ray_org, curve[3]);
-
-  const float4 mx = max(max(fabs(curve[0]), fabs(curve[1])), max(fabs(curve[2]), fabs(curve[3])));
-  const float eps = 4.0f * FLT_EPSILON * max(max(mx.x, mx.y), max(mx.z, mx.w));
   const float step_size = 1.0f / (float)N;
 
   /* Evaluate first point and radius scaled normal direction. */
@@ -571,17 +559,21 @@ ccl_device_inline bool ribbon_intersect(const float3 ray_org,
   for (int i = 0; i < N; i++) {
     const float u = i * step_size;
     const float4 p1 = catmull_rom_basis_eval(curve, u + step_size);
-    bool valid = cylinder_culling_test(
-        make_float2(p0.x, p0.y), make_float2(p1.x, p1.y), max(p0.w, p1.w));
-    if (!valid) {
-      continue;
-    }
 
     /* Evaluate next point. */
     float3 dp1dt = float4_to_float3(catmull_rom_basis_derivative(curve, u + step_size));
     dp1dt = (max3(fabs(dp1dt)) < eps) ? float4_to_float3(p1 - p0) : dp1dt;
     const float3 wn1 = normalize(make_float3(dp1dt.y, -dp1dt.x, 0.0f)) * p1.w;
 
+    bool valid = cylinder_culling_test(
+        make_float2(p0.x, p0.y), make_float2(p1.x, p1.y), max(p0.w, p1.w));
+    if (!valid) {
+      /* Next segment starts at the end of this one, even if it was culled. */
+      p0 = p1;
+      wn0 = wn1;
+      continue;
+    }
+
     /* Construct quad coordinates. */
     const float3 lp0 = float4_to_float3(p0) + wn0;
     const float3 lp1 = float4_to_float3(p1) + wn1;
@@ -617,6 +609,198 @@ ccl_device_inline bool ribbon_intersect(const float3 ray_org,
   return false;
 }
 
+#  ifdef __KERNEL_SSE2__
+/* Maximum number of segments of the vectorized ribbon intersection, matching the limit of
+ * the curve subdivisions scene parameter. */
+#    define CURVE_RIBBON_MAX_SEGMENTS 16
+
+ccl_device_inline void catmull_rom_basis_weights_sse(const ssef &u, ssef n[4])
+{
+  const ssef t = u;
+  const ssef s = 1.0f - u;
+  n[0] = -t * s * s;
+  n[1] = 2.0f + t * t * (3.0f * t - 5.0f);
+  n[2] = 2.0f + s * s * (3.0f * s - 5.0f);
+  n[3] = -s * t * t;
+}
+
+ccl_device_inline void catmull_rom_basis_derivative_weights_sse(const ssef &u, ssef n[4])
+{
+  const ssef t = u;
+  const ssef s = 1.0f - u;
+  n[0] = -s * s + 2.0f * s * t;
+  n[1] = 2.0f * t * (3.0f * t - 5.0f) + 3.0f * t * t;
+  n[2] = 2.0f * s * (3.0f * t + 2.0f) - 3.0f * s * s;
+  n[3] = -2.0f * s * t + t * t;
+}
+
+/* Component of the curve for four parameters at once, with weights from the functions above. */
+ccl_device_inline ssef catmull_rom_basis_sse(const float c0,
+                                             const float c1,
+                                             const float c2,
+                                             const float c3,
+                                             const ssef n[4])
+{
+  return 0.5f * (c0 * n[0] + c1 * n[1] + c2 * n[2] + c3 * n[3]);
+}
+
+/* Same as ribbon_intersect_segments, but evaluating the curve points and intersecting the
+ * segments four at a time. */
+ccl_device_inline bool ribbon_intersect_segments_sse(const float4 curve[4],
+                                                     const int N,
+                                                     const float eps,
+                                                     Intersection *isect)
+{
+  const int num_points = N + 1;
+  const float step_size = 1.0f / (float)N;
+  const ssef lane = ssef(0.0f, 1.0f, 2.0f, 3.0f);
+
+  /* Points, derivatives and radius scaled normal directions in ray space, in chunks of four
+   * with room for the end points of the last segments. */
+  ccl_align(16) float px[CURVE_RIBBON_MAX_SEGMENTS + 4];
+  ccl_align(16) float py[CURVE_RIBBON_MAX_SEGMENTS + 4];
+  ccl_align(16) float pz[CURVE_RIBBON_MAX_SEGMENTS + 4];
+  ccl_align(16) float pw[CURVE_RIBBON_MAX_SEGMENTS + 4];
+  ccl_align(16) float dx[CURVE_RIBBON_MAX_SEGMENTS + 4];
+  ccl_align(16) float dy[CURVE_RIBBON_MAX_SEGMENTS + 4];
+  ccl_align(16) float dz[CURVE_RIBBON_MAX_SEGMENTS + 4];
+  ccl_align(16) float nx[CURVE_RIBBON_MAX_SEGMENTS + 4];
+  ccl_align(16) float ny[CURVE_RIBBON_MAX_SEGMENTS + 4];
+
+  for (int i = 0; i < num_points; i += 4) {
+    const ssef u = (ssef((float)i) + lane) * step_size;
+    ssef n[4];
+
+    catmull_rom_basis_weights_sse(u, n);
+    store4f(&px[i], catmull_rom_basis_sse(curve[0].x, curve[1].x, curve[2].x, curve[3].x, n));
+    store4f(&py[i], catmull_rom_basis_sse(curve[0].y, curve[1].y, curve[2].y, curve[3].y, n));
+    store4f(&pz[i], catmull_rom_basis_sse(curve[0].z, curve[1].z, curve[2].z, curve[3].z, n));
+    store4f(&pw[i], catmull_rom_basis_sse(curve[0].w, curve[1].w, curve[2].w, curve[3].w, n));
+
+    catmull_rom_basis_derivative_weights_sse(u, n);
+    store4f(&dx[i], catmull_rom_basis_sse(curve[0].x, curve[1].x, curve[2].x, curve[3].x, n));
+    store4f(&dy[i], catmull_rom_basis_sse(curve[0].y, curve[1].y, curve[2].y, curve[3].y, n));
+    store4f(&dz[i], catmull_rom_basis_sse(curve[0].z, curve[1].z, curve[2].z, curve[3].z, n));
+  }
+
+  /* Where the derivative vanishes, use the difference to the previous point instead, or the
+   * next point for the first one. */
+  for (int i = 0; i < num_points; i++) {
+    if (max(max(fabsf(dx[i]), fabsf(dy[i])), fabsf(dz[i])) < eps) {
+      const int j = max(i, 1);
+      dx[i] = px[j] - px[j - 1];
+      dy[i] = py[j] - py[j - 1];
+    }
+  }
+
+  for (int i = 0; i < num_points; i += 4) {
+    const ssef x = load4f(&dy[i]);
+    const ssef y = -load4f(&dx[i]);
+    const ssef len = mm_sqrt(x * x + y * y);
+    const ssef w = load4f(&pw[i]);
+    store4f(&nx[i], x / len * w);
+    store4f(&ny[i], y / len * w);
+  }
+
+  for (int i = 0; i < N; i += 4) {
+    const ssef p0x = load4f(&px[i]), p0y = load4f(&py[i]), p0z = load4f(&pz[i]);
+    const ssef p0w = load4f(&pw[i]), n0x = load4f(&nx[i]), n0y = load4f(&ny[i]);
+    const ssef p1x = loadu4f(&px[i + 1]), p1y = loadu4f(&py[i + 1]), p1z = loadu4f(&pz[i + 1]);
+    const ssef p1w = loadu4f(&pw[i + 1]), n1x = loadu4f(&nx[i + 1]), n1y = loadu4f(&ny[i + 1]);
+
+    /* Cylinder culling test. */
+    const ssef dpx = p1x - p0x;
+    const ssef dpy = p1y - p0y;
+    const ssef num = dpx * p0y - dpy * p0x;
+    const ssef r = max(p0w, p1w);
+    sseb valid = ((ssef((float)i) + lane) < ssef((float)N)) &
+                 (num * num <= r * r * (dpx * dpx + dpy * dpy));
+    if (none(valid)) {
+      continue;
+    }
+
+    /* Construct quad coordinates. */
+    const ssef lp0x = p0x + n0x, lp0y = p0y + n0y;
+    const ssef lp1x = p1x + n1x, lp1y = p1y + n1y;
+    const ssef up0x = p0x - n0x, up0y = p0y - n0y;
+    const ssef up1x = p1x - n1x, up1y = p1y - n1y;
+
+    /* Intersect quad lp0, lp1, up1, up0 as in ribbon_intersect_quad. */
+    const ssef edbx = lp1x - up0x;
+    const ssef edby = lp1y - up0y;
+    const sseb first = (up0x * edby - up0y * edbx) <= 0.0f;
+
+    const ssef v0x = select(first, lp0x, up1x), v0y = select(first, lp0y, up1y);
+    const ssef v0z = select(first, p0z, p1z);
+    const ssef v1x = select(first, lp1x, up0x), v1y = select(first, lp1y, up0y);
+    const ssef v1z = select(first, p1z, p0z);
+    const ssef v2x = select(first, up0x, lp1x), v2y = select(first, up0y, lp1y);
+    const ssef v2z = select(first, p0z, p1z);
+
+    const ssef e0x = v2x - v0x, e0y = v2y - v0y, e0z = v2z - v0z;
+    const ssef e1x = v0x - v1x, e1y = v0y - v1y, e1z = v0z - v1z;
+
+    const ssef U = v0x * e0y - v0y * e0x;
+    const ssef V = v1x * e1y - v1y * e1x;
+    valid &= max(U, V) <= 0.0f;
+
+    const ssef Ngx = e1y * e0z - e1z * e0y;
+    const ssef Ngy = e1z * e0x - e1x * e0z;
+    const ssef den = e1x * e0y - e1y * e0x;
+    const ssef rcp_den = 1.0f / den;
+
+    const ssef t = rcp_den * (v0x * Ngx + v0y * Ngy + v0z * den);
+    valid &= (0.0f <= t) & (t <= ssef(isect->t)) & (den != 0.0f);
+
+    const ssef vu = select(first, U * rcp_den, 1.0f - U * rcp_den);
+    const ssef vv = select(first, V * rcp_den, 1.0f - V * rcp_den);
+
+    /* Ignore self intersections. */
+    valid &= t > 2.0f * (p0w + vu * (p1w - p0w));
+
+    const int mask = (int)movemask(valid);
+    if (mask) {
+      /* First hit along the curve, as in the scalar version. */
+      const int k = __bsf(mask);
+      isect->t = t[k];
+      isect->u = (i + k) * step_size + vu[k] * step_size;
+      isect->v = 2.0f * vv[k] - 1.0f;
+      return true;
+    }
+  }
+  return false;
+}
+#  endif
+
+ccl_device_inline bool ribbon_intersect(const float3 ray_org,
+                                        const float3 ray_dir,
+                                        const float ray_tfar,
+                                        const int N,
+                                        float4 curve[4],
+                                        Intersection *isect)
+{
+  /* Transform control points into ray space. */
+  float3 ray_space[3];
+  ribbon_ray_space(ray_dir, ray_space);
+
+  curve[0] = ribbon_to_ray_space(ray_space, ray_org, curve[0]);
+  curve[1] = ribbon_to_ray_space(ray_space, ray_org, curve[1]);
+  curve[2] = ribbon_to_ray_space(ray_space, ray_org, curve[2]);
+  curve[3] = ribbon_to_ray_space(ray_space, ray_org, curve[3]);
+
+  const float4 mx = max(max(fabs(curve[0]), fabs(curve[1])), max(fabs(curve[2]), fabs(curve[3])));
+  const float eps = 4.0f * FLT_EPSILON * max(max(mx.x, mx.y), max(mx.z, mx.w));
+
+#  ifdef __KERNEL_SSE2__
+  /* A single segment is faster without the overhead of the vectorized version. */
+  if (N > 1 && N <= CURVE_RIBBON_MAX_SEGMENTS) {
+    return ribbon_intersect_segments_sse(curve, N, eps, isect);
+  }
+#  endif
+
+  return ribbon_intersect_segments(curve, N, eps, isect);
+}
+
 ccl_device_forceinline bool curve_intersect(KernelGlobals *kg,
                                             Intersection *isect,
                                             const float3 P,
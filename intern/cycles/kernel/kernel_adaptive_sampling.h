@@ -25,6 +25,9 @@ ccl_device void kernel_do_adaptive_stopping(KernelGlobals *kg,
                                             ccl_global float *buffer,
                                             int sample)
 {
+  /* Samples are accumulated from the start of the rendered sample range. */
+  sample -= kernel_data.integrator.start_sample;
+
   /* TODO Stefan: Is this better in linear, sRGB or something else? */
   float4 I = *((ccl_global float4 *)buffer);
   float4 A = *(ccl_global float4 *)(buffer + kernel_data.film.pass_adaptive_aux_buffer);
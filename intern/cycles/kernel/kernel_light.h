@@ -15,6 +15,7 @@
  */
 
 #include "kernel_light_background.h"
+#include "kernel_light_tree.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -35,6 +36,16 @@ typedef struct LightSample {
   LightType type; /* type of light */
 } LightSample;
 
+/* Probability of picking the lamp out of all lights. */
+ccl_device_inline float lamp_light_select_pdf(KernelGlobals *kg, int lamp, float3 P)
+{
+  if (kernel_data.integrator.use_light_tree && kernel_tex_fetch(__lights, lamp).tree_node >= 0) {
+    return kernel_data.integrator.pdf_light_tree * light_tree_pdf(kg, lamp, P);
+  }
+
+  return kernel_data.integrator.pdf_lights;
+}
+
 /* Regular Light */
 
 ccl_device_inline bool lamp_light_sample(
@@ -153,7 +164,7 @@ ccl_device_inline bool lamp_light_sample(
     }
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= lamp_light_select_pdf(kg, lamp, P);
 
   return (ls->pdf > 0.0f);
 }
@@ -291,7 +302,7 @@ ccl_device bool lamp_light_eval(
     return false;
   }
 
-  ls->pdf *= kernel_data.integrator.pdf_lights;
+  ls->pdf *= lamp_light_select_pdf(kg, lamp, P);
 
   return true;
 }
@@ -651,6 +662,11 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
     }
 
     lamp = -prim - 1;
+
+    /* A single distribution entry stands for all lights in the light tree. */
+    if (lamp == kernel_data.integrator.num_all_lights) {
+      lamp = light_tree_sample(kg, P, &randu);
+    }
   }
 
   if (UNLIKELY(light_select_reached_max_bounces(kg, lamp, bounce))) {
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Light Tree
+ *
+ * Binary tree over point, spot and area lights, to pick a light proportional to
+ * an estimate of its contribution at the shading point rather than uniformly.
+ * The estimate is the energy of the lights in a node divided by the squared
+ * distance to its bounding sphere, ignoring orientation and occlusion. */
+
+ccl_device_inline float light_tree_node_importance(KernelGlobals *kg, int index, float3 P)
+{
+  const ccl_global KernelLightTreeNode *knode = &kernel_tex_fetch(__light_tree_nodes, index);
+  float3 center = make_float3(knode->center[0], knode->center[1], knode->center[2]);
+
+  /* Inside the bounding sphere, every light may be arbitrarily close. Also avoid
+   * division by zero for point lights without size. */
+  float dist_sq = max(len_squared(center - P), knode->radius * knode->radius);
+  dist_sq = max(dist_sq, 1e-12f);
+
+  return knode->energy / dist_sq;
+}
+
+/* Probability of going to the left child of an inner node. */
+ccl_device_inline float light_tree_left_probability(KernelGlobals *kg,
+                                                    int index,
+                                                    int right,
+                                                    float3 P)
+{
+  float left_importance = light_tree_node_importance(kg, index + 1, P);
+  float right_importance = light_tree_node_importance(kg, right, P);
+  float total_importance = left_importance + right_importance;
+
+  return (total_importance > 0.0f) ? left_importance / total_importance : 0.5f;
+}
+
+/* Traverse the tree to pick a lamp, rescaling the random number for reuse. */
+ccl_device int light_tree_sample(KernelGlobals *kg, float3 P, float *randu)
+{
+  float r = *randu;
+  int index = 0;
+
+  for (;;) {
+    int child = kernel_tex_fetch(__light_tree_nodes, index).child;
+
+    if (child < 0) {
+      *randu = r;
+      return ~child;
+    }
+
+    float left_probability = light_tree_left_probability(kg, index, child, P);
+
+    if (r < left_probability) {
+      r = r / left_probability;
+      index = index + 1;
+    }
+    else {
+      r = (r - left_probability) / (1.0f - left_probability);
+      index = child;
+    }
+  }
+}
+
+/* Probability of picking the lamp by traversing the tree, found by walking up
+ * from its leaf to the root. */
+ccl_device float light_tree_pdf(KernelGlobals *kg, int lamp, float3 P)
+{
+  int index = kernel_tex_fetch(__lights, lamp).tree_node;
+  float pdf = 1.0f;
+
+  while (index != 0) {
+    int parent = kernel_tex_fetch(__light_tree_nodes, index).parent;
+    int right = kernel_tex_fetch(__light_tree_nodes, parent).child;
+    float left_probability = light_tree_left_probability(kg, parent, right, P);
+
+    pdf *= (index == right) ? 1.0f - left_probability : left_probability;
+    index = parent;
+  }
+
+  return pdf;
+}
+
+CCL_NAMESPACE_END
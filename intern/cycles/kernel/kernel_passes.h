@@ -192,7 +192,8 @@ ccl_device_inline void kernel_write_data_passes(KernelGlobals *kg,
   if (!(path_flag & PATH_RAY_SINGLE_PASS_DONE)) {
     if (!(sd->flag & SD_TRANSPARENT) || kernel_data.film.pass_alpha_threshold == 0.0f ||
         average(shader_bsdf_alpha(kg, sd)) >= kernel_data.film.pass_alpha_threshold) {
-      if (state->sample == 0) {
+      /* First sample of the rendered range, so renders of a sample range get these too. */
+      if (state->sample == kernel_data.integrator.start_sample) {
         if (flag & PASSMASK(DEPTH)) {
           float depth = camera_z_depth(kg, sd->P);
           kernel_write_pass_float(buffer + kernel_data.film.pass_depth, depth);
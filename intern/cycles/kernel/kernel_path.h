@@ -512,7 +512,8 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
                                                   Ray *ray,
                                                   PathRadiance *L,
                                                   ccl_global float *buffer,
-                                                  ShaderData *emission_sd)
+                                                  ShaderData *emission_sd,
+                                                  Intersection *camera_isect)
 {
   PROFILING_INIT(kg, PROFILING_PATH_INTEGRATE);
 
@@ -530,7 +531,23 @@ ccl_device_forceinline void kernel_path_integrate(KernelGlobals *kg,
     for (;;) {
       /* Find intersection with objects in scene. */
       Intersection isect;
-      bool hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+      bool hit;
+
+      if (camera_isect) {
+        /* Camera ray was already intersected in a packet with neighboring pixels. */
+        isect = *camera_isect;
+        hit = (isect.prim != PRIM_NONE);
+        camera_isect = NULL;
+#  ifdef __KERNEL_DEBUG__
+        L->debug_data.num_bvh_traversed_nodes += isect.num_traversed_nodes;
+        L->debug_data.num_bvh_traversed_instances += isect.num_traversed_instances;
+        L->debug_data.num_bvh_intersections += isect.num_intersections;
+        L->debug_data.num_ray_bounces++;
+#  endif
+      }
+      else {
+        hit = kernel_path_scene_intersect(kg, state, ray, &isect, L);
+      }
 
       /* Find intersection with lamps and compute emission for MIS. */
       kernel_path_lamp_emission(kg, state, ray, throughput, &isect, &sd, L);
@@ -689,11 +706,83 @@ ccl_device void kernel_path_trace(
 #  endif
 
   /* Integrate. */
-  kernel_path_integrate(kg, &state, throughput, &ray, &L, buffer, emission_sd);
+  kernel_path_integrate(kg, &state, throughput, &ray, &L, buffer, emission_sd, NULL);
 
   kernel_write_result(kg, buffer, sample, &L);
 }
 
+#  ifdef __KERNEL_CPU__
+/* Path trace a row of neighboring pixels, intersecting their coherent camera
+ * rays together as a packet before integrating each path on its own. */
+ccl_device void kernel_path_trace_packet(KernelGlobals *kg,
+                                         ccl_global float *buffer,
+                                         int sample,
+                                         int x,
+                                         int y,
+                                         int num_pixels,
+                                         int offset,
+                                         int stride)
+{
+  PROFILING_INIT(kg, PROFILING_RAY_SETUP);
+
+  kernel_assert(num_pixels <= BVH_PACKET_SIZE);
+
+  int pass_stride = kernel_data.film.pass_stride;
+  uint rng_hash[BVH_PACKET_SIZE];
+  Ray rays[BVH_PACKET_SIZE];
+  Intersection isects[BVH_PACKET_SIZE];
+
+  /* Initialize random numbers and sample rays, pixels that are skipped get an
+   * empty ray that is not traced. */
+  for (int i = 0; i < num_pixels; i++) {
+    ccl_global float *pixel_buffer = buffer + (offset + x + i + y * stride) * pass_stride;
+
+    if (kernel_data.film.pass_adaptive_aux_buffer) {
+      ccl_global float4 *aux = (ccl_global float4 *)(pixel_buffer +
+                                                     kernel_data.film.pass_adaptive_aux_buffer);
+      if ((*aux).w > 0.0f) {
+        rays[i].P = make_float3(0.0f, 0.0f, 0.0f);
+        rays[i].D = make_float3(0.0f, 0.0f, 0.0f);
+        rays[i].t = 0.0f;
+        continue;
+      }
+    }
+
+    kernel_path_trace_setup(kg, sample, x + i, y, &rng_hash[i], &rays[i]);
+  }
+
+  /* Camera rays all have the same visibility. */
+  scene_intersect_packet(kg, rays, PATH_RAY_CAMERA, isects, num_pixels);
+
+  for (int i = 0; i < num_pixels; i++) {
+    if (rays[i].t == 0.0f) {
+      continue;
+    }
+
+    ccl_global float *pixel_buffer = buffer + (offset + x + i + y * stride) * pass_stride;
+
+    /* Initialize state. */
+    float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
+
+    PathRadiance L;
+    path_radiance_init(kg, &L);
+
+    ShaderDataTinyStorage emission_sd_storage;
+    ShaderData *emission_sd = AS_SHADER_DATA(&emission_sd_storage);
+
+    PathState state;
+    path_state_init(kg, emission_sd, &state, rng_hash[i], sample, &rays[i]);
+    kernel_assert(path_state_ray_visibility(kg, &state) == PATH_RAY_CAMERA);
+
+    /* Integrate. */
+    kernel_path_integrate(
+        kg, &state, throughput, &rays[i], &L, pixel_buffer, emission_sd, &isects[i]);
+
+    kernel_write_result(kg, pixel_buffer, sample, &L);
+  }
+}
+#  endif /* __KERNEL_CPU__ */
+
 #endif /* __SPLIT_KERNEL__ */
 
 CCL_NAMESPACE_END
@@ -63,6 +63,9 @@ CCL_NAMESPACE_BEGIN
 
 #define VOLUME_STACK_SIZE 32
 
+/* Number of rays traced together in a packet by the CPU kernel. */
+#define BVH_PACKET_SIZE 8
+
 /* Split kernel constants */
 #define WORK_POOL_SIZE_GPU 64
 #define WORK_POOL_SIZE_CPU 1
@@ -324,7 +327,11 @@ enum PathRayFlag {
   /* Ray is to be terminated. */
   PATH_RAY_TERMINATE = (PATH_RAY_TERMINATE_IMMEDIATE | PATH_RAY_TERMINATE_AFTER_TRANSPARENT),
   /* Path and shader is being evaluated for direct lighting emission. */
-  PATH_RAY_EMISSION = (1 << 22)
+  PATH_RAY_EMISSION = (1 << 22),
+
+  /* Special flag to tag BVH nodes with quantized child bounds. Outside of
+   * PATH_RAY_ALL_VISIBILITY, so it never matches the visibility of a ray. */
+  PATH_RAY_NODE_COMPRESSED = (1 << 23)
 };
 
 /* Closure Label */
@@ -1389,7 +1396,9 @@ typedef struct KernelIntegrator {
 
   int max_closures;
 
-  int pad1, pad2;
+  /* light tree */
+  int use_light_tree;
+  float pdf_light_tree;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
@@ -1521,7 +1530,7 @@ typedef struct KernelLight {
   float max_bounces;
   float random;
   float strength[3];
-  float pad1;
+  int tree_node;
   Transform tfm;
   Transform itfm;
   union {
@@ -1548,6 +1557,20 @@ typedef struct KernelLightDistribution {
 } KernelLightDistribution;
 static_assert_align(KernelLightDistribution, 16);
 
+typedef struct KernelLightTreeNode {
+  /* Bounding sphere and total energy of the lights in the node. */
+  float center[3];
+  float radius;
+  float energy;
+  /* Parent node index, -1 for the root. */
+  int parent;
+  /* Right child index for inner nodes, the left child directly follows the
+   * node. For leaf nodes the complement of the lamp index. */
+  int child;
+  int pad1;
+} KernelLightTreeNode;
+static_assert_align(KernelLightTreeNode, 16);
+
 typedef struct KernelParticle {
   int index;
   float age;
@@ -22,13 +22,15 @@
 #  include <nanovdb/util/SampleFromVoxels.h>
 #endif
 
+#include "util/util_texture_cache.h"
+
 CCL_NAMESPACE_BEGIN
 
 /* Make template functions private so symbols don't conflict between kernels with different
  * instruction sets. */
 namespace {
 
-template<typename T> struct TextureInterpolator {
+template<typename T, bool is_sparse = false> struct TextureInterpolator {
 #define SET_CUBIC_SPLINE_WEIGHTS(u, t) \
   { \
     u[0] = (((-1.0f / 6.0f) * t + 0.5f) * t - 0.5f) * t + (1.0f / 6.0f); \
@@ -93,6 +95,37 @@ template<typename T> struct TextureInterpolator {
     return read(data[y * width + x]);
   }
 
+  /* Read a voxel, from sparse tiles with the layout in util_texture.h if is_sparse is set.
+   * Voxels of empty tiles are zero and not stored, with an alpha of one like the stored voxels. */
+  static ccl_always_inline float4 read_3d(const TextureInfo &info, int x, int y, int z)
+  {
+    const int width = info.width;
+    const int height = info.height;
+
+    if (!is_sparse) {
+      const T *data = (const T *)info.data;
+      return read(data[x + y * width + z * width * height]);
+    }
+
+    const int tiles_x = tex_sparse_num_tiles(width);
+    const int tiles_y = tex_sparse_num_tiles(height);
+    const int tx = x >> TEX_SPARSE_TILE_SHIFT;
+    const int ty = y >> TEX_SPARSE_TILE_SHIFT;
+    const int tz = z >> TEX_SPARSE_TILE_SHIFT;
+    const int tile = ((const int *)info.data)[tx + (ty + tz * tiles_y) * tiles_x];
+    if (tile == TEX_SPARSE_EMPTY_TILE) {
+      return make_float4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    const T *data = (const T *)((const char *)info.data +
+                                tex_sparse_voxels_offset(width, height, info.depth));
+    const int offset = (x & TEX_SPARSE_TILE_MASK) +
+                       ((y & TEX_SPARSE_TILE_MASK) +
+                        (z & TEX_SPARSE_TILE_MASK) * TEX_SPARSE_TILE_SIZE) *
+                           TEX_SPARSE_TILE_SIZE;
+    return read(data[(size_t)tile * TEX_SPARSE_TILE_VOXELS + offset]);
+  }
+
   static ccl_always_inline int wrap_periodic(int x, int width)
   {
     x %= width;
@@ -293,8 +326,7 @@ template<typename T> struct TextureInterpolator {
         return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
     }
 
-    const T *data = (const T *)info.data;
-    return read(data[ix + iy * width + iz * width * height]);
+    return read_3d(info, ix, iy, iz);
   }
 
   static ccl_always_inline float4 interp_3d_linear(const TextureInfo &info,
@@ -341,19 +373,17 @@ template<typename T> struct TextureInterpolator {
         return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
     }
 
-    const T *data = (const T *)info.data;
     float4 r;
 
-    r = (1.0f - tz) * (1.0f - ty) * (1.0f - tx) *
-        read(data[ix + iy * width + iz * width * height]);
-    r += (1.0f - tz) * (1.0f - ty) * tx * read(data[nix + iy * width + iz * width * height]);
-    r += (1.0f - tz) * ty * (1.0f - tx) * read(data[ix + niy * width + iz * width * height]);
-    r += (1.0f - tz) * ty * tx * read(data[nix + niy * width + iz * width * height]);
+    r = (1.0f - tz) * (1.0f - ty) * (1.0f - tx) * read_3d(info, ix, iy, iz);
+    r += (1.0f - tz) * (1.0f - ty) * tx * read_3d(info, nix, iy, iz);
+    r += (1.0f - tz) * ty * (1.0f - tx) * read_3d(info, ix, niy, iz);
+    r += (1.0f - tz) * ty * tx * read_3d(info, nix, niy, iz);
 
-    r += tz * (1.0f - ty) * (1.0f - tx) * read(data[ix + iy * width + niz * width * height]);
-    r += tz * (1.0f - ty) * tx * read(data[nix + iy * width + niz * width * height]);
-    r += tz * ty * (1.0f - tx) * read(data[ix + niy * width + niz * width * height]);
-    r += tz * ty * tx * read(data[nix + niy * width + niz * width * height]);
+    r += tz * (1.0f - ty) * (1.0f - tx) * read_3d(info, ix, iy, niz);
+    r += tz * (1.0f - ty) * tx * read_3d(info, nix, iy, niz);
+    r += tz * ty * (1.0f - tx) * read_3d(info, ix, niy, niz);
+    r += tz * ty * tx * read_3d(info, nix, niy, niz);
 
     return r;
   }
@@ -429,15 +459,14 @@ template<typename T> struct TextureInterpolator {
     }
 
     const int xc[4] = {pix, ix, nix, nnix};
-    const int yc[4] = {width * piy, width * iy, width * niy, width * nniy};
-    const int zc[4] = {
-        width * height * piz, width * height * iz, width * height * niz, width * height * nniz};
+    const int yc[4] = {piy, iy, niy, nniy};
+    const int zc[4] = {piz, iz, niz, nniz};
     float u[4], v[4], w[4];
 
     /* Some helper macro to keep code reasonable size,
      * let compiler to inline all the matrix multiplications.
      */
-#define DATA(x, y, z) (read(data[xc[x] + yc[y] + zc[z]]))
+#define DATA(x, y, z) (read_3d(info, xc[x], yc[y], zc[z]))
 #define COL_TERM(col, row) \
   (v[col] * (u[0] * DATA(0, col, row) + u[1] * DATA(1, col, row) + u[2] * DATA(2, col, row) + \
              u[3] * DATA(3, col, row)))
@@ -449,7 +478,6 @@ template<typename T> struct TextureInterpolator {
     SET_CUBIC_SPLINE_WEIGHTS(w, tz);
 
     /* Actual interpolation. */
-    const T *data = (const T *)info.data;
     return ROW_TERM(0) + ROW_TERM(1) + ROW_TERM(2) + ROW_TERM(3);
 
 #undef COL_TERM
@@ -472,9 +500,13 @@ template<typename T> struct TextureInterpolator {
         return interp_3d_tricubic(info, x, y, z);
     }
   }
-#undef SET_CUBIC_SPLINE_WEIGHTS
 };
 
+/* Interpolation of sparse 3D textures. */
+template<typename T> using SparseTextureInterpolator = TextureInterpolator<T, true>;
+
+#undef SET_CUBIC_SPLINE_WEIGHTS
+
 #ifdef WITH_NANOVDB
 template<typename T> struct NanoVDBInterpolator {
   static ccl_always_inline float4 read(float r)
@@ -515,6 +547,12 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
 {
   const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
 
+  /* Pixels are loaded on demand, without derivatives the highest resolution is used. */
+  if (info.cache_handle) {
+    const float2 zero = make_float2(0.0f, 0.0f);
+    return TextureCache::lookup(info, x, y, zero, zero);
+  }
+
   switch (info.data_type) {
     case IMAGE_DATA_TYPE_HALF:
       return TextureInterpolator<half>::interp(info, x, y);
@@ -539,6 +577,20 @@ ccl_device float4 kernel_tex_image_interp(KernelGlobals *kg, int id, float x, fl
   }
 }
 
+/* Images in the texture cache are filtered using the texture coordinate derivatives,
+ * so that only tiles of the MIP level matching the footprint need to be loaded. */
+ccl_device bool kernel_tex_image_is_cached(KernelGlobals *kg, int id)
+{
+  return kernel_tex_fetch(__texture_info, id).cache_handle != 0;
+}
+
+ccl_device float4
+kernel_tex_image_interp_cached(KernelGlobals *kg, int id, float x, float y, float2 dx, float2 dy)
+{
+  const TextureInfo &info = kernel_tex_fetch(__texture_info, id);
+  return TextureCache::lookup(info, x, y, dx, dy);
+}
+
 ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg,
                                              int id,
                                              float3 P,
@@ -567,6 +619,10 @@ ccl_device float4 kernel_tex_image_interp_3d(KernelGlobals *kg,
       return TextureInterpolator<ushort4>::interp_3d(info, P.x, P.y, P.z, interp);
     case IMAGE_DATA_TYPE_FLOAT4:
       return TextureInterpolator<float4>::interp_3d(info, P.x, P.y, P.z, interp);
+    case IMAGE_DATA_TYPE_SPARSE_FLOAT:
+      return SparseTextureInterpolator<float>::interp_3d(info, P.x, P.y, P.z, interp);
+    case IMAGE_DATA_TYPE_SPARSE_FLOAT4:
+      return SparseTextureInterpolator<float4>::interp_3d(info, P.x, P.y, P.z, interp);
 #ifdef WITH_NANOVDB
     case IMAGE_DATA_TYPE_NANOVDB_FLOAT:
       return NanoVDBInterpolator<float>::interp_3d(info, P.x, P.y, P.z, interp);
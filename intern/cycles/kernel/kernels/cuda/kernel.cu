@@ -137,6 +137,9 @@ kernel_cuda_adaptive_scale_samples(WorkTile *tile, int start_sample, int sample,
 			uint y = tile->y + work_index / tile->w;
 			int index = tile->offset + x + y * tile->stride;
 			ccl_global float *buffer = tile->buffer + index * kernel_data.film.pass_stride;
+			/* Samples are counted from the start of the rendered sample range. */
+			start_sample -= kernel_data.integrator.start_sample;
+			sample -= kernel_data.integrator.start_sample;
 			if(buffer[kernel_data.film.pass_sample_count] < 0.0f) {
 				buffer[kernel_data.film.pass_sample_count] = -buffer[kernel_data.film.pass_sample_count];
 				float sample_multiplier = sample / max((float)start_sample + 1.0f, buffer[kernel_data.film.pass_sample_count]);
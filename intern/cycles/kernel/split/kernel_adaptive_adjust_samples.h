@@ -26,10 +26,12 @@ ccl_device void kernel_adaptive_adjust_samples(KernelGlobals *kg)
                          y * kernel_split_params.tile.stride) *
                         kernel_data.film.pass_stride;
     ccl_global float *buffer = kernel_split_params.tile.buffer + buffer_offset;
-    int sample = kernel_split_params.tile.start_sample + kernel_split_params.tile.num_samples;
+    /* Samples are counted from the start of the rendered sample range. */
+    int start_sample = kernel_split_params.tile.start_sample - kernel_data.integrator.start_sample;
+    int sample = start_sample + kernel_split_params.tile.num_samples;
     if (buffer[kernel_data.film.pass_sample_count] < 0.0f) {
       buffer[kernel_data.film.pass_sample_count] = -buffer[kernel_data.film.pass_sample_count];
-      float sample_multiplier = sample / max((float)kernel_split_params.tile.start_sample + 1.0f,
+      float sample_multiplier = sample / max((float)start_sample + 1.0f,
                                              buffer[kernel_data.film.pass_sample_count]);
       if (sample_multiplier != 1.0f) {
         kernel_adaptive_post_adjust(kg, buffer, sample_multiplier);
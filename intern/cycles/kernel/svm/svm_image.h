@@ -16,14 +16,48 @@
 
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint flags)
+#ifdef __KERNEL_CPU__
+/* Footprint of an image lookup for the texture cache. Node inputs have no derivatives,
+ * so take them from the default UV map when that is the lookup vector, and use the
+ * full resolution otherwise. */
+ccl_device_inline void svm_image_texture_derivatives(
+    KernelGlobals *kg, ShaderData *sd, uint flags, float2 *dx, float2 *dy)
+{
+  if (flags & NODE_IMAGE_USE_UV_DERIVATIVES) {
+    const AttributeDescriptor desc = find_attribute(kg, sd, ATTR_STD_UV);
+
+    if (desc.offset != ATTR_STD_NOT_FOUND) {
+      primitive_surface_attribute_float2(kg, sd, desc, dx, dy);
+      return;
+    }
+  }
+
+  *dx = make_float2(0.0f, 0.0f);
+  *dy = make_float2(0.0f, 0.0f);
+}
+#endif
+
+ccl_device float4
+svm_image_texture(KernelGlobals *kg, ShaderData *sd, int id, float x, float y, uint flags)
 {
   if (id == -1) {
     return make_float4(
         TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
   }
 
+#ifdef __KERNEL_CPU__
+  float4 r;
+  if (kernel_tex_image_is_cached(kg, id)) {
+    float2 dx, dy;
+    svm_image_texture_derivatives(kg, sd, flags, &dx, &dy);
+    r = kernel_tex_image_interp_cached(kg, id, x, y, dx, dy);
+  }
+  else {
+    r = kernel_tex_image_interp(kg, id, x, y);
+  }
+#else
   float4 r = kernel_tex_image_interp(kg, id, x, y);
+#endif
   const float alpha = r.w;
 
   if ((flags & NODE_IMAGE_ALPHA_UNASSOCIATE) && alpha != 1.0f && alpha != 0.0f) {
@@ -108,7 +142,7 @@ ccl_device void svm_node_tex_image(
     id = -num_nodes;
   }
 
-  float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, flags);
+  float4 f = svm_image_texture(kg, sd, id, tex_co.x, tex_co.y, flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -198,15 +232,15 @@ ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float
   /* Map so that no textures are flipped, rotation is somewhat arbitrary. */
   if (weight.x > 0.0f) {
     float2 uv = make_float2((signed_N.x < 0.0f) ? 1.0f - co.y : co.y, co.z);
-    f += weight.x * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.x * svm_image_texture(kg, sd, id, uv.x, uv.y, flags);
   }
   if (weight.y > 0.0f) {
     float2 uv = make_float2((signed_N.y > 0.0f) ? 1.0f - co.x : co.x, co.z);
-    f += weight.y * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.y * svm_image_texture(kg, sd, id, uv.x, uv.y, flags);
   }
   if (weight.z > 0.0f) {
     float2 uv = make_float2((signed_N.z > 0.0f) ? 1.0f - co.y : co.y, co.x);
-    f += weight.z * svm_image_texture(kg, id, uv.x, uv.y, flags);
+    f += weight.z * svm_image_texture(kg, sd, id, uv.x, uv.y, flags);
   }
 
   if (stack_valid(out_offset))
@@ -236,7 +270,7 @@ ccl_device void svm_node_tex_environment(KernelGlobals *kg,
   else
     uv = direction_to_mirrorball(co);
 
-  float4 f = svm_image_texture(kg, id, uv.x, uv.y, flags);
+  float4 f = svm_image_texture(kg, sd, id, uv.x, uv.y, flags);
 
   if (stack_valid(out_offset))
     stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -22,6 +22,7 @@
 #include "util/util_map.h"
 #include "util/util_system.h"
 #include "util/util_task.h"
+#include "util/util_tbb.h"
 #include "util/util_time.h"
 
 #include <OpenImageIO/filesystem.h>
@@ -460,14 +461,17 @@ bool DenoiseTask::load_input_pixels(int layer)
     buffer_data += frame_stride;
   }
 
-  /* Preprocess */
+  /* Preprocess, with rows in parallel. */
   buffer_data = input_pixels.data();
   for (int neighbor = 0; neighbor < image.in_neighbors.size() + 1; neighbor++) {
     /* Clamp */
     if (denoiser->params.clamp_input) {
-      for (int i = 0; i < num_pixels * INPUT_NUM_CHANNELS; i++) {
-        buffer_data[i] = clamp(buffer_data[i], -1e8f, 1e8f);
-      }
+      parallel_for(0, h, [&](int y) {
+        float *row = buffer_data + y * w * INPUT_NUM_CHANNELS;
+        for (int i = 0; i < w * INPUT_NUM_CHANNELS; i++) {
+          row[i] = clamp(row[i], -1e8f, 1e8f);
+        }
+      });
     }
 
     /* Box blur */
@@ -475,7 +479,7 @@ bool DenoiseTask::load_input_pixels(int layer)
     float *data = buffer_data + 14;
     array<float> temp(num_pixels);
 
-    for (int y = 0; y < h; y++) {
+    parallel_for(0, h, [&](int y) {
       for (int x = 0; x < w; x++) {
         int n = 0;
         float sum = 0.0f;
@@ -484,9 +488,9 @@ bool DenoiseTask::load_input_pixels(int layer)
         }
         temp[y * w + x] = sum / n;
       }
-    }
+    });
 
-    for (int y = 0; y < h; y++) {
+    parallel_for(0, h, [&](int y) {
       for (int x = 0; x < w; x++) {
         int n = 0;
         float sum = 0.0f;
@@ -497,11 +501,11 @@ bool DenoiseTask::load_input_pixels(int layer)
 
         data[INPUT_NUM_CHANNELS * (y * w + x)] = sum / n;
       }
-    }
+    });
 
     /* Highlight compression */
     data = buffer_data + 8;
-    for (int y = 0; y < h; y++) {
+    parallel_for(0, h, [&](int y) {
       for (int x = 0; x < w; x++) {
         int idx = INPUT_NUM_CHANNELS * (y * w + x);
         float3 color = make_float3(data[idx], data[idx + 1], data[idx + 2]);
@@ -510,14 +514,11 @@ bool DenoiseTask::load_input_pixels(int layer)
         data[idx + 1] = color.y;
         data[idx + 2] = color.z;
       }
-    }
+    });
 
     buffer_data += frame_stride;
   }
 
-  /* Copy to device */
-  input_pixels.copy_to_device();
-
   return true;
 }
 
@@ -539,10 +540,10 @@ bool DenoiseTask::load()
     return false;
   }
 
-  /* Allocate device buffer. */
+  /* Allocate host buffer, it is copied to the device in exec() so that loading does not
+   * interfere with denoising of another frame on the device. */
   int num_frames = image.in_neighbors.size() + 1;
   input_pixels.alloc(image.width * INPUT_NUM_CHANNELS, image.height * num_frames);
-  input_pixels.zero_to_device();
 
   /* Read pixels for first layer. */
   current_layer = 0;
@@ -564,6 +565,8 @@ bool DenoiseTask::exec()
     }
 
     /* Run task on device. */
+    input_pixels.copy_to_device();
+
     DeviceTask task(DeviceTask::RENDER);
     create_task(task);
     device->task_add(task);
@@ -572,12 +575,15 @@ bool DenoiseTask::exec()
     printf("\n");
   }
 
+  /* Free device memory before saving, which may happen in another thread. */
+  input_pixels.free();
+
   return true;
 }
 
-bool DenoiseTask::save()
+bool DenoiseTask::save(const string &out_filepath)
 {
-  bool ok = image.save_output(denoiser->output[frame], error);
+  bool ok = image.save_output(out_filepath, error);
   free();
   return ok;
 }
@@ -812,50 +818,37 @@ bool DenoiseImage::save_output(const string &out_filepath, string &error)
     }
   }
 
-  /* We don't need input anymore at this point, and will possibly
-   * overwrite the same file. */
+  /* We don't need input anymore at this point. */
   close_input();
 
-  /* Write to temporary file path, so we denoise images in place and don't
-   * risk destroying files when something goes wrong in file saving. */
-  string extension = OIIO::Filesystem::extension(out_filepath);
-  string unique_name = ".denoise-tmp-" + OIIO::Filesystem::unique_path();
-  string tmp_filepath = out_filepath + unique_name + extension;
-  unique_ptr<ImageOutput> out(ImageOutput::create(tmp_filepath));
+  unique_ptr<ImageOutput> out(ImageOutput::create(out_filepath));
 
   if (!out) {
-    error = "Failed to open temporary file " + tmp_filepath + " for writing";
+    error = "Failed to open file " + out_filepath + " for writing";
     return false;
   }
 
-  /* Open temporary file and write image buffers. */
-  if (!out->open(tmp_filepath, out_spec)) {
-    error = "Failed to open file " + tmp_filepath + " for writing: " + out->geterror();
+  /* Open file and write image buffers. */
+  if (!out->open(out_filepath, out_spec)) {
+    error = "Failed to open file " + out_filepath + " for writing: " + out->geterror();
     return false;
   }
 
   bool ok = true;
   if (!out->write_image(TypeDesc::FLOAT, pixels.data())) {
-    error = "Failed to write to file " + tmp_filepath + ": " + out->geterror();
+    error = "Failed to write to file " + out_filepath + ": " + out->geterror();
     ok = false;
   }
 
   if (!out->close()) {
-    error = "Failed to save to file " + tmp_filepath + ": " + out->geterror();
+    error = "Failed to save to file " + out_filepath + ": " + out->geterror();
     ok = false;
   }
 
   out.reset();
 
-  /* Copy temporary file to outputput filepath. */
-  string rename_error;
-  if (ok && !OIIO::Filesystem::rename(tmp_filepath, out_filepath, rename_error)) {
-    error = "Failed to move denoised image to " + out_filepath + ": " + rename_error;
-    ok = false;
-  }
-
   if (!ok) {
-    OIIO::Filesystem::remove(tmp_filepath);
+    OIIO::Filesystem::remove(out_filepath);
   }
 
   return ok;
@@ -893,13 +886,34 @@ bool Denoiser::run()
 
   num_frames = output.size();
 
+  /* Skip empty output paths. */
+  vector<int> frames;
   for (int frame = 0; frame < num_frames; frame++) {
-    /* Skip empty output paths. */
-    if (output[frame].empty()) {
-      continue;
+    if (!output[frame].empty()) {
+      frames.push_back(frame);
     }
+  }
+
+  /* Write to temporary file paths, so we denoise images in place and don't risk destroying
+   * files when something goes wrong in file saving. Files are only moved to the output paths
+   * once all frames are denoised, as later frames may still read them as neighbors. */
+  vector<string> tmp_filepaths(frames.size());
+  for (size_t i = 0; i < frames.size(); i++) {
+    const string &out_filepath = output[frames[i]];
+    const string extension = OIIO::Filesystem::extension(out_filepath);
+    const string unique_name = ".denoise-tmp-" + OIIO::Filesystem::unique_path();
+    tmp_filepaths[i] = out_filepath + unique_name + extension;
+  }
 
+  /* Frames are processed in a pipeline: while one frame is denoised on the device, the next
+   * frame is loaded and preprocessed and the previous one is saved, each in its own thread. */
+  vector<unique_ptr<DenoiseTask>> tasks(frames.size());
+  /* Not vector<bool>, since elements are written from different threads. */
+  vector<int> tasks_ok(frames.size(), true);
+
+  auto load_task = [&](size_t i) {
     /* Determine neighbor frame numbers that should be used for filtering. */
+    const int frame = frames[i];
     vector<int> neighbor_frames;
     for (int f = frame - params.neighbor_frames; f <= frame + params.neighbor_frames; f++) {
       if (f >= 0 && f < num_frames && f != frame) {
@@ -907,27 +921,95 @@ bool Denoiser::run()
       }
     }
 
+    tasks[i].reset(new DenoiseTask(device, this, frame, neighbor_frames));
+    tasks_ok[i] = tasks[i]->load();
+  };
+
+  auto save_task = [&](size_t i) {
+    tasks_ok[i] = tasks[i]->save(tmp_filepaths[i]);
+    if (tasks_ok[i]) {
+      tasks[i].reset();
+    }
+  };
+
+  unique_ptr<thread> load_thread, save_thread;
+  size_t save_index = 0;
+  bool ok = true;
+
+  if (!frames.empty()) {
+    load_task(0);
+  }
+
+  for (size_t i = 0; i < frames.size() && ok; i++) {
+    if (load_thread) {
+      load_thread->join();
+      load_thread.reset();
+    }
+
+    if (!tasks_ok[i]) {
+      error = tasks[i]->error;
+      ok = false;
+      break;
+    }
+
+    if (i + 1 < frames.size()) {
+      load_thread.reset(new thread(function_bind(load_task, i + 1)));
+    }
+
     /* Execute task. */
-    DenoiseTask task(device, this, frame, neighbor_frames);
-    if (!task.load()) {
-      error = task.error;
-      return false;
+    if (!tasks[i]->exec()) {
+      error = tasks[i]->error;
+      ok = false;
+      break;
     }
 
-    if (!task.exec()) {
-      error = task.error;
-      return false;
+    if (save_thread) {
+      save_thread->join();
+      save_thread.reset();
+
+      if (!tasks_ok[save_index]) {
+        error = tasks[save_index]->error;
+        ok = false;
+        break;
+      }
     }
 
-    if (!task.save()) {
-      error = task.error;
-      return false;
+    save_index = i;
+    save_thread.reset(new thread(function_bind(save_task, i)));
+  }
+
+  /* Wait for remaining threads, also when stopping early on errors. */
+  if (load_thread) {
+    load_thread->join();
+  }
+
+  if (save_thread) {
+    save_thread->join();
+
+    if (ok && !tasks_ok[save_index]) {
+      error = tasks[save_index]->error;
+      ok = false;
     }
+  }
 
-    task.free();
+  /* Copy temporary files to output filepaths. */
+  for (size_t i = 0; i < frames.size() && ok; i++) {
+    string rename_error;
+    if (!OIIO::Filesystem::rename(tmp_filepaths[i], output[frames[i]], rename_error)) {
+      error = "Failed to move denoised image to " + output[frames[i]] + ": " + rename_error;
+      ok = false;
+    }
   }
 
-  return true;
+  if (!ok) {
+    foreach (const string &tmp_filepath, tmp_filepaths) {
+      if (OIIO::Filesystem::exists(tmp_filepath)) {
+        OIIO::Filesystem::remove(tmp_filepath);
+      }
+    }
+  }
+
+  return ok;
 }
 
 CCL_NAMESPACE_END
@@ -161,12 +161,14 @@ class DenoiseTask {
   /* Task stages */
   bool load();
   bool exec();
-  bool save();
+  bool save(const string &out_filepath);
   void free();
 
   string error;
 
  protected:
+  friend class Denoiser;
+
   /* Denoiser parameters and device */
   Denoiser *denoiser;
   Device *device;
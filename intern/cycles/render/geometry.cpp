@@ -33,6 +33,7 @@
 #include "render/stats.h"
 #include "render/volume.h"
 
+#include "subd/subd_dice.h"
 #include "subd/subd_patch_table.h"
 #include "subd/subd_split.h"
 
@@ -41,6 +42,7 @@
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -209,6 +211,7 @@ void Geometry::compute_bvh(
       bparams.bvh_layout = bvh_layout;
       bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
                                     params->use_bvh_unaligned_nodes;
+      bparams.use_compressed_nodes = params->use_bvh_compressed_nodes;
       bparams.num_motion_triangle_steps = params->num_bvh_time_steps;
       bparams.num_motion_curve_steps = params->num_bvh_time_steps;
       bparams.bvh_type = params->bvh_type;
@@ -264,10 +267,12 @@ GeometryManager::GeometryManager()
 {
   need_update = true;
   need_flags_update = true;
+  scene_bvh = NULL;
 }
 
 GeometryManager::~GeometryManager()
 {
+  free_scene_bvh();
 }
 
 void GeometryManager::update_osl_attributes(Device *device,
@@ -657,8 +662,17 @@ void GeometryManager::device_update_attributes(Device *device,
    * maps next */
 
   /* Pre-allocate attributes to avoid arrays re-allocation which would
-   * take 2x of overall attribute memory usage.
+   * take 2x of overall attribute memory usage. Also remember where the
+   * attributes of every geometry start, so they can be filled in parallel.
    */
+  struct AttributeOffsets {
+    size_t float_offset;
+    size_t float2_offset;
+    size_t float3_offset;
+    size_t uchar4_offset;
+  };
+  vector<AttributeOffsets> geom_attributes_offsets(scene->geometry.size());
+
   size_t attr_float_size = 0;
   size_t attr_float2_size = 0;
   size_t attr_float3_size = 0;
@@ -666,6 +680,13 @@ void GeometryManager::device_update_attributes(Device *device,
   for (size_t i = 0; i < scene->geometry.size(); i++) {
     Geometry *geom = scene->geometry[i];
     AttributeRequestSet &attributes = geom_attributes[i];
+
+    AttributeOffsets &offsets = geom_attributes_offsets[i];
+    offsets.float_offset = attr_float_size;
+    offsets.float2_offset = attr_float2_size;
+    offsets.float3_offset = attr_float3_size;
+    offsets.uchar4_offset = attr_uchar4_size;
+
     foreach (AttributeRequest &req, attributes.requests) {
       Attribute *attr = geom->attributes.find(req);
 
@@ -697,16 +718,22 @@ void GeometryManager::device_update_attributes(Device *device,
   dscene->attributes_float3.alloc(attr_float3_size);
   dscene->attributes_uchar4.alloc(attr_uchar4_size);
 
-  size_t attr_float_offset = 0;
-  size_t attr_float2_offset = 0;
-  size_t attr_float3_offset = 0;
-  size_t attr_uchar4_offset = 0;
+  /* Fill in attributes, every geometry writes to its own range of the arrays
+   * so the result does not depend on the order the tasks run in. */
+  parallel_for(size_t(0), scene->geometry.size(), [&](size_t i) {
+    if (progress.get_cancel()) {
+      return;
+    }
 
-  /* Fill in attributes. */
-  for (size_t i = 0; i < scene->geometry.size(); i++) {
     Geometry *geom = scene->geometry[i];
     AttributeRequestSet &attributes = geom_attributes[i];
 
+    const AttributeOffsets &offsets = geom_attributes_offsets[i];
+    size_t attr_float_offset = offsets.float_offset;
+    size_t attr_float2_offset = offsets.float2_offset;
+    size_t attr_float3_offset = offsets.float3_offset;
+    size_t attr_uchar4_offset = offsets.uchar4_offset;
+
     /* todo: we now store std and name attributes from requests even if
      * they actually refer to the same mesh attributes, optimize */
     foreach (AttributeRequest &req, attributes.requests) {
@@ -743,11 +770,11 @@ void GeometryManager::device_update_attributes(Device *device,
                                         req.subd_type,
                                         req.subd_desc);
       }
-
-      if (progress.get_cancel())
-        return;
     }
-  }
+  });
+
+  if (progress.get_cancel())
+    return;
 
   /* create attribute lookup maps */
   if (scene->shader_manager->use_osl())
@@ -916,8 +943,11 @@ void GeometryManager::device_update_mesh(
     uint *tri_patch = dscene->tri_patch.alloc(tri_size);
     float2 *tri_patch_uv = dscene->tri_patch_uv.alloc(vert_size);
 
-    foreach (Geometry *geom, scene->geometry) {
-      if (geom->type == Geometry::MESH || geom->type == Geometry::VOLUME) {
+    /* Offsets are already computed, so meshes can be packed in parallel. */
+    parallel_for(size_t(0), scene->geometry.size(), [&](size_t i) {
+      Geometry *geom = scene->geometry[i];
+      if ((geom->type == Geometry::MESH || geom->type == Geometry::VOLUME) &&
+          !progress.get_cancel()) {
         Mesh *mesh = static_cast<Mesh *>(geom);
         mesh->pack_shaders(scene, &tri_shader[mesh->prim_offset]);
         mesh->pack_normals(&vnormal[mesh->vert_offset]);
@@ -927,10 +957,11 @@ void GeometryManager::device_update_mesh(
                          &tri_patch_uv[mesh->vert_offset],
                          mesh->vert_offset,
                          mesh->prim_offset);
-        if (progress.get_cancel())
-          return;
       }
-    }
+    });
+
+    if (progress.get_cancel())
+      return;
 
     /* vertex coordinates */
     progress.set_status("Updating Mesh", "Copying Mesh to device");
@@ -948,17 +979,19 @@ void GeometryManager::device_update_mesh(
     float4 *curve_keys = dscene->curve_keys.alloc(curve_key_size);
     float4 *curves = dscene->curves.alloc(curve_size);
 
-    foreach (Geometry *geom, scene->geometry) {
-      if (geom->type == Geometry::HAIR) {
+    parallel_for(size_t(0), scene->geometry.size(), [&](size_t i) {
+      Geometry *geom = scene->geometry[i];
+      if (geom->type == Geometry::HAIR && !progress.get_cancel()) {
         Hair *hair = static_cast<Hair *>(geom);
         hair->pack_curves(scene,
                           &curve_keys[hair->curvekey_offset],
                           &curves[hair->prim_offset],
                           hair->curvekey_offset);
-        if (progress.get_cancel())
-          return;
       }
-    }
+    });
+
+    if (progress.get_cancel())
+      return;
 
     dscene->curve_keys.copy_to_device();
     dscene->curves.copy_to_device();
@@ -969,8 +1002,9 @@ void GeometryManager::device_update_mesh(
 
     uint *patch_data = dscene->patches.alloc(patch_size);
 
-    foreach (Geometry *geom, scene->geometry) {
-      if (geom->type == Geometry::MESH) {
+    parallel_for(size_t(0), scene->geometry.size(), [&](size_t i) {
+      Geometry *geom = scene->geometry[i];
+      if (geom->type == Geometry::MESH && !progress.get_cancel()) {
         Mesh *mesh = static_cast<Mesh *>(geom);
         mesh->pack_patches(&patch_data[mesh->patch_offset],
                            mesh->vert_offset,
@@ -981,11 +1015,11 @@ void GeometryManager::device_update_mesh(
           mesh->patch_table->copy_adjusting_offsets(&patch_data[mesh->patch_table_offset],
                                                     mesh->patch_table_offset);
         }
-
-        if (progress.get_cancel())
-          return;
       }
-    }
+    });
+
+    if (progress.get_cancel())
+      return;
 
     dscene->patches.copy_to_device();
   }
@@ -1008,13 +1042,59 @@ void GeometryManager::device_update_mesh(
   }
 }
 
+template<typename T>
+static void bvh_array_to_device(device_vector<T> &dst, array<T> &src, const bool keep_src)
+{
+  if (src.size() == 0) {
+    return;
+  }
+
+  if (keep_src) {
+    memcpy(dst.alloc(src.size()), src.data(), sizeof(T) * src.size());
+  }
+  else {
+    dst.steal_data(src);
+  }
+  dst.copy_to_device();
+}
+
+bool GeometryManager::scene_bvh_can_refit(Scene *scene,
+                                          const BVHParams &bparams,
+                                          bool geometry_rebuilt)
+{
+  /* Collect per object state that affects which primitives end up in the scene BVH. */
+  vector<pair<Geometry *, int>> objects;
+  objects.reserve(scene->objects.size());
+  foreach (Object *ob, scene->objects) {
+    Geometry *geom = ob->geometry;
+    const int state = (ob->is_traceable() ? 1 : 0) | (geom->is_instanced() ? 2 : 0) |
+                      (ob->use_motion() ? 4 : 0) | (geom->use_motion_blur ? 8 : 0);
+    objects.push_back(std::make_pair(geom, state));
+  }
+
+  const bool can_refit = scene_bvh && !geometry_rebuilt &&
+                         scene_bvh->params.bvh_layout == bparams.bvh_layout &&
+                         scene_bvh->params.use_unaligned_nodes == bparams.use_unaligned_nodes &&
+                         scene_bvh->params.use_compressed_nodes == bparams.use_compressed_nodes &&
+                         scene_bvh->params.num_motion_triangle_steps ==
+                             bparams.num_motion_triangle_steps &&
+                         scene_bvh->params.num_motion_curve_steps ==
+                             bparams.num_motion_curve_steps &&
+                         scene_bvh->params.bvh_type == bparams.bvh_type &&
+                         scene_bvh->params.curve_subdivisions == bparams.curve_subdivisions &&
+                         scene_bvh->objects == scene->objects &&
+                         scene_bvh->geometry == scene->geometry && scene_bvh_objects == objects;
+
+  scene_bvh_objects.swap(objects);
+  return can_refit;
+}
+
 void GeometryManager::device_update_bvh(Device *device,
                                         DeviceScene *dscene,
                                         Scene *scene,
+                                        bool geometry_rebuilt,
                                         Progress &progress)
 {
-  /* bvh build */
-  progress.set_status("Updating Scene BVH", "Building");
 
   BVHParams bparams;
   bparams.top_level = true;
@@ -1023,6 +1103,7 @@ void GeometryManager::device_update_bvh(Device *device,
   bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
   bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
                                 scene->params.use_bvh_unaligned_nodes;
+  bparams.use_compressed_nodes = scene->params.use_bvh_compressed_nodes;
   bparams.num_motion_triangle_steps = scene->params.num_bvh_time_steps;
   bparams.num_motion_curve_steps = scene->params.num_bvh_time_steps;
   bparams.bvh_type = scene->params.bvh_type;
@@ -1030,8 +1111,27 @@ void GeometryManager::device_update_bvh(Device *device,
 
   VLOG(1) << "Using " << bvh_layout_name(bparams.bvh_layout) << " layout.";
 
-  BVH *bvh = BVH::create(bparams, scene->geometry, scene->objects, device);
-  bvh->build(progress, &device->stats);
+  /* Only BVH2 supports refitting the scene BVH, other layouts are rebuilt every update. Keeping
+   * the BVH duplicates its packed arrays on the host, so only do it when the scene may be
+   * updated again, for interactive renders or with persistent data. */
+  const bool keep_bvh = (bparams.bvh_layout == BVH_LAYOUT_BVH2) &&
+                        (!scene->params.background || scene->params.persistent_data);
+  const bool refit = keep_bvh && scene_bvh_can_refit(scene, bparams, geometry_rebuilt);
+  BVH *bvh;
+
+  if (refit) {
+    progress.set_status("Updating Scene BVH", "Refitting");
+
+    bvh = scene_bvh;
+    bvh->refit(progress);
+  }
+  else {
+    progress.set_status("Updating Scene BVH", "Building");
+
+    free_scene_bvh();
+    bvh = BVH::create(bparams, scene->geometry, scene->objects, device);
+    bvh->build(progress, &device->stats);
+  }
 
   if (progress.get_cancel()) {
 #ifdef WITH_EMBREE
@@ -1040,7 +1140,12 @@ void GeometryManager::device_update_bvh(Device *device,
       dscene->data.bvh.scene = NULL;
     }
 #endif
-    delete bvh;
+    if (bvh == scene_bvh) {
+      free_scene_bvh();
+    }
+    else {
+      delete bvh;
+    }
     return;
   }
 
@@ -1049,46 +1154,16 @@ void GeometryManager::device_update_bvh(Device *device,
 
   PackedBVH &pack = bvh->pack;
 
-  if (pack.nodes.size()) {
-    dscene->bvh_nodes.steal_data(pack.nodes);
-    dscene->bvh_nodes.copy_to_device();
-  }
-  if (pack.leaf_nodes.size()) {
-    dscene->bvh_leaf_nodes.steal_data(pack.leaf_nodes);
-    dscene->bvh_leaf_nodes.copy_to_device();
-  }
-  if (pack.object_node.size()) {
-    dscene->object_node.steal_data(pack.object_node);
-    dscene->object_node.copy_to_device();
-  }
-  if (pack.prim_tri_index.size()) {
-    dscene->prim_tri_index.steal_data(pack.prim_tri_index);
-    dscene->prim_tri_index.copy_to_device();
-  }
-  if (pack.prim_tri_verts.size()) {
-    dscene->prim_tri_verts.steal_data(pack.prim_tri_verts);
-    dscene->prim_tri_verts.copy_to_device();
-  }
-  if (pack.prim_type.size()) {
-    dscene->prim_type.steal_data(pack.prim_type);
-    dscene->prim_type.copy_to_device();
-  }
-  if (pack.prim_visibility.size()) {
-    dscene->prim_visibility.steal_data(pack.prim_visibility);
-    dscene->prim_visibility.copy_to_device();
-  }
-  if (pack.prim_index.size()) {
-    dscene->prim_index.steal_data(pack.prim_index);
-    dscene->prim_index.copy_to_device();
-  }
-  if (pack.prim_object.size()) {
-    dscene->prim_object.steal_data(pack.prim_object);
-    dscene->prim_object.copy_to_device();
-  }
-  if (pack.prim_time.size()) {
-    dscene->prim_time.steal_data(pack.prim_time);
-    dscene->prim_time.copy_to_device();
-  }
+  bvh_array_to_device(dscene->bvh_nodes, pack.nodes, keep_bvh);
+  bvh_array_to_device(dscene->bvh_leaf_nodes, pack.leaf_nodes, keep_bvh);
+  bvh_array_to_device(dscene->object_node, pack.object_node, keep_bvh);
+  bvh_array_to_device(dscene->prim_tri_index, pack.prim_tri_index, keep_bvh);
+  bvh_array_to_device(dscene->prim_tri_verts, pack.prim_tri_verts, keep_bvh);
+  bvh_array_to_device(dscene->prim_type, pack.prim_type, keep_bvh);
+  bvh_array_to_device(dscene->prim_visibility, pack.prim_visibility, keep_bvh);
+  bvh_array_to_device(dscene->prim_index, pack.prim_index, keep_bvh);
+  bvh_array_to_device(dscene->prim_object, pack.prim_object, keep_bvh);
+  bvh_array_to_device(dscene->prim_time, pack.prim_time, keep_bvh);
 
   dscene->data.bvh.root = pack.root_index;
   dscene->data.bvh.bvh_layout = bparams.bvh_layout;
@@ -1097,7 +1172,19 @@ void GeometryManager::device_update_bvh(Device *device,
 
   bvh->copy_to_device(progress, dscene);
 
-  delete bvh;
+  if (keep_bvh) {
+    bvh->discard_instances();
+    scene_bvh = bvh;
+  }
+  else {
+    delete bvh;
+  }
+}
+
+void GeometryManager::free_scene_bvh()
+{
+  delete scene_bvh;
+  scene_bvh = NULL;
 }
 
 void GeometryManager::device_update_preprocess(Device *device, Scene *scene, Progress &progress)
@@ -1308,7 +1395,19 @@ void GeometryManager::device_update(Device *device,
 
         progress.set_status("Updating Mesh", msg);
 
+        /* Keep diced vertices around for the next tessellation, when the mesh is
+         * likely to be tessellated again for a different dicing camera. */
+        const bool use_dice_cache = !scene->params.background || scene->params.persistent_data;
+        if (use_dice_cache && !mesh->dice_cache) {
+          mesh->dice_cache = new DiceCache();
+        }
+        else if (!use_dice_cache && mesh->dice_cache) {
+          delete mesh->dice_cache;
+          mesh->dice_cache = NULL;
+        }
+
         mesh->subd_params->camera = dicing_camera;
+        mesh->subd_params->cache = mesh->dice_cache;
         DiagSplit dsplit(*mesh->subd_params);
         mesh->tessellate(&dsplit);
 
@@ -1365,6 +1464,7 @@ void GeometryManager::device_update(Device *device,
   BVHLayout bvh_layout = BVHParams::best_bvh_layout(scene->params.bvh_layout,
                                                     device->get_bvh_layout_mask());
   bool displacement_done = false;
+  bool geometry_rebuilt = false;
   size_t num_bvh = 0;
 
   {
@@ -1386,6 +1486,10 @@ void GeometryManager::device_update(Device *device,
         if (geom->need_build_bvh(bvh_layout)) {
           num_bvh++;
         }
+
+        if (geom->need_update_rebuild) {
+          geometry_rebuilt = true;
+        }
       }
 
       if (progress.get_cancel())
@@ -1461,7 +1565,7 @@ void GeometryManager::device_update(Device *device,
         scene->update_stats->geometry.times.add_entry({"device_update (build scene BVH)", time});
       }
     });
-    device_update_bvh(device, dscene, scene, progress);
+    device_update_bvh(device, dscene, scene, geometry_rebuilt, progress);
     if (progress.get_cancel())
       return;
   }
@@ -24,6 +24,7 @@
 #include "render/attribute.h"
 
 #include "util/util_boundbox.h"
+#include "util/util_map.h"
 #include "util/util_set.h"
 #include "util/util_transform.h"
 #include "util/util_types.h"
@@ -162,10 +163,22 @@ class GeometryManager {
   /* Updates */
   void tag_update(Scene *scene);
 
+  /* Free scene BVH kept for refitting. Called by the scene when geometry or objects are deleted,
+   * since a node created later may reuse the address of a deleted one. */
+  void free_scene_bvh();
+
   /* Statistics */
   void collect_statistics(const Scene *scene, RenderStats *stats);
 
  protected:
+  /* Scene BVH kept between updates of interactive and persistent data renders, so it can be
+   * refitted instead of rebuilt when only vertex positions and object transforms changed. */
+  BVH *scene_bvh;
+  /* Per object state that the structure of the scene BVH depends on. */
+  vector<pair<Geometry *, int>> scene_bvh_objects;
+
+  bool scene_bvh_can_refit(Scene *scene, const BVHParams &bparams, bool geometry_rebuilt);
+
   bool displace(Device *device, DeviceScene *dscene, Scene *scene, Mesh *mesh, Progress &progress);
 
   void create_volume_mesh(Volume *volume, Progress &progress);
@@ -195,7 +208,11 @@ class GeometryManager {
                                 Scene *scene,
                                 Progress &progress);
 
-  void device_update_bvh(Device *device, DeviceScene *dscene, Scene *scene, Progress &progress);
+  void device_update_bvh(Device *device,
+                         DeviceScene *dscene,
+                         Scene *scene,
+                         bool geometry_rebuilt,
+                         Progress &progress);
 
   void device_update_displacement_images(Device *device, Scene *scene, Progress &progress);
 
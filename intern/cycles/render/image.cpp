@@ -30,6 +30,7 @@
 #include "util/util_progress.h"
 #include "util/util_task.h"
 #include "util/util_texture.h"
+#include "util/util_texture_cache.h"
 #include "util/util_unique_ptr.h"
 
 #ifdef WITH_OSL
@@ -77,6 +78,10 @@ const char *name_from_type(ImageDataType type)
       return "nanovdb_float";
     case IMAGE_DATA_TYPE_NANOVDB_FLOAT3:
       return "nanovdb_float3";
+    case IMAGE_DATA_TYPE_SPARSE_FLOAT:
+      return "sparse_float";
+    case IMAGE_DATA_TYPE_SPARSE_FLOAT4:
+      return "sparse_float4";
     case IMAGE_DATA_NUM_TYPES:
       assert(!"System enumerator type, should never be used");
       return "";
@@ -219,6 +224,7 @@ ImageMetaData::ImageMetaData()
       colorspace(u_colorspace_raw),
       colorspace_file_format(""),
       use_transform_3d(false),
+      use_sparse_3d(false),
       compress_as_srgb(false)
 {
 }
@@ -234,7 +240,8 @@ bool ImageMetaData::operator==(const ImageMetaData &other) const
 bool ImageMetaData::is_float() const
 {
   return (type == IMAGE_DATA_TYPE_FLOAT || type == IMAGE_DATA_TYPE_FLOAT4 ||
-          type == IMAGE_DATA_TYPE_HALF || type == IMAGE_DATA_TYPE_HALF4);
+          type == IMAGE_DATA_TYPE_HALF || type == IMAGE_DATA_TYPE_HALF4 ||
+          type == IMAGE_DATA_TYPE_SPARSE_FLOAT || type == IMAGE_DATA_TYPE_SPARSE_FLOAT4);
 }
 
 void ImageMetaData::detect_colorspace()
@@ -304,6 +311,11 @@ ImageManager::ImageManager(const DeviceInfo &info)
 
   /* Set image limits */
   has_half_images = info.has_half_images;
+
+  /* Only the CPU kernel can read pixels on demand and sample sparse volume grids. */
+  has_texture_cache = (info.type == DEVICE_CPU);
+  has_sparse_3d = (info.type == DEVICE_CPU);
+  texture_cache_acquired = false;
 }
 
 ImageManager::~ImageManager()
@@ -346,6 +358,7 @@ void ImageManager::load_image_metadata(Image *img)
   ImageMetaData &metadata = img->metadata;
   metadata = ImageMetaData();
   metadata.colorspace = img->params.colorspace;
+  metadata.use_sparse_3d = has_sparse_3d;
 
   if (img->loader->load_metadata(metadata)) {
     assert(metadata.type != IMAGE_DATA_NUM_TYPES);
@@ -448,6 +461,7 @@ int ImageManager::add_image_slot(ImageLoader *loader,
   img->builtin = builtin;
   img->users = 1;
   img->mem = NULL;
+  img->loaded_mem = NULL;
 
   images[slot] = img;
 
@@ -491,7 +505,7 @@ static bool image_associate_alpha(ImageManager::Image *img)
 }
 
 template<TypeDesc::BASETYPE FileFormat, typename StorageType>
-bool ImageManager::file_load_image(Image *img, int texture_limit)
+bool ImageManager::file_load_image(Image *img, device_texture *mem, int texture_limit)
 {
   /* we only handle certain number of components */
   if (!(img->metadata.channels >= 1 && img->metadata.channels <= 4)) {
@@ -520,7 +534,7 @@ bool ImageManager::file_load_image(Image *img, int texture_limit)
   }
   else {
     thread_scoped_lock device_lock(device_mutex);
-    pixels = (StorageType *)img->mem->alloc(width, height, depth);
+    pixels = (StorageType *)mem->alloc(width, height, depth);
   }
 
   if (pixels == NULL) {
@@ -637,7 +651,7 @@ bool ImageManager::file_load_image(Image *img, int texture_limit)
 
     {
       thread_scoped_lock device_lock(device_mutex);
-      texture_pixels = (StorageType *)img->mem->alloc(scaled_width, scaled_height, scaled_depth);
+      texture_pixels = (StorageType *)mem->alloc(scaled_width, scaled_height, scaled_depth);
     }
 
     memcpy(texture_pixels, &scaled_pixels[0], scaled_pixels.size() * sizeof(StorageType));
@@ -646,7 +660,46 @@ bool ImageManager::file_load_image(Image *img, int texture_limit)
   return true;
 }
 
-void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Progress *progress)
+bool ImageManager::use_texture_cache(Scene *scene, Image *img)
+{
+  if (!has_texture_cache || scene->params.texture_cache_size <= 0) {
+    return false;
+  }
+
+  /* Tiles are read from the file, so packed and generated images are loaded as usual. */
+  if (img->loader->osl_filepath().empty()) {
+    return false;
+  }
+
+  /* Pixels are used as stored in the file, so only 2D images that need no colorspace
+   * conversion or alpha handling other than OIIO's own associated alpha are supported. */
+  const ImageMetaData &metadata = img->metadata;
+  if (metadata.depth > 1) {
+    return false;
+  }
+  if (metadata.colorspace != u_colorspace_raw && metadata.colorspace != u_colorspace_srgb) {
+    return false;
+  }
+  if (metadata.channels == 2 || (metadata.channels > 3 && !image_associate_alpha(img))) {
+    return false;
+  }
+
+  return true;
+}
+
+uint64_t ImageManager::texture_cache_handle(Scene *scene, Image *img)
+{
+  thread_scoped_lock device_lock(device_mutex);
+
+  if (!texture_cache_acquired) {
+    TextureCache::init(scene->params.texture_cache_size);
+    texture_cache_acquired = true;
+  }
+
+  return TextureCache::get_handle(img->loader->osl_filepath().string());
+}
+
+void ImageManager::load_image_pixels(Device *device, Scene *scene, int slot, Progress *progress)
 {
   if (progress->get_cancel()) {
     return;
@@ -654,7 +707,11 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
 
   Image *img = images[slot];
 
-  progress->set_status("Updating Images", "Loading " + img->loader->name());
+  /* Pixels may already be loaded or being loaded in the background. */
+  thread_scoped_lock load_lock(img->load_mutex);
+  if (!img->need_load || img->loaded_mem) {
+    return;
+  }
 
   const int texture_limit = scene->params.texture_limit;
 
@@ -664,24 +721,26 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
   /* Name for debugging. */
   img->mem_name = string_printf("__tex_image_%s_%03d", name_from_type(type), slot);
 
-  /* Free previous texture in slot. */
-  if (img->mem) {
-    thread_scoped_lock device_lock(device_mutex);
-    delete img->mem;
-    img->mem = NULL;
-  }
-
-  img->mem = new device_texture(
+  /* Only fill in host memory here, the previous texture in the slot may still be
+   * in use and is replaced when copying to the device. */
+  device_texture *mem = new device_texture(
       device, img->mem_name.c_str(), slot, type, img->params.interpolation, img->params.extension);
-  img->mem->info.use_transform_3d = img->metadata.use_transform_3d;
-  img->mem->info.transform_3d = img->metadata.transform_3d;
+  mem->info.use_transform_3d = img->metadata.use_transform_3d;
+  mem->info.transform_3d = img->metadata.transform_3d;
+
+  /* Pixels in the texture cache are read on demand by the kernel, only a 1x1
+   * placeholder is allocated, which is also used if the lookup fails. */
+  const bool cached = use_texture_cache(scene, img);
+  if (cached) {
+    mem->info.cache_handle = texture_cache_handle(scene, img);
+  }
 
   /* Create new texture. */
   if (type == IMAGE_DATA_TYPE_FLOAT4) {
-    if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit)) {
+    if (cached || !file_load_image<TypeDesc::FLOAT, float>(img, mem, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
-      float *pixels = (float *)img->mem->alloc(1, 1);
+      float *pixels = (float *)mem->alloc(1, 1);
 
       pixels[0] = TEX_IMAGE_MISSING_R;
       pixels[1] = TEX_IMAGE_MISSING_G;
@@ -690,19 +749,19 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_FLOAT) {
-    if (!file_load_image<TypeDesc::FLOAT, float>(img, texture_limit)) {
+    if (cached || !file_load_image<TypeDesc::FLOAT, float>(img, mem, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
-      float *pixels = (float *)img->mem->alloc(1, 1);
+      float *pixels = (float *)mem->alloc(1, 1);
 
       pixels[0] = TEX_IMAGE_MISSING_R;
     }
   }
   else if (type == IMAGE_DATA_TYPE_BYTE4) {
-    if (!file_load_image<TypeDesc::UINT8, uchar>(img, texture_limit)) {
+    if (cached || !file_load_image<TypeDesc::UINT8, uchar>(img, mem, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
-      uchar *pixels = (uchar *)img->mem->alloc(1, 1);
+      uchar *pixels = (uchar *)mem->alloc(1, 1);
 
       pixels[0] = (TEX_IMAGE_MISSING_R * 255);
       pixels[1] = (TEX_IMAGE_MISSING_G * 255);
@@ -711,19 +770,19 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_BYTE) {
-    if (!file_load_image<TypeDesc::UINT8, uchar>(img, texture_limit)) {
+    if (cached || !file_load_image<TypeDesc::UINT8, uchar>(img, mem, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
-      uchar *pixels = (uchar *)img->mem->alloc(1, 1);
+      uchar *pixels = (uchar *)mem->alloc(1, 1);
 
       pixels[0] = (TEX_IMAGE_MISSING_R * 255);
     }
   }
   else if (type == IMAGE_DATA_TYPE_HALF4) {
-    if (!file_load_image<TypeDesc::HALF, half>(img, texture_limit)) {
+    if (cached || !file_load_image<TypeDesc::HALF, half>(img, mem, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
-      half *pixels = (half *)img->mem->alloc(1, 1);
+      half *pixels = (half *)mem->alloc(1, 1);
 
       pixels[0] = TEX_IMAGE_MISSING_R;
       pixels[1] = TEX_IMAGE_MISSING_G;
@@ -732,19 +791,19 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_USHORT) {
-    if (!file_load_image<TypeDesc::USHORT, uint16_t>(img, texture_limit)) {
+    if (cached || !file_load_image<TypeDesc::USHORT, uint16_t>(img, mem, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
-      uint16_t *pixels = (uint16_t *)img->mem->alloc(1, 1);
+      uint16_t *pixels = (uint16_t *)mem->alloc(1, 1);
 
       pixels[0] = (TEX_IMAGE_MISSING_R * 65535);
     }
   }
   else if (type == IMAGE_DATA_TYPE_USHORT4) {
-    if (!file_load_image<TypeDesc::USHORT, uint16_t>(img, texture_limit)) {
+    if (cached || !file_load_image<TypeDesc::USHORT, uint16_t>(img, mem, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
-      uint16_t *pixels = (uint16_t *)img->mem->alloc(1, 1);
+      uint16_t *pixels = (uint16_t *)mem->alloc(1, 1);
 
       pixels[0] = (TEX_IMAGE_MISSING_R * 65535);
       pixels[1] = (TEX_IMAGE_MISSING_G * 65535);
@@ -753,10 +812,10 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
     }
   }
   else if (type == IMAGE_DATA_TYPE_HALF) {
-    if (!file_load_image<TypeDesc::HALF, half>(img, texture_limit)) {
+    if (cached || !file_load_image<TypeDesc::HALF, half>(img, mem, texture_limit)) {
       /* on failure to load, we set a 1x1 pixels pink image */
       thread_scoped_lock device_lock(device_mutex);
-      half *pixels = (half *)img->mem->alloc(1, 1);
+      half *pixels = (half *)mem->alloc(1, 1);
 
       pixels[0] = TEX_IMAGE_MISSING_R;
     }
@@ -764,21 +823,59 @@ void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Pro
 #ifdef WITH_NANOVDB
   else if (type == IMAGE_DATA_TYPE_NANOVDB_FLOAT || type == IMAGE_DATA_TYPE_NANOVDB_FLOAT3) {
     thread_scoped_lock device_lock(device_mutex);
-    void *pixels = img->mem->alloc(img->metadata.byte_size, 0);
+    void *pixels = mem->alloc(img->metadata.byte_size, 0);
 
     if (pixels != NULL) {
       img->loader->load_pixels(img->metadata, pixels, img->metadata.byte_size, false);
     }
   }
 #endif
+  else if (type == IMAGE_DATA_TYPE_SPARSE_FLOAT || type == IMAGE_DATA_TYPE_SPARSE_FLOAT4) {
+    thread_scoped_lock device_lock(device_mutex);
+    void *pixels = mem->alloc(img->metadata.byte_size, 0);
+
+    if (pixels != NULL) {
+      img->loader->load_pixels(img->metadata, pixels, img->metadata.byte_size, false);
+    }
+
+    /* Dimensions of the grid in voxels, the memory itself is allocated as bytes. */
+    mem->info.width = img->metadata.width;
+    mem->info.height = img->metadata.height;
+    mem->info.depth = img->metadata.depth;
+  }
+
+  /* Cleanup memory in image loader. */
+  img->loader->cleanup();
+
+  img->loaded_mem = mem;
+}
 
+void ImageManager::device_load_image(Device *device, Scene *scene, int slot, Progress *progress)
+{
+  if (progress->get_cancel()) {
+    return;
+  }
+
+  Image *img = images[slot];
+
+  progress->set_status("Updating Images", "Loading " + img->loader->name());
+
+  load_image_pixels(device, scene, slot, progress);
+
+  thread_scoped_lock load_lock(img->load_mutex);
+  if (img->loaded_mem == NULL) {
+    return;
+  }
+
+  /* Replace previous texture in slot. */
   {
     thread_scoped_lock device_lock(device_mutex);
+    delete img->mem;
+    img->mem = img->loaded_mem;
+    img->loaded_mem = NULL;
     img->mem->copy_to_device();
   }
 
-  /* Cleanup memory in image loader. */
-  img->loader->cleanup();
   img->need_load = false;
 }
 
@@ -798,9 +895,10 @@ void ImageManager::device_free_image(Device *, int slot)
 #endif
   }
 
-  if (img->mem) {
+  if (img->mem || img->loaded_mem) {
     thread_scoped_lock device_lock(device_mutex);
     delete img->mem;
+    delete img->loaded_mem;
   }
 
   delete img->loader;
@@ -820,6 +918,16 @@ void ImageManager::device_update(Device *device, Scene *scene, Progress &progres
     }
   });
 
+  {
+    scoped_callback_timer timer([scene](double time) {
+      if (scene->update_stats) {
+        scene->update_stats->image.times.add_entry({"device_update (wait for pixels)", time});
+      }
+    });
+
+    load_pixels_pool.wait_work();
+  }
+
   TaskPool pool;
   for (size_t slot = 0; slot < images.size(); slot++) {
     Image *img = images[slot];
@@ -837,6 +945,23 @@ void ImageManager::device_update(Device *device, Scene *scene, Progress &progres
   need_update = false;
 }
 
+void ImageManager::device_load_pixels(Device *device, Scene *scene, Progress &progress)
+{
+  if (!need_update) {
+    return;
+  }
+
+  /* Read image files and convert pixels on the host while other managers are
+   * updating, uploading to the device happens later in device_update(). */
+  for (size_t slot = 0; slot < images.size(); slot++) {
+    Image *img = images[slot];
+    if (img && img->users > 0 && img->need_load && !img->loaded_mem) {
+      load_pixels_pool.push(
+          function_bind(&ImageManager::load_image_pixels, this, device, scene, slot, &progress));
+    }
+  }
+}
+
 void ImageManager::device_update_slot(Device *device, Scene *scene, int slot, Progress *progress)
 {
   Image *img = images[slot];
@@ -872,6 +997,8 @@ void ImageManager::device_load_builtin(Device *device, Scene *scene, Progress &p
 
 void ImageManager::device_free_builtin(Device *device)
 {
+  load_pixels_pool.wait_work();
+
   for (size_t slot = 0; slot < images.size(); slot++) {
     Image *img = images[slot];
     if (img && img->builtin) {
@@ -882,10 +1009,17 @@ void ImageManager::device_free_builtin(Device *device)
 
 void ImageManager::device_free(Device *device)
 {
+  load_pixels_pool.wait_work();
+
   for (size_t slot = 0; slot < images.size(); slot++) {
     device_free_image(device, slot);
   }
   images.clear();
+
+  if (texture_cache_acquired) {
+    TextureCache::exit();
+    texture_cache_acquired = false;
+  }
 }
 
 void ImageManager::collect_statistics(RenderStats *stats)
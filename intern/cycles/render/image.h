@@ -22,6 +22,7 @@
 #include "render/colorspace.h"
 
 #include "util/util_string.h"
+#include "util/util_task.h"
 #include "util/util_thread.h"
 #include "util/util_transform.h"
 #include "util/util_unique_ptr.h"
@@ -88,6 +89,9 @@ class ImageMetaData {
   bool use_transform_3d;
   Transform transform_3d;
 
+  /* Set by the image manager, if the device can sample sparse 3D images. */
+  bool use_sparse_3d;
+
   /* Automatically set. */
   bool compress_as_srgb;
 
@@ -177,6 +181,7 @@ class ImageManager {
                         const vector<int> &tiles);
   ImageHandle add_image(ImageLoader *loader, const ImageParams &params, const bool builtin = true);
 
+  void device_load_pixels(Device *device, Scene *scene, Progress &progress);
   void device_update(Device *device, Scene *scene, Progress &progress);
   void device_update_slot(Device *device, Scene *scene, int slot, Progress *progress);
   void device_free(Device *device);
@@ -203,13 +208,18 @@ class ImageManager {
 
     string mem_name;
     device_texture *mem;
+    device_texture *loaded_mem;
 
     int users;
     thread_mutex mutex;
+    thread_mutex load_mutex;
   };
 
  private:
   bool has_half_images;
+  bool has_texture_cache;
+  bool has_sparse_3d;
+  bool texture_cache_acquired;
 
   thread_mutex device_mutex;
   thread_mutex images_mutex;
@@ -218,6 +228,8 @@ class ImageManager {
   vector<Image *> images;
   void *osl_texture_system;
 
+  TaskPool load_pixels_pool;
+
   int add_image_slot(ImageLoader *loader, const ImageParams &params, const bool builtin);
   void add_image_user(int slot);
   void remove_image_user(int slot);
@@ -225,8 +237,12 @@ class ImageManager {
   void load_image_metadata(Image *img);
 
   template<TypeDesc::BASETYPE FileFormat, typename StorageType>
-  bool file_load_image(Image *img, int texture_limit);
+  bool file_load_image(Image *img, device_texture *mem, int texture_limit);
+
+  bool use_texture_cache(Scene *scene, Image *img);
+  uint64_t texture_cache_handle(Scene *scene, Image *img);
 
+  void load_image_pixels(Device *device, Scene *scene, int slot, Progress *progress);
   void device_load_image(Device *device, Scene *scene, int slot, Progress *progress);
   void device_free_image(Device *device, int slot);
 
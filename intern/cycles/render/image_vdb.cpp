@@ -24,8 +24,185 @@
 #  include <nanovdb/util/OpenToNanoVDB.h>
 #endif
 
+#include "util/util_logging.h"
+#include "util/util_tbb.h"
+#include "util/util_texture.h"
+
 CCL_NAMESPACE_BEGIN
 
+#if defined(WITH_OPENVDB) && !defined(WITH_NANOVDB)
+/* Sparse Textures
+ *
+ * Tiles of the texture are marked as used if they overlap a leaf node or an active tile
+ * of the tree, everything else has the background value and is left out. */
+
+template<typename GridType>
+static bool sparse_tiles_mark(const openvdb::GridBase::ConstPtr &grid_base,
+                              const openvdb::CoordBBox &bbox,
+                              vector<int> &tiles)
+{
+  typename GridType::ConstPtr grid = openvdb::gridConstPtrCast<GridType>(grid_base);
+
+  /* Left out tiles are read as zero. */
+  if (grid->background() != openvdb::zeroVal<typename GridType::ValueType>()) {
+    return false;
+  }
+
+  const openvdb::Coord dim = bbox.dim();
+  const int tiles_x = tex_sparse_num_tiles(dim.x());
+  const int tiles_y = tex_sparse_num_tiles(dim.y());
+
+  auto mark = [&](openvdb::CoordBBox node_bbox) {
+    node_bbox.intersect(bbox);
+    if (node_bbox.empty()) {
+      return;
+    }
+    const openvdb::Coord min = node_bbox.min() - bbox.min();
+    const openvdb::Coord max = node_bbox.max() - bbox.min();
+    for (int z = min.z() >> TEX_SPARSE_TILE_SHIFT; z <= max.z() >> TEX_SPARSE_TILE_SHIFT; z++) {
+      for (int y = min.y() >> TEX_SPARSE_TILE_SHIFT; y <= max.y() >> TEX_SPARSE_TILE_SHIFT; y++) {
+        for (int x = min.x() >> TEX_SPARSE_TILE_SHIFT; x <= max.x() >> TEX_SPARSE_TILE_SHIFT;
+             x++) {
+          tiles[x + (y + z * tiles_y) * tiles_x] = 0;
+        }
+      }
+    }
+  };
+
+  for (typename GridType::TreeType::LeafCIter leaf = grid->tree().cbeginLeaf(); leaf; ++leaf) {
+    mark(leaf->getNodeBoundingBox());
+  }
+
+  /* Active tiles of internal nodes, without visiting voxels of leaf nodes. */
+  typename GridType::ValueOnCIter iter = grid->cbeginValueOn();
+  iter.setMaxDepth(GridType::ValueOnCIter::LEAF_DEPTH - 1);
+  for (; iter; ++iter) {
+    openvdb::CoordBBox tile_bbox;
+    iter.getBoundingBox(tile_bbox);
+    mark(tile_bbox);
+  }
+
+  return true;
+}
+
+static void sparse_voxel_store(float &voxel, const float value)
+{
+  voxel = value;
+}
+
+static void sparse_voxel_store(float4 &voxel, const openvdb::Vec3f &value)
+{
+  voxel = make_float4(value.x(), value.y(), value.z(), 1.0f);
+}
+
+template<typename GridType, typename DenseType, typename T>
+static void sparse_tiles_copy(const openvdb::GridBase::ConstPtr &grid_base,
+                              const openvdb::CoordBBox &bbox,
+                              const vector<int> &tiles,
+                              T *voxels)
+{
+  typename GridType::ConstPtr grid = openvdb::gridConstPtrCast<GridType>(grid_base);
+
+  const openvdb::Coord dim = bbox.dim();
+  const int tiles_x = tex_sparse_num_tiles(dim.x());
+  const int tiles_y = tex_sparse_num_tiles(dim.y());
+  const int tiles_z = tex_sparse_num_tiles(dim.z());
+
+  parallel_for(0, tiles_z, [&](int z) {
+    vector<DenseType> tile_voxels(TEX_SPARSE_TILE_VOXELS);
+
+    for (int y = 0; y < tiles_y; y++) {
+      for (int x = 0; x < tiles_x; x++) {
+        const int tile = tiles[x + (y + z * tiles_y) * tiles_x];
+        if (tile == TEX_SPARSE_EMPTY_TILE) {
+          continue;
+        }
+
+        const openvdb::Coord tile_min = bbox.min() + openvdb::Coord(x << TEX_SPARSE_TILE_SHIFT,
+                                                                    y << TEX_SPARSE_TILE_SHIFT,
+                                                                    z << TEX_SPARSE_TILE_SHIFT);
+        const openvdb::CoordBBox tile_bbox(tile_min,
+                                           tile_min.offsetBy(TEX_SPARSE_TILE_SIZE - 1));
+
+        /* Tiles are small, copy serially and parallelize over tiles instead. */
+        openvdb::tools::Dense<DenseType, openvdb::tools::LayoutXYZ> dense(tile_bbox,
+                                                                          tile_voxels.data());
+        openvdb::tools::copyToDense(*grid, dense, true);
+
+        T *tile_out = voxels + (size_t)tile * TEX_SPARSE_TILE_VOXELS;
+        for (int i = 0; i < TEX_SPARSE_TILE_VOXELS; i++) {
+          sparse_voxel_store(tile_out[i], tile_voxels[i]);
+        }
+      }
+    }
+  });
+}
+
+static bool sparse_tiles_mark_grid(const openvdb::GridBase::ConstPtr &grid,
+                                   const openvdb::CoordBBox &bbox,
+                                   vector<int> &tiles)
+{
+  if (grid->isType<openvdb::FloatGrid>()) {
+    return sparse_tiles_mark<openvdb::FloatGrid>(grid, bbox, tiles);
+  }
+  else if (grid->isType<openvdb::Vec3fGrid>()) {
+    return sparse_tiles_mark<openvdb::Vec3fGrid>(grid, bbox, tiles);
+  }
+  else if (grid->isType<openvdb::BoolGrid>()) {
+    return sparse_tiles_mark<openvdb::BoolGrid>(grid, bbox, tiles);
+  }
+  else if (grid->isType<openvdb::DoubleGrid>()) {
+    return sparse_tiles_mark<openvdb::DoubleGrid>(grid, bbox, tiles);
+  }
+  else if (grid->isType<openvdb::Int32Grid>()) {
+    return sparse_tiles_mark<openvdb::Int32Grid>(grid, bbox, tiles);
+  }
+  else if (grid->isType<openvdb::Int64Grid>()) {
+    return sparse_tiles_mark<openvdb::Int64Grid>(grid, bbox, tiles);
+  }
+  else if (grid->isType<openvdb::Vec3IGrid>()) {
+    return sparse_tiles_mark<openvdb::Vec3IGrid>(grid, bbox, tiles);
+  }
+  else if (grid->isType<openvdb::Vec3dGrid>()) {
+    return sparse_tiles_mark<openvdb::Vec3dGrid>(grid, bbox, tiles);
+  }
+
+  /* Mask grids are mostly dense, keep using a dense texture for them. */
+  return false;
+}
+
+static void sparse_tiles_copy_grid(const openvdb::GridBase::ConstPtr &grid,
+                                   const openvdb::CoordBBox &bbox,
+                                   const vector<int> &tiles,
+                                   void *voxels)
+{
+  if (grid->isType<openvdb::FloatGrid>()) {
+    sparse_tiles_copy<openvdb::FloatGrid, float>(grid, bbox, tiles, (float *)voxels);
+  }
+  else if (grid->isType<openvdb::Vec3fGrid>()) {
+    sparse_tiles_copy<openvdb::Vec3fGrid, openvdb::Vec3f>(grid, bbox, tiles, (float4 *)voxels);
+  }
+  else if (grid->isType<openvdb::BoolGrid>()) {
+    sparse_tiles_copy<openvdb::BoolGrid, float>(grid, bbox, tiles, (float *)voxels);
+  }
+  else if (grid->isType<openvdb::DoubleGrid>()) {
+    sparse_tiles_copy<openvdb::DoubleGrid, float>(grid, bbox, tiles, (float *)voxels);
+  }
+  else if (grid->isType<openvdb::Int32Grid>()) {
+    sparse_tiles_copy<openvdb::Int32Grid, float>(grid, bbox, tiles, (float *)voxels);
+  }
+  else if (grid->isType<openvdb::Int64Grid>()) {
+    sparse_tiles_copy<openvdb::Int64Grid, float>(grid, bbox, tiles, (float *)voxels);
+  }
+  else if (grid->isType<openvdb::Vec3IGrid>()) {
+    sparse_tiles_copy<openvdb::Vec3IGrid, openvdb::Vec3f>(grid, bbox, tiles, (float4 *)voxels);
+  }
+  else if (grid->isType<openvdb::Vec3dGrid>()) {
+    sparse_tiles_copy<openvdb::Vec3dGrid, openvdb::Vec3f>(grid, bbox, tiles, (float4 *)voxels);
+  }
+}
+#endif
+
 VDBImageLoader::VDBImageLoader(const string &grid_name) : grid_name(grid_name)
 {
 }
@@ -133,6 +310,41 @@ bool VDBImageLoader::load_metadata(ImageMetaData &metadata)
   else {
     metadata.type = IMAGE_DATA_TYPE_FLOAT4;
   }
+
+  /* Store only tiles that contain values, if that takes less memory. */
+  sparse_tiles.clear();
+  if (metadata.use_sparse_3d) {
+    const size_t num_tiles = (size_t)tex_sparse_num_tiles(dim.x()) *
+                             tex_sparse_num_tiles(dim.y()) * tex_sparse_num_tiles(dim.z());
+    sparse_tiles.resize(num_tiles, TEX_SPARSE_EMPTY_TILE);
+
+    size_t num_used_tiles = 0;
+    if (sparse_tiles_mark_grid(grid, bbox, sparse_tiles)) {
+      for (int &tile : sparse_tiles) {
+        if (tile != TEX_SPARSE_EMPTY_TILE) {
+          tile = (int)num_used_tiles++;
+        }
+      }
+    }
+
+    const size_t num_voxels = (size_t)dim.x() * dim.y() * dim.z();
+    const size_t num_used_voxels = num_used_tiles * TEX_SPARSE_TILE_VOXELS;
+
+    if (num_used_tiles > 0 && num_used_voxels < num_voxels) {
+      const size_t voxel_size = (metadata.channels == 1) ? sizeof(float) : sizeof(float4);
+      metadata.type = (metadata.channels == 1) ? IMAGE_DATA_TYPE_SPARSE_FLOAT :
+                                                 IMAGE_DATA_TYPE_SPARSE_FLOAT4;
+      metadata.byte_size = tex_sparse_voxels_offset(dim.x(), dim.y(), dim.z()) +
+                           num_used_voxels * voxel_size;
+
+      VLOG(1) << "Sparse volume grid " << grid_name << ", "
+              << string_human_readable_size(metadata.byte_size) << " instead of "
+              << string_human_readable_size(num_voxels * voxel_size) << " dense.";
+    }
+    else {
+      sparse_tiles.clear();
+    }
+  }
 #  endif
 
   /* Set transform from object space to voxel index. */
@@ -157,13 +369,24 @@ bool VDBImageLoader::load_metadata(ImageMetaData &metadata)
 #endif
 }
 
-bool VDBImageLoader::load_pixels(const ImageMetaData &, void *pixels, const size_t, const bool)
+bool VDBImageLoader::load_pixels(const ImageMetaData &metadata,
+                                 void *pixels,
+                                 const size_t,
+                                 const bool)
 {
 #if defined(WITH_NANOVDB)
+  (void)metadata;
   memcpy(pixels, nanogrid.data(), nanogrid.size());
   return true;
 #elif defined(WITH_OPENVDB)
-  if (grid->isType<openvdb::FloatGrid>()) {
+  if (metadata.type == IMAGE_DATA_TYPE_SPARSE_FLOAT ||
+      metadata.type == IMAGE_DATA_TYPE_SPARSE_FLOAT4) {
+    memcpy(pixels, sparse_tiles.data(), sparse_tiles.size() * sizeof(int));
+    void *voxels = (char *)pixels +
+                   tex_sparse_voxels_offset(metadata.width, metadata.height, metadata.depth);
+    sparse_tiles_copy_grid(grid, bbox, sparse_tiles, voxels);
+  }
+  else if (grid->isType<openvdb::FloatGrid>()) {
     openvdb::tools::Dense<float, openvdb::tools::LayoutXYZ> dense(bbox, (float *)pixels);
     openvdb::tools::copyToDense(*openvdb::gridConstPtrCast<openvdb::FloatGrid>(grid), dense);
   }
@@ -205,6 +428,7 @@ bool VDBImageLoader::load_pixels(const ImageMetaData &, void *pixels, const size
 
   return true;
 #else
+  (void)metadata;
   (void)pixels;
   return false;
 #endif
@@ -231,6 +455,7 @@ void VDBImageLoader::cleanup()
 #ifdef WITH_OPENVDB
   /* Free OpenVDB grid memory as soon as we can. */
   grid.reset();
+  sparse_tiles.free_memory();
 #endif
 #ifdef WITH_NANOVDB
   nanogrid.reset();
@@ -26,6 +26,8 @@
 
 #include "render/image.h"
 
+#include "util/util_vector.h"
+
 CCL_NAMESPACE_BEGIN
 
 class VDBImageLoader : public ImageLoader {
@@ -57,6 +59,8 @@ class VDBImageLoader : public ImageLoader {
 #ifdef WITH_OPENVDB
   openvdb::GridBase::ConstPtr grid;
   openvdb::CoordBBox bbox;
+  /* Index of every tile for sparse textures, see util_texture.h. */
+  vector<int> sparse_tiles;
 #endif
 #ifdef WITH_NANOVDB
   nanovdb::GridHandle<> nanogrid;
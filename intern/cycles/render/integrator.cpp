@@ -79,6 +79,7 @@ NODE_DEFINE(Integrator)
   SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
   SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
   SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+  SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
 
   static NodeEnum method_enum;
   method_enum.insert("path", PATH);
@@ -200,6 +201,10 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
     kintegrator->adaptive_min_samples = max(4, adaptive_min_samples);
   }
 
+  /* Compared against the sample index, which does not start at zero when rendering a range of
+   * samples. */
+  kintegrator->adaptive_min_samples += start_sample;
+
   kintegrator->adaptive_step = 4;
   kintegrator->adaptive_stop_per_sample = device->info.has_adaptive_stop_per_sample;
 
@@ -278,6 +283,15 @@ bool Integrator::modified(const Integrator &integrator)
   return !Node::equals(integrator);
 }
 
+bool Integrator::use_light_tree_sampling() const
+{
+  /* Sampling all lights picks every lamp with equal probability. */
+  if (method == BRANCHED_PATH && (sample_all_lights_direct || sample_all_lights_indirect)) {
+    return false;
+  }
+  return use_light_tree;
+}
+
 void Integrator::tag_update(Scene *scene)
 {
   foreach (Shader *shader, scene->shaders) {
@@ -286,6 +300,9 @@ void Integrator::tag_update(Scene *scene)
       break;
     }
   }
+  if (use_light_tree_sampling() != scene->light_manager->use_light_tree) {
+    scene->light_manager->tag_update(scene);
+  }
   need_update = true;
 }
 
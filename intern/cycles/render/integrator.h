@@ -74,6 +74,7 @@ class Integrator : public Node {
   bool sample_all_lights_direct;
   bool sample_all_lights_indirect;
   float light_sampling_threshold;
+  bool use_light_tree;
 
   int adaptive_min_samples;
   float adaptive_threshold;
@@ -98,6 +99,7 @@ class Integrator : public Node {
   void device_free(Device *device, DeviceScene *dscene);
 
   bool modified(const Integrator &integrator);
+  bool use_light_tree_sampling() const;
   void tag_update(Scene *scene);
 };
 
@@ -186,6 +186,7 @@ LightManager::LightManager()
   need_update = true;
   need_update_background = true;
   use_light_visibility = false;
+  use_light_tree = false;
   last_background_enabled = false;
   last_background_resolution = 0;
 }
@@ -275,6 +276,57 @@ bool LightManager::object_usable_as_light(Object *object)
   return false;
 }
 
+/* Number of triangles handled by a single task when building the light distribution. */
+static const size_t LIGHT_TRIANGLES_PER_TASK = 8192;
+
+/* Range of triangles of an emissive object in the light distribution. Counts and area are
+ * first computed per range, and then replaced by the offset and accumulated area of all
+ * emissive triangles before the range. */
+struct LightTriangleRange {
+  Object *object;
+  int object_id;
+  int shader_flag;
+  size_t start;
+  size_t end;
+  size_t num_triangles;
+  float area;
+};
+
+static bool mesh_triangle_is_emissive(const Mesh *mesh, size_t i, Shader *default_surface)
+{
+  int shader_index = mesh->shader[i];
+  Shader *shader = (shader_index < mesh->used_shaders.size()) ?
+                       mesh->used_shaders[shader_index] :
+                       default_surface;
+
+  return shader->use_mis && shader->has_surface_emission;
+}
+
+static float mesh_triangle_area(const Mesh *mesh, const Transform &tfm, size_t i)
+{
+  Mesh::Triangle t = mesh->get_triangle(i);
+  if (!t.valid(&mesh->verts[0])) {
+    return 0.0f;
+  }
+  float3 p1 = mesh->verts[t.v[0]];
+  float3 p2 = mesh->verts[t.v[1]];
+  float3 p3 = mesh->verts[t.v[2]];
+
+  if (!mesh->transform_applied) {
+    p1 = transform_point(&tfm, p1);
+    p2 = transform_point(&tfm, p2);
+    p3 = transform_point(&tfm, p3);
+  }
+
+  return triangle_area(p1, p2, p3);
+}
+
+/* Lights with a position that can be bounded, picked through the light tree. */
+static bool light_use_tree(const Light *light)
+{
+  return (light->type == LIGHT_POINT || light->type == LIGHT_SPOT || light->type == LIGHT_AREA);
+}
+
 void LightManager::device_update_distribution(Device *,
                                               DeviceScene *dscene,
                                               Scene *scene,
@@ -284,53 +336,27 @@ void LightManager::device_update_distribution(Device *,
 
   /* count */
   size_t num_lights = 0;
+  size_t num_tree_lights = 0;
   size_t num_portals = 0;
   size_t num_background_lights = 0;
-  size_t num_triangles = 0;
 
   bool background_mis = false;
 
   foreach (Light *light, scene->lights) {
     if (light->is_enabled) {
       num_lights++;
+      if (use_light_tree && light_use_tree(light)) {
+        num_tree_lights++;
+      }
     }
     if (light->is_portal) {
       num_portals++;
     }
   }
 
-  foreach (Object *object, scene->objects) {
-    if (progress.get_cancel())
-      return;
-
-    if (!object_usable_as_light(object)) {
-      continue;
-    }
-
-    /* Count triangles. */
-    Mesh *mesh = static_cast<Mesh *>(object->geometry);
-    size_t mesh_num_triangles = mesh->num_triangles();
-    for (size_t i = 0; i < mesh_num_triangles; i++) {
-      int shader_index = mesh->shader[i];
-      Shader *shader = (shader_index < mesh->used_shaders.size()) ?
-                           mesh->used_shaders[shader_index] :
-                           scene->default_surface;
-
-      if (shader->use_mis && shader->has_surface_emission) {
-        num_triangles++;
-      }
-    }
-  }
-
-  size_t num_distribution = num_triangles + num_lights;
-  VLOG(1) << "Total " << num_distribution << " of light distribution primitives.";
-
-  /* emission area */
-  KernelLightDistribution *distribution = dscene->light_distribution.alloc(num_distribution + 1);
-  float totarea = 0.0f;
-
-  /* triangles */
-  size_t offset = 0;
+  /* Split triangles of emissive objects into ranges, so that emissive triangles
+   * can be counted and their area accumulated in parallel. */
+  vector<LightTriangleRange> ranges;
   int j = 0;
 
   foreach (Object *object, scene->objects) {
@@ -341,11 +367,7 @@ void LightManager::device_update_distribution(Device *,
       j++;
       continue;
     }
-    /* Sum area. */
-    Mesh *mesh = static_cast<Mesh *>(object->geometry);
-    bool transform_applied = mesh->transform_applied;
-    Transform tfm = object->tfm;
-    int object_id = j;
+
     int shader_flag = 0;
 
     if (!(object->visibility & PATH_RAY_DIFFUSE)) {
@@ -365,41 +387,95 @@ void LightManager::device_update_distribution(Device *,
       use_light_visibility = true;
     }
 
+    Mesh *mesh = static_cast<Mesh *>(object->geometry);
     size_t mesh_num_triangles = mesh->num_triangles();
-    for (size_t i = 0; i < mesh_num_triangles; i++) {
-      int shader_index = mesh->shader[i];
-      Shader *shader = (shader_index < mesh->used_shaders.size()) ?
-                           mesh->used_shaders[shader_index] :
-                           scene->default_surface;
-
-      if (shader->use_mis && shader->has_surface_emission) {
-        distribution[offset].totarea = totarea;
-        distribution[offset].prim = i + mesh->prim_offset;
-        distribution[offset].mesh_light.shader_flag = shader_flag;
-        distribution[offset].mesh_light.object_id = object_id;
-        offset++;
-
-        Mesh::Triangle t = mesh->get_triangle(i);
-        if (!t.valid(&mesh->verts[0])) {
-          continue;
-        }
-        float3 p1 = mesh->verts[t.v[0]];
-        float3 p2 = mesh->verts[t.v[1]];
-        float3 p3 = mesh->verts[t.v[2]];
-
-        if (!transform_applied) {
-          p1 = transform_point(&tfm, p1);
-          p2 = transform_point(&tfm, p2);
-          p3 = transform_point(&tfm, p3);
-        }
+    for (size_t start = 0; start < mesh_num_triangles; start += LIGHT_TRIANGLES_PER_TASK) {
+      LightTriangleRange range;
+      range.object = object;
+      range.object_id = j;
+      range.shader_flag = shader_flag;
+      range.start = start;
+      range.end = std::min(start + LIGHT_TRIANGLES_PER_TASK, mesh_num_triangles);
+      range.num_triangles = 0;
+      range.area = 0.0f;
+      ranges.push_back(range);
+    }
+
+    j++;
+  }
+
+  double time_start = time_dt();
+
+  /* Count emissive triangles and sum their area. */
+  parallel_for(blocked_range<size_t>(0, ranges.size(), 1), [&](const blocked_range<size_t> &r) {
+    for (size_t k = r.begin(); k < r.end(); k++) {
+      LightTriangleRange &range = ranges[k];
+      Mesh *mesh = static_cast<Mesh *>(range.object->geometry);
 
-        totarea += triangle_area(p1, p2, p3);
+      for (size_t i = range.start; i < range.end; i++) {
+        if (mesh_triangle_is_emissive(mesh, i, scene->default_surface)) {
+          range.num_triangles++;
+          range.area += mesh_triangle_area(mesh, range.object->tfm, i);
+        }
       }
     }
+  });
 
-    j++;
+  if (progress.get_cancel())
+    return;
+
+  /* Exclusive prefix sum, turning the counts and area of each range into its
+   * offset in the distribution and the total area of all preceding triangles. */
+  size_t num_triangles = 0;
+  float totarea = 0.0f;
+
+  foreach (LightTriangleRange &range, ranges) {
+    const size_t range_num_triangles = range.num_triangles;
+    const float range_area = range.area;
+
+    range.num_triangles = num_triangles;
+    range.area = totarea;
+
+    num_triangles += range_num_triangles;
+    totarea += range_area;
   }
 
+  /* Lights in the light tree share a single entry. */
+  size_t num_distribution = num_triangles + num_lights - num_tree_lights;
+  if (num_tree_lights > 0) {
+    num_distribution++;
+  }
+  VLOG(1) << "Total " << num_distribution << " of light distribution primitives.";
+
+  /* emission area */
+  KernelLightDistribution *distribution = dscene->light_distribution.alloc(num_distribution + 1);
+
+  /* triangles */
+  parallel_for(blocked_range<size_t>(0, ranges.size(), 1), [&](const blocked_range<size_t> &r) {
+    for (size_t k = r.begin(); k < r.end(); k++) {
+      const LightTriangleRange &range = ranges[k];
+      Mesh *mesh = static_cast<Mesh *>(range.object->geometry);
+      size_t offset = range.num_triangles;
+      float area = range.area;
+
+      for (size_t i = range.start; i < range.end; i++) {
+        if (mesh_triangle_is_emissive(mesh, i, scene->default_surface)) {
+          distribution[offset].totarea = area;
+          distribution[offset].prim = i + mesh->prim_offset;
+          distribution[offset].mesh_light.shader_flag = range.shader_flag;
+          distribution[offset].mesh_light.object_id = range.object_id;
+          offset++;
+
+          area += mesh_triangle_area(mesh, range.object->tfm, i);
+        }
+      }
+    }
+  });
+
+  VLOG(2) << "Triangle light distribution build time " << time_dt() - time_start << "\n";
+
+  size_t offset = num_triangles;
+
   float trianglearea = totarea;
 
   /* point lights */
@@ -411,11 +487,14 @@ void LightManager::device_update_distribution(Device *,
     if (!light->is_enabled)
       continue;
 
-    distribution[offset].totarea = totarea;
-    distribution[offset].prim = ~light_index;
-    distribution[offset].lamp.pad = 1.0f;
-    distribution[offset].lamp.size = light->size;
-    totarea += lightarea;
+    if (!(use_light_tree && light_use_tree(light))) {
+      distribution[offset].totarea = totarea;
+      distribution[offset].prim = ~light_index;
+      distribution[offset].lamp.pad = 1.0f;
+      distribution[offset].lamp.size = light->size;
+      totarea += lightarea;
+      offset++;
+    }
 
     if (light->type == LIGHT_DISTANT) {
       use_lamp_mis |= (light->angle > 0.0f && light->use_mis);
@@ -432,6 +511,16 @@ void LightManager::device_update_distribution(Device *,
     }
 
     light_index++;
+  }
+
+  /* Light tree, picked with the same probability as all its lights together. The
+   * kernel recognizes it by the lamp index past the last light. */
+  if (num_tree_lights > 0) {
+    distribution[offset].totarea = totarea;
+    distribution[offset].prim = ~light_index;
+    distribution[offset].lamp.pad = 1.0f;
+    distribution[offset].lamp.size = 0.0f;
+    totarea += lightarea * num_tree_lights;
     offset++;
   }
 
@@ -442,8 +531,12 @@ void LightManager::device_update_distribution(Device *,
   distribution[num_distribution].lamp.size = 0.0f;
 
   if (totarea > 0.0f) {
-    for (size_t i = 0; i < num_distribution; i++)
-      distribution[i].totarea /= totarea;
+    parallel_for(blocked_range<size_t>(0, num_distribution, LIGHT_TRIANGLES_PER_TASK),
+                 [&](const blocked_range<size_t> &r) {
+                   for (size_t i = r.begin(); i < r.end(); i++) {
+                     distribution[i].totarea /= totarea;
+                   }
+                 });
     distribution[num_distribution].totarea = 1.0f;
   }
 
@@ -481,6 +574,10 @@ void LightManager::device_update_distribution(Device *,
 
     kintegrator->use_lamp_mis = use_lamp_mis;
 
+    /* Probability of picking the light tree entry, the tree traversal gives the rest. */
+    kintegrator->use_light_tree = (num_tree_lights > 0);
+    kintegrator->pdf_light_tree = kintegrator->pdf_lights * num_tree_lights;
+
     /* bit of an ugly hack to compensate for emitting triangles influencing
      * amount of samples we get for this pass */
     kfilm->pass_shadow_scale = 1.0f;
@@ -517,6 +614,8 @@ void LightManager::device_update_distribution(Device *,
     kintegrator->pdf_triangles = 0.0f;
     kintegrator->pdf_lights = 0.0f;
     kintegrator->use_lamp_mis = false;
+    kintegrator->use_light_tree = false;
+    kintegrator->pdf_light_tree = 0.0f;
 
     kbackground->num_portals = 0;
     kbackground->portal_offset = 0;
@@ -900,6 +999,7 @@ void LightManager::device_update_points(Device *, DeviceScene *dscene, Scene *sc
 
     klights[light_index].max_bounces = max_bounces;
     klights[light_index].random = random;
+    klights[light_index].tree_node = -1;
 
     klights[light_index].tfm = light->tfm;
     klights[light_index].itfm = transform_inverse(light->tfm);
@@ -941,6 +1041,7 @@ void LightManager::device_update_points(Device *, DeviceScene *dscene, Scene *sc
     klights[light_index].area.dir[0] = dir.x;
     klights[light_index].area.dir[1] = dir.y;
     klights[light_index].area.dir[2] = dir.z;
+    klights[light_index].tree_node = -1;
     klights[light_index].tfm = light->tfm;
     klights[light_index].itfm = transform_inverse(light->tfm);
 
@@ -954,6 +1055,141 @@ void LightManager::device_update_points(Device *, DeviceScene *dscene, Scene *sc
   dscene->lights.copy_to_device();
 }
 
+/* Light tree build primitive. */
+struct LightTreeLight {
+  int lamp;
+  BoundBox bounds;
+  float energy;
+};
+
+static int light_tree_build_recursive(vector<LightTreeLight> &tree_lights,
+                                      const size_t start,
+                                      const size_t end,
+                                      const int parent,
+                                      vector<KernelLightTreeNode> &nodes,
+                                      KernelLight *klights,
+                                      BoundBox *r_bounds,
+                                      float *r_energy)
+{
+  const int index = nodes.size();
+  nodes.push_back(KernelLightTreeNode());
+
+  BoundBox bounds;
+  float energy;
+  int child;
+
+  if (end - start == 1) {
+    const LightTreeLight &tree_light = tree_lights[start];
+    bounds = tree_light.bounds;
+    energy = tree_light.energy;
+    child = ~tree_light.lamp;
+    klights[tree_light.lamp].tree_node = index;
+  }
+  else {
+    /* Median split along the largest axis of the light centers. */
+    BoundBox centroid_bounds = BoundBox::empty;
+    for (size_t i = start; i < end; i++) {
+      centroid_bounds.grow(tree_lights[i].bounds.center());
+    }
+
+    const float3 size = centroid_bounds.size();
+    const int axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z) ? 1 : 2;
+    const size_t middle = (start + end) / 2;
+
+    std::nth_element(tree_lights.begin() + start,
+                     tree_lights.begin() + middle,
+                     tree_lights.begin() + end,
+                     [axis](const LightTreeLight &a, const LightTreeLight &b) {
+                       return a.bounds.center()[axis] < b.bounds.center()[axis];
+                     });
+
+    BoundBox right_bounds;
+    float right_energy;
+    light_tree_build_recursive(
+        tree_lights, start, middle, index, nodes, klights, &bounds, &energy);
+    child = light_tree_build_recursive(
+        tree_lights, middle, end, index, nodes, klights, &right_bounds, &right_energy);
+
+    bounds.grow(right_bounds);
+    energy += right_energy;
+  }
+
+  KernelLightTreeNode &knode = nodes[index];
+  const float3 center = bounds.center();
+  knode.center[0] = center.x;
+  knode.center[1] = center.y;
+  knode.center[2] = center.z;
+  knode.radius = len(bounds.size()) * 0.5f;
+  knode.energy = energy;
+  knode.parent = parent;
+  knode.child = child;
+  knode.pad1 = 0;
+
+  *r_bounds = bounds;
+  *r_energy = energy;
+
+  return index;
+}
+
+void LightManager::device_update_tree(Device *, DeviceScene *dscene, Scene *scene)
+{
+  if (!use_light_tree) {
+    return;
+  }
+
+  vector<LightTreeLight> tree_lights;
+  int light_index = 0;
+
+  foreach (Light *light, scene->lights) {
+    if (!light->is_enabled) {
+      continue;
+    }
+
+    if (light_use_tree(light)) {
+      float3 extent;
+      if (light->type == LIGHT_AREA) {
+        const float3 axisu = light->axisu * (light->sizeu * light->size);
+        const float3 axisv = light->axisv * (light->sizev * light->size);
+        extent = (fabs(axisu) + fabs(axisv)) * 0.5f;
+      }
+      else {
+        extent = make_float3(light->size, light->size, light->size);
+      }
+
+      LightTreeLight tree_light;
+      tree_light.lamp = light_index;
+      tree_light.bounds = BoundBox(light->co - extent, light->co + extent);
+      /* Negative strength still contributes light, so sample by magnitude. */
+      tree_light.energy = average(fabs(light->strength));
+      tree_lights.push_back(tree_light);
+    }
+
+    light_index++;
+  }
+
+  if (tree_lights.empty()) {
+    return;
+  }
+
+  vector<KernelLightTreeNode> nodes;
+  nodes.reserve(tree_lights.size() * 2 - 1);
+
+  BoundBox bounds;
+  float energy;
+  light_tree_build_recursive(
+      tree_lights, 0, tree_lights.size(), -1, nodes, dscene->lights.data(), &bounds, &energy);
+
+  VLOG(1) << "Light tree with " << tree_lights.size() << " lights and " << nodes.size()
+          << " nodes.";
+
+  KernelLightTreeNode *knodes = dscene->light_tree_nodes.alloc(nodes.size());
+  memcpy(knodes, nodes.data(), sizeof(KernelLightTreeNode) * nodes.size());
+  dscene->light_tree_nodes.copy_to_device();
+
+  /* Leaf node indices were filled in after uploading lights. */
+  dscene->lights.copy_to_device();
+}
+
 void LightManager::device_update(Device *device,
                                  DeviceScene *dscene,
                                  Scene *scene,
@@ -976,11 +1212,16 @@ void LightManager::device_update(Device *device,
   device_free(device, dscene, need_update_background);
 
   use_light_visibility = false;
+  use_light_tree = scene->integrator->use_light_tree_sampling();
 
   device_update_points(device, dscene, scene);
   if (progress.get_cancel())
     return;
 
+  device_update_tree(device, dscene, scene);
+  if (progress.get_cancel())
+    return;
+
   device_update_distribution(device, dscene, scene, progress);
   if (progress.get_cancel())
     return;
@@ -1008,6 +1249,7 @@ void LightManager::device_free(Device *, DeviceScene *dscene, const bool free_ba
 {
   dscene->light_distribution.free();
   dscene->lights.free();
+  dscene->light_tree_nodes.free();
   if (free_background) {
     dscene->light_background_marginal_cdf.free();
     dscene->light_background_conditional_cdf.free();
@@ -86,6 +86,7 @@ class Light : public Node {
 class LightManager {
  public:
   bool use_light_visibility;
+  bool use_light_tree;
   bool need_update;
 
   /* Need to update background (including multiple importance map) */
@@ -115,6 +116,7 @@ class LightManager {
   void test_enabled_lights(Scene *scene);
 
   void device_update_points(Device *device, DeviceScene *dscene, Scene *scene);
+  void device_update_tree(Device *device, DeviceScene *dscene, Scene *scene);
   void device_update_distribution(Device *device,
                                   DeviceScene *dscene,
                                   Scene *scene,
@@ -35,7 +35,8 @@ enum MergeChannelOp {
   MERGE_CHANNEL_NOP,
   MERGE_CHANNEL_COPY,
   MERGE_CHANNEL_SUM,
-  MERGE_CHANNEL_AVERAGE
+  MERGE_CHANNEL_AVERAGE,
+  MERGE_CHANNEL_VARIANCE
 };
 
 struct MergeImagePass {
@@ -58,6 +59,8 @@ struct MergeImageLayer {
   vector<MergeImagePass> passes;
   /* Sample amount that was used for rendering this layer. */
   int samples;
+  /* Offset of the adaptive sampling sample count channel in input image, or -1. */
+  int sample_count_offset;
 };
 
 /* Merge Image */
@@ -84,6 +87,9 @@ static MergeChannelOp parse_channel_operation(const string &pass_name)
            string_startswith(pass_name, "Debug Render Time")) {
     return MERGE_CHANNEL_SUM;
   }
+  else if (pass_name == "Denoising Variance") {
+    return MERGE_CHANNEL_VARIANCE;
+  }
   else {
     return MERGE_CHANNEL_AVERAGE;
   }
@@ -171,6 +177,13 @@ static bool parse_channels(const ImageSpec &in_spec,
 
     layer.name = name;
     layer.samples = 0;
+    layer.sample_count_offset = -1;
+
+    for (const MergeImagePass &pass : layer.passes) {
+      if (string_endswith(pass.channel_name, ".Debug Sample Count.X")) {
+        layer.sample_count_offset = pass.offset;
+      }
+    }
 
     /* Determine number of samples from metadata. */
     if (layer.name == "") {
@@ -285,7 +298,8 @@ static void merge_layer_render_time(ImageSpec &spec,
 
 static void merge_channels_metadata(vector<MergeImage> &images,
                                     ImageSpec &out_spec,
-                                    vector<int> &channel_total_samples)
+                                    vector<int> &channel_total_samples,
+                                    vector<int> &channel_num_layers)
 {
   /* Based on first image. */
   out_spec = images[0].in->spec();
@@ -305,6 +319,7 @@ static void merge_channels_metadata(vector<MergeImage> &images,
           if (pass.channel_name == out_spec.channelnames[i]) {
             pass.merge_offset = i;
             channel_total_samples[i] += layer.samples;
+            channel_num_layers[i]++;
             /* First image wins for channels that can't be averaged or summed. */
             if (pass.op == MERGE_CHANNEL_COPY) {
               pass.op = MERGE_CHANNEL_NOP;
@@ -318,6 +333,7 @@ static void merge_channels_metadata(vector<MergeImage> &images,
           /* Add new channel. */
           pass.merge_offset = out_spec.nchannels;
           channel_total_samples.push_back(layer.samples);
+          channel_num_layers.push_back(1);
 
           out_spec.channelnames.push_back(pass.channel_name);
           out_spec.channelformats.push_back(pass.format);
@@ -349,7 +365,7 @@ static void merge_channels_metadata(vector<MergeImage> &images,
   }
 }
 
-static void alloc_pixels(const ImageSpec &spec, array<float> &pixels)
+template<typename T> static void alloc_pixels(const ImageSpec &spec, array<T> &pixels)
 {
   const size_t width = spec.width;
   const size_t height = spec.height;
@@ -362,11 +378,39 @@ static void alloc_pixels(const ImageSpec &spec, array<float> &pixels)
 static bool merge_pixels(const vector<MergeImage> &images,
                          const ImageSpec &out_spec,
                          const vector<int> &channel_total_samples,
+                         const vector<int> &channel_num_layers,
                          array<float> &out_pixels,
                          string &error)
 {
-  alloc_pixels(out_spec, out_pixels);
-  memset(out_pixels.data(), 0, out_pixels.size() * sizeof(float));
+  /* Accumulate in double precision, to not lose precision when merging
+   * many renders of small sample ranges. */
+  array<double> merged_pixels;
+  alloc_pixels(out_spec, merged_pixels);
+  memset(merged_pixels.data(), 0, merged_pixels.size() * sizeof(double));
+
+  /* With adaptive sampling every pixel has its own number of samples, stored as a fraction of
+   * the layer samples in the sample count pass. When all images have it for a layer, average
+   * channels are weighted by the per pixel number of samples. */
+  const size_t out_num_pixels = (size_t)out_spec.width * (size_t)out_spec.height;
+  map<string, bool> layer_adaptive;
+  for (const MergeImage &image : images) {
+    for (const MergeImageLayer &layer : image.layers) {
+      const bool adaptive = (layer.sample_count_offset != -1);
+      auto it = layer_adaptive.find(layer.name);
+      layer_adaptive[layer.name] = (it == layer_adaptive.end()) ? adaptive :
+                                                                  it->second && adaptive;
+    }
+  }
+
+  map<string, array<double>> layer_pixel_samples;
+  for (const auto &i : layer_adaptive) {
+    if (i.second) {
+      array<double> &pixel_samples = layer_pixel_samples[i.first];
+      pixel_samples.resize(out_num_pixels);
+      memset(pixel_samples.data(), 0, pixel_samples.size() * sizeof(double));
+    }
+  }
+  vector<const array<double> *> channel_pixel_samples(out_spec.nchannels, NULL);
 
   for (const MergeImage &image : images) {
     /* Read all channels into buffer. Reading all channels at once is
@@ -386,6 +430,17 @@ static bool merge_pixels(const vector<MergeImage> &images,
       const size_t out_stride = out_spec.nchannels;
       const size_t num_pixels = pixels.size();
 
+      array<double> *pixel_samples = NULL;
+      auto it = layer_pixel_samples.find(layer.name);
+      if (it != layer_pixel_samples.end()) {
+        pixel_samples = &it->second;
+
+        size_t offset = layer.sample_count_offset;
+        for (size_t i = 0; i < out_num_pixels; i++, offset += stride) {
+          (*pixel_samples)[i] += fabs((double)pixels[offset]) * layer.samples;
+        }
+      }
+
       for (const MergeImagePass &pass : layer.passes) {
         size_t offset = pass.offset;
         size_t out_offset = pass.merge_offset;
@@ -395,29 +450,76 @@ static bool merge_pixels(const vector<MergeImage> &images,
             break;
           case MERGE_CHANNEL_COPY:
             for (; offset < num_pixels; offset += stride, out_offset += out_stride) {
-              out_pixels[out_offset] = pixels[offset];
+              merged_pixels[out_offset] = pixels[offset];
             }
             break;
           case MERGE_CHANNEL_SUM:
             for (; offset < num_pixels; offset += stride, out_offset += out_stride) {
-              out_pixels[out_offset] += pixels[offset];
+              merged_pixels[out_offset] += pixels[offset];
             }
             break;
-          case MERGE_CHANNEL_AVERAGE:
+          case MERGE_CHANNEL_AVERAGE: {
+            if (pixel_samples && (int)offset != layer.sample_count_offset) {
+              /* Sum of samples, divided by the total per pixel samples at the end. */
+              channel_pixel_samples[out_offset] = pixel_samples;
+              const size_t count_offset = layer.sample_count_offset;
+
+              for (; offset < num_pixels; offset += stride, out_offset += out_stride) {
+                const size_t pixel_count_offset = offset - pass.offset + count_offset;
+                const double num_samples = fabs((double)pixels[pixel_count_offset]) *
+                                           layer.samples;
+                merged_pixels[out_offset] += num_samples * pixels[offset];
+              }
+              break;
+            }
+
             /* Weights based on sample metadata. Per channel since not
              * all files are guaranteed to have the same channels. */
             const int total_samples = channel_total_samples[out_offset];
-            const float t = (float)layer.samples / (float)total_samples;
+            const double t = (double)layer.samples / (double)total_samples;
 
             for (; offset < num_pixels; offset += stride, out_offset += out_stride) {
-              out_pixels[out_offset] += t * pixels[offset];
+              merged_pixels[out_offset] += t * pixels[offset];
             }
             break;
+          }
+          case MERGE_CHANNEL_VARIANCE: {
+            /* Sample variances are pooled, weighted by their degrees of freedom. */
+            const int total_samples = channel_total_samples[out_offset];
+            const int total_dof = total_samples - channel_num_layers[out_offset];
+            const double t = (total_dof > 0) ?
+                                 (double)(layer.samples - 1) / (double)total_dof :
+                                 (double)layer.samples / (double)total_samples;
+
+            for (; offset < num_pixels; offset += stride, out_offset += out_stride) {
+              merged_pixels[out_offset] += t * pixels[offset];
+            }
+            break;
+          }
         }
       }
     }
   }
 
+  for (size_t channel = 0; channel < channel_pixel_samples.size(); channel++) {
+    const array<double> *pixel_samples = channel_pixel_samples[channel];
+    if (pixel_samples == NULL) {
+      continue;
+    }
+
+    size_t offset = channel;
+    for (size_t i = 0; i < out_num_pixels; i++, offset += out_spec.nchannels) {
+      if ((*pixel_samples)[i] > 0.0) {
+        merged_pixels[offset] /= (*pixel_samples)[i];
+      }
+    }
+  }
+
+  alloc_pixels(out_spec, out_pixels);
+  for (size_t i = 0; i < out_pixels.size(); i++) {
+    out_pixels[i] = (float)merged_pixels[i];
+  }
+
   return true;
 }
 
@@ -497,11 +599,13 @@ bool ImageMerger::run()
   /* Merge metadata and setup channels and offsets. */
   ImageSpec out_spec;
   vector<int> channel_total_samples;
-  merge_channels_metadata(images, out_spec, channel_total_samples);
+  vector<int> channel_num_layers;
+  merge_channels_metadata(images, out_spec, channel_total_samples, channel_num_layers);
 
   /* Merge pixels. */
   array<float> out_pixels;
-  if (!merge_pixels(images, out_spec, channel_total_samples, out_pixels, error)) {
+  if (!merge_pixels(
+          images, out_spec, channel_total_samples, channel_num_layers, out_pixels, error)) {
     return false;
   }
 
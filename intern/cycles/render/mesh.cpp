@@ -25,6 +25,7 @@
 #include "render/object.h"
 #include "render/scene.h"
 
+#include "subd/subd_dice.h"
 #include "subd/subd_patch_table.h"
 #include "subd/subd_split.h"
 
@@ -150,6 +151,7 @@ Mesh::Mesh(const NodeType *node_type_, Type geom_type_)
 
   subdivision_type = SUBDIVISION_NONE;
   subd_params = NULL;
+  dice_cache = NULL;
 
   patch_table = NULL;
 }
@@ -162,6 +164,7 @@ Mesh::~Mesh()
 {
   delete patch_table;
   delete subd_params;
+  delete dice_cache;
 }
 
 void Mesh::resize_mesh(int numverts, int numtris)
@@ -47,6 +47,7 @@ class SceneParams;
 class AttributeRequest;
 struct SubdParams;
 class DiagSplit;
+class DiceCache;
 struct PackedPatchTable;
 
 /* Mesh */
@@ -143,6 +144,7 @@ class Mesh : public Geometry {
   array<SubdEdgeCrease> subd_creases;
 
   SubdParams *subd_params;
+  DiceCache *dice_cache;
 
   AttributeSet subd_attributes;
 
@@ -356,6 +356,26 @@ void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attribute
   ShaderNode::attributes(shader, attributes);
 }
 
+/* Check if an image is looked up with the default UV map as is, so the kernel can take the
+ * lookup footprint from the UV derivatives. */
+static bool image_vector_is_default_uv(ShaderInput *vector_in)
+{
+  ShaderOutput *link = vector_in->link;
+  if (link == NULL) {
+    return false;
+  }
+
+  const ShaderNode *node = link->parent;
+  if (node->type == TextureCoordinateNode::node_type) {
+    return link->name() == "UV" && !static_cast<const TextureCoordinateNode *>(node)->from_dupli;
+  }
+  if (node->type == UVMapNode::node_type) {
+    const UVMapNode *uvmap = static_cast<const UVMapNode *>(node);
+    return uvmap->attribute.empty() && !uvmap->from_dupli;
+  }
+  return false;
+}
+
 void ImageTextureNode::compile(SVMCompiler &compiler)
 {
   ShaderInput *vector_in = input("Vector");
@@ -388,6 +408,10 @@ void ImageTextureNode::compile(SVMCompiler &compiler)
       flags |= NODE_IMAGE_ALPHA_UNASSOCIATE;
     }
   }
+  if (projection == NODE_IMAGE_PROJ_FLAT && tex_mapping.skip() &&
+      image_vector_is_default_uv(vector_in)) {
+    flags |= NODE_IMAGE_USE_UV_DERIVATIVES;
+  }
 
   if (projection != NODE_IMAGE_PROJ_BOX) {
     /* If there only is one image (a very common case), we encode it as a negative value. */
@@ -74,6 +74,7 @@ DeviceScene::DeviceScene(Device *device)
       attributes_uchar4(device, "__attributes_uchar4", MEM_GLOBAL),
       light_distribution(device, "__light_distribution", MEM_GLOBAL),
       lights(device, "__lights", MEM_GLOBAL),
+      light_tree_nodes(device, "__light_tree_nodes", MEM_GLOBAL),
       light_background_marginal_cdf(device, "__light_background_marginal_cdf", MEM_GLOBAL),
       light_background_conditional_cdf(device, "__light_background_conditional_cdf", MEM_GLOBAL),
       particles(device, "__particles", MEM_GLOBAL),
@@ -137,6 +138,8 @@ void Scene::free_memory(bool final)
 {
   foreach (Shader *s, shaders)
     delete s;
+  geometry_manager->free_scene_bvh();
+
   foreach (Geometry *g, geometry)
     delete g;
   foreach (Object *o, objects)
@@ -217,7 +220,9 @@ void Scene::device_update(Device *device_, Progress &progress)
   /* The order of updates is important, because there's dependencies between
    * the different managers, using data computed by previous managers.
    *
-   * - Image manager uploads images used by shaders.
+   * - Image manager uploads images used by shaders. Pixels of images added by
+   *   the shader compilation are loaded in the background while objects and
+   *   geometry are updated, only copying them to the device waits on that.
    * - Camera may be used for adaptive subdivision.
    * - Displacement shader must have all shader data available.
    * - Light manager needs lookup tables and final mesh data to compute emission CDF.
@@ -231,6 +236,8 @@ void Scene::device_update(Device *device_, Progress &progress)
   if (progress.get_cancel() || device->have_error())
     return;
 
+  image_manager->device_load_pixels(device, this, progress);
+
   progress.set_status("Updating Background");
   background->device_update(device, &dscene, this);
 
@@ -669,30 +676,35 @@ template<> void Scene::delete_node_impl(Light *node)
 template<> void Scene::delete_node_impl(Mesh *node)
 {
   delete_node_from_array(geometry, static_cast<Geometry *>(node));
+  geometry_manager->free_scene_bvh();
   geometry_manager->tag_update(this);
 }
 
 template<> void Scene::delete_node_impl(Hair *node)
 {
   delete_node_from_array(geometry, static_cast<Geometry *>(node));
+  geometry_manager->free_scene_bvh();
   geometry_manager->tag_update(this);
 }
 
 template<> void Scene::delete_node_impl(Volume *node)
 {
   delete_node_from_array(geometry, static_cast<Geometry *>(node));
+  geometry_manager->free_scene_bvh();
   geometry_manager->tag_update(this);
 }
 
 template<> void Scene::delete_node_impl(Geometry *node)
 {
   delete_node_from_array(geometry, node);
+  geometry_manager->free_scene_bvh();
   geometry_manager->tag_update(this);
 }
 
 template<> void Scene::delete_node_impl(Object *node)
 {
   delete_node_from_array(objects, node);
+  geometry_manager->free_scene_bvh();
   object_manager->tag_update(this);
 }
 
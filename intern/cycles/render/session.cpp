@@ -116,7 +116,8 @@ Session::~Session()
 
     display = new DisplayBuffer(device, false);
     display->reset(buffers->params);
-    copy_to_display_buffer(params.samples);
+    copy_to_display_buffer(tile_manager.range_start_sample +
+                           tile_manager.get_num_effective_samples());
 
     int w = display->draw_width;
     int h = display->draw_height;
@@ -1132,7 +1133,8 @@ void Session::copy_to_display_buffer(int sample)
   task.rgba_byte = display->rgba_byte.device_pointer;
   task.rgba_half = display->rgba_half.device_pointer;
   task.buffer = buffers->buffer.device_pointer;
-  task.sample = sample;
+  /* Buffers only contain the samples of the rendered range. */
+  task.sample = sample - tile_manager.range_start_sample;
   tile_manager.state.buffer.get_offset_stride(task.offset, task.stride);
 
   if (task.w > 0 && task.h > 0) {
@@ -84,6 +84,18 @@ class NamedTimeStats {
     entries.push_back(entry);
   }
 
+  /* Total time of all entries with the given name. */
+  double get_time(const string &name) const
+  {
+    double time = 0.0;
+    for (const NamedTimeEntry &entry : entries) {
+      if (entry.name == name) {
+        time += entry.time;
+      }
+    }
+    return time;
+  }
+
   /* Generate full human-readable report. */
   string full_report(int indent_level = 0);
 
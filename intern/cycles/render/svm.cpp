@@ -17,7 +17,9 @@
 #include "device/device.h"
 
 #include "render/background.h"
+#include "render/film.h"
 #include "render/graph.h"
+#include "render/integrator.h"
 #include "render/light.h"
 #include "render/mesh.h"
 #include "render/nodes.h"
@@ -28,6 +30,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_md5.h"
 #include "util/util_progress.h"
 #include "util/util_task.h"
 
@@ -45,6 +48,33 @@ SVMShaderManager::~SVMShaderManager()
 
 void SVMShaderManager::reset(Scene * /*scene*/)
 {
+  compiled_shaders.clear();
+}
+
+string SVMShaderManager::shader_compile_hash(Scene *scene, Shader *shader)
+{
+  /* Changes to the graph itself are detected with the update tag instead, the graph is
+   * modified in place by compilation so its contents can't be compared afterwards. */
+  MD5Hash md5;
+  shader->hash(md5);
+
+  const bool background = (shader == scene->background->get_shader(scene));
+  md5.append((uint8_t *)&background, sizeof(background));
+  md5.append((uint8_t *)&shader->used, sizeof(shader->used));
+
+  if (shader->has_integrator_dependency) {
+    scene->integrator->hash(md5);
+  }
+
+  /* AOV output nodes write to slots that depend on the AOV passes. */
+  foreach (const Pass &pass, scene->passes) {
+    if (pass.type == PASS_AOV_COLOR || pass.type == PASS_AOV_VALUE) {
+      md5.append((uint8_t *)&pass.type, sizeof(pass.type));
+      md5.append(pass.name.string());
+    }
+  }
+
+  return md5.get_hex();
 }
 
 void SVMShaderManager::device_update_shader(Scene *scene,
@@ -92,20 +122,37 @@ void SVMShaderManager::device_update(Device *device,
   /* test if we need to update */
   device_free(device, dscene, scene);
 
-  /* Build all shaders. */
+  /* Build shaders that changed since the last update, others reuse their SVM nodes. */
   TaskPool task_pool;
   vector<array<int4>> shader_svm_nodes(num_shaders);
+  vector<string> shader_hashes(num_shaders);
+  vector<bool> shader_compiled(num_shaders, true);
+  int num_compiled = 0;
   for (int i = 0; i < num_shaders; i++) {
+    Shader *shader = scene->shaders[i];
+    shader_hashes[i] = shader_compile_hash(scene, shader);
+
+    map<Shader *, CompiledShader>::iterator it = compiled_shaders.find(shader);
+    if (!shader->need_update && it != compiled_shaders.end() &&
+        it->second.graph == shader->graph && it->second.hash == shader_hashes[i]) {
+      shader_svm_nodes[i].steal_data(it->second.svm_nodes);
+      shader_compiled[i] = false;
+      continue;
+    }
+
     task_pool.push(function_bind(&SVMShaderManager::device_update_shader,
                                  this,
                                  scene,
-                                 scene->shaders[i],
+                                 shader,
                                  &progress,
                                  &shader_svm_nodes[i]));
+    num_compiled++;
   }
   task_pool.wait_work();
 
   if (progress.get_cancel()) {
+    /* Reused nodes were taken out of the cache, compile everything again next time. */
+    compiled_shaders.clear();
     return;
   }
 
@@ -123,8 +170,8 @@ void SVMShaderManager::device_update(Device *device,
   for (int i = 0; i < num_shaders; i++) {
     Shader *shader = scene->shaders[i];
 
-    shader->need_update = false;
-    if (shader->use_mis && shader->has_surface_emission) {
+    /* Light distribution only depends on emission of shaders that were compiled again. */
+    if (shader_compiled[i] && shader->use_mis && shader->has_surface_emission) {
       scene->light_manager->need_update = true;
     }
 
@@ -151,6 +198,19 @@ void SVMShaderManager::device_update(Device *device,
     svm_nodes += shader_size;
   }
 
+  /* Keep nodes for the next update, dropping shaders that were removed from the scene. The
+   * hash is computed again since compilation updates the integrator dependency. */
+  compiled_shaders.clear();
+  for (int i = 0; i < num_shaders; i++) {
+    Shader *shader = scene->shaders[i];
+    shader->need_update = false;
+
+    CompiledShader &compiled = compiled_shaders[shader];
+    compiled.graph = shader->graph;
+    compiled.hash = (shader_compiled[i]) ? shader_compile_hash(scene, shader) : shader_hashes[i];
+    compiled.svm_nodes.steal_data(shader_svm_nodes[i]);
+  }
+
   if (progress.get_cancel()) {
     return;
   }
@@ -162,7 +222,8 @@ void SVMShaderManager::device_update(Device *device,
   need_update = false;
 
   VLOG(1) << "Shader manager updated " << num_shaders << " shaders in " << time_dt() - start_time
-          << " seconds.";
+          << " seconds, compiled " << num_compiled << " and reused "
+          << num_shaders - num_compiled << ".";
 }
 
 void SVMShaderManager::device_free(Device *device, DeviceScene *dscene, Scene *scene)
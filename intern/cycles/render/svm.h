@@ -22,6 +22,7 @@
 #include "render/shader.h"
 
 #include "util/util_array.h"
+#include "util/util_map.h"
 #include "util/util_set.h"
 #include "util/util_string.h"
 #include "util/util_thread.h"
@@ -54,6 +55,18 @@ class SVMShaderManager : public ShaderManager {
                             Shader *shader,
                             Progress *progress,
                             array<int4> *svm_nodes);
+
+  /* Hash of the settings besides the graph that compiled SVM nodes depend on. */
+  string shader_compile_hash(Scene *scene, Shader *shader);
+
+  /* SVM nodes of shaders from the previous update, starting with the local jump node. Shaders
+   * that were not tagged for update and have the same hash are not compiled again. */
+  struct CompiledShader {
+    ShaderGraph *graph;
+    string hash;
+    array<int4> svm_nodes;
+  };
+  map<Shader *, CompiledShader> compiled_shaders;
 };
 
 /* Graph Compiler */
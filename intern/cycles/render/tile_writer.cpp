@@ -0,0 +1,177 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/tile_writer.h"
+
+#include "util/util_logging.h"
+
+CCL_NAMESPACE_BEGIN
+
+TileImageWriter::TileImageWriter() : mem_peak(0), next_row(0), mem_used(0)
+{
+}
+
+TileImageWriter::~TileImageWriter()
+{
+  if (out) {
+    close();
+  }
+}
+
+bool TileImageWriter::open(const string &filepath_, const ImageSpec &spec_)
+{
+  thread_scoped_lock lock(mutex);
+
+  filepath = filepath_;
+  spec = spec_;
+
+  out = unique_ptr<ImageOutput>(ImageOutput::create(filepath));
+  if (!out) {
+    error = "Failed to create image file " + filepath;
+    return false;
+  }
+
+  if (!out->open(filepath, spec)) {
+    error = "Failed to open image file " + filepath + " for writing: " + out->geterror();
+    out.reset();
+    return false;
+  }
+
+  rows.clear();
+  row_num_pixels.clear();
+  row_num_pixels.resize(spec.height, 0);
+  next_row = 0;
+  mem_used = 0;
+  mem_peak = 0;
+
+  return true;
+}
+
+bool TileImageWriter::write_tile(int x, int y, int w, int h, const float *pixels)
+{
+  thread_scoped_lock lock(mutex);
+
+  if (!out) {
+    return false;
+  }
+
+  if (x < 0 || y < 0 || w < 0 || h < 0 || x + w > spec.width || y + h > spec.height) {
+    error = string_printf("Tile %d %d %d %d outside of image file %s of size %d %d",
+                          x,
+                          y,
+                          w,
+                          h,
+                          filepath.c_str(),
+                          spec.width,
+                          spec.height);
+    return false;
+  }
+
+  const size_t num_channels = spec.nchannels;
+  const size_t row_size = (size_t)spec.width * num_channels;
+
+  for (int ty = 0; ty < h; ty++) {
+    /* Conversion for different top/bottom convention. */
+    const int row = spec.height - 1 - (y + ty);
+    if (row < next_row) {
+      /* Already written, tiles are expected to be written once. */
+      continue;
+    }
+
+    vector<float> &row_pixels = rows[row];
+    if (row_pixels.empty()) {
+      row_pixels.resize(row_size, 0.0f);
+      mem_used += row_size * sizeof(float);
+      if (mem_used > mem_peak) {
+        mem_peak = mem_used;
+      }
+    }
+
+    memcpy(&row_pixels[x * num_channels],
+           pixels + ty * w * num_channels,
+           sizeof(float) * w * num_channels);
+    row_num_pixels[row] += w;
+  }
+
+  return write_finished_rows();
+}
+
+bool TileImageWriter::write_finished_rows()
+{
+  while (next_row < spec.height && row_num_pixels[next_row] >= spec.width) {
+    auto it = rows.find(next_row);
+    assert(it != rows.end());
+
+    if (!write_row(next_row, &it->second[0])) {
+      return false;
+    }
+
+    mem_used -= it->second.size() * sizeof(float);
+    rows.erase(it);
+    next_row++;
+  }
+
+  return true;
+}
+
+bool TileImageWriter::write_row(int row, const float *pixels)
+{
+  if (!out->write_scanline(row, 0, TypeDesc::FLOAT, pixels)) {
+    error = "Failed to write to image file " + filepath + ": " + out->geterror();
+    return false;
+  }
+
+  return true;
+}
+
+bool TileImageWriter::close()
+{
+  thread_scoped_lock lock(mutex);
+
+  if (!out) {
+    return false;
+  }
+
+  bool ok = true;
+
+  if (next_row < spec.height) {
+    VLOG(1) << "Writing " << spec.height - next_row << " unfinished rows to " << filepath;
+
+    /* Scanlines must be written in order, fill in rows that are not complete. */
+    const vector<float> black(spec.width * spec.nchannels, 0.0f);
+
+    for (; ok && next_row < spec.height; next_row++) {
+      auto it = rows.find(next_row);
+      ok = write_row(next_row, (it != rows.end()) ? &it->second[0] : &black[0]);
+    }
+    rows.clear();
+    mem_used = 0;
+  }
+
+  if (!out->close()) {
+    error = "Failed to save image file " + filepath + ": " + out->geterror();
+    ok = false;
+  }
+
+  out.reset();
+
+  VLOG(1) << "Wrote " << filepath << ", peak memory of unfinished rows "
+          << string_human_readable_size(mem_peak);
+
+  return ok;
+}
+
+CCL_NAMESPACE_END
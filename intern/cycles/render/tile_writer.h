@@ -0,0 +1,83 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TILE_WRITER_H__
+#define __TILE_WRITER_H__
+
+#include "util/util_map.h"
+#include "util/util_string.h"
+#include "util/util_thread.h"
+#include "util/util_unique_ptr.h"
+#include "util/util_vector.h"
+
+#include <OpenImageIO/imageio.h>
+
+OIIO_NAMESPACE_USING
+
+CCL_NAMESPACE_BEGIN
+
+/* Tile Image Writer
+ *
+ * Streams finished render tiles to an image file, so that the full frame does
+ * not have to be kept in memory for very high resolution renders. Tiles can be
+ * written in any order, rows are written to the file as soon as all tiles
+ * covering them are finished and freed afterwards. Rendering tiles from top to
+ * bottom keeps the number of rows waiting in memory to about one row of tiles. */
+
+class TileImageWriter {
+ public:
+  TileImageWriter();
+  ~TileImageWriter();
+
+  /* Open file for writing, with size, channels and metadata from the spec. */
+  bool open(const string &filepath, const ImageSpec &spec);
+
+  /* Write pixels of a tile, with rows in bottom to top order as in render
+   * buffers and all channels of a pixel interleaved. Tiles must be inside of
+   * the image. Thread safe. */
+  bool write_tile(int x, int y, int w, int h, const float *pixels);
+
+  /* Write remaining rows and close the file. Rows of tiles that were never
+   * written, for example due to cancelling the render, are left black. */
+  bool close();
+
+  /* Peak memory used by rows waiting for tiles, in bytes. */
+  size_t mem_peak;
+
+  /* Error message, in case of failure. */
+  string error;
+
+ protected:
+  bool write_finished_rows();
+  bool write_row(int row, const float *pixels);
+
+  thread_mutex mutex;
+  unique_ptr<ImageOutput> out;
+  ImageSpec spec;
+  string filepath;
+
+  /* Rows that were partially written, in top to bottom file order. */
+  map<int, vector<float>> rows;
+  /* Number of pixels written for every row. */
+  vector<int> row_num_pixels;
+  /* Next row to write to the file. */
+  int next_row;
+  size_t mem_used;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __TILE_WRITER_H__ */
@@ -30,6 +30,7 @@
 #include "util/util_logging.h"
 #include "util/util_openvdb.h"
 #include "util/util_progress.h"
+#include "util/util_texture.h"
 #include "util/util_types.h"
 
 CCL_NAMESPACE_BEGIN
@@ -425,6 +426,36 @@ bool VolumeMeshBuilder::empty_grid() const
 }
 
 #ifdef WITH_OPENVDB
+static openvdb::math::Transform::Ptr openvdb_transform_from_texture(int width,
+                                                                    int height,
+                                                                    int depth,
+                                                                    Transform transform_3d)
+{
+  /* Compute index to world matrix. */
+  float3 voxel_size = make_float3(1.0f / width, 1.0f / height, 1.0f / depth);
+
+  transform_3d = transform_inverse(transform_3d);
+
+  openvdb::Mat4R index_to_world_mat((double)(voxel_size.x * transform_3d[0][0]),
+                                    0.0,
+                                    0.0,
+                                    0.0,
+                                    0.0,
+                                    (double)(voxel_size.y * transform_3d[1][1]),
+                                    0.0,
+                                    0.0,
+                                    0.0,
+                                    0.0,
+                                    (double)(voxel_size.z * transform_3d[2][2]),
+                                    0.0,
+                                    (double)transform_3d[0][3],
+                                    (double)transform_3d[1][3],
+                                    (double)transform_3d[2][3],
+                                    1.0);
+
+  return openvdb::math::Transform::createLinearTransform(index_to_world_mat);
+}
+
 template<typename GridType>
 static openvdb::GridBase::ConstPtr openvdb_grid_from_device_texture(device_texture *image_memory,
                                                                     float volume_clipping,
@@ -450,34 +481,71 @@ static openvdb::GridBase::ConstPtr openvdb_grid_from_device_texture(device_textu
    * volume_clipping parameter. */
   sparse->tree().voxelizeActiveTiles();
 
-  /* Compute index to world matrix. */
-  float3 voxel_size = make_float3(1.0f / image_memory->data_width,
-                                  1.0f / image_memory->data_height,
-                                  1.0f / image_memory->data_depth);
+  sparse->setTransform(openvdb_transform_from_texture(image_memory->data_width,
+                                                      image_memory->data_height,
+                                                      image_memory->data_depth,
+                                                      transform_3d));
 
-  transform_3d = transform_inverse(transform_3d);
+  return sparse;
+}
 
-  openvdb::Mat4R index_to_world_mat((double)(voxel_size.x * transform_3d[0][0]),
-                                    0.0,
-                                    0.0,
-                                    0.0,
-                                    0.0,
-                                    (double)(voxel_size.y * transform_3d[1][1]),
-                                    0.0,
-                                    0.0,
-                                    0.0,
-                                    0.0,
-                                    (double)(voxel_size.z * transform_3d[2][2]),
-                                    0.0,
-                                    (double)transform_3d[0][3],
-                                    (double)transform_3d[1][3],
-                                    (double)transform_3d[2][3],
-                                    1.0);
+/* Build the topology of a sparse texture, with voxels active where any channel is
+ * above the clipping threshold, like #copyFromDense does for dense textures. */
+static openvdb::GridBase::ConstPtr openvdb_grid_from_sparse_texture(device_texture *image_memory,
+                                                                    float volume_clipping,
+                                                                    Transform transform_3d)
+{
+  const TextureInfo &info = image_memory->info;
+  const int tiles_x = tex_sparse_num_tiles(info.width);
+  const int tiles_y = tex_sparse_num_tiles(info.height);
+  const int tiles_z = tex_sparse_num_tiles(info.depth);
+  const int num_channels = (info.data_type == IMAGE_DATA_TYPE_SPARSE_FLOAT4) ? 4 : 1;
+
+  const int *tiles = static_cast<const int *>(image_memory->host_pointer);
+  const float *voxels = reinterpret_cast<const float *>(
+      static_cast<const char *>(image_memory->host_pointer) +
+      tex_sparse_voxels_offset(info.width, info.height, info.depth));
+
+  openvdb::MaskGrid::Ptr sparse = openvdb::MaskGrid::create();
+  openvdb::MaskGrid::Accessor accessor = sparse->getAccessor();
+
+  for (int tz = 0; tz < tiles_z; tz++) {
+    for (int ty = 0; ty < tiles_y; ty++) {
+      for (int tx = 0; tx < tiles_x; tx++) {
+        const int tile = tiles[tx + (ty + tz * tiles_y) * tiles_x];
+        if (tile == TEX_SPARSE_EMPTY_TILE) {
+          continue;
+        }
+
+        const float *tile_voxels = voxels + (size_t)tile * TEX_SPARSE_TILE_VOXELS * num_channels;
+
+        for (int i = 0; i < TEX_SPARSE_TILE_VOXELS; i++) {
+          const int x = (tx << TEX_SPARSE_TILE_SHIFT) + (i & TEX_SPARSE_TILE_MASK);
+          const int y = (ty << TEX_SPARSE_TILE_SHIFT) +
+                        ((i >> TEX_SPARSE_TILE_SHIFT) & TEX_SPARSE_TILE_MASK);
+          const int z = (tz << TEX_SPARSE_TILE_SHIFT) + (i >> (2 * TEX_SPARSE_TILE_SHIFT));
+
+          /* Tiles at the end of the grid are partially outside of it. */
+          if (x >= info.width || y >= info.height || z >= info.depth) {
+            continue;
+          }
 
-  openvdb::math::Transform::Ptr index_to_world_tfm =
-      openvdb::math::Transform::createLinearTransform(index_to_world_mat);
+          const float *value = tile_voxels + i * num_channels;
+          bool active = false;
+          for (int c = 0; c < min(num_channels, 3); c++) {
+            active |= fabsf(value[c]) > volume_clipping;
+          }
 
-  sparse->setTransform(index_to_world_tfm);
+          if (active) {
+            accessor.setValueOn(openvdb::Coord(x, y, z));
+          }
+        }
+      }
+    }
+  }
+
+  sparse->setTransform(
+      openvdb_transform_from_texture(info.width, info.height, info.depth, transform_3d));
 
   return sparse;
 }
@@ -512,11 +580,16 @@ void GeometryManager::create_volume_mesh(Volume *volume, Progress &progress)
       do_clipping = true;
     }
 
-    /* Else fall back to creating an OpenVDB grid from the dense volume data. */
+    /* Else fall back to creating an OpenVDB grid from the volume texture data. */
     if (!grid) {
       device_texture *image_memory = handle.image_memory();
+      const ImageDataType type = handle.metadata().type;
 
-      if (image_memory->data_elements == 1) {
+      if (type == IMAGE_DATA_TYPE_SPARSE_FLOAT || type == IMAGE_DATA_TYPE_SPARSE_FLOAT4) {
+        grid = openvdb_grid_from_sparse_texture(
+            image_memory, volume->clipping, handle.metadata().transform_3d);
+      }
+      else if (image_memory->data_elements == 1) {
         grid = openvdb_grid_from_device_texture<openvdb::FloatGrid>(
             image_memory, volume->clipping, handle.metadata().transform_3d);
       }
@@ -20,8 +20,115 @@
 #include "subd/subd_dice.h"
 #include "subd/subd_patch.h"
 
+#include "util/util_hash.h"
+#include "util/util_md5.h"
+#include "util/util_task.h"
+
 CCL_NAMESPACE_BEGIN
 
+/* Dice Cache */
+
+DiceCache::Key::Key(const Subpatch &sub) : patch_index(sub.patch->patch_index)
+{
+  for (int i = 0; i < 4; i++) {
+    corners[i] = sub.corners[i];
+    T[i] = sub.edges[i].T;
+  }
+}
+
+bool DiceCache::Key::operator==(const Key &other) const
+{
+  if (patch_index != other.patch_index) {
+    return false;
+  }
+
+  for (int i = 0; i < 4; i++) {
+    if (corners[i] != other.corners[i] || T[i] != other.T[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+size_t DiceCache::KeyHasher::operator()(const Key &key) const
+{
+  uint hash = hash_uint(key.patch_index);
+
+  for (int i = 0; i < 4; i++) {
+    hash = hash_uint4(hash,
+                      __float_as_uint(key.corners[i].x),
+                      __float_as_uint(key.corners[i].y),
+                      (uint)key.T[i]);
+  }
+
+  return hash;
+}
+
+DiceCache::DiceCache()
+{
+}
+
+template<typename T> static void md5_append_value(MD5Hash &md5, const T &value)
+{
+  md5.append((const uint8_t *)&value, sizeof(value));
+}
+
+/* Only the xyz components, the padding of float3 is not initialized. */
+static void md5_append_float3_array(MD5Hash &md5, const float3 *data, size_t size)
+{
+  for (size_t i = 0; i < size; i++) {
+    const float xyz[3] = {data[i].x, data[i].y, data[i].z};
+    md5_append_value(md5, xyz);
+  }
+}
+
+void DiceCache::validate(Mesh *mesh)
+{
+  /* Hash everything the patches are built from. A collision would reuse vertices of
+   * another control mesh, so use a strong hash rather than a fast one. */
+  MD5Hash md5;
+  md5_append_value(md5, mesh->subdivision_type);
+
+  md5_append_value(md5, mesh->verts.size());
+  md5_append_float3_array(md5, mesh->verts.data(), mesh->verts.size());
+
+  Attribute *attr_vN = mesh->subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
+  md5_append_value(md5, attr_vN != NULL);
+  if (attr_vN) {
+    md5_append_float3_array(md5, attr_vN->data_float3(), mesh->verts.size());
+  }
+
+  md5_append_value(md5, mesh->subd_faces.size());
+  for (size_t i = 0; i < mesh->subd_faces.size(); i++) {
+    const Mesh::SubdFace &face = mesh->subd_faces[i];
+    md5_append_value(md5, face.start_corner);
+    md5_append_value(md5, face.num_corners);
+    md5_append_value(md5, face.ptex_offset);
+    md5_append_value(md5, face.shader);
+    md5_append_value(md5, face.smooth);
+  }
+
+  md5_append_value(md5, mesh->subd_face_corners.size());
+  if (mesh->subd_face_corners.size()) {
+    md5.append((const uint8_t *)mesh->subd_face_corners.data(),
+               sizeof(int) * mesh->subd_face_corners.size());
+  }
+
+  md5_append_value(md5, mesh->subd_creases.size());
+  for (size_t i = 0; i < mesh->subd_creases.size(); i++) {
+    const Mesh::SubdEdgeCrease &crease = mesh->subd_creases[i];
+    md5_append_value(md5, crease.v);
+    md5_append_value(md5, crease.crease);
+  }
+
+  const string hash = md5.get_hex();
+  if (hash != mesh_hash) {
+    entries.clear();
+    mesh_hash = hash;
+  }
+}
+
 /* EdgeDice Base */
 
 EdgeDice::EdgeDice(const SubdParams &params_) : params(params_)
@@ -45,8 +152,8 @@ void EdgeDice::reserve(int num_verts, int num_triangles)
   vert_offset = mesh->verts.size();
   tri_offset = mesh->num_triangles();
 
-  mesh->resize_mesh(mesh->verts.size() + num_verts, mesh->num_triangles());
-  mesh->reserve_mesh(mesh->verts.size() + num_verts, mesh->num_triangles() + num_triangles);
+  /* Allocate all verts and triangles up front so subpatches can be diced in parallel. */
+  mesh->resize_mesh(mesh->verts.size() + num_verts, mesh->num_triangles() + num_triangles);
 
   Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
 
@@ -56,12 +163,8 @@ void EdgeDice::reserve(int num_verts, int num_triangles)
   params.mesh->num_subd_verts += num_verts;
 }
 
-void EdgeDice::set_vert(Patch *patch, int index, float2 uv)
+void EdgeDice::set_vert(int index, float2 uv, float3 P, float3 N)
 {
-  float3 P, N;
-
-  patch->eval(&P, NULL, NULL, &N, uv.x, uv.y);
-
   assert(index < params.mesh->verts.size());
 
   mesh_P[index] = P;
@@ -69,17 +172,22 @@ void EdgeDice::set_vert(Patch *patch, int index, float2 uv)
   params.mesh->vert_patch_uv[index + vert_offset] = make_float2(uv.x, uv.y);
 }
 
-void EdgeDice::add_triangle(Patch *patch, int v0, int v1, int v2)
+void EdgeDice::add_triangle(Patch *patch, int index, int v0, int v1, int v2)
 {
   Mesh *mesh = params.mesh;
+  size_t tri = tri_offset + index;
 
-  mesh->add_triangle(v0 + vert_offset, v1 + vert_offset, v2 + vert_offset, patch->shader, true);
-  params.mesh->triangle_patch[params.mesh->num_triangles() - 1] = patch->patch_index;
+  assert(tri < mesh->num_triangles());
 
-  tri_offset++;
+  mesh->triangles[tri * 3 + 0] = v0 + vert_offset;
+  mesh->triangles[tri * 3 + 1] = v1 + vert_offset;
+  mesh->triangles[tri * 3 + 2] = v2 + vert_offset;
+  mesh->shader[tri] = patch->shader;
+  mesh->smooth[tri] = true;
+  mesh->triangle_patch[tri] = patch->patch_index;
 }
 
-void EdgeDice::stitch_triangles(Subpatch &sub, int edge)
+void EdgeDice::stitch_triangles(Subpatch &sub, int edge, int &tri_index)
 {
   int Mu = max(sub.edge_u0.T, sub.edge_u1.T);
   int Mv = max(sub.edge_v0.T, sub.edge_v1.T);
@@ -122,7 +230,7 @@ void EdgeDice::stitch_triangles(Subpatch &sub, int edge)
         v2 = sub.get_vert_along_grid_edge(edge, ++i);
     }
 
-    add_triangle(sub.patch, v1, v0, v2);
+    add_triangle(sub.patch, tri_index++, v1, v0, v2);
   }
 }
 
@@ -152,12 +260,44 @@ float3 QuadDice::eval_projected(Subpatch &sub, float u, float v)
   return P;
 }
 
-void QuadDice::set_vert(Subpatch &sub, int index, float u, float v)
+void QuadDice::set_vert(Subpatch &sub,
+                        int index,
+                        float u,
+                        float v,
+                        bool owned,
+                        const DiceCache::Entry *cached,
+                        DiceCache::Entry *entry,
+                        int &entry_index)
 {
-  EdgeDice::set_vert(sub.patch, index, map_uv(sub, u, v));
+  float2 uv = map_uv(sub, u, v);
+  float3 P, N;
+
+  if (cached) {
+    P = cached->P[entry_index];
+    N = cached->N[entry_index];
+  }
+  else {
+    sub.patch->eval(&P, NULL, NULL, &N, uv.x, uv.y);
+
+    if (entry) {
+      entry->P[entry_index] = P;
+      entry->N[entry_index] = N;
+    }
+  }
+  entry_index++;
+
+  if (owned) {
+    EdgeDice::set_vert(index, uv, P, N);
+  }
 }
 
-void QuadDice::set_side(Subpatch &sub, int edge)
+void QuadDice::set_side(Subpatch &sub,
+                        int edge,
+                        const vector<int> &vert_owner,
+                        int sub_index,
+                        const DiceCache::Entry *cached,
+                        DiceCache::Entry *entry,
+                        int &entry_index)
 {
   int t = sub.edges[edge].T;
 
@@ -186,7 +326,10 @@ void QuadDice::set_side(Subpatch &sub, int edge)
         break;
     }
 
-    set_vert(sub, sub.get_vert_along_edge(edge, i), u, v);
+    int index = sub.get_vert_along_edge(edge, i);
+    bool owned = (vert_owner[index] == sub_index);
+
+    set_vert(sub, index, u, v, owned, cached, entry, entry_index);
   }
 }
 
@@ -224,9 +367,15 @@ float QuadDice::scale_factor(Subpatch &sub, int Mu, int Mv)
   return S;
 }
 
-void QuadDice::add_grid(Subpatch &sub, int Mu, int Mv, int offset)
+void QuadDice::add_grid(Subpatch &sub,
+                        int Mu,
+                        int Mv,
+                        const DiceCache::Entry *cached,
+                        DiceCache::Entry *entry,
+                        int &entry_index)
 {
   /* create inner grid */
+  int offset = sub.inner_grid_vert_offset;
   float du = 1.0f / (float)Mu;
   float dv = 1.0f / (float)Mv;
 
@@ -235,26 +384,34 @@ void QuadDice::add_grid(Subpatch &sub, int Mu, int Mv, int offset)
       float u = i * du;
       float v = j * dv;
 
-      set_vert(sub, offset + (i - 1) + (j - 1) * (Mu - 1), u, v);
+      set_vert(
+          sub, offset + (i - 1) + (j - 1) * (Mu - 1), u, v, true, cached, entry, entry_index);
+    }
+  }
+}
+
+void QuadDice::add_grid_triangles(Subpatch &sub, int Mu, int Mv, int &tri_index)
+{
+  int offset = sub.inner_grid_vert_offset;
 
-      if (i < Mu - 1 && j < Mv - 1) {
-        int i1 = offset + (i - 1) + (j - 1) * (Mu - 1);
-        int i2 = offset + i + (j - 1) * (Mu - 1);
-        int i3 = offset + i + j * (Mu - 1);
-        int i4 = offset + (i - 1) + j * (Mu - 1);
+  for (int j = 1; j < Mv - 1; j++) {
+    for (int i = 1; i < Mu - 1; i++) {
+      int i1 = offset + (i - 1) + (j - 1) * (Mu - 1);
+      int i2 = offset + i + (j - 1) * (Mu - 1);
+      int i3 = offset + i + j * (Mu - 1);
+      int i4 = offset + (i - 1) + j * (Mu - 1);
 
-        add_triangle(sub.patch, i1, i2, i3);
-        add_triangle(sub.patch, i1, i3, i4);
-      }
+      add_triangle(sub.patch, tri_index++, i1, i2, i3);
+      add_triangle(sub.patch, tri_index++, i1, i3, i4);
     }
   }
 }
 
-void QuadDice::dice(Subpatch &sub)
+void QuadDice::grid_size(Subpatch &sub, int *Mu, int *Mv)
 {
   /* compute inner grid size with scale factor */
-  int Mu = max(sub.edge_u0.T, sub.edge_u1.T);
-  int Mv = max(sub.edge_v0.T, sub.edge_v1.T);
+  *Mu = max(sub.edge_u0.T, sub.edge_u1.T);
+  *Mv = max(sub.edge_v0.T, sub.edge_v1.T);
 
 #if 0 /* Doesn't work very well, especially at grazing angles. */
   float S = scale_factor(sub, ef, Mu, Mv);
@@ -262,22 +419,105 @@ void QuadDice::dice(Subpatch &sub)
   float S = 1.0f;
 #endif
 
-  Mu = max((int)ceilf(S * Mu), 2);  // XXX handle 0 & 1?
-  Mv = max((int)ceilf(S * Mv), 2);  // XXX handle 0 & 1?
+  *Mu = max((int)ceilf(S * *Mu), 2);  // XXX handle 0 & 1?
+  *Mv = max((int)ceilf(S * *Mv), 2);  // XXX handle 0 & 1?
+}
+
+void QuadDice::dice_verts(Subpatch &sub,
+                          const vector<int> &vert_owner,
+                          int sub_index,
+                          const DiceCache::Entry *cached,
+                          DiceCache::Entry *entry)
+{
+  int Mu, Mv;
+  grid_size(sub, &Mu, &Mv);
+
+  if (entry) {
+    int num_verts = (Mu - 1) * (Mv - 1) + sub.edge_u0.T + sub.edge_u1.T + sub.edge_v0.T +
+                    sub.edge_v1.T;
+    entry->P.resize(num_verts);
+    entry->N.resize(num_verts);
+  }
+
+  int entry_index = 0;
 
   /* inner grid */
-  add_grid(sub, Mu, Mv, sub.inner_grid_vert_offset);
+  add_grid(sub, Mu, Mv, cached, entry, entry_index);
 
   /* sides */
-  set_side(sub, 0);
-  set_side(sub, 1);
-  set_side(sub, 2);
-  set_side(sub, 3);
-
-  stitch_triangles(sub, 0);
-  stitch_triangles(sub, 1);
-  stitch_triangles(sub, 2);
-  stitch_triangles(sub, 3);
+  for (int edge = 0; edge < 4; edge++) {
+    set_side(sub, edge, vert_owner, sub_index, cached, entry, entry_index);
+  }
+}
+
+void QuadDice::dice_triangles(Subpatch &sub)
+{
+  int Mu, Mv;
+  grid_size(sub, &Mu, &Mv);
+
+  int tri_index = sub.triangle_offset;
+
+  /* inner grid */
+  add_grid_triangles(sub, Mu, Mv, tri_index);
+
+  /* stitch sides, this uses the positions of the verts of neighboring
+   * subpatches so can only be done once all verts are set. */
+  for (int edge = 0; edge < 4; edge++) {
+    stitch_triangles(sub, edge, tri_index);
+  }
+}
+
+void QuadDice::dice(vector<Subpatch> &subpatches, int num_edge_verts)
+{
+  const size_t num_subpatches = subpatches.size();
+  DiceCache *cache = params.cache;
+
+  /* Verts on edges are shared by subpatches, find the last one to set them. */
+  vector<int> vert_owner(num_edge_verts, -1);
+
+  for (size_t i = 0; i < num_subpatches; i++) {
+    Subpatch &sub = subpatches[i];
+
+    for (int edge = 0; edge < 4; edge++) {
+      for (int j = 0; j < sub.edges[edge].T; j++) {
+        vert_owner[sub.get_vert_along_edge(edge, j)] = i;
+      }
+    }
+  }
+
+  /* Find subpatches diced with the same corners and edge factors before. */
+  vector<DiceCache::Entry *> cached(num_subpatches, NULL);
+  vector<DiceCache::Entry> entries((cache) ? num_subpatches : 0);
+
+  if (cache) {
+    for (size_t i = 0; i < num_subpatches; i++) {
+      DiceCache::EntryMap::iterator it = cache->entries.find(DiceCache::Key(subpatches[i]));
+      if (it != cache->entries.end()) {
+        cached[i] = &it->second;
+      }
+    }
+  }
+
+  parallel_for(size_t(0), num_subpatches, [&](size_t i) {
+    DiceCache::Entry *entry = (cache && !cached[i]) ? &entries[i] : NULL;
+    dice_verts(subpatches[i], vert_owner, i, cached[i], entry);
+  });
+
+  parallel_for(size_t(0), num_subpatches, [&](size_t i) { dice_triangles(subpatches[i]); });
+
+  /* Keep only the subpatches of this tessellation in the cache. */
+  if (cache) {
+    DiceCache::EntryMap new_entries;
+
+    for (size_t i = 0; i < num_subpatches; i++) {
+      DiceCache::Entry &entry = (cached[i]) ? *cached[i] : entries[i];
+      DiceCache::Entry &new_entry = new_entries[DiceCache::Key(subpatches[i])];
+      new_entry.P.swap(entry.P);
+      new_entry.N.swap(entry.N);
+    }
+
+    cache->entries.swap(new_entries);
+  }
 }
 
 CCL_NAMESPACE_END
@@ -22,6 +22,8 @@
  * DiagSplit. For more algorithm details, see the DiagSplit paper or the
  * ARB_tessellation_shader OpenGL extension, Section 2.X.2. */
 
+#include "util/util_map.h"
+#include "util/util_string.h"
 #include "util/util_types.h"
 #include "util/util_vector.h"
 
@@ -30,6 +32,7 @@
 CCL_NAMESPACE_BEGIN
 
 class Camera;
+class DiceCache;
 class Mesh;
 class Patch;
 
@@ -43,6 +46,7 @@ struct SubdParams {
   int max_level;
   Camera *camera;
   Transform objecttoworld;
+  DiceCache *cache;
 
   SubdParams(Mesh *mesh_, bool ptex_ = false)
   {
@@ -54,9 +58,51 @@ struct SubdParams {
     dicing_rate = 1.0f;
     max_level = 12;
     camera = NULL;
+    cache = NULL;
   }
 };
 
+/* Dice Cache
+ *
+ * Vertices evaluated for the subpatches of the previous tessellation of a mesh.
+ * When only the dicing camera changes, most subpatches end up with the same
+ * corners and edge factors, and their vertices are copied from the cache
+ * instead of evaluating the patches again. */
+
+class DiceCache {
+ public:
+  struct Key {
+    int patch_index;
+    float2 corners[4];
+    int T[4];
+
+    explicit Key(const Subpatch &sub);
+
+    bool operator==(const Key &other) const;
+  };
+
+  struct KeyHasher {
+    size_t operator()(const Key &key) const;
+  };
+
+  /* Positions and normals in the order the subpatch vertices are evaluated. */
+  struct Entry {
+    vector<float3> P;
+    vector<float3> N;
+  };
+
+  typedef unordered_map<Key, Entry, KeyHasher> EntryMap;
+
+  DiceCache();
+
+  /* Clear the cache if the control mesh changed since it was filled. */
+  void validate(Mesh *mesh);
+
+  EntryMap entries;
+  /* MD5 of the control mesh the entries were evaluated for. */
+  string mesh_hash;
+};
+
 /* EdgeDice Base */
 
 class EdgeDice {
@@ -71,10 +117,10 @@ class EdgeDice {
 
   void reserve(int num_verts, int num_triangles);
 
-  void set_vert(Patch *patch, int index, float2 uv);
-  void add_triangle(Patch *patch, int v0, int v1, int v2);
+  void set_vert(int index, float2 uv, float3 P, float3 N);
+  void add_triangle(Patch *patch, int index, int v0, int v1, int v2);
 
-  void stitch_triangles(Subpatch &sub, int edge);
+  void stitch_triangles(Subpatch &sub, int edge, int &tri_index);
 };
 
 /* Quad EdgeDice */
@@ -86,16 +132,47 @@ class QuadDice : public EdgeDice {
   float3 eval_projected(Subpatch &sub, float u, float v);
 
   float2 map_uv(Subpatch &sub, float u, float v);
-  void set_vert(Subpatch &sub, int index, float u, float v);
-
-  void add_grid(Subpatch &sub, int Mu, int Mv, int offset);
-
-  void set_side(Subpatch &sub, int edge);
+  void set_vert(Subpatch &sub,
+                int index,
+                float u,
+                float v,
+                bool owned,
+                const DiceCache::Entry *cached,
+                DiceCache::Entry *entry,
+                int &entry_index);
+
+  void add_grid(Subpatch &sub,
+                int Mu,
+                int Mv,
+                const DiceCache::Entry *cached,
+                DiceCache::Entry *entry,
+                int &entry_index);
+  void add_grid_triangles(Subpatch &sub, int Mu, int Mv, int &tri_index);
+
+  void set_side(Subpatch &sub,
+                int edge,
+                const vector<int> &vert_owner,
+                int sub_index,
+                const DiceCache::Entry *cached,
+                DiceCache::Entry *entry,
+                int &entry_index);
 
   float quad_area(const float3 &a, const float3 &b, const float3 &c, const float3 &d);
   float scale_factor(Subpatch &sub, int Mu, int Mv);
 
-  void dice(Subpatch &sub);
+  void grid_size(Subpatch &sub, int *Mu, int *Mv);
+
+  void dice_verts(Subpatch &sub,
+                  const vector<int> &vert_owner,
+                  int sub_index,
+                  const DiceCache::Entry *cached,
+                  DiceCache::Entry *entry);
+  void dice_triangles(Subpatch &sub);
+
+  /* Dice all subpatches in parallel. Vertices on edges shared between
+   * subpatches are below num_edge_verts, and written by the last subpatch to
+   * use them only so the result does not depend on the order of tasks. */
+  void dice(vector<Subpatch> &subpatches, int num_edge_verts);
 };
 
 CCL_NAMESPACE_END
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests of compressed BVH nodes, included with the defines of different kernels. */
+
+#include "testing/testing.h"
+
+#include "bvh/bvh2.h"
+#include "bvh/bvh_params.h"
+
+// clang-format off
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/kernels/cpu/kernel_cpu_image.h"
+#include "kernel/kernel_random.h"
+#include "kernel/kernel_projection.h"
+#include "kernel/geom/geom.h"
+// clang-format on
+
+#include "util/util_boundbox.h"
+#include "util/util_hash.h"
+#include "util/util_system.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Included in the namespace, as in kernel/bvh/bvh.h. */
+#include "kernel/bvh/bvh_nodes.h"
+
+namespace {
+
+bool validate_cpu_capabilities()
+{
+#ifdef __KERNEL_AVX2__
+  return system_cpu_support_avx2();
+#else
+  return true;
+#endif
+}
+
+#define VALIDATECPU \
+  if (!validate_cpu_capabilities()) \
+    return;
+
+/* Gives access to packing a single node. */
+class CompressedBVH2 : public BVH2 {
+ public:
+  CompressedBVH2(const BVHParams &params)
+      : BVH2(params, vector<Geometry *>(), vector<Object *>())
+  {
+    pack.nodes.resize(BVH_COMPRESSED_NODE_SIZE);
+  }
+
+  using BVH2::pack_compressed_node;
+};
+
+/* Pack two child bounds into a compressed node and check that the bounds decoded by the
+ * kernel contain the original bounds, and lie within the parent bounds. */
+void check_compressed_node(const BoundBox &b0, const BoundBox &b1)
+{
+  BVHParams params;
+  params.use_compressed_nodes = true;
+  CompressedBVH2 bvh(params);
+
+  const uint visibility0 = PATH_RAY_CAMERA | PATH_RAY_SHADOW;
+  const uint visibility1 = PATH_RAY_DIFFUSE | PATH_RAY_VOLUME_SCATTER;
+  bvh.pack_compressed_node(0, b0, b1, -1, -2, visibility0, visibility1);
+
+  const int4 header = bvh.pack.nodes[0];
+  EXPECT_EQ(header.x, visibility0 | PATH_RAY_NODE_COMPRESSED);
+  EXPECT_EQ(header.y, visibility1 | PATH_RAY_NODE_COMPRESSED);
+  EXPECT_EQ(header.z, -1);
+  EXPECT_EQ(header.w, -2);
+
+  KernelGlobals kg;
+  kg.__bvh_nodes.data = (float4 *)&bvh.pack.nodes[0];
+  kg.__bvh_nodes.width = bvh.pack.nodes.size();
+
+  float4 nodes[3];
+  bvh_compressed_node_fetch_bounds(&kg, 0, &nodes[0], &nodes[1], &nodes[2]);
+
+  const BoundBox parent = merge(b0, b1);
+  for (int axis = 0; axis < 3; axis++) {
+    const float4 node = nodes[axis];
+    EXPECT_LE(node.x, b0.min[axis]);
+    EXPECT_LE(node.y, b1.min[axis]);
+    EXPECT_GE(node.z, b0.max[axis]);
+    EXPECT_GE(node.w, b1.max[axis]);
+
+    EXPECT_GE(node.x, parent.min[axis]);
+    EXPECT_GE(node.y, parent.min[axis]);
+  }
+}
+
+BoundBox random_box(const float3 center, const float size, const uint seed)
+{
+  const float3 a = make_float3(hash_uint2_to_float(seed, 0),
+                               hash_uint2_to_float(seed, 1),
+                               hash_uint2_to_float(seed, 2));
+  const float3 b = make_float3(hash_uint2_to_float(seed, 3),
+                               hash_uint2_to_float(seed, 4),
+                               hash_uint2_to_float(seed, 5));
+  return BoundBox(center + (min(a, b) - make_float3(0.5f, 0.5f, 0.5f)) * size,
+                  center + (max(a, b) - make_float3(0.5f, 0.5f, 0.5f)) * size);
+}
+
+}  // namespace
+
+TEST(TEST_CATEGORY_NAME, quantize)
+{
+  VALIDATECPU
+
+  const float origin = -3.7f;
+  const float scale = ldexpf(1.0f, -5);
+
+  for (uint i = 0; i < 10000; i++) {
+    const float value = origin + hash_uint2_to_float(i, 0) * 255.0f * scale;
+
+    /* Tightest steps that still contain the value after dequantization. */
+    const uint lower = bvh_quantize_lower(value, origin, scale);
+    EXPECT_LE(origin + lower * scale, value);
+    EXPECT_TRUE(lower == 255 || origin + (lower + 1) * scale > value);
+
+    const uint upper = bvh_quantize_upper(value, origin, scale);
+    EXPECT_GE(origin + upper * scale, value);
+    EXPECT_TRUE(upper == 0 || origin + (upper - 1) * scale < value);
+  }
+
+  /* Values outside of the parent range are clamped. */
+  EXPECT_EQ(bvh_quantize_lower(origin - 1.0f, origin, scale), 0);
+  EXPECT_EQ(bvh_quantize_upper(origin + 256.0f * scale, origin, scale), 255);
+}
+
+TEST(TEST_CATEGORY_NAME, random)
+{
+  VALIDATECPU
+
+  for (uint i = 0; i < 1000; i++) {
+    const float3 center = make_float3(hash_uint2_to_float(i, 10) * 20.0f - 10.0f,
+                                      hash_uint2_to_float(i, 11) * 20.0f - 10.0f,
+                                      hash_uint2_to_float(i, 12) * 20.0f - 10.0f);
+    check_compressed_node(random_box(center, 1.0f, i * 2), random_box(center, 3.0f, i * 2 + 1));
+  }
+}
+
+TEST(TEST_CATEGORY_NAME, degenerate)
+{
+  VALIDATECPU
+
+  const float3 p = make_float3(1.5f, -2.25f, 7.0f);
+
+  /* Points, and boxes that are flat along one axis. */
+  check_compressed_node(BoundBox(p), BoundBox(p));
+  check_compressed_node(BoundBox(p), BoundBox(p, p + make_float3(1.0f, 1.0f, 1.0f)));
+  check_compressed_node(BoundBox(p, p + make_float3(1.0f, 0.0f, 1.0f)),
+                        BoundBox(p, p + make_float3(0.0f, 1.0f, 1.0f)));
+  check_compressed_node(BoundBox(make_float3(0.0f, 0.0f, 0.0f)),
+                        BoundBox(make_float3(0.0f, 0.0f, 0.0f)));
+}
+
+TEST(TEST_CATEGORY_NAME, large)
+{
+  VALIDATECPU
+
+  const float3 one = make_float3(1.0f, 1.0f, 1.0f);
+
+  check_compressed_node(BoundBox(-1e37f * one, 1e37f * one), BoundBox(-one, one));
+  check_compressed_node(BoundBox(1e30f * one, 1e30f * one + one), BoundBox(-one, one));
+  check_compressed_node(BoundBox(1e6f * one, 1e6f * one + 0.125f * one),
+                        BoundBox(1e6f * one + 0.5f * one, 1e6f * one + one));
+}
+
+TEST(TEST_CATEGORY_NAME, small)
+{
+  VALIDATECPU
+
+  const float3 one = make_float3(1.0f, 1.0f, 1.0f);
+
+  check_compressed_node(BoundBox(-1e-30f * one, 1e-30f * one),
+                        BoundBox(1e-31f * one, 1e-30f * one));
+  /* Denormals. */
+  check_compressed_node(BoundBox(-1e-40f * one, 1e-40f * one),
+                        BoundBox(-1e-41f * one, 0.0f * one));
+  check_compressed_node(BoundBox(1000.0f * one, 1000.0f * one + 1e-4f * one),
+                        BoundBox(1000.0f * one + 2e-4f * one, 1000.0f * one + 3e-4f * one));
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "kernel/filter/filter.h"
+
+#include "util/util_array.h"
+#include "util/util_math.h"
+#include "util/util_optimization.h"
+#include "util/util_system.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Odd size, so rows end in the middle of both four and eight pixel groups. */
+const int width = 37;
+const int height = 23;
+const int stride = 40;
+/* Padding around the images, the non-local means kernels read a few pixels outside of rows. */
+const int padding = 2 * stride;
+const int pass_size = stride * height + 2 * padding;
+
+const int r = 3;
+const int f = 2;
+const float a = 1.0f;
+const float k_2 = 0.25f;
+
+/* Non-local means kernels of one CPU architecture. */
+struct FilterNLMKernels {
+  decltype(&kernel_cpu_filter_nlm_calc_difference) calc_difference;
+  decltype(&kernel_cpu_filter_nlm_blur) blur;
+  decltype(&kernel_cpu_filter_nlm_calc_weight) calc_weight;
+  decltype(&kernel_cpu_filter_nlm_update_output) update_output;
+  decltype(&kernel_cpu_filter_nlm_normalize) normalize;
+};
+
+#define FILTER_NLM_KERNELS(arch) \
+  { \
+    kernel_##arch##_filter_nlm_calc_difference, kernel_##arch##_filter_nlm_blur, \
+        kernel_##arch##_filter_nlm_calc_weight, kernel_##arch##_filter_nlm_update_output, \
+        kernel_##arch##_filter_nlm_normalize \
+  }
+
+/* Buffers of the non-local means filter, with the same contents for all architectures. */
+struct FilterNLMBuffers {
+  explicit FilterNLMBuffers(const bool is_color)
+      : channel_offset(is_color ? pass_size : 0), num_channels(is_color ? 3 : 1)
+  {
+    image.resize(pass_size * num_channels);
+    guide.resize(pass_size * num_channels);
+    variance.resize(pass_size * num_channels);
+    for (int i = 0; i < pass_size * num_channels; i++) {
+      image[i] = 0.5f + 0.5f * sinf(i * 0.37f);
+      guide[i] = image[i] + 0.1f * sinf(i * 1.3f);
+      variance[i] = 0.01f + 0.05f * (0.5f + 0.5f * cosf(i * 0.71f));
+    }
+
+    /* Temporary buffers start with values, so pixels that are written by one architecture but
+     * not by the other show up as differences. */
+    difference.resize(pass_size);
+    blur_difference.resize(pass_size);
+    weight_accum.resize(pass_size);
+    out.resize(pass_size);
+    for (int i = 0; i < pass_size; i++) {
+      difference[i] = blur_difference[i] = weight_accum[i] = out[i] = 1.0f;
+    }
+  }
+
+  static float *pass(array<float> &buffer)
+  {
+    return buffer.data() + padding;
+  }
+
+  /* Filter with one offset, like the CPU device does. */
+  void update(const FilterNLMKernels &kernels, const int dx, const int dy)
+  {
+    int local_rect[4] = {max(0, -dx), max(0, -dy), width - max(0, dx), height - max(0, dy)};
+    kernels.calc_difference(dx,
+                            dy,
+                            pass(guide),
+                            pass(variance),
+                            NULL,
+                            pass(difference),
+                            local_rect,
+                            stride,
+                            channel_offset,
+                            0,
+                            a,
+                            k_2);
+    kernels.blur(pass(difference), pass(blur_difference), local_rect, stride, f);
+    kernels.calc_weight(pass(blur_difference), pass(difference), local_rect, stride, f);
+    kernels.blur(pass(difference), pass(blur_difference), local_rect, stride, f);
+    kernels.update_output(dx,
+                          dy,
+                          pass(blur_difference),
+                          pass(image),
+                          pass(difference),
+                          pass(out),
+                          pass(weight_accum),
+                          local_rect,
+                          channel_offset,
+                          stride,
+                          f);
+  }
+
+  void normalize(const FilterNLMKernels &kernels)
+  {
+    int rect[4] = {0, 0, width, height};
+    kernels.normalize(pass(out), pass(weight_accum), rect, stride);
+  }
+
+  int channel_offset;
+  int num_channels;
+
+  array<float> image;
+  array<float> guide;
+  array<float> variance;
+
+  array<float> difference;
+  array<float> blur_difference;
+  array<float> weight_accum;
+  array<float> out;
+};
+
+/* Compare buffers including the padding, since kernels write full groups of four pixels.
+ * Pixels outside of the rect may not be finite, but must match as well. */
+void compare_buffers(const array<float> &result,
+                     const array<float> &expected,
+                     const char *name,
+                     const int dx,
+                     const int dy)
+{
+  for (int i = 0; i < pass_size; i++) {
+    if (!isfinite_safe(expected[i])) {
+      ASSERT_EQ(isnan_safe(result[i]), isnan_safe(expected[i]));
+      ASSERT_TRUE(isnan_safe(expected[i]) || result[i] == expected[i]);
+      continue;
+    }
+    ASSERT_NEAR(result[i], expected[i], 1e-5f * max(1.0f, fabsf(expected[i])))
+        << name << ", offset " << dx << " " << dy << ", pixel " << (i - padding) % stride << " "
+        << (i - padding) / stride;
+  }
+}
+
+void compare_filter_nlm(const FilterNLMKernels &kernels, const bool is_color)
+{
+  const FilterNLMKernels reference_kernels = FILTER_NLM_KERNELS(cpu);
+  FilterNLMBuffers reference(is_color);
+  FilterNLMBuffers buffers(is_color);
+
+  for (int i = 0; i < (2 * r + 1) * (2 * r + 1); i++) {
+    const int dy = i / (2 * r + 1) - r;
+    const int dx = i % (2 * r + 1) - r;
+
+    reference.update(reference_kernels, dx, dy);
+    buffers.update(kernels, dx, dy);
+
+    compare_buffers(buffers.difference, reference.difference, "difference", dx, dy);
+    compare_buffers(buffers.blur_difference, reference.blur_difference, "blur", dx, dy);
+    compare_buffers(buffers.weight_accum, reference.weight_accum, "weight", dx, dy);
+    compare_buffers(buffers.out, reference.out, "output", dx, dy);
+  }
+
+  reference.normalize(reference_kernels);
+  buffers.normalize(kernels);
+  compare_buffers(buffers.out, reference.out, "normalized output", 0, 0);
+}
+
+}  // namespace
+
+/* The AVX kernels process eight pixels at a time where possible, they must give the same
+ * results as the four pixel loops of the regular kernel. */
+
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX
+TEST(kernel_filter_nlm, avx)
+{
+  if (!system_cpu_support_avx()) {
+    return;
+  }
+
+  const FilterNLMKernels kernels = FILTER_NLM_KERNELS(cpu_avx);
+  compare_filter_nlm(kernels, false);
+  compare_filter_nlm(kernels, true);
+}
+#endif
+
+#ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
+TEST(kernel_filter_nlm, avx2)
+{
+  if (!system_cpu_support_avx2()) {
+    return;
+  }
+
+  const FilterNLMKernels kernels = FILTER_NLM_KERNELS(cpu_avx2);
+  compare_filter_nlm(kernels, false);
+  compare_filter_nlm(kernels, true);
+}
+#endif
+
+CCL_NAMESPACE_END
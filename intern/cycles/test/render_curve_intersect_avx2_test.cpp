@@ -0,0 +1,47 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Same as render_curve_intersect_test.cpp, compiled with the flags and defines of the AVX2
+ * kernel. */
+#if defined(__x86_64__) || defined(_M_X64)
+#  define __KERNEL_SSE__
+#  define __KERNEL_SSE2__
+#  define __KERNEL_SSE3__
+#  define __KERNEL_SSSE3__
+#  define __KERNEL_SSE41__
+#  define __KERNEL_AVX__
+#  define __KERNEL_AVX2__
+#endif
+#define __KERNEL_CPU__
+
+#include "render_curve_intersect_test.h"
+
+#include "util/util_system.h"
+
+CCL_NAMESPACE_BEGIN
+
+#ifdef __KERNEL_AVX2__
+TEST(render_curve_intersect_avx2, ribbon_sse)
+{
+  if (!system_cpu_support_avx2()) {
+    return;
+  }
+
+  check_ribbon_sse();
+}
+#endif
+
+CCL_NAMESPACE_END
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render_curve_intersect_test.h"
+
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+#ifdef __KERNEL_SSE2__
+
+TEST(render_curve_intersect, ribbon_sse_performance)
+{
+  vector<float4> curves;
+  create_curves(curves);
+
+  const int num_repeats = 50;
+
+  for (const int N : subdivisions) {
+    for (int use_sse = 0; use_sse < 2; use_sse++) {
+      int num_hits = 0;
+
+      const double time_start = time_dt();
+      for (int r = 0; r < num_repeats; r++) {
+        for (int i = 0; i < num_curves; i++) {
+          Intersection isect;
+          num_hits += intersect(&curves[i * 4], N, use_sse, &isect);
+        }
+      }
+      const double time = time_dt() - time_start;
+
+      printf("Intersect %d ribbons, %d subdivisions, %s: %.3f ms, %d hits\n",
+             num_curves * num_repeats,
+             N,
+             (use_sse) ? "SSE" : "scalar",
+             time * 1000.0,
+             num_hits);
+    }
+  }
+}
+
+#endif
+
+CCL_NAMESPACE_END
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RENDER_CURVE_INTERSECT_TEST_H__
+#define __RENDER_CURVE_INTERSECT_TEST_H__
+
+#include "testing/testing.h"
+
+// clang-format off
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/kernels/cpu/kernel_cpu_image.h"
+#include "kernel/kernel_random.h"
+#include "kernel/kernel_projection.h"
+#include "kernel/geom/geom.h"
+// clang-format on
+
+#include "util/util_hash.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+#ifdef __KERNEL_SSE2__
+
+namespace {
+
+const int num_curves = 20000;
+const int subdivisions[] = {1, 2, 4, 8, 16};
+
+/* Hair like curves in ray space, where the ray starts at the origin along the z axis. */
+inline void create_curves(vector<float4> &curves)
+{
+  curves.resize(num_curves * 4);
+
+  for (int i = 0; i < num_curves; i++) {
+    for (int k = 0; k < 4; k++) {
+      curves[i * 4 + k] = make_float4(2.0f * hash_uint3_to_float(i, k, 0) - 1.0f,
+                                      2.0f * hash_uint3_to_float(i, k, 1) - 1.0f,
+                                      1.0f + 4.0f * hash_uint3_to_float(i, k, 2),
+                                      0.01f + 0.1f * hash_uint3_to_float(i, k, 3));
+    }
+  }
+}
+
+inline bool intersect(const float4 *curve, const int N, const bool use_sse, Intersection *isect)
+{
+  const float eps = 4.0f * FLT_EPSILON * 5.0f;
+
+  *isect = Intersection();
+  isect->t = FLT_MAX;
+
+  return (use_sse) ? ribbon_intersect_segments_sse(curve, N, eps, isect) :
+                     ribbon_intersect_segments(curve, N, eps, isect);
+}
+
+/* The vectorized intersection must find the same hits as the scalar one. */
+inline void check_ribbon_sse()
+{
+  vector<float4> curves;
+  create_curves(curves);
+
+  for (const int N : subdivisions) {
+    int num_hits = 0;
+    int num_mismatches = 0;
+
+    for (int i = 0; i < num_curves; i++) {
+      Intersection isect, isect_sse;
+      const bool hit = intersect(&curves[i * 4], N, false, &isect);
+      const bool hit_sse = intersect(&curves[i * 4], N, true, &isect_sse);
+
+      /* Rays grazing a segment edge may go either way due to rounding. */
+      if (hit != hit_sse) {
+        num_mismatches++;
+        continue;
+      }
+
+      if (hit) {
+        EXPECT_NEAR(isect.t, isect_sse.t, 1e-4f);
+        EXPECT_NEAR(isect.u, isect_sse.u, 1e-4f);
+        EXPECT_NEAR(isect.v, isect_sse.v, 1e-3f);
+        num_hits++;
+      }
+    }
+
+    EXPECT_GT(num_hits, num_curves / 100);
+    EXPECT_LE(num_mismatches, num_curves / 1000);
+  }
+}
+
+}  // namespace
+
+#endif
+
+CCL_NAMESPACE_END
+
+#endif /* __RENDER_CURVE_INTERSECT_TEST_H__ */
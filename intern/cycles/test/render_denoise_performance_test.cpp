@@ -0,0 +1,120 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+#include "render/denoising.h"
+
+#include "util/util_math.h"
+#include "util/util_time.h"
+
+#include <OpenImageIO/filesystem.h>
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int width = 960;
+const int height = 540;
+const int num_frames = 8;
+
+/* Passes read by the denoiser, with the value of all their channels. */
+struct DenoisePassValue {
+  const char *name;
+  const char *channels;
+  float value;
+};
+
+const DenoisePassValue denoise_passes[] = {
+    {"Combined", "RGB", 0.0f},
+    {"Denoising Depth", "Z", 5.0f},
+    {"Denoising Normal", "XYZ", 0.57735f},
+    {"Denoising Shadowing", "X", 1.0f},
+    {"Denoising Albedo", "RGB", 0.8f},
+    {"Noisy Image", "RGB", 0.5f},
+    {"Denoising Variance", "RGB", 0.01f},
+    {"Denoising Intensity", "X", 0.5f},
+};
+
+/* Write a frame with the passes of the denoiser, with some noise on the image. */
+bool write_frame(const string &filepath, const int frame)
+{
+  ImageSpec spec(width, height, 0, TypeDesc::FLOAT);
+  vector<float> values;
+  vector<bool> noisy;
+  for (const DenoisePassValue &pass : denoise_passes) {
+    for (const char *channel = pass.channels; *channel; channel++) {
+      spec.channelnames.push_back(string_printf("View Layer.%s.%c", pass.name, *channel));
+      values.push_back(pass.value);
+      noisy.push_back(string(pass.name) == "Noisy Image");
+    }
+  }
+  spec.nchannels = spec.channelnames.size();
+
+  vector<float> pixels((size_t)width * height * spec.nchannels);
+  for (size_t i = 0; i < pixels.size(); i++) {
+    const int c = i % spec.nchannels;
+    pixels[i] = values[c];
+    if (noisy[c]) {
+      pixels[i] += 0.2f * sinf((float)(i + frame) * 12.9898f);
+    }
+  }
+
+  unique_ptr<ImageOutput> out(ImageOutput::create(filepath));
+  return out && out->open(filepath, spec) && out->write_image(TypeDesc::FLOAT, &pixels[0]) &&
+         out->close();
+}
+
+}  // namespace
+
+TEST(render_denoise, animation_performance)
+{
+  vector<DeviceInfo> devices = Device::available_devices(DEVICE_MASK_CPU);
+  ASSERT_FALSE(devices.empty());
+
+  Denoiser denoiser(devices[0]);
+  denoiser.params.neighbor_frames = 2;
+  denoiser.samples_override = 16;
+
+  const string dirpath = OIIO::Filesystem::temp_directory_path() + "/cycles_denoise_" +
+                         OIIO::Filesystem::unique_path();
+  ASSERT_TRUE(OIIO::Filesystem::create_directory(dirpath));
+
+  for (int frame = 0; frame < num_frames; frame++) {
+    const string input = string_printf("%s/input_%d.exr", dirpath.c_str(), frame);
+    ASSERT_TRUE(write_frame(input, frame));
+    denoiser.input.push_back(input);
+    denoiser.output.push_back(string_printf("%s/output_%d.exr", dirpath.c_str(), frame));
+  }
+
+  const double time_start = time_dt();
+  const bool ok = denoiser.run();
+  const double time = time_dt() - time_start;
+
+  OIIO::Filesystem::remove_all(dirpath);
+  ASSERT_TRUE(ok) << denoiser.error;
+
+  printf("Denoiser, %d frames of %dx%d: %.2f seconds, %.2f frames/s, %.2f Mpixels/s\n",
+         num_frames,
+         width,
+         height,
+         time,
+         num_frames / time,
+         (double)num_frames * width * height / time * 1e-6);
+}
+
+CCL_NAMESPACE_END
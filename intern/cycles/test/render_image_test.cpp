@@ -0,0 +1,165 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+#include "render/colorspace.h"
+#include "render/image.h"
+#include "render/scene.h"
+
+#include "util/util_foreach.h"
+#include "util/util_image.h"
+#include "util/util_path.h"
+#include "util/util_progress.h"
+#include "util/util_stats.h"
+#include "util/util_texture_cache.h"
+#include "util/util_unique_ptr.h"
+
+#include <OpenImageIO/filesystem.h>
+
+CCL_NAMESPACE_BEGIN
+
+class RenderImage : public testing::Test {
+ protected:
+  Stats stats;
+  Profiler profiler;
+  DeviceInfo device_info;
+  Device *device_cpu;
+  SceneParams scene_params;
+  Scene *scene;
+  Progress progress;
+  vector<string> filepaths;
+
+  virtual void SetUp()
+  {
+    device_cpu = Device::create(device_info, stats, profiler, true);
+    scene_params.texture_cache_size = 16;
+    scene = new Scene(scene_params, device_cpu);
+  }
+
+  virtual void TearDown()
+  {
+    delete scene;
+    delete device_cpu;
+
+    foreach (const string &filepath, filepaths) {
+      path_remove(filepath);
+    }
+  }
+
+  /* 8x8 PNG filled with a single color. */
+  string write_image(const int channels)
+  {
+    const string filepath = OIIO::Filesystem::temp_directory_path() + "/cycles_image_" +
+                            OIIO::Filesystem::unique_path() + ".png";
+    filepaths.push_back(filepath);
+
+    const int size = 8;
+    const uchar color[4] = {255, 0, 0, 255};
+    vector<uchar> pixels(size * size * channels);
+    for (size_t i = 0; i < pixels.size(); i++) {
+      pixels[i] = color[i % channels];
+    }
+
+    unique_ptr<ImageOutput> out = unique_ptr<ImageOutput>(ImageOutput::create(filepath));
+    ImageSpec spec(size, size, channels, TypeDesc::UINT8);
+    EXPECT_TRUE(out && out->open(filepath, spec));
+    if (out) {
+      out->write_image(TypeDesc::UINT8, &pixels[0]);
+      out->close();
+    }
+
+    return filepath;
+  }
+
+  /* Load the image and return its texture, with the cache handle in its info. */
+  device_texture *load_image(ImageHandle &handle,
+                             const int channels,
+                             const ImageParams &params = ImageParams())
+  {
+    handle = scene->image_manager->add_image(write_image(channels), params);
+    scene->image_manager->device_update(device_cpu, scene, progress);
+    return handle.image_memory();
+  }
+};
+
+TEST_F(RenderImage, texture_cache_rgb)
+{
+  ImageHandle handle;
+  device_texture *mem = load_image(handle, 3);
+  ASSERT_TRUE(mem != NULL);
+
+  /* Pixels are not loaded up front, only the placeholder. */
+  EXPECT_NE(mem->info.cache_handle, 0);
+  EXPECT_EQ(mem->data_width, 1);
+  EXPECT_EQ(mem->data_height, 1);
+
+  const float4 color = TextureCache::lookup(
+      mem->info, 0.5f, 0.5f, make_float2(0.0f, 0.0f), make_float2(0.0f, 0.0f));
+  EXPECT_NEAR(color.x, 1.0f, 1e-6f);
+  EXPECT_NEAR(color.y, 0.0f, 1e-6f);
+  EXPECT_NEAR(color.z, 0.0f, 1e-6f);
+  EXPECT_NEAR(color.w, 1.0f, 1e-6f);
+}
+
+TEST_F(RenderImage, texture_cache_rgba)
+{
+  /* Alpha associated by OIIO, as when loading the full image. */
+  ImageParams params;
+  params.colorspace = u_colorspace_srgb;
+  ImageHandle handle;
+  device_texture *mem = load_image(handle, 4, params);
+  ASSERT_TRUE(mem != NULL);
+  EXPECT_NE(mem->info.cache_handle, 0);
+}
+
+TEST_F(RenderImage, texture_cache_unsupported)
+{
+  /* Channel packed alpha is kept unassociated, which the cache does not do. */
+  ImageParams params;
+  params.colorspace = u_colorspace_srgb;
+  params.alpha_type = IMAGE_ALPHA_CHANNEL_PACKED;
+  ImageHandle handle_packed;
+  device_texture *mem_packed = load_image(handle_packed, 4, params);
+  ASSERT_TRUE(mem_packed != NULL);
+  EXPECT_EQ(mem_packed->info.cache_handle, 0);
+  EXPECT_EQ(mem_packed->data_width, 8);
+
+  /* Two channel images are expanded on load. */
+  ImageHandle handle_gray;
+  device_texture *mem_gray = load_image(handle_gray, 2);
+  ASSERT_TRUE(mem_gray != NULL);
+  EXPECT_EQ(mem_gray->info.cache_handle, 0);
+  EXPECT_EQ(mem_gray->data_width, 8);
+}
+
+TEST_F(RenderImage, texture_cache_disabled)
+{
+  delete scene;
+  scene_params.texture_cache_size = 0;
+  scene = new Scene(scene_params, device_cpu);
+
+  ImageHandle handle;
+  device_texture *mem = load_image(handle, 3);
+  ASSERT_TRUE(mem != NULL);
+  EXPECT_EQ(mem->info.cache_handle, 0);
+  EXPECT_EQ(mem->data_width, 8);
+  EXPECT_EQ(mem->data_height, 8);
+}
+
+CCL_NAMESPACE_END
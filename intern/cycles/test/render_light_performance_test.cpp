@@ -0,0 +1,39 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render_light_test.h"
+
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+TEST_F(RenderLight, triangle_distribution_performance)
+{
+  const int res = 1000;
+  for (int i = 0; i < 4; i++) {
+    add_emissive_grid(res, transform_translate(0.0f, 0.0f, (float)i));
+  }
+
+  double time_start = time_dt();
+  scene->light_manager->device_update(device_cpu, &scene->dscene, scene, progress);
+  const double time = time_dt() - time_start;
+
+  printf("LightManager::device_update, %d emissive triangles: %.3f ms\n",
+         scene->dscene.data.integrator.num_distribution,
+         time * 1000.0);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render_light_test.h"
+
+CCL_NAMESPACE_BEGIN
+
+TEST_F(RenderLight, triangle_distribution)
+{
+  const int res = 200;
+  add_emissive_grid(res, transform_scale(2.0f, 2.0f, 2.0f));
+
+  scene->light_manager->device_update(device_cpu, &scene->dscene, scene, progress);
+
+  /* Every second quad is emissive, all triangles have the same area. */
+  const size_t num_triangles = res * res;
+  const KernelIntegrator *kintegrator = &scene->dscene.data.integrator;
+  ASSERT_EQ(kintegrator->num_distribution, num_triangles);
+  EXPECT_NEAR(kintegrator->pdf_triangles, 1.0f / (num_triangles * 2.0f), 1e-9f);
+
+  const KernelLightDistribution *distribution = scene->dscene.light_distribution.data();
+  ASSERT_EQ(scene->dscene.light_distribution.size(), num_triangles + 1);
+
+  int prev_prim = -1;
+  for (size_t i = 0; i < num_triangles; i++) {
+    EXPECT_NEAR(distribution[i].totarea, (float)i / num_triangles, 1e-5f);
+    EXPECT_GT(distribution[i].prim, prev_prim);
+    EXPECT_EQ(distribution[i].mesh_light.object_id, 0);
+    prev_prim = distribution[i].prim;
+  }
+  EXPECT_EQ(distribution[num_triangles].totarea, 1.0f);
+}
+
+TEST_F(RenderLight, light_tree)
+{
+  scene->default_light->has_surface_emission = true;
+  scene->integrator->use_light_tree = true;
+
+  const int num_lights = 100;
+  float total_energy = 0.0f;
+  for (int i = 0; i < num_lights; i++) {
+    Light *light = scene->create_node<Light>();
+    light->type = (i % 2) ? LIGHT_POINT : LIGHT_AREA;
+    light->co = make_float3((float)(i % 10), (float)(i / 10), 1.0f);
+    light->strength = make_float3(1.0f, 1.0f, 1.0f) * (float)(i + 1);
+    light->size = 0.1f;
+    total_energy += (float)(i + 1);
+  }
+  /* Distant lights stay in the regular distribution. */
+  Light *sun = scene->create_node<Light>();
+  sun->type = LIGHT_DISTANT;
+
+  scene->light_manager->device_update(device_cpu, &scene->dscene, scene, progress);
+
+  const KernelIntegrator *kintegrator = &scene->dscene.data.integrator;
+  EXPECT_TRUE(kintegrator->use_light_tree);
+  EXPECT_EQ(kintegrator->num_all_lights, num_lights + 1);
+  EXPECT_EQ(kintegrator->num_distribution, 2);
+  EXPECT_NEAR(kintegrator->pdf_light_tree, (float)num_lights / (num_lights + 1), 1e-6f);
+
+  /* Binary tree with a leaf for every light. */
+  const KernelLightTreeNode *nodes = scene->dscene.light_tree_nodes.data();
+  ASSERT_EQ(scene->dscene.light_tree_nodes.size(), num_lights * 2 - 1);
+  EXPECT_EQ(nodes[0].parent, -1);
+  EXPECT_NEAR(nodes[0].energy, total_energy, 1e-3f);
+
+  const KernelLight *klights = scene->dscene.lights.data();
+  for (int lamp = 0; lamp < num_lights; lamp++) {
+    const int index = klights[lamp].tree_node;
+    ASSERT_GT(index, 0);
+    EXPECT_EQ(nodes[index].child, ~lamp);
+    EXPECT_NEAR(nodes[index].energy, (float)(lamp + 1), 1e-6f);
+
+    /* Leaf is reachable from the root through its parents. */
+    const int parent = nodes[index].parent;
+    EXPECT_TRUE(parent + 1 == index || nodes[parent].child == index);
+  }
+  EXPECT_EQ(klights[num_lights].tree_node, -1);
+
+  for (int index = 0; index < num_lights * 2 - 1; index++) {
+    if (nodes[index].child >= 0) {
+      const KernelLightTreeNode &left = nodes[index + 1];
+      const KernelLightTreeNode &right = nodes[nodes[index].child];
+      EXPECT_EQ(left.parent, index);
+      EXPECT_EQ(right.parent, index);
+      EXPECT_NEAR(nodes[index].energy, left.energy + right.energy, 1e-3f);
+    }
+  }
+}
+
+TEST_F(RenderLight, light_tree_negative_strength)
+{
+  scene->default_light->has_surface_emission = true;
+  scene->integrator->use_light_tree = true;
+
+  const float3 strengths[] = {make_float3(-2.0f, -2.0f, -2.0f),
+                              make_float3(3.0f, -3.0f, 3.0f),
+                              make_float3(1.0f, 1.0f, 1.0f)};
+  for (int i = 0; i < 3; i++) {
+    Light *light = scene->create_node<Light>();
+    light->type = LIGHT_POINT;
+    light->co = make_float3((float)i, 0.0f, 1.0f);
+    light->strength = strengths[i];
+    light->size = 0.1f;
+  }
+
+  scene->light_manager->device_update(device_cpu, &scene->dscene, scene, progress);
+
+  /* Lights are sampled by the magnitude of their strength. */
+  const KernelLightTreeNode *nodes = scene->dscene.light_tree_nodes.data();
+  const KernelLight *klights = scene->dscene.lights.data();
+  ASSERT_EQ(scene->dscene.light_tree_nodes.size(), 5);
+  EXPECT_NEAR(nodes[klights[0].tree_node].energy, 2.0f, 1e-6f);
+  EXPECT_NEAR(nodes[klights[1].tree_node].energy, 3.0f, 1e-6f);
+  EXPECT_NEAR(nodes[klights[2].tree_node].energy, 1.0f, 1e-6f);
+  EXPECT_NEAR(nodes[0].energy, 6.0f, 1e-5f);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RENDER_LIGHT_TEST_H__
+#define __RENDER_LIGHT_TEST_H__
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+#include "render/integrator.h"
+#include "render/light.h"
+#include "render/mesh.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+
+#include "util/util_progress.h"
+#include "util/util_stats.h"
+
+CCL_NAMESPACE_BEGIN
+
+class RenderLight : public testing::Test {
+ protected:
+  Stats stats;
+  Profiler profiler;
+  DeviceInfo device_info;
+  Device *device_cpu;
+  SceneParams scene_params;
+  Scene *scene;
+  Progress progress;
+  Shader *emission_shader;
+  Shader *diffuse_shader;
+
+  virtual void SetUp()
+  {
+    device_cpu = Device::create(device_info, stats, profiler, true);
+    scene = new Scene(scene_params, device_cpu);
+
+    /* Set shader flags directly instead of compiling graphs. */
+    emission_shader = new Shader();
+    emission_shader->use_mis = true;
+    emission_shader->has_surface_emission = true;
+    scene->shaders.push_back(emission_shader);
+
+    diffuse_shader = new Shader();
+    diffuse_shader->use_mis = false;
+    diffuse_shader->has_surface_emission = false;
+    scene->shaders.push_back(diffuse_shader);
+  }
+
+  virtual void TearDown()
+  {
+    delete scene;
+    delete device_cpu;
+  }
+
+  /* Grid of `res * res` quads split into triangles, with every second quad emissive. */
+  void add_emissive_grid(const int res, const Transform &tfm)
+  {
+    Mesh *mesh = new Mesh();
+    mesh->used_shaders.push_back(emission_shader);
+    mesh->used_shaders.push_back(diffuse_shader);
+    mesh->reserve_mesh((res + 1) * (res + 1), res * res * 2);
+
+    for (int y = 0; y <= res; y++) {
+      for (int x = 0; x <= res; x++) {
+        mesh->add_vertex(make_float3((float)x, (float)y, 0.0f));
+      }
+    }
+
+    for (int y = 0; y < res; y++) {
+      for (int x = 0; x < res; x++) {
+        const int v0 = y * (res + 1) + x;
+        const int v1 = v0 + 1;
+        const int v2 = v0 + res + 2;
+        const int v3 = v0 + res + 1;
+        const int shader = ((x + y) % 2) ? 0 : 1;
+        mesh->add_triangle(v0, v1, v2, shader, false);
+        mesh->add_triangle(v0, v2, v3, shader, false);
+      }
+    }
+    mesh->compute_bounds();
+    scene->geometry.push_back(mesh);
+
+    Object *object = new Object();
+    object->geometry = mesh;
+    object->tfm = tfm;
+    object->compute_bounds(false);
+    scene->objects.push_back(object);
+  }
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __RENDER_LIGHT_TEST_H__ */
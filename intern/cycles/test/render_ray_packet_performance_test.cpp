@@ -0,0 +1,55 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render_ray_packet_test.h"
+
+#include "util/util_time.h"
+
+CCL_NAMESPACE_BEGIN
+
+TEST_F(RenderRayPacket, intersect_performance)
+{
+  /* Instances of a dense mesh, rotated so the BVH is not trivially aligned. */
+  Mesh *mesh = add_grid_mesh(500);
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 8; x++) {
+      add_object(mesh,
+                 transform_translate((float)x, (float)y, 0.0f) *
+                     transform_rotate(0.1f * (x + y), make_float3(0.0f, 0.0f, 1.0f)));
+    }
+  }
+  sync_kernel_globals();
+
+  vector<Ray> rays;
+  create_rays(1920, 1080, 8.0f, rays);
+
+  const int packet_sizes[] = {1, BVH_PACKET_SIZE};
+  for (const int packet_size : packet_sizes) {
+    vector<Intersection> isects;
+
+    const double time_start = time_dt();
+    intersect_rays(rays, packet_size, isects);
+    const double time = time_dt() - time_start;
+
+    printf("Intersect %d camera rays, packet size %d: %.3f ms, %.2f Mrays/s\n",
+           (int)rays.size(),
+           packet_size,
+           time * 1000.0,
+           rays.size() / time * 1e-6);
+  }
+}
+
+CCL_NAMESPACE_END
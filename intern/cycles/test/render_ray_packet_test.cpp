@@ -0,0 +1,58 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render_ray_packet_test.h"
+
+CCL_NAMESPACE_BEGIN
+
+TEST_F(RenderRayPacket, intersect)
+{
+  Mesh *mesh = add_grid_mesh(50);
+  for (int i = 0; i < 4; i++) {
+    add_object(mesh, transform_translate((float)(i % 2), (float)(i / 2), 0.0f));
+  }
+  sync_kernel_globals();
+
+  /* Odd width so the last packet of every row is partially filled. */
+  vector<Ray> rays;
+  create_rays(101, 100, 2.0f, rays);
+
+  vector<Intersection> isects_single, isects_packet;
+  intersect_rays(rays, 1, isects_single);
+  intersect_rays(rays, BVH_PACKET_SIZE, isects_packet);
+
+  int num_hits = 0;
+  for (size_t i = 0; i < rays.size(); i++) {
+    EXPECT_EQ(isects_packet[i].prim, isects_single[i].prim);
+    EXPECT_EQ(isects_packet[i].object, isects_single[i].object);
+    if (isects_single[i].prim != PRIM_NONE) {
+      EXPECT_EQ(isects_packet[i].t, isects_single[i].t);
+      EXPECT_EQ(isects_packet[i].u, isects_single[i].u);
+      EXPECT_EQ(isects_packet[i].v, isects_single[i].v);
+#ifdef __KERNEL_DEBUG__
+      /* Debug counters are tracked per ray in packets too. */
+      EXPECT_GT(isects_packet[i].num_traversed_nodes, 0);
+      EXPECT_GT(isects_packet[i].num_traversed_instances, 0);
+      EXPECT_GT(isects_packet[i].num_intersections, 0);
+#endif
+      num_hits++;
+    }
+  }
+  EXPECT_GT(num_hits, 0);
+  EXPECT_LT(num_hits, (int)rays.size());
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RENDER_RAY_PACKET_TEST_H__
+#define __RENDER_RAY_PACKET_TEST_H__
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+// clang-format off
+#include "kernel/kernel.h"
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+// clang-format on
+
+#include "render/mesh.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+
+#include "util/util_progress.h"
+#include "util/util_stats.h"
+#include "util/util_task.h"
+
+CCL_NAMESPACE_BEGIN
+
+class RenderRayPacket : public testing::Test {
+ protected:
+  Stats stats;
+  Profiler profiler;
+  DeviceInfo device_info;
+  Device *device_cpu;
+  SceneParams scene_params;
+  Scene *scene;
+  Progress progress;
+  KernelGlobals kg;
+
+  virtual void SetUp()
+  {
+    TaskScheduler::init(0);
+
+    device_cpu = Device::create(device_info, stats, profiler, true);
+    scene_params.bvh_layout = BVH_LAYOUT_BVH2;
+    scene = new Scene(scene_params, device_cpu);
+    kg = KernelGlobals();
+  }
+
+  virtual void TearDown()
+  {
+    delete scene;
+    delete device_cpu;
+
+    TaskScheduler::exit();
+  }
+
+  /* Grid of `res * res` quads split into triangles, as a height field. */
+  Mesh *add_grid_mesh(const int res)
+  {
+    Mesh *mesh = new Mesh();
+    mesh->used_shaders.push_back(scene->default_surface);
+    mesh->reserve_mesh((res + 1) * (res + 1), res * res * 2);
+
+    for (int y = 0; y <= res; y++) {
+      for (int x = 0; x <= res; x++) {
+        const float height = 0.5f * sinf(x * 0.3f) * cosf(y * 0.2f);
+        mesh->add_vertex(make_float3((float)x / res, (float)y / res, height));
+      }
+    }
+
+    for (int y = 0; y < res; y++) {
+      for (int x = 0; x < res; x++) {
+        const int v0 = y * (res + 1) + x;
+        mesh->add_triangle(v0, v0 + 1, v0 + res + 2, 0, false);
+        mesh->add_triangle(v0, v0 + res + 2, v0 + res + 1, 0, false);
+      }
+    }
+    scene->geometry.push_back(mesh);
+    return mesh;
+  }
+
+  void add_object(Mesh *mesh, const Transform &tfm)
+  {
+    Object *object = new Object();
+    object->geometry = mesh;
+    object->tfm = tfm;
+    scene->objects.push_back(object);
+  }
+
+  /* Point the kernel globals to the scene data needed for ray intersection. */
+  void sync_kernel_globals()
+  {
+    scene->device_update(device_cpu, progress);
+
+    DeviceScene &dscene = scene->dscene;
+    device_memory *mems[] = {&dscene.bvh_nodes,
+                             &dscene.bvh_leaf_nodes,
+                             &dscene.object_node,
+                             &dscene.prim_tri_index,
+                             &dscene.prim_tri_verts,
+                             &dscene.prim_type,
+                             &dscene.prim_visibility,
+                             &dscene.prim_index,
+                             &dscene.prim_object,
+                             &dscene.tri_vindex,
+                             &dscene.objects,
+                             &dscene.object_flag};
+
+    for (device_memory *mem : mems) {
+      kernel_global_memory_copy(&kg, mem->name, mem->host_pointer, mem->data_size);
+    }
+    kernel_const_copy(&kg, "__data", &dscene.data, sizeof(dscene.data));
+  }
+
+  /* Coherent rays looking down on the scene from a grid of origins, with a
+   * slight perspective like camera rays. */
+  void create_rays(const int width, const int height, const float size, vector<Ray> &rays)
+  {
+    rays.resize(width * height);
+
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        const float u = (x + 0.5f) / width - 0.5f;
+        const float v = (y + 0.5f) / height - 0.5f;
+
+        Ray &ray = rays[y * width + x];
+        ray.P = make_float3(size * 0.5f, size * 0.5f, 10.0f);
+        ray.D = normalize(make_float3(u * size * 0.15f, v * size * 0.15f, -1.0f));
+        ray.t = FLT_MAX;
+        ray.time = 0.5f;
+      }
+    }
+  }
+
+  void intersect_rays(const vector<Ray> &rays,
+                      const int packet_size,
+                      vector<Intersection> &isects)
+  {
+    const int num_rays = rays.size();
+    isects.resize(num_rays);
+
+    for (int i = 0; i < num_rays; i += packet_size) {
+      kernel_cpu_intersect_packet(
+          &kg, &rays[i], PATH_RAY_CAMERA, &isects[i], min(packet_size, num_rays - i));
+    }
+  }
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __RENDER_RAY_PACKET_TEST_H__ */
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+// clang-format off
+#include "kernel/kernel.h"
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+// clang-format on
+
+#include "render/mesh.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+
+#include "util/util_progress.h"
+#include "util/util_set.h"
+#include "util/util_stats.h"
+#include "util/util_task.h"
+
+CCL_NAMESPACE_BEGIN
+
+class RenderSceneBVH : public testing::Test {
+ protected:
+  Stats stats;
+  Profiler profiler;
+  DeviceInfo device_info;
+  Device *device_cpu;
+  SceneParams scene_params;
+  Scene *scene;
+  Progress progress;
+  KernelGlobals kg;
+  /* Sub-status messages reported while updating the scene BVH. */
+  set<string> bvh_substatus;
+
+  virtual void SetUp()
+  {
+    TaskScheduler::init(0);
+
+    device_cpu = Device::create(device_info, stats, profiler, true);
+    scene_params.bvh_layout = BVH_LAYOUT_BVH2;
+    /* The scene BVH is only kept for refitting in interactive renders. */
+    scene_params.background = false;
+    scene = new Scene(scene_params, device_cpu);
+    kg = KernelGlobals();
+
+    progress.set_update_callback([&]() {
+      string status, substatus;
+      progress.get_status(status, substatus);
+      if (status == "Updating Scene BVH") {
+        bvh_substatus.insert(substatus);
+      }
+    });
+  }
+
+  virtual void TearDown()
+  {
+    delete scene;
+    delete device_cpu;
+
+    TaskScheduler::exit();
+  }
+
+  Object *add_quad_object(const Transform &tfm)
+  {
+    Mesh *mesh = scene->create_node<Mesh>();
+    mesh->used_shaders.push_back(scene->default_surface);
+    mesh->reserve_mesh(4, 2);
+    mesh->add_vertex(make_float3(0.0f, 0.0f, 0.0f));
+    mesh->add_vertex(make_float3(1.0f, 0.0f, 0.0f));
+    mesh->add_vertex(make_float3(1.0f, 1.0f, 0.0f));
+    mesh->add_vertex(make_float3(0.0f, 1.0f, 0.0f));
+    mesh->add_triangle(0, 1, 2, 0, false);
+    mesh->add_triangle(0, 2, 3, 0, false);
+
+    Object *object = scene->create_node<Object>();
+    object->geometry = mesh;
+    object->tfm = tfm;
+    return object;
+  }
+
+  void device_update()
+  {
+    bvh_substatus.clear();
+    scene->device_update(device_cpu, progress);
+  }
+
+  /* Intersect a grid of rays looking down on the scene. */
+  void intersect_rays(vector<Intersection> &isects)
+  {
+    DeviceScene &dscene = scene->dscene;
+    device_memory *mems[] = {&dscene.bvh_nodes,
+                             &dscene.bvh_leaf_nodes,
+                             &dscene.object_node,
+                             &dscene.prim_tri_index,
+                             &dscene.prim_tri_verts,
+                             &dscene.prim_type,
+                             &dscene.prim_visibility,
+                             &dscene.prim_index,
+                             &dscene.prim_object,
+                             &dscene.tri_vindex,
+                             &dscene.objects,
+                             &dscene.object_flag};
+
+    for (device_memory *mem : mems) {
+      kernel_global_memory_copy(&kg, mem->name, mem->host_pointer, mem->data_size);
+    }
+    kernel_const_copy(&kg, "__data", &dscene.data, sizeof(dscene.data));
+
+    const int res = 64;
+    isects.resize(res * res);
+
+    for (int y = 0; y < res; y++) {
+      for (int x = 0; x < res; x++) {
+        Ray ray;
+        const float u = (x + 0.5f) / res;
+        const float v = (y + 0.5f) / res;
+        ray.P = make_float3(-0.5f + 4.0f * u, -0.5f + 2.0f * v, 10.0f);
+        ray.D = make_float3(0.0f, 0.0f, -1.0f);
+        ray.t = FLT_MAX;
+        ray.time = 0.5f;
+
+        kernel_cpu_intersect_packet(&kg, &ray, PATH_RAY_CAMERA, &isects[y * res + x], 1);
+      }
+    }
+  }
+
+  /* Check that the current scene BVH finds the same hits as building it from scratch. */
+  void check_bvh_matches_build()
+  {
+    vector<Intersection> isects;
+    intersect_rays(isects);
+
+    scene->geometry_manager->free_scene_bvh();
+    scene->geometry_manager->tag_update(scene);
+    device_update();
+    EXPECT_TRUE(bvh_built());
+
+    vector<Intersection> isects_build;
+    intersect_rays(isects_build);
+
+    int num_hits = 0;
+    for (size_t i = 0; i < isects.size(); i++) {
+      EXPECT_EQ(isects[i].prim, isects_build[i].prim);
+      EXPECT_EQ(isects[i].object, isects_build[i].object);
+      if (isects_build[i].prim != PRIM_NONE) {
+        EXPECT_NEAR(isects[i].t, isects_build[i].t, 1e-5f);
+        num_hits++;
+      }
+    }
+    EXPECT_GT(num_hits, 0);
+  }
+
+  bool bvh_refitted()
+  {
+    return bvh_substatus.count("Refitting") && !bvh_substatus.count("Building");
+  }
+
+  bool bvh_built()
+  {
+    return bvh_substatus.count("Building") && !bvh_substatus.count("Refitting");
+  }
+};
+
+TEST_F(RenderSceneBVH, refit_and_rebuild)
+{
+  Object *object_a = add_quad_object(transform_identity());
+  Object *object_b = add_quad_object(transform_translate(make_float3(2.0f, 0.0f, 0.0f)));
+
+  device_update();
+  EXPECT_TRUE(bvh_built());
+
+  /* Moving an object keeps the structure of the tree. */
+  object_a->tfm = transform_translate(make_float3(0.5f, 0.0f, 1.0f));
+  object_a->tag_update(scene);
+  device_update();
+  EXPECT_TRUE(bvh_refitted());
+  check_bvh_matches_build();
+
+  /* Deleting an object changes it. */
+  Mesh *mesh_b = static_cast<Mesh *>(object_b->geometry);
+  scene->delete_node(object_b);
+  scene->delete_node(mesh_b);
+  device_update();
+  EXPECT_TRUE(bvh_built());
+
+  /* And the rebuilt tree can be refitted again. */
+  object_a->tfm = transform_identity();
+  object_a->tag_update(scene);
+  device_update();
+  EXPECT_TRUE(bvh_refitted());
+  check_bvh_matches_build();
+}
+
+TEST_F(RenderSceneBVH, refit_deformed_mesh)
+{
+  Object *object_a = add_quad_object(transform_identity());
+  add_quad_object(transform_translate(make_float3(2.0f, 0.0f, 0.0f)));
+
+  device_update();
+  EXPECT_TRUE(bvh_built());
+
+  /* Moving vertices with the same topology refits. */
+  Mesh *mesh_a = static_cast<Mesh *>(object_a->geometry);
+  mesh_a->verts[2] = make_float3(1.5f, 1.0f, 2.0f);
+  mesh_a->verts[3] = make_float3(-0.5f, 1.0f, 0.5f);
+  mesh_a->tag_update(scene, false);
+  device_update();
+  EXPECT_TRUE(bvh_refitted());
+  check_bvh_matches_build();
+}
+
+CCL_NAMESPACE_END
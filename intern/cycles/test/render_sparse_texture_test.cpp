@@ -0,0 +1,233 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+// clang-format off
+#include "kernel/kernel_compat_cpu.h"
+#include "kernel/kernel_math.h"
+#include "kernel/kernel_types.h"
+#include "kernel/split/kernel_split_data.h"
+#include "kernel/kernel_globals.h"
+#include "kernel/kernels/cpu/kernel_cpu_image.h"
+// clang-format on
+
+#include "util/util_hash.h"
+#include "util/util_texture.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Grid size that is not a multiple of the tile size, so the last tiles along each axis
+ * are partially outside of the grid. */
+const int width = 20;
+const int height = 13;
+const int depth = 11;
+
+/* A few tiles with values, next to empty tiles. Tile (2, 1, 1) is partial along all axes. */
+bool tile_is_filled(const int tx, const int ty, const int tz)
+{
+  return (tx == 0 && ty == 0 && tz == 0) || (tx == 1 && ty == 0 && tz == 0) ||
+         (tx == 1 && ty == 1 && tz == 0) || (tx == 2 && ty == 1 && tz == 1);
+}
+
+float voxel_hash(const int x, const int y, const int z, const int channel)
+{
+  return hash_uint4_to_float(x, y, z, channel);
+}
+
+/* Voxel values, empty tiles read as zero with an alpha of one. */
+void voxel_value(const int x, const int y, const int z, const bool filled, float *value)
+{
+  *value = (filled) ? voxel_hash(x, y, z, 0) : 0.0f;
+}
+
+void voxel_value(const int x, const int y, const int z, const bool filled, float4 *value)
+{
+  *value = (filled) ? make_float4(voxel_hash(x, y, z, 0),
+                                  voxel_hash(x, y, z, 1),
+                                  voxel_hash(x, y, z, 2),
+                                  1.0f) :
+                      make_float4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+/* Large values for voxels outside of the grid, to detect reading them. */
+void voxel_outside(float *value)
+{
+  *value = 1e6f;
+}
+
+void voxel_outside(float4 *value)
+{
+  *value = make_float4(1e6f, 1e6f, 1e6f, 1e6f);
+}
+
+/* The same grid stored densely and sparsely. */
+template<typename T> class SparseGrid {
+ public:
+  SparseGrid()
+  {
+    const int tiles_x = tex_sparse_num_tiles(width);
+    const int tiles_y = tex_sparse_num_tiles(height);
+    const int tiles_z = tex_sparse_num_tiles(depth);
+
+    dense.resize(width * height * depth);
+    for (int z = 0; z < depth; z++) {
+      for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+          const bool filled = tile_is_filled(x / TEX_SPARSE_TILE_SIZE,
+                                             y / TEX_SPARSE_TILE_SIZE,
+                                             z / TEX_SPARSE_TILE_SIZE);
+          voxel_value(x, y, z, filled, &dense[x + (y + z * height) * width]);
+        }
+      }
+    }
+
+    vector<int> tiles;
+    int num_filled = 0;
+    for (int tz = 0; tz < tiles_z; tz++) {
+      for (int ty = 0; ty < tiles_y; ty++) {
+        for (int tx = 0; tx < tiles_x; tx++) {
+          tiles.push_back(tile_is_filled(tx, ty, tz) ? num_filled++ : TEX_SPARSE_EMPTY_TILE);
+        }
+      }
+    }
+
+    /* Storage as float4 for alignment of the voxels. */
+    const size_t voxels_offset = tex_sparse_voxels_offset(width, height, depth);
+    const size_t size = voxels_offset + sizeof(T) * num_filled * TEX_SPARSE_TILE_VOXELS;
+    sparse.resize((size + sizeof(float4) - 1) / sizeof(float4));
+    memcpy(sparse.data(), tiles.data(), sizeof(int) * tiles.size());
+
+    T *voxels = (T *)((char *)sparse.data() + voxels_offset);
+    for (int tile = 0; tile < tiles.size(); tile++) {
+      if (tiles[tile] == TEX_SPARSE_EMPTY_TILE) {
+        continue;
+      }
+
+      const int tx = tile % tiles_x;
+      const int ty = (tile / tiles_x) % tiles_y;
+      const int tz = tile / (tiles_x * tiles_y);
+      T *tile_voxels = voxels + (size_t)tiles[tile] * TEX_SPARSE_TILE_VOXELS;
+
+      for (int i = 0; i < TEX_SPARSE_TILE_VOXELS; i++) {
+        const int lx = i & TEX_SPARSE_TILE_MASK;
+        const int ly = (i >> TEX_SPARSE_TILE_SHIFT) & TEX_SPARSE_TILE_MASK;
+        const int lz = i >> (2 * TEX_SPARSE_TILE_SHIFT);
+        const int x = tx * TEX_SPARSE_TILE_SIZE + lx;
+        const int y = ty * TEX_SPARSE_TILE_SIZE + ly;
+        const int z = tz * TEX_SPARSE_TILE_SIZE + lz;
+
+        /* Voxels of partial tiles outside of the grid must never be read. */
+        if (x < width && y < height && z < depth) {
+          tile_voxels[i] = dense[x + (y + z * height) * width];
+        }
+        else {
+          voxel_outside(&tile_voxels[i]);
+        }
+      }
+    }
+  }
+
+  TextureInfo info(const void *data, const ExtensionType extension)
+  {
+    TextureInfo info = {0};
+    info.data = (uint64_t)data;
+    info.interpolation = INTERPOLATION_LINEAR;
+    info.extension = extension;
+    info.width = width;
+    info.height = height;
+    info.depth = depth;
+    return info;
+  }
+
+  void check(const float3 P, const ExtensionType extension, const InterpolationType interp)
+  {
+    const float4 expected = TextureInterpolator<T>::interp_3d(
+        info(dense.data(), extension), P.x, P.y, P.z, interp);
+    const float4 result = SparseTextureInterpolator<T>::interp_3d(
+        info(sparse.data(), extension), P.x, P.y, P.z, interp);
+
+    EXPECT_NEAR(result.x, expected.x, 1e-5f) << P.x << " " << P.y << " " << P.z;
+    EXPECT_NEAR(result.y, expected.y, 1e-5f) << P.x << " " << P.y << " " << P.z;
+    EXPECT_NEAR(result.z, expected.z, 1e-5f) << P.x << " " << P.y << " " << P.z;
+    EXPECT_NEAR(result.w, expected.w, 1e-5f) << P.x << " " << P.y << " " << P.z;
+  }
+
+  vector<T> dense;
+  vector<float4> sparse;
+};
+
+/* Coordinates around tile borders and the grid bounds, along one axis. */
+vector<float> border_coordinates(const int size)
+{
+  const float offsets[] = {-1.0f, -0.5f, -0.1f, 0.0f, 0.1f, 0.5f, 1.0f};
+  vector<float> coordinates;
+  for (int border = 0; border < size + TEX_SPARSE_TILE_SIZE; border += TEX_SPARSE_TILE_SIZE) {
+    for (const float offset : offsets) {
+      coordinates.push_back((min(border, size) + offset) / size);
+    }
+  }
+  return coordinates;
+}
+
+template<typename T> void check_sparse_texture()
+{
+  SparseGrid<T> grid;
+
+  const ExtensionType extensions[] = {EXTENSION_REPEAT, EXTENSION_EXTEND, EXTENSION_CLIP};
+  const InterpolationType interpolations[] = {
+      INTERPOLATION_CLOSEST, INTERPOLATION_LINEAR, INTERPOLATION_CUBIC};
+
+  const vector<float> xs = border_coordinates(width);
+  const vector<float> ys = border_coordinates(height);
+  const vector<float> zs = border_coordinates(depth);
+
+  for (const ExtensionType extension : extensions) {
+    for (const InterpolationType interp : interpolations) {
+      for (const float z : zs) {
+        for (const float y : ys) {
+          for (const float x : xs) {
+            grid.check(make_float3(x, y, z), extension, interp);
+          }
+        }
+      }
+
+      for (uint i = 0; i < 1000; i++) {
+        const float3 P = make_float3(hash_uint2_to_float(i, 0) * 1.2f - 0.1f,
+                                     hash_uint2_to_float(i, 1) * 1.2f - 0.1f,
+                                     hash_uint2_to_float(i, 2) * 1.2f - 0.1f);
+        grid.check(P, extension, interp);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(render_sparse_texture, float)
+{
+  check_sparse_texture<float>();
+}
+
+TEST(render_sparse_texture, float4)
+{
+  check_sparse_texture<float4>();
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/mock_log.h"
+#include "testing/testing.h"
+
+#include "device/device.h"
+
+#include "render/scene.h"
+#include "render/shader.h"
+
+#include "util/util_array.h"
+#include "util/util_logging.h"
+#include "util/util_progress.h"
+#include "util/util_stats.h"
+#include "util/util_string.h"
+
+using testing::_;
+using testing::AnyNumber;
+using testing::HasSubstr;
+using testing::ScopedMockLog;
+
+CCL_NAMESPACE_BEGIN
+
+class RenderSVM : public testing::Test {
+ protected:
+  ScopedMockLog log;
+  Stats stats;
+  Profiler profiler;
+  DeviceInfo device_info;
+  Device *device_cpu;
+  SceneParams scene_params;
+  Scene *scene;
+  Progress progress;
+
+  virtual void SetUp()
+  {
+    util_logging_start();
+    util_logging_verbosity_set(1);
+
+    device_cpu = Device::create(device_info, stats, profiler, true);
+    scene = new Scene(scene_params, device_cpu);
+  }
+
+  virtual void TearDown()
+  {
+    delete scene;
+    delete device_cpu;
+  }
+
+  void shader_update()
+  {
+    scene->shader_manager->device_update(device_cpu, &scene->dscene, scene, progress);
+  }
+
+  array<int4> svm_nodes()
+  {
+    device_vector<int4> &nodes = scene->dscene.svm_nodes;
+    array<int4> result;
+    result.resize(nodes.size());
+    memcpy(result.data(), nodes.data(), sizeof(int4) * nodes.size());
+    return result;
+  }
+};
+
+#define EXPECT_ANY_MESSAGE(log) EXPECT_CALL(log, Log(_, _, _)).Times(AnyNumber());
+
+#define CORRECT_INFO_MESSAGE(log, message) \
+  EXPECT_CALL(log, Log(google::INFO, _, HasSubstr(message)));
+
+/*
+ * Test that only shaders tagged for update are compiled again, and that the result matches
+ * compiling all shaders.
+ */
+TEST_F(RenderSVM, reuse_compiled_shaders)
+{
+  const int num_shaders = scene->shaders.size();
+
+  EXPECT_ANY_MESSAGE(log);
+  EXPECT_CALL(log, Log(google::INFO, _, HasSubstr(string_printf("compiled %d and reused 0.",
+                                                                num_shaders))))
+      .Times(2);
+  CORRECT_INFO_MESSAGE(log, string_printf("compiled 1 and reused %d.", num_shaders - 1));
+  CORRECT_INFO_MESSAGE(log, string_printf("compiled 0 and reused %d.", num_shaders));
+
+  shader_update();
+
+  scene->default_surface->tag_update(scene);
+  shader_update();
+  const array<int4> partial_nodes = svm_nodes();
+
+  scene->shader_manager->need_update = true;
+  shader_update();
+  EXPECT_TRUE(svm_nodes() == partial_nodes);
+
+  /* Drop the compiled shaders to force compiling all of them again. */
+  scene->shader_manager->reset(scene);
+  scene->shader_manager->need_update = true;
+  shader_update();
+  EXPECT_TRUE(svm_nodes() == partial_nodes);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/tile_writer.h"
+
+#include <OpenImageIO/filesystem.h>
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int width = 100;
+const int height = 70;
+const int tile_size = 16;
+const int num_channels = 3;
+
+/* Value of a channel at a pixel, in bottom to top row order. */
+float pixel_value(int x, int y, int c)
+{
+  return (float)((y * width + x) * num_channels + c);
+}
+
+void write_tile(TileImageWriter &writer, int x, int y)
+{
+  const int w = min(tile_size, width - x);
+  const int h = min(tile_size, height - y);
+
+  vector<float> pixels(w * h * num_channels);
+  for (int ty = 0; ty < h; ty++) {
+    for (int tx = 0; tx < w; tx++) {
+      for (int c = 0; c < num_channels; c++) {
+        pixels[(ty * w + tx) * num_channels + c] = pixel_value(x + tx, y + ty, c);
+      }
+    }
+  }
+
+  EXPECT_TRUE(writer.write_tile(x, y, w, h, &pixels[0]));
+}
+
+}  // namespace
+
+TEST(render_tile_writer, write_tiles)
+{
+  const string filepath = OIIO::Filesystem::temp_directory_path() + "/cycles_tile_writer_" +
+                          OIIO::Filesystem::unique_path() + ".exr";
+
+  TileImageWriter writer;
+  ImageSpec spec(width, height, num_channels, TypeDesc::FLOAT);
+  ASSERT_TRUE(writer.open(filepath, spec));
+
+  /* Tiles from top to bottom, right to left within a row of tiles. */
+  const int num_tile_rows = (height + tile_size - 1) / tile_size;
+  for (int tile_row = num_tile_rows - 1; tile_row >= 0; tile_row--) {
+    for (int x = (width - 1) / tile_size * tile_size; x >= 0; x -= tile_size) {
+      write_tile(writer, x, tile_row * tile_size);
+    }
+  }
+
+  /* Tiles outside of the image are rejected. */
+  vector<float> tile_pixels(tile_size * tile_size * num_channels, 0.0f);
+  EXPECT_FALSE(writer.write_tile(width - 1, 0, tile_size, tile_size, &tile_pixels[0]));
+  EXPECT_FALSE(writer.write_tile(0, height - 1, tile_size, tile_size, &tile_pixels[0]));
+  EXPECT_FALSE(writer.write_tile(-1, 0, tile_size, tile_size, &tile_pixels[0]));
+  EXPECT_FALSE(writer.write_tile(0, -1, tile_size, tile_size, &tile_pixels[0]));
+
+  ASSERT_TRUE(writer.close());
+
+  /* No more than one row of tiles waited in memory. */
+  EXPECT_LE(writer.mem_peak, sizeof(float) * width * tile_size * num_channels);
+
+  unique_ptr<ImageInput> in(ImageInput::open(filepath));
+  ASSERT_TRUE(in != NULL);
+  vector<float> pixels(width * height * num_channels);
+  ASSERT_TRUE(in->read_image(TypeDesc::FLOAT, &pixels[0]));
+  in->close();
+  OIIO::Filesystem::remove(filepath);
+
+  /* Rows in the file are top to bottom. */
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      for (int c = 0; c < num_channels; c++) {
+        const int row = height - 1 - y;
+        EXPECT_EQ(pixels[(row * width + x) * num_channels + c], pixel_value(x, y, c));
+      }
+    }
+  }
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/mesh.h"
+
+#include "subd/subd_dice.h"
+#include "subd/subd_patch.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Control mesh of two quads sharing an edge. */
+void create_control_mesh(Mesh &mesh)
+{
+  mesh.subdivision_type = Mesh::SUBDIVISION_CATMULL_CLARK;
+  mesh.reserve_mesh(6, 0);
+  mesh.reserve_subd_faces(2, 0, 8);
+
+  for (int i = 0; i < 6; i++) {
+    mesh.add_vertex(make_float3((float)(i % 3), (float)(i / 3), 0.0f));
+  }
+
+  int face0[4] = {0, 1, 4, 3};
+  int face1[4] = {1, 2, 5, 4};
+  mesh.add_subd_face(face0, 4, 0, true);
+  mesh.add_subd_face(face1, 4, 0, true);
+}
+
+/* Add a cache entry, as if a subpatch of the first face was diced. */
+void fill_cache(DiceCache &cache)
+{
+  LinearQuadPatch patch;
+  Subpatch sub(&patch);
+  for (int i = 0; i < 4; i++) {
+    sub.edges[i].T = 4;
+  }
+
+  DiceCache::Entry &entry = cache.entries[DiceCache::Key(sub)];
+  entry.P.resize(9, make_float3(0.0f, 0.0f, 0.0f));
+  entry.N.resize(9, make_float3(0.0f, 0.0f, 1.0f));
+}
+
+}  // namespace
+
+TEST(subd_dice_cache, unchanged)
+{
+  Mesh mesh;
+  create_control_mesh(mesh);
+
+  DiceCache cache;
+  cache.validate(&mesh);
+  fill_cache(cache);
+
+  /* Only the dicing changed, entries are kept. */
+  cache.validate(&mesh);
+  EXPECT_EQ(cache.entries.size(), 1);
+}
+
+TEST(subd_dice_cache, changed_control_mesh)
+{
+  Mesh mesh;
+  create_control_mesh(mesh);
+
+  DiceCache cache;
+  cache.validate(&mesh);
+
+  /* Smallest possible change of a vertex position. */
+  fill_cache(cache);
+  mesh.verts[4].z = nextafterf(mesh.verts[4].z, 1.0f);
+  cache.validate(&mesh);
+  EXPECT_TRUE(cache.entries.empty());
+
+  /* Same vertices, different face. */
+  fill_cache(cache);
+  std::swap(mesh.subd_face_corners[0], mesh.subd_face_corners[1]);
+  cache.validate(&mesh);
+  EXPECT_TRUE(cache.entries.empty());
+
+  fill_cache(cache);
+  mesh.subd_faces[1].smooth = false;
+  cache.validate(&mesh);
+  EXPECT_TRUE(cache.entries.empty());
+
+  fill_cache(cache);
+  Mesh::SubdEdgeCrease crease = {{1, 4}, 0.5f};
+  mesh.subd_creases.push_back_slow(crease);
+  cache.validate(&mesh);
+  EXPECT_TRUE(cache.entries.empty());
+
+  fill_cache(cache);
+  mesh.subdivision_type = Mesh::SUBDIVISION_LINEAR;
+  cache.validate(&mesh);
+  EXPECT_TRUE(cache.entries.empty());
+
+  /* Cache is filled again for the new control mesh. */
+  fill_cache(cache);
+  cache.validate(&mesh);
+  EXPECT_EQ(cache.entries.size(), 1);
+}
+
+CCL_NAMESPACE_END
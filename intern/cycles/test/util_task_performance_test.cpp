@@ -0,0 +1,83 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_task.h"
+#include "util/util_time.h"
+
+#include <atomic>
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+void task_run()
+{
+}
+
+void task_split(TaskPool *pool, std::atomic<int> *num_leafs, int depth)
+{
+  if (depth == 0) {
+    (*num_leafs)++;
+    return;
+  }
+
+  pool->push([=] { task_split(pool, num_leafs, depth - 1); });
+  pool->push([=] { task_split(pool, num_leafs, depth - 1); });
+}
+
+}  // namespace
+
+TEST(util_task, fine_grained_performance)
+{
+  /* Scheduling overhead of tasks that do no work, pushed from a single thread
+   * and recursively from worker threads. */
+  TaskScheduler::init(0);
+  const int num_threads = TaskScheduler::num_threads();
+  const int depth = 20;
+  const int num_tasks = 1 << depth;
+
+  double time_start = time_dt();
+  TaskPool pool;
+  for (int i = 0; i < num_tasks; ++i) {
+    pool.push(function_bind(task_run));
+  }
+  pool.wait_work();
+  const double time_single = time_dt() - time_start;
+
+  time_start = time_dt();
+  TaskPool split_pool;
+  std::atomic<int> num_leafs(0);
+  split_pool.push([&] { task_split(&split_pool, &num_leafs, depth); });
+  TaskPool::Summary summary;
+  split_pool.wait_work(&summary);
+  const double time_split = time_dt() - time_start;
+
+  TaskScheduler::exit();
+  EXPECT_EQ(num_leafs, num_tasks);
+
+  printf("%d threads, %d tasks pushed from one thread: %.1f ns per task\n",
+         num_threads,
+         num_tasks,
+         time_single / num_tasks * 1e9);
+  printf("%d threads, %d tasks pushed from tasks: %.1f ns per task\n",
+         num_threads,
+         summary.num_tasks_handled,
+         time_split / summary.num_tasks_handled * 1e9);
+}
+
+CCL_NAMESPACE_END
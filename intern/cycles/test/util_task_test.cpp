@@ -18,6 +18,8 @@
 
 #include "util/util_task.h"
 
+#include <atomic>
+
 CCL_NAMESPACE_BEGIN
 
 namespace {
@@ -26,6 +28,18 @@ void task_run()
 {
 }
 
+/* Push tasks recursively from worker threads, like BVH building does. */
+void task_split(TaskPool *pool, std::atomic<int> *num_leafs, int depth)
+{
+  if (depth == 0) {
+    (*num_leafs)++;
+    return;
+  }
+
+  pool->push([=] { task_split(pool, num_leafs, depth - 1); });
+  pool->push([=] { task_split(pool, num_leafs, depth - 1); });
+}
+
 }  // namespace
 
 TEST(util_task, basic)
@@ -56,4 +70,40 @@ TEST(util_task, multiple_times)
   }
 }
 
+TEST(util_task, push_from_tasks)
+{
+  TaskScheduler::init(0);
+  TaskPool pool;
+  std::atomic<int> num_leafs(0);
+  pool.push([&] { task_split(&pool, &num_leafs, 12); });
+  TaskPool::Summary summary;
+  pool.wait_work(&summary);
+  TaskScheduler::exit();
+  EXPECT_EQ(num_leafs, 1 << 12);
+  EXPECT_EQ(summary.num_tasks_handled, (1 << 13) - 1);
+}
+
+TEST(util_task, nested_wait)
+{
+  /* Waiting for a pool inside a task must not block the only thread. */
+  const int thread_counts[] = {1, 0};
+  for (const int num_threads : thread_counts) {
+    TaskScheduler::init(num_threads);
+    TaskPool pool;
+    std::atomic<int> num_done(0);
+    for (int i = 0; i < 16; ++i) {
+      pool.push([&] {
+        TaskPool inner_pool;
+        for (int j = 0; j < 100; ++j) {
+          inner_pool.push([&] { num_done++; });
+        }
+        inner_pool.wait_work();
+      });
+    }
+    pool.wait_work();
+    TaskScheduler::exit();
+    EXPECT_EQ(num_done, 16 * 100);
+  }
+}
+
 CCL_NAMESPACE_END
@@ -82,6 +82,9 @@ class DebugFlags {
 
     /* Whether split kernel is used */
     bool split_kernel;
+
+    /* Whether camera rays of neighboring pixels are traced together as a packet. */
+    bool ray_packets;
   };
 
   /* Descriptor of CUDA feature-set to be used. */
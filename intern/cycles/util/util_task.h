@@ -23,6 +23,8 @@
 #include "util/util_thread.h"
 #include "util/util_vector.h"
 
+#include <atomic>
+
 CCL_NAMESPACE_BEGIN
 
 class TaskPool;
@@ -32,10 +34,15 @@ typedef function<void(void)> TaskRunFunction;
 
 /* Task Pool
  *
- * Pool of tasks that will be executed by the central TaskScheduler.For each
+ * Pool of tasks that will be executed by the central TaskScheduler. For each
  * pool, we can wait for all tasks to be done, or cancel them before they are
  * done.
  *
+ * Tasks may push more tasks into the same or another pool, and wait for
+ * another pool. Waiting executes pending tasks instead of blocking the worker
+ * thread, so nested parallelism like recursive BVH building does not starve
+ * the scheduler.
+ *
  * TaskRunFunction may be created with std::bind or lambda expressions. */
 
 class TaskPool {
@@ -71,14 +78,17 @@ class TaskPool {
   /* Time time stamp of first task pushed. */
   double start_time;
 
-  /* Number of all tasks handled by this pool. */
-  int num_tasks_handled;
+  /* Number of all tasks handled by this pool, tasks may be pushed from multiple threads. */
+  std::atomic<int> num_tasks_handled;
 };
 
 /* Task Scheduler
  *
- * Central scheduler that holds running threads ready to execute tasks. A singe
- * queue holds the task from all pools. */
+ * Central scheduler that holds running threads ready to execute tasks, shared
+ * by all pools. This is a work stealing scheduler built on TBB: every thread
+ * has its own deque of tasks, tasks pushed from a worker thread go to the
+ * deque of that thread and idle threads steal tasks from the other deques.
+ * There is no central queue that threads contend on. */
 
 class TaskScheduler {
  public:
@@ -59,6 +59,8 @@ typedef enum ImageDataType {
   IMAGE_DATA_TYPE_USHORT = 7,
   IMAGE_DATA_TYPE_NANOVDB_FLOAT = 8,
   IMAGE_DATA_TYPE_NANOVDB_FLOAT3 = 9,
+  IMAGE_DATA_TYPE_SPARSE_FLOAT = 10,
+  IMAGE_DATA_TYPE_SPARSE_FLOAT4 = 11,
 
   IMAGE_DATA_NUM_TYPES
 } ImageDataType;
@@ -105,9 +107,38 @@ typedef struct TextureInfo {
   uint width, height, depth;
   /* Transform for 3D textures. */
   uint use_transform_3d;
+  /* Handle in the CPU texture cache, when pixels are loaded on demand. */
+  uint64_t cache_handle;
   Transform transform_3d;
 } TextureInfo;
 
+/* Sparse 3D textures
+ *
+ * Volume grids are split into tiles of TEX_SPARSE_TILE_SIZE^3 voxels, and only tiles that
+ * contain values are stored. The texture data starts with the index of every tile of the grid,
+ * or TEX_SPARSE_EMPTY_TILE for tiles that are zero everywhere. The voxels of the stored tiles
+ * follow after that, in x, y, z order within each tile. */
+#define TEX_SPARSE_TILE_SHIFT 3
+#define TEX_SPARSE_TILE_SIZE (1 << TEX_SPARSE_TILE_SHIFT)
+#define TEX_SPARSE_TILE_MASK (TEX_SPARSE_TILE_SIZE - 1)
+#define TEX_SPARSE_TILE_VOXELS (TEX_SPARSE_TILE_SIZE * TEX_SPARSE_TILE_SIZE * TEX_SPARSE_TILE_SIZE)
+#define TEX_SPARSE_EMPTY_TILE (-1)
+
+ccl_device_inline int tex_sparse_num_tiles(const int size)
+{
+  return (size + TEX_SPARSE_TILE_MASK) >> TEX_SPARSE_TILE_SHIFT;
+}
+
+/* Offset in bytes of the voxels, after the tile indices. */
+ccl_device_inline size_t tex_sparse_voxels_offset(const int width,
+                                                  const int height,
+                                                  const int depth)
+{
+  const size_t num_tiles = (size_t)tex_sparse_num_tiles(width) * tex_sparse_num_tiles(height) *
+                           tex_sparse_num_tiles(depth);
+  return (num_tiles * sizeof(int) + 15) & ~(size_t)15;
+}
+
 CCL_NAMESPACE_END
 
 #endif /* __UTIL_TEXTURE_H__ */
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/util_texture_cache.h"
+#include "util/util_logging.h"
+#include "util/util_thread.h"
+
+#include <OpenImageIO/texture.h>
+
+CCL_NAMESPACE_BEGIN
+
+OIIO_NAMESPACE_USING
+
+static TextureSystem *texture_system = NULL;
+static int texture_system_users = 0;
+static thread_mutex texture_system_mutex;
+
+void TextureCache::init(int max_memory_mb)
+{
+  thread_scoped_lock lock(texture_system_mutex);
+
+  if (texture_system_users == 0) {
+    /* Not shared with OSL, which needs an effectively unlimited budget. */
+    texture_system = TextureSystem::create(false);
+
+    /* Images without tiles and MIP levels get them generated on load, so that
+     * lookups only read the tiles at the resolution they need. */
+    texture_system->attribute("automip", 1);
+    texture_system->attribute("autotile", 64);
+    texture_system->attribute("gray_to_rgb", 1);
+    texture_system->attribute("max_memory_MB", max_memory_mb);
+
+    VLOG(1) << "Texture cache created with " << max_memory_mb << " MB budget.";
+  }
+
+  texture_system_users++;
+}
+
+void TextureCache::exit()
+{
+  thread_scoped_lock lock(texture_system_mutex);
+  texture_system_users--;
+
+  if (texture_system_users == 0) {
+    texture_system->invalidate_all(true);
+    TextureSystem::destroy(texture_system);
+    texture_system = NULL;
+  }
+}
+
+uint64_t TextureCache::get_handle(const string &filepath)
+{
+  if (texture_system == NULL) {
+    return 0;
+  }
+
+  return (uint64_t)texture_system->get_texture_handle(ustring(filepath));
+}
+
+float4 TextureCache::lookup(const TextureInfo &info, float x, float y, float2 dx, float2 dy)
+{
+  TextureOpt options;
+
+  switch (info.interpolation) {
+    case INTERPOLATION_CLOSEST:
+      options.interpmode = TextureOpt::InterpClosest;
+      break;
+    case INTERPOLATION_CUBIC:
+    case INTERPOLATION_SMART:
+      options.interpmode = TextureOpt::InterpSmartBicubic;
+      break;
+    default:
+      options.interpmode = TextureOpt::InterpBilinear;
+      break;
+  }
+
+  switch (info.extension) {
+    case EXTENSION_EXTEND:
+      options.swrap = options.twrap = TextureOpt::WrapClamp;
+      break;
+    case EXTENSION_CLIP:
+      options.swrap = options.twrap = TextureOpt::WrapBlack;
+      break;
+    default:
+      options.swrap = options.twrap = TextureOpt::WrapPeriodic;
+      break;
+  }
+
+  /* Alpha for images without an alpha channel. */
+  options.fill = 1.0f;
+
+  /* Cycles images are stored bottom to top, files top to bottom. */
+  float result[4];
+  TextureSystem::TextureHandle *handle = (TextureSystem::TextureHandle *)info.cache_handle;
+
+  if (!texture_system->texture(
+          handle, NULL, options, x, 1.0f - y, dx.x, -dx.y, dy.x, -dy.y, 4, result)) {
+    return make_float4(
+        TEX_IMAGE_MISSING_R, TEX_IMAGE_MISSING_G, TEX_IMAGE_MISSING_B, TEX_IMAGE_MISSING_A);
+  }
+
+  return make_float4(result[0], result[1], result[2], result[3]);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_TEXTURE_CACHE_H__
+#define __UTIL_TEXTURE_CACHE_H__
+
+#include "util/util_string.h"
+#include "util/util_texture.h"
+#include "util/util_types.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Texture Cache
+ *
+ * OpenImageIO texture system shared by all CPU renders in the process, which
+ * reads image tiles and MIP levels on demand within a fixed memory budget,
+ * instead of loading full resolution images into memory up front. */
+
+class TextureCache {
+ public:
+  /* Acquire and release the shared cache, with the memory budget in megabytes. */
+  static void init(int max_memory_mb);
+  static void exit();
+
+  /* Handle to look up the image file with, or 0 if the cache is not initialized. */
+  static uint64_t get_handle(const string &filepath);
+
+  /* Filtered lookup at normalized coordinates, with the footprint given by the
+   * coordinate derivatives. Interpolation and extension are taken from info. */
+  static float4 lookup(const TextureInfo &info, float x, float y, float2 dx, float2 dy);
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_TEXTURE_CACHE_H__ */
@@ -413,6 +413,11 @@ void CustomData_from_bmesh_block(const struct CustomData *source,
                                  struct CustomData *dest,
                                  void *src_block,
                                  int dest_index);
+void CustomData_from_bmesh_blocks(const struct CustomData *source,
+                                  struct CustomData *dest,
+                                  void *const *src_blocks,
+                                  int dest_index,
+                                  int count);
 
 /* query info over types */
 void CustomData_file_write_info(int type, const char **r_struct_name, int *r_struct_num);
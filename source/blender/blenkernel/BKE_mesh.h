@@ -686,6 +686,10 @@ void BKE_mesh_eval_geometry(struct Depsgraph *depsgraph, struct Mesh *mesh);
 /* Draw Cache */
 void BKE_mesh_batch_cache_dirty_tag(struct Mesh *me, eMeshBatchDirtyMode mode);
 void BKE_mesh_batch_cache_free(struct Mesh *me);
+void *BKE_mesh_batch_cache_detach(struct Mesh *me);
+void BKE_mesh_batch_cache_attach(struct Mesh *me,
+                                 void *batch_cache,
+                                 eMeshBatchDirtyMode mode);
 
 extern void (*BKE_mesh_batch_cache_dirty_tag_cb)(struct Mesh *me, eMeshBatchDirtyMode mode);
 extern void (*BKE_mesh_batch_cache_free_cb)(struct Mesh *me);
@@ -1755,6 +1755,109 @@ static void mesh_runtime_check_normals_valid(const Mesh *mesh)
   BLI_assert(!(mesh->runtime.cd_dirty_poly & CD_MASK_NORMAL));
 }
 
+/**
+ * Draw cache of the previous evaluated mesh of an object, kept while the modifier stack is
+ * evaluated again so its GPU buffers can be reused when only vertex positions changed.
+ */
+typedef struct MeshBatchCacheReuse {
+  void *batch_cache;
+  int totvert, totedge, totloop, totpoly;
+  CustomData_MeshMasks data_mask;
+  bool need_mapping;
+} MeshBatchCacheReuse;
+
+static void mesh_batch_cache_reuse_begin(Object *ob, MeshBatchCacheReuse *r_reuse)
+{
+  memset(r_reuse, 0, sizeof(*r_reuse));
+
+  ID *data_eval = ob->runtime.data_eval;
+  if (data_eval == NULL || !ob->runtime.is_data_eval_owned || GS(data_eval->name) != ID_ME) {
+    return;
+  }
+  Mesh *mesh_eval_prev = (Mesh *)data_eval;
+  r_reuse->batch_cache = BKE_mesh_batch_cache_detach(mesh_eval_prev);
+  r_reuse->totvert = mesh_eval_prev->totvert;
+  r_reuse->totedge = mesh_eval_prev->totedge;
+  r_reuse->totloop = mesh_eval_prev->totloop;
+  r_reuse->totpoly = mesh_eval_prev->totpoly;
+  r_reuse->data_mask = ob->runtime.last_data_mask;
+  r_reuse->need_mapping = ob->runtime.last_need_mapping;
+}
+
+/**
+ * The previous draw cache only needs its position dependent buffers updated when every
+ * modifier in the stack is deform only and the input mesh itself was not modified: the
+ * evaluated mesh then has the same topology and attributes as the previous one.
+ */
+static bool mesh_batch_cache_reuse_is_deform_only(struct Depsgraph *depsgraph,
+                                                  Scene *scene,
+                                                  Object *ob,
+                                                  const Mesh *mesh_input,
+                                                  const Mesh *mesh_eval,
+                                                  const MeshBatchCacheReuse *reuse,
+                                                  const CustomData_MeshMasks *dataMask,
+                                                  const bool need_mapping)
+{
+  if (ob->mode & (OB_MODE_ALL_SCULPT | OB_MODE_ALL_PAINT)) {
+    /* Paint modes change attributes of the mesh in place. */
+    return false;
+  }
+  if (mesh_input->id.recalc & ID_RECALC_COPY_ON_WRITE) {
+    return false;
+  }
+  if ((reuse->totvert != mesh_eval->totvert) || (reuse->totedge != mesh_eval->totedge) ||
+      (reuse->totloop != mesh_eval->totloop) || (reuse->totpoly != mesh_eval->totpoly)) {
+    return false;
+  }
+  if ((reuse->need_mapping != need_mapping) ||
+      !CustomData_MeshMasks_are_matching(&reuse->data_mask, dataMask) ||
+      !CustomData_MeshMasks_are_matching(dataMask, &reuse->data_mask)) {
+    return false;
+  }
+
+  const bool use_render = (DEG_get_mode(depsgraph) == DAG_EVAL_RENDER);
+  const int required_mode = use_render ? eModifierMode_Render : eModifierMode_Realtime;
+  VirtualModifierData virtualModifierData;
+  for (ModifierData *md = BKE_modifiers_get_virtual_modifierlist(ob, &virtualModifierData); md;
+       md = md->next) {
+    if (!BKE_modifier_is_enabled(scene, md, required_mode)) {
+      continue;
+    }
+    const ModifierTypeInfo *mti = BKE_modifier_get_info(md->type);
+    if (mti->type != eModifierTypeType_OnlyDeform) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void mesh_batch_cache_reuse_end(struct Depsgraph *depsgraph,
+                                       Scene *scene,
+                                       Object *ob,
+                                       const Mesh *mesh_input,
+                                       Mesh *mesh_eval,
+                                       const bool is_mesh_eval_owned,
+                                       MeshBatchCacheReuse *reuse,
+                                       const CustomData_MeshMasks *dataMask,
+                                       const bool need_mapping)
+{
+  if (reuse->batch_cache == NULL) {
+    return;
+  }
+  if (!is_mesh_eval_owned) {
+    /* Shared evaluated mesh, it manages its own draw cache. */
+    BKE_mesh_batch_cache_attach(mesh_eval, reuse->batch_cache, BKE_MESH_BATCH_DIRTY_ALL);
+    return;
+  }
+  const bool is_deform_only = mesh_batch_cache_reuse_is_deform_only(
+      depsgraph, scene, ob, mesh_input, mesh_eval, reuse, dataMask, need_mapping);
+  BKE_mesh_batch_cache_attach(mesh_eval,
+                              reuse->batch_cache,
+                              is_deform_only ? BKE_MESH_BATCH_DIRTY_DEFORM :
+                                               BKE_MESH_BATCH_DIRTY_ALL);
+  mesh_eval->runtime.batch_cache_deform_update = is_deform_only;
+}
+
 static void mesh_build_data(struct Depsgraph *depsgraph,
                             Scene *scene,
                             Object *ob,
@@ -1767,6 +1870,9 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
    * they aren't cleaned up properly on mode switch, causing crashes, e.g T58150. */
   BLI_assert(ob->id.tag & LIB_TAG_COPIED_ON_WRITE);
 
+  MeshBatchCacheReuse batch_cache_reuse;
+  mesh_batch_cache_reuse_begin(ob, &batch_cache_reuse);
+
   BKE_object_free_derived_caches(ob);
   if (DEG_is_active(depsgraph)) {
     BKE_sculpt_update_object_before_eval(ob);
@@ -1804,6 +1910,16 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
   const bool is_mesh_eval_owned = (mesh_eval != mesh->runtime.mesh_eval);
   BKE_object_eval_assign_data(ob, &mesh_eval->id, is_mesh_eval_owned);
 
+  mesh_batch_cache_reuse_end(depsgraph,
+                             scene,
+                             ob,
+                             mesh,
+                             mesh_eval,
+                             is_mesh_eval_owned,
+                             &batch_cache_reuse,
+                             dataMask,
+                             need_mapping);
+
   ob->runtime.mesh_deform_eval = mesh_deform_eval;
   ob->runtime.last_data_mask = *dataMask;
   ob->runtime.last_need_mapping = need_mapping;
@@ -4185,6 +4185,53 @@ void CustomData_from_bmesh_block(const CustomData *source,
   }
 }
 
+/**
+ * Same as calling #CustomData_from_bmesh_block for each of \a src_blocks,
+ * but matching layers are only looked up once and copied one layer at a time.
+ *
+ * \param src_blocks: The custom-data blocks of \a count elements,
+ * copied into \a dest starting at \a dest_index.
+ */
+void CustomData_from_bmesh_blocks(const CustomData *source,
+                                  CustomData *dest,
+                                  void *const *src_blocks,
+                                  int dest_index,
+                                  int count)
+{
+  int dest_i = 0;
+  for (int src_i = 0; src_i < source->totlayer; src_i++) {
+    while (dest_i < dest->totlayer && dest->layers[dest_i].type < source->layers[src_i].type) {
+      dest_i++;
+    }
+
+    if (dest_i >= dest->totlayer) {
+      return;
+    }
+
+    if (dest->layers[dest_i].type == source->layers[src_i].type) {
+      const LayerTypeInfo *typeInfo = layerType_getInfo(dest->layers[dest_i].type);
+      const int offset = source->layers[src_i].offset;
+      void *dst_data = POINTER_OFFSET(dest->layers[dest_i].data,
+                                      (size_t)dest_index * typeInfo->size);
+
+      if (typeInfo->copy) {
+        for (int i = 0; i < count; i++) {
+          typeInfo->copy(POINTER_OFFSET(src_blocks[i], offset), dst_data, 1);
+          dst_data = POINTER_OFFSET(dst_data, typeInfo->size);
+        }
+      }
+      else {
+        for (int i = 0; i < count; i++) {
+          memcpy(dst_data, POINTER_OFFSET(src_blocks[i], offset), typeInfo->size);
+          dst_data = POINTER_OFFSET(dst_data, typeInfo->size);
+        }
+      }
+
+      dest_i++;
+    }
+  }
+}
+
 void CustomData_file_write_info(int type, const char **r_struct_name, int *r_struct_num)
 {
   const LayerTypeInfo *typeInfo = layerType_getInfo(type);
@@ -49,12 +49,12 @@
 #include "BKE_editmesh_cache.h"
 #include "BKE_global.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
 #include "BKE_multires.h"
 #include "BKE_report.h"
 
 #include "BLI_strict_flags.h"
 
-#include "atomic_ops.h"
 #include "mikktspace.h"
 
 // #define DEBUG_TIME
@@ -211,8 +211,15 @@ typedef struct MeshCalcNormalsData {
   const MLoop *mloop;
   MVert *mverts;
   float (*pnors)[3];
-  float (*lnors_weighted)[3];
   float (*vnors)[3];
+  /**
+   * When threaded, the weight of the poly normal in the vertex normal is stored per corner,
+   * and vertex normals are gathered from their corners afterwards. Otherwise poly normals are
+   * added to vertex normals directly, in the same order.
+   */
+  float *loop_weights;
+  int *loop_polys;
+  const MeshElemMap *vert_loops;
 } MeshCalcNormalsData;
 
 static void mesh_calc_normals_poly_cb(void *__restrict userdata,
@@ -225,67 +232,124 @@ static void mesh_calc_normals_poly_cb(void *__restrict userdata,
   BKE_mesh_calc_poly_normal(mp, data->mloop + mp->loopstart, data->mverts, data->pnors[pidx]);
 }
 
-static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
-                                              const int pidx,
-                                              const TaskParallelTLS *__restrict UNUSED(tls))
+/**
+ * Compute the angle weight of the polygon normal at each corner.
+ * Inline version of #accumulate_vertex_normals_poly_v3, without any temporary edge-vector buffer.
+ *
+ * The weights are either stored in \a r_loop_weights, or the weighted normal is added to the
+ * vertex normals in \a vnors directly.
+ */
+BLI_INLINE void mesh_calc_normals_poly_accum_corners(const MLoop *ml,
+                                                     const MVert *mverts,
+                                                     const int nverts,
+                                                     const float pnor[3],
+                                                     float (*vnors)[3],
+                                                     float *r_loop_weights)
 {
-  MeshCalcNormalsData *data = userdata;
-  const MPoly *mp = &data->mpolys[pidx];
-  const MLoop *ml = &data->mloop[mp->loopstart];
-  const MVert *mverts = data->mverts;
+  /* Normalized direction of the edge ending at the current corner. */
+  float dir_prev[3];
+  float dir_first[3];
+  const float *co_curr = mverts[ml[0].v].co;
+  sub_v3_v3v3(dir_first, co_curr, mverts[ml[nverts - 1].v].co);
+  normalize_v3(dir_first);
+  copy_v3_v3(dir_prev, dir_first);
 
-  float pnor_temp[3];
-  float *pnor = data->pnors ? data->pnors[pidx] : pnor_temp;
-  float(*lnors_weighted)[3] = data->lnors_weighted;
+  for (int i = 0; i < nverts; i++) {
+    float dir_next[3];
+    if (i != nverts - 1) {
+      const float *co_next = mverts[ml[i + 1].v].co;
+      sub_v3_v3v3(dir_next, co_next, co_curr);
+      normalize_v3(dir_next);
+      co_curr = co_next;
+    }
+    else {
+      /* The closing edge has already been computed. */
+      copy_v3_v3(dir_next, dir_first);
+    }
 
-  const int nverts = mp->totloop;
-  float(*edgevecbuf)[3] = BLI_array_alloca(edgevecbuf, (size_t)nverts);
+    /* Angle between the two poly edges incident on this vertex. */
+    const float fac = saacos(-dot_v3v3(dir_prev, dir_next));
+    if (r_loop_weights) {
+      r_loop_weights[i] = fac;
+    }
+    else {
+      madd_v3_v3fl(vnors[ml[i].v], pnor, fac);
+    }
 
-  /* Polygon Normal and edge-vector */
-  /* inline version of #BKE_mesh_calc_poly_normal, also does edge-vectors */
-  {
-    int i_prev = nverts - 1;
-    const float *v_prev = mverts[ml[i_prev].v].co;
-    const float *v_curr;
+    copy_v3_v3(dir_prev, dir_next);
+  }
+}
 
-    zero_v3(pnor);
-    /* Newell's Method */
-    for (int i = 0; i < nverts; i++) {
-      v_curr = mverts[ml[i].v].co;
-      add_newell_cross_v3_v3v3(pnor, v_prev, v_curr);
+static void mesh_calc_normals_poly_and_vertex_accum_cb(
+    void *__restrict userdata, const int pidx, const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshCalcNormalsData *data = userdata;
+  const MPoly *mp = &data->mpolys[pidx];
+  const MLoop *ml = &data->mloop[mp->loopstart];
+  const MVert *mverts = data->mverts;
+  float *pnor = data->pnors[pidx];
+  float *loop_weights = NULL;
 
-      /* Unrelated to normalize, calculate edge-vector */
-      sub_v3_v3v3(edgevecbuf[i_prev], v_prev, v_curr);
-      normalize_v3(edgevecbuf[i_prev]);
-      i_prev = i;
+  if (data->loop_weights) {
+    loop_weights = &data->loop_weights[mp->loopstart];
+    for (int i = 0; i < mp->totloop; i++) {
+      data->loop_polys[mp->loopstart + i] = pidx;
+    }
+  }
 
-      v_prev = v_curr;
+  /* Triangles and quads are by far the most common polygons, give them dedicated paths
+   * the compiler can fully unroll. */
+  switch (mp->totloop) {
+    case 3: {
+      const float len = normal_tri_v3(
+          pnor, mverts[ml[0].v].co, mverts[ml[1].v].co, mverts[ml[2].v].co);
+      if (UNLIKELY(len == 0.0f)) {
+        zero_v3(pnor);
+        pnor[2] = 1.0f;
+      }
+      mesh_calc_normals_poly_accum_corners(ml, mverts, 3, pnor, data->vnors, loop_weights);
+      break;
+    }
+    case 4: {
+      const float len = normal_quad_v3(pnor,
+                                       mverts[ml[0].v].co,
+                                       mverts[ml[1].v].co,
+                                       mverts[ml[2].v].co,
+                                       mverts[ml[3].v].co);
+      if (UNLIKELY(len == 0.0f)) {
+        zero_v3(pnor);
+        pnor[2] = 1.0f;
+      }
+      mesh_calc_normals_poly_accum_corners(ml, mverts, 4, pnor, data->vnors, loop_weights);
+      break;
     }
-    if (UNLIKELY(normalize_v3(pnor) == 0.0f)) {
-      pnor[2] = 1.0f; /* other axes set to 0.0 */
+    default: {
+      const int nverts = mp->totloop;
+      /* Newell's Method, inline version of #BKE_mesh_calc_poly_normal. */
+      const float *v_prev = mverts[ml[nverts - 1].v].co;
+      zero_v3(pnor);
+      for (int i = 0; i < nverts; i++) {
+        const float *v_curr = mverts[ml[i].v].co;
+        add_newell_cross_v3_v3v3(pnor, v_prev, v_curr);
+        v_prev = v_curr;
+      }
+      if (UNLIKELY(normalize_v3(pnor) == 0.0f)) {
+        pnor[2] = 1.0f; /* other axes set to 0.0 */
+      }
+      mesh_calc_normals_poly_accum_corners(ml, mverts, nverts, pnor, data->vnors, loop_weights);
+      break;
     }
   }
+}
 
-  /* accumulate angle weighted face normal */
-  /* inline version of #accumulate_vertex_normals_poly_v3,
-   * split between this threaded callback and #mesh_calc_normals_poly_accum_cb. */
-  {
-    const float *prev_edge = edgevecbuf[nverts - 1];
-
-    for (int i = 0; i < nverts; i++) {
-      const int lidx = mp->loopstart + i;
-      const float *cur_edge = edgevecbuf[i];
-
-      /* calculate angle between the two poly edges incident on
-       * this vertex */
-      const float fac = saacos(-dot_v3v3(cur_edge, prev_edge));
-
-      /* Store for later accumulation */
-      mul_v3_v3fl(lnors_weighted[lidx], pnor, fac);
-
-      prev_edge = cur_edge;
-    }
+BLI_INLINE void mesh_calc_normals_vert_finalize(MVert *mv, float no[3])
+{
+  if (UNLIKELY(normalize_v3(no) == 0.0f)) {
+    /* following Mesh convention; we use vertex coordinate itself for normal in this case */
+    normalize_v3_v3(no, mv->co);
   }
+
+  normal_float_to_short_v3(mv->no, no);
 }
 
 static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
@@ -294,15 +358,28 @@ static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
 {
   MeshCalcNormalsData *data = userdata;
 
-  MVert *mv = &data->mverts[vidx];
+  mesh_calc_normals_vert_finalize(&data->mverts[vidx], data->vnors[vidx]);
+}
+
+/**
+ * Sum the weighted normals of the polys around a vertex, in the order of their corners. This is
+ * the same order in which they are added when not threaded, so results don't depend on the
+ * number of threads.
+ */
+static void mesh_calc_normals_poly_gather_cb(void *__restrict userdata,
+                                             const int vidx,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshCalcNormalsData *data = userdata;
+  const MeshElemMap *vert_loops = &data->vert_loops[vidx];
   float *no = data->vnors[vidx];
 
-  if (UNLIKELY(normalize_v3(no) == 0.0f)) {
-    /* following Mesh convention; we use vertex coordinate itself for normal in this case */
-    normalize_v3_v3(no, mv->co);
+  for (int i = 0; i < vert_loops->count; i++) {
+    const int l = vert_loops->indices[i];
+    madd_v3_v3fl(no, data->pnors[data->loop_polys[l]], data->loop_weights[l]);
   }
 
-  normal_float_to_short_v3(mv->no, no);
+  mesh_calc_normals_vert_finalize(&data->mverts[vidx], no);
 }
 
 void BKE_mesh_calc_normals_poly(MVert *mverts,
@@ -337,11 +414,9 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
   }
 
   float(*vnors)[3] = r_vertnors;
-  float(*lnors_weighted)[3] = MEM_malloc_arrayN(
-      (size_t)numLoops, sizeof(*lnors_weighted), __func__);
   bool free_vnors = false;
 
-  /* first go through and calculate normals for all the polys */
+  /* Vertex normals are accumulated, they must start zeroed. */
   if (vnors == NULL) {
     vnors = MEM_calloc_arrayN((size_t)numVerts, sizeof(*vnors), __func__);
     free_vnors = true;
@@ -350,33 +425,58 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
     memset(vnors, 0, sizeof(*vnors) * (size_t)numVerts);
   }
 
+  if (pnors == NULL) {
+    pnors = MEM_malloc_arrayN((size_t)numPolys, sizeof(*pnors), __func__);
+  }
+
+  const bool use_threading = (numPolys > settings.min_iter_per_thread) &&
+                             (BLI_task_scheduler_num_threads() > 1);
+
   MeshCalcNormalsData data = {
       .mpolys = mpolys,
       .mloop = mloop,
       .mverts = mverts,
       .pnors = pnors,
-      .lnors_weighted = lnors_weighted,
       .vnors = vnors,
   };
 
-  /* Compute poly normals, and prepare weighted loop normals. */
-  BLI_task_parallel_range(0, numPolys, &data, mesh_calc_normals_poly_prepare_cb, &settings);
+  if (use_threading) {
+    /* Compute poly normals and corner weights, then gather them into vertex normals. */
+    MeshElemMap *vert_loops;
+    int *vert_loops_mem;
+    BKE_mesh_vert_loop_map_create(
+        &vert_loops, &vert_loops_mem, mpolys, mloop, numVerts, numPolys, numLoops);
+
+    data.loop_weights = MEM_malloc_arrayN((size_t)numLoops, sizeof(float), __func__);
+    data.loop_polys = MEM_malloc_arrayN((size_t)numLoops, sizeof(int), __func__);
+    data.vert_loops = vert_loops;
+
+    BLI_task_parallel_range(
+        0, numPolys, &data, mesh_calc_normals_poly_and_vertex_accum_cb, &settings);
+    BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_gather_cb, &settings);
 
-  /* Actually accumulate weighted loop normals into vertex ones. */
-  /* Unfortunately, not possible to thread that
-   * (not in a reasonable, totally lock- and barrier-free fashion),
-   * since several loops will point to the same vertex... */
-  for (int lidx = 0; lidx < numLoops; lidx++) {
-    add_v3_v3(vnors[mloop[lidx].v], data.lnors_weighted[lidx]);
+    MEM_freeN(data.loop_weights);
+    MEM_freeN(data.loop_polys);
+    MEM_freeN(vert_loops);
+    MEM_freeN(vert_loops_mem);
   }
+  else {
+    /* Compute poly normals, and accumulate them into vertex ones. */
+    settings.use_threading = false;
+    BLI_task_parallel_range(
+        0, numPolys, &data, mesh_calc_normals_poly_and_vertex_accum_cb, &settings);
 
-  /* Normalize and validate computed vertex normals. */
-  BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_finalize_cb, &settings);
+    /* Normalize and validate computed vertex normals. */
+    settings.use_threading = true;
+    BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_finalize_cb, &settings);
+  }
 
+  if (pnors != r_polynors) {
+    MEM_freeN(pnors);
+  }
   if (free_vnors) {
     MEM_freeN(vnors);
   }
-  MEM_freeN(lnors_weighted);
 }
 
 void BKE_mesh_ensure_normals(Mesh *mesh)
@@ -768,8 +868,21 @@ void BKE_lnor_space_custom_normal_to_data(MLoopNorSpace *lnor_space,
   }
 }
 
+/** Minimum number of polygons handled by a single thread. */
 #define LOOP_SPLIT_TASK_BLOCK_SIZE 1024
 
+/**
+ * What has to be computed for a given loop.
+ */
+enum {
+  /** The loop normal is computed while walking the smooth fan of another loop. */
+  LOOP_SPLIT_SKIP = 0,
+  /** Both edges around that vertex are sharp, the loop just takes its poly normal. */
+  LOOP_SPLIT_SINGLE = 1,
+  /** The loop is the entry point of a smooth fan. */
+  LOOP_SPLIT_FAN = 2,
+};
+
 typedef struct LoopSplitTaskData {
   /* Specific to each instance (each task). */
 
@@ -784,7 +897,7 @@ typedef struct LoopSplitTaskData {
   const int *e2l_prev;
   int mp_index;
 
-  /** This one is special, it's owned and managed by worker tasks,
+  /** This one is special, it's owned and managed by worker threads,
    * avoid to have to create it for each fan! */
   BLI_Stack *edge_vectors;
 
@@ -807,6 +920,8 @@ typedef struct LoopSplitTaskDataCommon {
   int (*edge_to_loops)[2];
   int *loop_to_poly;
   const float (*polynors)[3];
+  /** Loop aligned #LOOP_SPLIT_SKIP & co, only computed ahead when lnor spaces are needed. */
+  char *loop_types;
 
   int numEdges;
   int numLoops;
@@ -1310,54 +1425,39 @@ static void loop_split_worker_do(LoopSplitTaskDataCommon *common_data,
   }
 }
 
-static void loop_split_worker(TaskPool *__restrict pool, void *taskdata)
+/**
+ * Cheap check whether given loop, which current edge is smooth, may be the entry point of a
+ * cyclic smooth fan. Needed because cyclic smooth fans have no obvious 'entry point',
+ * and yet we need to walk them once, and only once.
+ *
+ * The loop with the lowest index of the fan is used as entry point, so that this can be found out
+ * for all loops in parallel. The loop of the other polygon using the current edge is next to a
+ * loop of the same fan, since loops of a polygon are contiguous, if it has a lower index there
+ * is no need to walk the fan at all.
+ */
+static bool loop_split_cyclic_smooth_fan_start_maybe(const int *e2l_curr,
+                                                     const int *e2l_prev,
+                                                     const int ml_curr_index)
 {
-  LoopSplitTaskDataCommon *common_data = BLI_task_pool_user_data(pool);
-  LoopSplitTaskData *data = taskdata;
-
-  /* Temp edge vectors stack, only used when computing lnor spacearr. */
-  BLI_Stack *edge_vectors = common_data->lnors_spacearr ?
-                                BLI_stack_new(sizeof(float[3]), __func__) :
-                                NULL;
-
-#ifdef DEBUG_TIME
-  TIMEIT_START_AVERAGED(loop_split_worker);
-#endif
-
-  for (int i = 0; i < LOOP_SPLIT_TASK_BLOCK_SIZE; i++, data++) {
-    /* A NULL ml_curr is used to tag ended data! */
-    if (data->ml_curr == NULL) {
-      break;
-    }
-
-    loop_split_worker_do(common_data, data, edge_vectors);
-  }
-
-  if (edge_vectors) {
-    BLI_stack_free(edge_vectors);
+  if (IS_EDGE_SHARP(e2l_prev)) {
+    /* Sharp loop, so not a cyclic smooth fan... */
+    return false;
   }
-
-#ifdef DEBUG_TIME
-  TIMEIT_END_AVERAGED(loop_split_worker);
-#endif
+  const int ml_other_index = (e2l_curr[0] == ml_curr_index) ? e2l_curr[1] : e2l_curr[0];
+  return ml_other_index > ml_curr_index;
 }
 
 /**
- * Check whether given loop is part of an unknown-so-far cyclic smooth fan, or not.
- * Needed because cyclic smooth fans have no obvious 'entry point',
- * and yet we need to walk them once, and only once.
+ * Check whether given loop is the entry point of a cyclic smooth fan, or not,
+ * see #loop_split_cyclic_smooth_fan_start_maybe.
  */
-static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
-                                                         const MPoly *mpolys,
-                                                         const int (*edge_to_loops)[2],
-                                                         const int *loop_to_poly,
-                                                         const int *e2l_prev,
-                                                         BLI_bitmap *skip_loops,
-                                                         const MLoop *ml_curr,
-                                                         const MLoop *ml_prev,
-                                                         const int ml_curr_index,
-                                                         const int ml_prev_index,
-                                                         const int mp_curr_index)
+static bool loop_split_check_cyclic_smooth_fan_start(const LoopSplitTaskDataCommon *common_data,
+                                                     const int *e2l_prev,
+                                                     const MLoop *ml_curr,
+                                                     const MLoop *ml_prev,
+                                                     const int ml_curr_index,
+                                                     const int ml_prev_index,
+                                                     const int mp_curr_index)
 {
   const unsigned int mv_pivot_index = ml_curr->v; /* The vertex we are "fanning" around! */
   const int *e2lfan_curr;
@@ -1366,11 +1466,6 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
   int mlfan_curr_index, mlfan_vert_index, mpfan_curr_index;
 
   e2lfan_curr = e2l_prev;
-  if (IS_EDGE_SHARP(e2lfan_curr)) {
-    /* Sharp loop, so not a cyclic smooth fan... */
-    return false;
-  }
-
   mlfan_curr = ml_prev;
   mlfan_curr_index = ml_prev_index;
   mlfan_vert_index = ml_curr_index;
@@ -1380,14 +1475,13 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
   BLI_assert(mlfan_vert_index >= 0);
   BLI_assert(mpfan_curr_index >= 0);
 
-  BLI_assert(!BLI_BITMAP_TEST(skip_loops, mlfan_vert_index));
-  BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
-
-  while (true) {
+  /* A fan cannot have more loops than the mesh, this only guards against invalid topology
+   * making us walk in circles without ever getting back to the initial loop. */
+  for (int i = 0; i < common_data->numLoops; i++) {
     /* Find next loop of the smooth fan. */
-    BKE_mesh_loop_manifold_fan_around_vert_next(mloops,
-                                                mpolys,
-                                                loop_to_poly,
+    BKE_mesh_loop_manifold_fan_around_vert_next(common_data->mloops,
+                                                common_data->mpolys,
+                                                common_data->loop_to_poly,
                                                 e2lfan_curr,
                                                 mv_pivot_index,
                                                 &mlfan_curr,
@@ -1395,203 +1489,178 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
                                                 &mlfan_vert_index,
                                                 &mpfan_curr_index);
 
-    e2lfan_curr = edge_to_loops[mlfan_curr->e];
+    e2lfan_curr = common_data->edge_to_loops[mlfan_curr->e];
 
     if (IS_EDGE_SHARP(e2lfan_curr)) {
       /* Sharp loop/edge, so not a cyclic smooth fan... */
       return false;
     }
-    /* Smooth loop/edge... */
-    if (BLI_BITMAP_TEST(skip_loops, mlfan_vert_index)) {
-      if (mlfan_vert_index == ml_curr_index) {
-        /* We walked around a whole cyclic smooth fan without finding any already-processed loop,
-         * means we can use initial ml_curr/ml_prev edge as start for this smooth fan. */
-        return true;
-      }
-      /* ... already checked in some previous looping, we can abort. */
+    if (mlfan_vert_index == ml_curr_index) {
+      /* We walked around a whole cyclic smooth fan without finding any loop with a lower index,
+       * means we can use initial ml_curr/ml_prev edge as start for this smooth fan. */
+      return true;
+    }
+    if (mlfan_vert_index < ml_curr_index) {
+      /* ... another loop of this fan is its entry point, we can abort. */
       return false;
     }
-
-    /* ... we can skip it in future, and keep checking the smooth fan. */
-    BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
   }
+  return false;
 }
 
-static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common_data)
+/**
+ * Get what has to be computed for given loop, see #LOOP_SPLIT_SKIP & co.
+ */
+static char loop_split_loop_type_get(const LoopSplitTaskDataCommon *common_data,
+                                     const int ml_curr_index,
+                                     const int ml_prev_index,
+                                     const int mp_index)
 {
-  MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
-  float(*loopnors)[3] = common_data->loopnors;
-
   const MLoop *mloops = common_data->mloops;
-  const MPoly *mpolys = common_data->mpolys;
-  const int *loop_to_poly = common_data->loop_to_poly;
   const int(*edge_to_loops)[2] = common_data->edge_to_loops;
-  const int numLoops = common_data->numLoops;
-  const int numPolys = common_data->numPolys;
-
-  const MPoly *mp;
-  int mp_index;
-
-  const MLoop *ml_curr;
-  const MLoop *ml_prev;
-  int ml_curr_index;
-  int ml_prev_index;
-
-  BLI_bitmap *skip_loops = BLI_BITMAP_NEW(numLoops, __func__);
-
-  LoopSplitTaskData *data_buff = NULL;
-  int data_idx = 0;
-
-  /* Temp edge vectors stack, only used when computing lnor spacearr
-   * (and we are not multi-threading). */
-  BLI_Stack *edge_vectors = NULL;
 
-#ifdef DEBUG_TIME
-  TIMEIT_START_AVERAGED(loop_split_generator);
-#endif
-
-  if (!pool) {
-    if (lnors_spacearr) {
-      edge_vectors = BLI_stack_new(sizeof(float[3]), __func__);
+  const MLoop *ml_curr = &mloops[ml_curr_index];
+  const MLoop *ml_prev = &mloops[ml_prev_index];
+  const int *e2l_curr = edge_to_loops[ml_curr->e];
+  const int *e2l_prev = edge_to_loops[ml_prev->e];
+
+  /* A smooth edge, we have to check for cyclic smooth fan case.
+   * If this loop is the entry point of a cyclic smooth fan,
+   * we can do it using that loop/edge, otherwise we can skip it. */
+  if (!IS_EDGE_SHARP(e2l_curr)) {
+    if (!loop_split_cyclic_smooth_fan_start_maybe(e2l_curr, e2l_prev, ml_curr_index)) {
+      return LOOP_SPLIT_SKIP;
     }
-  }
-
-  /* We now know edges that can be smoothed (with their vector, and their two loops),
-   * and edges that will be hard! Now, time to generate the normals.
+    return loop_split_check_cyclic_smooth_fan_start(
+               common_data, e2l_prev, ml_curr, ml_prev, ml_curr_index, ml_prev_index, mp_index) ?
+               LOOP_SPLIT_FAN :
+               LOOP_SPLIT_SKIP;
+  }
+
+  /* We *do not need* to check/tag loops as already computed!
+   * Due to the fact a loop only links to one of its two edges,
+   * a same fan *will never be walked more than once!*
+   * Since we consider edges having neighbor polys with inverted
+   * (flipped) normals as sharp, we are sure that no fan will be skipped,
+   * even only considering the case (sharp curr_edge, smooth prev_edge),
+   * and not the alternative (smooth curr_edge, sharp prev_edge).
+   * All this due/thanks to link between normals and loop ordering (i.e. winding).
    */
-  for (mp = mpolys, mp_index = 0; mp_index < numPolys; mp++, mp_index++) {
-    float(*lnors)[3];
-    const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
-    ml_curr_index = mp->loopstart;
-    ml_prev_index = ml_last_index;
+  return IS_EDGE_SHARP(e2l_prev) ? LOOP_SPLIT_SINGLE : LOOP_SPLIT_FAN;
+}
 
-    ml_curr = &mloops[ml_curr_index];
-    ml_prev = &mloops[ml_prev_index];
-    lnors = &loopnors[ml_curr_index];
+static void loop_split_type_cb(void *__restrict userdata,
+                               const int mp_index,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LoopSplitTaskDataCommon *common_data = userdata;
+  const MPoly *mp = &common_data->mpolys[mp_index];
+  const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
+  int ml_prev_index = ml_last_index;
 
-    for (; ml_curr_index <= ml_last_index; ml_curr++, ml_curr_index++, lnors++) {
-      const int *e2l_curr = edge_to_loops[ml_curr->e];
-      const int *e2l_prev = edge_to_loops[ml_prev->e];
+  for (int ml_curr_index = mp->loopstart; ml_curr_index <= ml_last_index; ml_curr_index++) {
+    common_data->loop_types[ml_curr_index] = loop_split_loop_type_get(
+        common_data, ml_curr_index, ml_prev_index, mp_index);
+    ml_prev_index = ml_curr_index;
+  }
+}
 
-#if 0
-      printf("Checking loop %d / edge %u / vert %u (sharp edge: %d, skiploop: %d)...",
-             ml_curr_index,
-             ml_curr->e,
-             ml_curr->v,
-             IS_EDGE_SHARP(e2l_curr),
-             BLI_BITMAP_TEST_BOOL(skip_loops, ml_curr_index));
-#endif
+typedef struct LoopSplitTLS {
+  /** Temp edge vectors stack, only used when computing lnor spacearr, created on first use. */
+  BLI_Stack *edge_vectors;
+} LoopSplitTLS;
+
+static void loop_split_poly_cb(void *__restrict userdata,
+                               const int mp_index,
+                               const TaskParallelTLS *__restrict tls)
+{
+  LoopSplitTaskDataCommon *common_data = userdata;
+  LoopSplitTLS *tls_data = tls->userdata_chunk;
+  MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
+  const char *loop_types = common_data->loop_types;
 
-      /* A smooth edge, we have to check for cyclic smooth fan case.
-       * If we find a new, never-processed cyclic smooth fan, we can do it now using that loop/edge
-       * as 'entry point', otherwise we can skip it. */
-
-      /* Note: In theory, we could make loop_split_generator_check_cyclic_smooth_fan() store
-       * mlfan_vert_index'es and edge indexes in two stacks, to avoid having to fan again around
-       * the vert during actual computation of clnor & clnorspace. However, this would complicate
-       * the code, add more memory usage, and despite its logical complexity,
-       * loop_manifold_fan_around_vert_next() is quite cheap in term of CPU cycles,
-       * so really think it's not worth it. */
-      if (!IS_EDGE_SHARP(e2l_curr) && (BLI_BITMAP_TEST(skip_loops, ml_curr_index) ||
-                                       !loop_split_generator_check_cyclic_smooth_fan(mloops,
-                                                                                     mpolys,
-                                                                                     edge_to_loops,
-                                                                                     loop_to_poly,
-                                                                                     e2l_prev,
-                                                                                     skip_loops,
-                                                                                     ml_curr,
-                                                                                     ml_prev,
-                                                                                     ml_curr_index,
-                                                                                     ml_prev_index,
-                                                                                     mp_index))) {
-        //              printf("SKIPPING!\n");
+  const MLoop *mloops = common_data->mloops;
+  const MPoly *mp = &common_data->mpolys[mp_index];
+  const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
+  int ml_prev_index = ml_last_index;
+
+  for (int ml_curr_index = mp->loopstart; ml_curr_index <= ml_last_index; ml_curr_index++) {
+    const char loop_type = loop_types ? loop_types[ml_curr_index] :
+                                        loop_split_loop_type_get(common_data,
+                                                                 ml_curr_index,
+                                                                 ml_prev_index,
+                                                                 mp_index);
+
+    if (loop_type != LOOP_SPLIT_SKIP) {
+      LoopSplitTaskData data = {NULL};
+
+      data.ml_curr = &mloops[ml_curr_index];
+      data.ml_prev = &mloops[ml_prev_index];
+      data.ml_curr_index = ml_curr_index;
+      data.mp_index = mp_index;
+      if (loop_type == LOOP_SPLIT_SINGLE) {
+        data.lnor = &common_data->loopnors[ml_curr_index];
       }
       else {
-        LoopSplitTaskData *data, data_local;
-
-        //              printf("PROCESSING!\n");
-
-        if (pool) {
-          if (data_idx == 0) {
-            data_buff = MEM_calloc_arrayN(
-                LOOP_SPLIT_TASK_BLOCK_SIZE, sizeof(*data_buff), __func__);
-          }
-          data = &data_buff[data_idx];
-        }
-        else {
-          data = &data_local;
-          memset(data, 0, sizeof(*data));
-        }
-
-        if (IS_EDGE_SHARP(e2l_curr) && IS_EDGE_SHARP(e2l_prev)) {
-          data->lnor = lnors;
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
-#if 0 /* Not needed for 'single' loop. */
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = NULL; /* Tag as 'single' task. */
-#endif
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
-        }
-        /* We *do not need* to check/tag loops as already computed!
-         * Due to the fact a loop only links to one of its two edges,
-         * a same fan *will never be walked more than once!*
-         * Since we consider edges having neighbor polys with inverted
-         * (flipped) normals as sharp, we are sure that no fan will be skipped,
-         * even only considering the case (sharp curr_edge, smooth prev_edge),
-         * and not the alternative (smooth curr_edge, sharp prev_edge).
-         * All this due/thanks to link between normals and loop ordering (i.e. winding).
-         */
-        else {
-#if 0 /* Not needed for 'fan' loops. */
-          data->lnor = lnors;
-#endif
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = e2l_prev; /* Also tag as 'fan' task. */
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
-        }
+        data.ml_prev_index = ml_prev_index;
+        data.e2l_prev = common_data->edge_to_loops[data.ml_prev->e]; /* Also tag as 'fan' task. */
+      }
 
-        if (pool) {
-          data_idx++;
-          if (data_idx == LOOP_SPLIT_TASK_BLOCK_SIZE) {
-            BLI_task_pool_push(pool, loop_split_worker, data_buff, true, NULL);
-            data_idx = 0;
-          }
-        }
-        else {
-          loop_split_worker_do(common_data, data, edge_vectors);
+      if (lnors_spacearr) {
+        /* Lnor spaces of fans entry points are allocated ahead,
+         * see #loop_split_lnor_spaces_create. */
+        data.lnor_space = lnors_spacearr->lspacearr[ml_curr_index];
+        if (tls_data->edge_vectors == NULL) {
+          tls_data->edge_vectors = BLI_stack_new(sizeof(float[3]), __func__);
         }
       }
 
-      ml_prev = ml_curr;
-      ml_prev_index = ml_curr_index;
+      loop_split_worker_do(common_data, &data, tls_data->edge_vectors);
     }
+
+    ml_prev_index = ml_curr_index;
   }
+}
 
-  /* Last block of data... Since it is calloc'ed and we use first NULL item as stopper,
-   * everything is fine. */
-  if (pool && data_idx) {
-    BLI_task_pool_push(pool, loop_split_worker, data_buff, true, NULL);
+static void loop_split_free_cb(const void *__restrict UNUSED(userdata), void *__restrict chunk)
+{
+  LoopSplitTLS *tls_data = chunk;
+  if (tls_data->edge_vectors) {
+    BLI_stack_free(tls_data->edge_vectors);
+    tls_data->edge_vectors = NULL;
   }
+}
 
-  if (edge_vectors) {
-    BLI_stack_free(edge_vectors);
+/**
+ * Allocate the lnor spaces of all smooth fans at once, since the memarena is not thread-safe.
+ * The space of each fan is stored at its entry loop in \a lnors_spacearr,
+ * the fan processing then assigns it to all other loops of the fan.
+ */
+static void loop_split_lnor_spaces_create(LoopSplitTaskDataCommon *common_data)
+{
+  MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
+  const char *loop_types = common_data->loop_types;
+  const int numLoops = common_data->numLoops;
+
+  int num_spaces = 0;
+  for (int i = 0; i < numLoops; i++) {
+    if (loop_types[i] != LOOP_SPLIT_SKIP) {
+      num_spaces++;
+    }
+  }
+  if (num_spaces == 0) {
+    return;
   }
-  MEM_freeN(skip_loops);
 
-#ifdef DEBUG_TIME
-  TIMEIT_END_AVERAGED(loop_split_generator);
-#endif
+  MLoopNorSpace *lnor_spaces = BLI_memarena_calloc(lnors_spacearr->mem,
+                                                   sizeof(*lnor_spaces) * (size_t)num_spaces);
+  lnors_spacearr->num_spaces += num_spaces;
+
+  for (int i = 0; i < numLoops; i++) {
+    if (loop_types[i] != LOOP_SPLIT_SKIP) {
+      lnors_spacearr->lspacearr[i] = lnor_spaces++;
+    }
+  }
 }
 
 /**
@@ -1708,20 +1777,30 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
   /* This first loop check which edges are actually smooth, and compute edge vectors. */
   mesh_edges_sharp_tag(&common_data, check_angle, split_angle, false);
 
-  if (numLoops < LOOP_SPLIT_TASK_BLOCK_SIZE * 8) {
-    /* Not enough loops to be worth the whole threading overhead... */
-    loop_split_generator(NULL, &common_data);
-  }
-  else {
-    TaskPool *task_pool = BLI_task_pool_create(&common_data, TASK_PRIORITY_HIGH);
-
-    loop_split_generator(task_pool, &common_data);
-
-    BLI_task_pool_work_and_wait(task_pool);
+  /* We now know edges that can be smoothed (with their vector, and their two loops),
+   * and edges that will be hard! Now, time to generate the normals.
+   * Each smooth fan is only computed from its entry loop, which every loop can find out on its
+   * own, so there is no need to gather fans beforehand. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = LOOP_SPLIT_TASK_BLOCK_SIZE;
+  /* Not enough loops to be worth the whole threading overhead... */
+  settings.use_threading = (numLoops >= LOOP_SPLIT_TASK_BLOCK_SIZE * 8);
 
-    BLI_task_pool_free(task_pool);
+  if (r_lnors_spacearr) {
+    /* Lnor spaces have to be allocated outside of the threaded loop. */
+    common_data.loop_types = MEM_malloc_arrayN((size_t)numLoops, sizeof(char), __func__);
+    BLI_task_parallel_range(0, numPolys, &common_data, loop_split_type_cb, &settings);
+    loop_split_lnor_spaces_create(&common_data);
   }
 
+  LoopSplitTLS tls_data = {NULL};
+  settings.userdata_chunk = &tls_data;
+  settings.userdata_chunk_size = sizeof(tls_data);
+  settings.func_free = loop_split_free_cb;
+  BLI_task_parallel_range(0, numPolys, &common_data, loop_split_poly_cb, &settings);
+
+  MEM_SAFE_FREE(common_data.loop_types);
   MEM_freeN(edge_to_loops);
   if (!r_loop_to_poly) {
     MEM_freeN(loop_to_poly);
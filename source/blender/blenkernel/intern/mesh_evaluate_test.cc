@@ -0,0 +1,154 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation
+ * All rights reserved.
+ */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_meshdata_types.h"
+
+#include "BLI_float3.hh"
+#include "BLI_map.hh"
+#include "BLI_math.h"
+#include "BLI_vector.hh"
+
+#include "BKE_mesh.h"
+
+#include "mesh_evaluate_test_util.hh"
+
+namespace blender::bke::tests {
+
+static void expect_normals_near(const float (*a)[3], const float (*b)[3], const int len)
+{
+  for (int i = 0; i < len; i++) {
+    EXPECT_V3_NEAR(a[i], b[i], 1e-5f);
+  }
+}
+
+TEST(mesh_evaluate, calc_normals_poly)
+{
+  for (const bool use_tris : {false, true}) {
+    TestMesh mesh(32, use_tris);
+    const int verts_len = (int)mesh.verts.size();
+    const int polys_len = (int)mesh.polys.size();
+
+    Vector<float3> vert_normals(verts_len), vert_normals_ref(verts_len);
+    Vector<float3> poly_normals(polys_len), poly_normals_ref(polys_len);
+
+    mesh.calc_normals((float(*)[3])vert_normals.data(), (float(*)[3])poly_normals.data());
+    mesh.calc_normals_reference((float(*)[3])vert_normals_ref.data(),
+                                (float(*)[3])poly_normals_ref.data());
+
+    expect_normals_near((const float(*)[3])poly_normals.data(),
+                        (const float(*)[3])poly_normals_ref.data(),
+                        polys_len);
+    expect_normals_near((const float(*)[3])vert_normals.data(),
+                        (const float(*)[3])vert_normals_ref.data(),
+                        verts_len);
+
+    /* Short normals stored in the vertices must match the float ones. */
+    for (const int i : mesh.verts.index_range()) {
+      float no[3];
+      normal_short_to_float_v3(no, mesh.verts[i].no);
+      EXPECT_V3_NEAR(no, vert_normals[i], 1e-4f);
+    }
+  }
+}
+
+TEST(mesh_evaluate, normals_loop_split)
+{
+  for (const bool use_tris : {false, true}) {
+    TestMesh mesh(32, use_tris);
+    mesh.tag_sharp();
+    const int loops_len = (int)mesh.loops.size();
+
+    Vector<float3> poly_normals(mesh.polys.size());
+    mesh.calc_normals(nullptr, (float(*)[3])poly_normals.data());
+    const float(*polynors)[3] = (const float(*)[3])poly_normals.data();
+
+    for (const float split_angle : {(float)M_PI, DEG2RADF(15.0f), 0.0f}) {
+      const Vector<int> fans = mesh.calc_smooth_fans_reference(polynors, split_angle);
+      Vector<float3> loop_normals(loops_len), loop_normals_ref(loops_len);
+      mesh.calc_loop_normals_reference(polynors, fans, (float(*)[3])loop_normals_ref.data());
+
+      mesh.calc_loop_normals(
+          polynors, split_angle, nullptr, nullptr, (float(*)[3])loop_normals.data());
+      expect_normals_near((const float(*)[3])loop_normals.data(),
+                          (const float(*)[3])loop_normals_ref.data(),
+                          loops_len);
+
+      /* Same normals when lnor spaces are requested, and one lnor space per smooth fan. */
+      MLoopNorSpaceArray lnors_spacearr = {nullptr};
+      mesh.calc_loop_normals(
+          polynors, split_angle, &lnors_spacearr, nullptr, (float(*)[3])loop_normals.data());
+      expect_normals_near((const float(*)[3])loop_normals.data(),
+                          (const float(*)[3])loop_normals_ref.data(),
+                          loops_len);
+
+      Map<int, MLoopNorSpace *> fan_spaces;
+      for (const int i : mesh.loops.index_range()) {
+        MLoopNorSpace *lnor_space = lnors_spacearr.lspacearr[i];
+        ASSERT_NE(lnor_space, nullptr);
+        EXPECT_EQ(fan_spaces.lookup_or_add(fans[i], lnor_space), lnor_space);
+      }
+      EXPECT_EQ(lnors_spacearr.num_spaces, fan_spaces.size());
+      BKE_lnor_spacearr_free(&lnors_spacearr);
+    }
+  }
+}
+
+TEST(mesh_evaluate, normals_loop_split_custom)
+{
+  TestMesh mesh(32, true);
+  const int loops_len = (int)mesh.loops.size();
+
+  Vector<float3> poly_normals(mesh.polys.size());
+  mesh.calc_normals(nullptr, (float(*)[3])poly_normals.data());
+  const float(*polynors)[3] = (const float(*)[3])poly_normals.data();
+
+  /* Store auto-smooth normals as custom normals, and get them back. */
+  Vector<float3> loop_normals_ref(loops_len), loop_normals(loops_len);
+  mesh.calc_loop_normals(
+      polynors, DEG2RADF(15.0f), nullptr, nullptr, (float(*)[3])loop_normals_ref.data());
+  loop_normals = loop_normals_ref;
+
+  Vector<short> clnors(loops_len * 2);
+  BKE_mesh_normals_loop_custom_set(mesh.verts.data(),
+                                   (int)mesh.verts.size(),
+                                   mesh.edges.data(),
+                                   (int)mesh.edges.size(),
+                                   mesh.loops.data(),
+                                   (float(*)[3])loop_normals.data(),
+                                   loops_len,
+                                   mesh.polys.data(),
+                                   polynors,
+                                   (int)mesh.polys.size(),
+                                   (short(*)[2])clnors.data());
+
+  mesh.calc_loop_normals(polynors,
+                         (float)M_PI,
+                         nullptr,
+                         (short(*)[2])clnors.data(),
+                         (float(*)[3])loop_normals.data());
+  for (const int i : mesh.loops.index_range()) {
+    EXPECT_V3_NEAR(loop_normals[i], loop_normals_ref[i], 1e-3f);
+  }
+}
+
+}  // namespace blender::bke::tests
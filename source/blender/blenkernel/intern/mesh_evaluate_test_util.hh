@@ -0,0 +1,279 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation
+ * All rights reserved.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bke
+ *
+ * Procedural meshes shared by the mesh normals unit and performance tests.
+ */
+
+#include <initializer_list>
+#include <utility>
+
+#include "DNA_meshdata_types.h"
+
+#include "BLI_float3.hh"
+#include "BLI_map.hh"
+#include "BLI_math.h"
+#include "BLI_span.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_mesh.h"
+
+namespace blender::bke::tests {
+
+/**
+ * Wavy grid of `res * res` cells, alternating quads and pairs of triangles,
+ * followed by a single hexagon so every code path of the normal calculation is used.
+ */
+struct TestMesh {
+  Vector<MVert> verts;
+  Vector<MEdge> edges;
+  Vector<MLoop> loops;
+  Vector<MPoly> polys;
+  Map<std::pair<uint, uint>, int> edge_map;
+
+  TestMesh(const int res, const bool use_tris)
+  {
+    const int verts_per_row = res + 1;
+    for (int y = 0; y < verts_per_row; y++) {
+      for (int x = 0; x < verts_per_row; x++) {
+        MVert mv = {{0}};
+        mv.co[0] = (float)x;
+        mv.co[1] = (float)y;
+        mv.co[2] = sinf((float)x * 0.3f) * cosf((float)y * 0.7f);
+        verts.append(mv);
+      }
+    }
+    for (int y = 0; y < res; y++) {
+      for (int x = 0; x < res; x++) {
+        const uint v0 = (uint)(y * verts_per_row + x);
+        const uint v1 = v0 + 1;
+        const uint v2 = v1 + (uint)verts_per_row;
+        const uint v3 = v0 + (uint)verts_per_row;
+        if (use_tris && ((x + y) % 2)) {
+          add_poly({v0, v1, v2});
+          add_poly({v0, v2, v3});
+        }
+        else {
+          add_poly({v0, v1, v2, v3});
+        }
+      }
+    }
+
+    const uint hexagon_start = (uint)verts.size();
+    for (int i = 0; i < 6; i++) {
+      const float angle = (float)i * (float)M_PI / 3.0f;
+      MVert mv = {{0}};
+      mv.co[0] = -10.0f + cosf(angle);
+      mv.co[1] = sinf(angle);
+      mv.co[2] = (i % 2) ? 0.1f : -0.1f;
+      verts.append(mv);
+    }
+    add_poly({hexagon_start,
+              hexagon_start + 1,
+              hexagon_start + 2,
+              hexagon_start + 3,
+              hexagon_start + 4,
+              hexagon_start + 5});
+  }
+
+  void add_poly(std::initializer_list<uint> poly_verts)
+  {
+    MPoly mp = {0};
+    mp.loopstart = (int)loops.size();
+    mp.totloop = (int)poly_verts.size();
+    mp.flag = ME_SMOOTH;
+    polys.append(mp);
+    for (const uint *v = poly_verts.begin(); v != poly_verts.end(); v++) {
+      const uint v_next = (v + 1 == poly_verts.end()) ? *poly_verts.begin() : *(v + 1);
+      MLoop ml = {0};
+      ml.v = *v;
+      ml.e = (uint)edge_map.lookup_or_add_cb({std::min(*v, v_next), std::max(*v, v_next)}, [&]() {
+        MEdge me = {0};
+        me.v1 = *v;
+        me.v2 = v_next;
+        edges.append(me);
+        return (int)edges.size() - 1;
+      });
+      loops.append(ml);
+    }
+  }
+
+  /** Make some edges sharp and some faces flat, to get all kinds of smooth fans. */
+  void tag_sharp()
+  {
+    for (const int i : edges.index_range()) {
+      if (i % 11 == 0) {
+        edges[i].flag |= ME_SHARP;
+      }
+    }
+    for (const int i : polys.index_range()) {
+      if (i % 13 == 0) {
+        polys[i].flag &= (char)~ME_SMOOTH;
+      }
+    }
+  }
+
+  void calc_normals(float (*r_vert_normals)[3], float (*r_poly_normals)[3])
+  {
+    BKE_mesh_calc_normals_poly(verts.data(),
+                               r_vert_normals,
+                               (int)verts.size(),
+                               loops.data(),
+                               polys.data(),
+                               (int)loops.size(),
+                               (int)polys.size(),
+                               r_poly_normals,
+                               false);
+  }
+
+  void calc_loop_normals(const float (*poly_normals)[3],
+                         const float split_angle,
+                         MLoopNorSpaceArray *r_lnors_spacearr,
+                         short (*clnors)[2],
+                         float (*r_loop_normals)[3])
+  {
+    BKE_mesh_normals_loop_split(verts.data(),
+                                (int)verts.size(),
+                                edges.data(),
+                                (int)edges.size(),
+                                loops.data(),
+                                r_loop_normals,
+                                (int)loops.size(),
+                                polys.data(),
+                                poly_normals,
+                                (int)polys.size(),
+                                true,
+                                split_angle,
+                                r_lnors_spacearr,
+                                clnors,
+                                nullptr);
+  }
+
+  /** Straightforward single threaded version, using the generic polygon utilities. */
+  void calc_normals_reference(float (*r_vert_normals)[3], float (*r_poly_normals)[3])
+  {
+    memset(r_vert_normals, 0, sizeof(*r_vert_normals) * (size_t)verts.size());
+    for (const int i : polys.index_range()) {
+      const MPoly *mp = &polys[i];
+      const MLoop *ml = &loops[mp->loopstart];
+      BKE_mesh_calc_poly_normal(mp, ml, verts.data(), r_poly_normals[i]);
+
+      Vector<float *> vert_normals;
+      Vector<const float *> vert_cos;
+      Vector<float3> vdiffs(mp->totloop);
+      for (int j = 0; j < mp->totloop; j++) {
+        vert_normals.append(r_vert_normals[ml[j].v]);
+        vert_cos.append(verts[(int)ml[j].v].co);
+      }
+      accumulate_vertex_normals_poly_v3(vert_normals.data(),
+                                        r_poly_normals[i],
+                                        vert_cos.data(),
+                                        (float(*)[3])vdiffs.data(),
+                                        mp->totloop);
+    }
+    for (const int i : verts.index_range()) {
+      normalize_v3(r_vert_normals[i]);
+    }
+  }
+
+  /**
+   * Group loops into smooth fans by joining the corners of both faces of every smooth edge,
+   * returns the fan of each loop as the index of one of its loops.
+   */
+  Vector<int> calc_smooth_fans_reference(const float (*poly_normals)[3], const float split_angle)
+  {
+    const float split_angle_cos = cosf(split_angle);
+    Vector<Vector<int>> edge_loops(edges.size());
+    Vector<int> loop_to_poly(loops.size());
+    for (const int i : polys.index_range()) {
+      for (int j = polys[i].loopstart; j < polys[i].loopstart + polys[i].totloop; j++) {
+        edge_loops[(int)loops[j].e].append(j);
+        loop_to_poly[j] = i;
+      }
+    }
+
+    Vector<int> fans(loops.size());
+    for (const int i : fans.index_range()) {
+      fans[i] = i;
+    }
+    auto fan_find = [&](int i) {
+      while (fans[i] != i) {
+        i = fans[i] = fans[fans[i]];
+      }
+      return i;
+    };
+    auto corner_find = [&](const int poly, const uint v) {
+      const MPoly &mp = polys[poly];
+      for (int j = mp.loopstart; j < mp.loopstart + mp.totloop; j++) {
+        if (loops[j].v == v) {
+          return j;
+        }
+      }
+      return -1;
+    };
+
+    for (const int i : edges.index_range()) {
+      if (edge_loops[i].size() != 2) {
+        continue;
+      }
+      const int l0 = edge_loops[i][0], l1 = edge_loops[i][1];
+      const int p0 = loop_to_poly[l0], p1 = loop_to_poly[l1];
+      if (!(polys[p0].flag & ME_SMOOTH) || !(polys[p1].flag & ME_SMOOTH) ||
+          (edges[i].flag & ME_SHARP) || loops[l0].v == loops[l1].v ||
+          dot_v3v3(poly_normals[p0], poly_normals[p1]) < split_angle_cos) {
+        continue;
+      }
+      for (const uint v : {edges[i].v1, edges[i].v2}) {
+        fans[fan_find(corner_find(p0, v))] = fan_find(corner_find(p1, v));
+      }
+    }
+
+    for (const int i : fans.index_range()) {
+      fans[i] = fan_find(i);
+    }
+    return fans;
+  }
+
+  void calc_loop_normals_reference(const float (*poly_normals)[3],
+                                   const Span<int> fans,
+                                   float (*r_loop_normals)[3])
+  {
+    Vector<float3> fan_normals(loops.size(), float3(0.0f));
+    for (const int i : polys.index_range()) {
+      const MPoly &mp = polys[i];
+      for (int j = 0; j < mp.totloop; j++) {
+        const MLoop &ml = loops[mp.loopstart + j];
+        const MLoop &ml_prev = loops[mp.loopstart + (j + mp.totloop - 1) % mp.totloop];
+        const MLoop &ml_next = loops[mp.loopstart + (j + 1) % mp.totloop];
+        const float angle = angle_v3v3v3(
+            verts[(int)ml_prev.v].co, verts[(int)ml.v].co, verts[(int)ml_next.v].co);
+        madd_v3_v3fl(fan_normals[fans[mp.loopstart + j]], poly_normals[i], angle);
+      }
+    }
+    for (const int i : loops.index_range()) {
+      normalize_v3_v3(r_loop_normals[i], fan_normals[fans[i]]);
+    }
+  }
+};
+
+}  // namespace blender::bke::tests
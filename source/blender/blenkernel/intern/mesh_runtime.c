@@ -64,6 +64,7 @@ void BKE_mesh_runtime_reset_on_copy(Mesh *mesh, const int UNUSED(flag))
   runtime->mesh_eval = NULL;
   runtime->edit_data = NULL;
   runtime->batch_cache = NULL;
+  runtime->batch_cache_deform_update = false;
   runtime->subdiv_ccg = NULL;
   memset(&runtime->looptris, 0, sizeof(runtime->looptris));
   runtime->bvh_cache = NULL;
@@ -265,6 +266,37 @@ void BKE_mesh_batch_cache_free(Mesh *me)
   }
 }
 
+/**
+ * Take ownership of the draw cache of \a me, so it can outlive the mesh.
+ * The result must be given back with #BKE_mesh_batch_cache_attach.
+ */
+void *BKE_mesh_batch_cache_detach(Mesh *me)
+{
+  void *batch_cache = me->runtime.batch_cache;
+  me->runtime.batch_cache = NULL;
+  return batch_cache;
+}
+
+/**
+ * Give a draw cache detached from another mesh to \a me, tagging it with \a mode.
+ * When \a me already has a cache of its own the detached one is freed instead.
+ */
+void BKE_mesh_batch_cache_attach(Mesh *me, void *batch_cache, eMeshBatchDirtyMode mode)
+{
+  if (batch_cache == NULL) {
+    return;
+  }
+  if (me->runtime.batch_cache != NULL) {
+    /* The draw engine only frees caches through a mesh, use a temporary one. */
+    Mesh me_tmp = {{NULL}};
+    me_tmp.runtime.batch_cache = batch_cache;
+    BKE_mesh_batch_cache_free(&me_tmp);
+    return;
+  }
+  me->runtime.batch_cache = batch_cache;
+  BKE_mesh_batch_cache_dirty_tag(me, mode);
+}
+
 /** \} */
 
 /** \name Mesh runtime debug helpers.
@@ -348,9 +348,14 @@ void BKE_object_eval_uber_transform(Depsgraph *depsgraph, Object *object)
 void BKE_object_batch_cache_dirty_tag(Object *ob)
 {
   switch (ob->type) {
-    case OB_MESH:
-      BKE_mesh_batch_cache_dirty_tag(ob->data, BKE_MESH_BATCH_DIRTY_ALL);
+    case OB_MESH: {
+      Mesh *me = ob->data;
+      BKE_mesh_batch_cache_dirty_tag(me,
+                                     me->runtime.batch_cache_deform_update ?
+                                         BKE_MESH_BATCH_DIRTY_DEFORM :
+                                         BKE_MESH_BATCH_DIRTY_ALL);
       break;
+    }
     case OB_LATTICE:
       BKE_lattice_batch_cache_dirty_tag(ob->data, BKE_LATTICE_BATCH_DIRTY_ALL);
       break;
@@ -0,0 +1,72 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_float3.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_mesh.h"
+
+#include "PIL_time.h"
+
+#include "mesh_evaluate_test_util.hh"
+
+#define NUM_RUN_AVERAGED 5
+
+namespace blender::bke::tests {
+
+TEST(mesh_evaluate, calc_normals_poly)
+{
+  for (const bool use_tris : {false, true}) {
+    TestMesh mesh(1000, use_tris);
+    Vector<float3> poly_normals(mesh.polys.size());
+
+    const double time_start = PIL_check_seconds_timer();
+    for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+      mesh.calc_normals(nullptr, (float(*)[3])poly_normals.data());
+    }
+    const double time_avg = (PIL_check_seconds_timer() - time_start) / NUM_RUN_AVERAGED;
+
+    printf("BKE_mesh_calc_normals_poly, %d verts, %d polys (%s): %.3f ms\n",
+           (int)mesh.verts.size(),
+           (int)mesh.polys.size(),
+           use_tris ? "quads and tris" : "quads",
+           time_avg * 1000.0);
+  }
+}
+
+TEST(mesh_evaluate, normals_loop_split)
+{
+  TestMesh mesh(1000, true);
+  mesh.tag_sharp();
+
+  Vector<float3> poly_normals(mesh.polys.size());
+  Vector<float3> loop_normals(mesh.loops.size());
+  mesh.calc_normals(nullptr, (float(*)[3])poly_normals.data());
+  const float(*polynors)[3] = (const float(*)[3])poly_normals.data();
+
+  for (const bool use_lnor_spaces : {false, true}) {
+    const double time_start = PIL_check_seconds_timer();
+    for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+      MLoopNorSpaceArray lnors_spacearr = {nullptr};
+      mesh.calc_loop_normals(polynors,
+                             DEG2RADF(30.0f),
+                             use_lnor_spaces ? &lnors_spacearr : nullptr,
+                             nullptr,
+                             (float(*)[3])loop_normals.data());
+      if (use_lnor_spaces) {
+        BKE_lnor_spacearr_free(&lnors_spacearr);
+      }
+    }
+    const double time_avg = (PIL_check_seconds_timer() - time_start) / NUM_RUN_AVERAGED;
+
+    printf("BKE_mesh_normals_loop_split, %d loops (%s): %.3f ms\n",
+           (int)mesh.loops.size(),
+           use_lnor_spaces ? "with lnor spaces" : "no lnor spaces",
+           time_avg * 1000.0);
+  }
+}
+
+}  // namespace blender::bke::tests
@@ -80,7 +80,9 @@
 
 #include "BLI_alloca.h"
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_math_vector.h"
+#include "BLI_task.h"
 
 #include "BKE_customdata.h"
 #include "BKE_mesh.h"
@@ -564,16 +566,267 @@ BLI_INLINE void bmesh_quick_edgedraw_flag(MEdge *med, BMEdge *e)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name BMesh to Mesh Element Conversion
+ *
+ * Elements are converted in parallel, in chunks of #BM_TO_ME_CHUNK_SIZE elements
+ * for which custom-data is copied one layer at a time.
+ * Vertices, edges and faces are converted in this order,
+ * since edges and loops reference the indices of the previous ones.
+ * \{ */
+
+#define BM_TO_ME_CHUNK_SIZE 1024
+
+typedef struct BMToMeshData {
+  BMesh *bm;
+  Mesh *me;
+
+  int cd_vert_bweight_offset;
+  int cd_edge_bweight_offset;
+  int cd_edge_crease_offset;
+
+  /** Clear #ME_EDGEDRAW using face angles, otherwise only set it for boundary edges. */
+  bool use_edgedraw_angle;
+
+  /** Optional #CD_ORIGINDEX layers, filled with the element indices. */
+  int *vert_origindex;
+  int *edge_origindex;
+  int *poly_origindex;
+} BMToMeshData;
+
+typedef struct BMToMeshTLS {
+  /** Custom-data blocks of the loops of the current chunk of faces. */
+  void **loop_blocks;
+  int loop_blocks_len;
+} BMToMeshTLS;
+
+static void bm_to_mesh_verts_cb(void *__restrict userdata,
+                                const int chunk,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BMToMeshData *data = userdata;
+  BMesh *bm = data->bm;
+  Mesh *me = data->me;
+  const int index_start = chunk * BM_TO_ME_CHUNK_SIZE;
+  const int index_end = min_ii(index_start + BM_TO_ME_CHUNK_SIZE, bm->totvert);
+  void *blocks[BM_TO_ME_CHUNK_SIZE];
+
+  for (int i = index_start; i < index_end; i++) {
+    BMVert *v = bm->vtable[i];
+    MVert *mv = &me->mvert[i];
+
+    copy_v3_v3(mv->co, v->co);
+    normal_float_to_short_v3(mv->no, v->no);
+
+    mv->flag = BM_vert_flag_to_mflag(v);
+
+    if (data->cd_vert_bweight_offset != -1) {
+      mv->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(v, data->cd_vert_bweight_offset);
+    }
+    if (data->vert_origindex) {
+      data->vert_origindex[i] = i;
+    }
+
+    BM_elem_index_set(v, i); /* set_inline */
+    blocks[i - index_start] = v->head.data;
+
+    BM_CHECK_ELEMENT(v);
+  }
+
+  /* Copy over custom-data. */
+  CustomData_from_bmesh_blocks(
+      &bm->vdata, &me->vdata, blocks, index_start, index_end - index_start);
+}
+
+static void bm_to_mesh_edges_cb(void *__restrict userdata,
+                                const int chunk,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BMToMeshData *data = userdata;
+  BMesh *bm = data->bm;
+  Mesh *me = data->me;
+  const int index_start = chunk * BM_TO_ME_CHUNK_SIZE;
+  const int index_end = min_ii(index_start + BM_TO_ME_CHUNK_SIZE, bm->totedge);
+  void *blocks[BM_TO_ME_CHUNK_SIZE];
+
+  for (int i = index_start; i < index_end; i++) {
+    BMEdge *e = bm->etable[i];
+    MEdge *med = &me->medge[i];
+
+    med->v1 = BM_elem_index_get(e->v1);
+    med->v2 = BM_elem_index_get(e->v2);
+
+    med->flag = BM_edge_flag_to_mflag(e);
+
+    if (data->use_edgedraw_angle) {
+      bmesh_quick_edgedraw_flag(med, e);
+    }
+    else if ((med->flag & ME_EDGEDRAW) == 0) {
+      /* Used for evaluation, only enable draw for single user edges. */
+      if (e->l && e->l == e->l->radial_next) {
+        med->flag |= ME_EDGEDRAW;
+      }
+    }
+
+    if (data->cd_edge_crease_offset != -1) {
+      med->crease = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, data->cd_edge_crease_offset);
+    }
+    if (data->cd_edge_bweight_offset != -1) {
+      med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, data->cd_edge_bweight_offset);
+    }
+
+    BM_elem_index_set(e, i); /* set_inline */
+    blocks[i - index_start] = e->head.data;
+
+    BM_CHECK_ELEMENT(e);
+  }
+
+  /* Copy over custom-data. */
+  CustomData_from_bmesh_blocks(
+      &bm->edata, &me->edata, blocks, index_start, index_end - index_start);
+
+  if (data->edge_origindex) {
+    for (int i = index_start; i < index_end; i++) {
+      data->edge_origindex[i] = i;
+    }
+  }
+}
+
+/**
+ * \note Expects #MPoly.loopstart and #MPoly.totloop to be set already,
+ * so chunks know where their loops are.
+ */
+static void bm_to_mesh_faces_cb(void *__restrict userdata,
+                                const int chunk,
+                                const TaskParallelTLS *__restrict tls)
+{
+  BMToMeshData *data = userdata;
+  BMToMeshTLS *tls_data = tls->userdata_chunk;
+  BMesh *bm = data->bm;
+  Mesh *me = data->me;
+  const int index_start = chunk * BM_TO_ME_CHUNK_SIZE;
+  const int index_end = min_ii(index_start + BM_TO_ME_CHUNK_SIZE, bm->totface);
+  void *blocks[BM_TO_ME_CHUNK_SIZE];
+
+  const int loop_index_start = me->mpoly[index_start].loopstart;
+  const int loop_index_end = me->mpoly[index_end - 1].loopstart + me->mpoly[index_end - 1].totloop;
+  if (tls_data->loop_blocks_len < loop_index_end - loop_index_start) {
+    MEM_SAFE_FREE(tls_data->loop_blocks);
+    tls_data->loop_blocks_len = loop_index_end - loop_index_start;
+    tls_data->loop_blocks = MEM_mallocN(sizeof(void *) * (size_t)tls_data->loop_blocks_len,
+                                        __func__);
+  }
+
+  for (int i = index_start; i < index_end; i++) {
+    BMFace *f = bm->ftable[i];
+    MPoly *mp = &me->mpoly[i];
+    BMLoop *l_iter, *l_first;
+    int j = mp->loopstart;
+
+    mp->mat_nr = f->mat_nr;
+    mp->flag = BM_face_flag_to_mflag(f);
+
+    l_iter = l_first = BM_FACE_FIRST_LOOP(f);
+    do {
+      MLoop *ml = &me->mloop[j];
+      ml->e = BM_elem_index_get(l_iter->e);
+      ml->v = BM_elem_index_get(l_iter->v);
+
+      BM_elem_index_set(l_iter, j); /* set_inline */
+      tls_data->loop_blocks[j - loop_index_start] = l_iter->head.data;
+
+      j++;
+      BM_CHECK_ELEMENT(l_iter);
+      BM_CHECK_ELEMENT(l_iter->e);
+      BM_CHECK_ELEMENT(l_iter->v);
+    } while ((l_iter = l_iter->next) != l_first);
+
+    BM_elem_index_set(f, i); /* set_inline */
+    blocks[i - index_start] = f->head.data;
+
+    BM_CHECK_ELEMENT(f);
+  }
+
+  /* Copy over custom-data. */
+  CustomData_from_bmesh_blocks(&bm->ldata,
+                               &me->ldata,
+                               tls_data->loop_blocks,
+                               loop_index_start,
+                               loop_index_end - loop_index_start);
+  CustomData_from_bmesh_blocks(
+      &bm->pdata, &me->pdata, blocks, index_start, index_end - index_start);
+
+  if (data->poly_origindex) {
+    for (int i = index_start; i < index_end; i++) {
+      data->poly_origindex[i] = i;
+    }
+  }
+}
+
+static void bm_to_mesh_faces_free_cb(const void *__restrict UNUSED(userdata),
+                                     void *__restrict chunk)
+{
+  BMToMeshTLS *tls_data = chunk;
+  MEM_SAFE_FREE(tls_data->loop_blocks);
+}
+
+static int bm_to_mesh_chunks_num(const int elem_num)
+{
+  return (elem_num + BM_TO_ME_CHUNK_SIZE - 1) / BM_TO_ME_CHUNK_SIZE;
+}
+
+/**
+ * Fill the vertex, edge, loop and polygon arrays of \a data->me and their custom-data layers
+ * from the BMesh. Also sets the index of all BMesh elements, matching the mesh.
+ */
+static void bm_to_mesh_elems(BMToMeshData *data)
+{
+  BMesh *bm = data->bm;
+  Mesh *me = data->me;
+  TaskParallelSettings settings;
+
+  BM_mesh_elem_table_ensure(bm, BM_VERT | BM_EDGE | BM_FACE);
+
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (bm->totvert >= BM_OMP_LIMIT);
+  BLI_task_parallel_range(
+      0, bm_to_mesh_chunks_num(bm->totvert), data, bm_to_mesh_verts_cb, &settings);
+  bm->elem_index_dirty &= ~BM_VERT;
+
+  settings.use_threading = (bm->totedge >= BM_OMP_LIMIT);
+  BLI_task_parallel_range(
+      0, bm_to_mesh_chunks_num(bm->totedge), data, bm_to_mesh_edges_cb, &settings);
+  bm->elem_index_dirty &= ~BM_EDGE;
+
+  /* Loop offsets are needed ahead to convert faces in parallel. */
+  int loop_index = 0;
+  for (int i = 0; i < bm->totface; i++) {
+    MPoly *mp = &me->mpoly[i];
+    mp->loopstart = loop_index;
+    mp->totloop = bm->ftable[i]->len;
+    loop_index += mp->totloop;
+  }
+  BLI_assert(loop_index == bm->totloop);
+
+  BMToMeshTLS tls_data = {NULL};
+  settings.use_threading = (bm->totface >= BM_OMP_LIMIT);
+  settings.userdata_chunk = &tls_data;
+  settings.userdata_chunk_size = sizeof(tls_data);
+  settings.func_free = bm_to_mesh_faces_free_cb;
+  BLI_task_parallel_range(
+      0, bm_to_mesh_chunks_num(bm->totface), data, bm_to_mesh_faces_cb, &settings);
+  bm->elem_index_dirty &= ~(BM_FACE | BM_LOOP);
+}
+
+/** \} */
+
 /**
  *
  * \param bmain: May be NULL in case \a calc_object_remap parameter option is not set.
  */
 void BM_mesh_bm_to_me(Main *bmain, BMesh *bm, Mesh *me, const struct BMeshToMeshParams *params)
 {
-  MEdge *med;
-  BMVert *v, *eve;
-  BMEdge *e;
-  BMFace *f;
+  BMVert *eve;
   BMIter iter;
   int i, j;
 
@@ -640,91 +893,18 @@ void BM_mesh_bm_to_me(Main *bmain, BMesh *bm, Mesh *me, const struct BMeshToMesh
   /* This is called again, 'dotess' arg is used there. */
   BKE_mesh_update_customdata_pointers(me, 0);
 
-  i = 0;
-  BM_ITER_MESH (v, &iter, bm, BM_VERTS_OF_MESH) {
-    copy_v3_v3(mvert->co, v->co);
-    normal_float_to_short_v3(mvert->no, v->no);
-
-    mvert->flag = BM_vert_flag_to_mflag(v);
-
-    BM_elem_index_set(v, i); /* set_inline */
-
-    /* Copy over custom-data. */
-    CustomData_from_bmesh_block(&bm->vdata, &me->vdata, v->head.data, i);
-
-    if (cd_vert_bweight_offset != -1) {
-      mvert->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(v, cd_vert_bweight_offset);
-    }
-
-    i++;
-    mvert++;
-
-    BM_CHECK_ELEMENT(v);
-  }
-  bm->elem_index_dirty &= ~BM_VERT;
-
-  med = medge;
-  i = 0;
-  BM_ITER_MESH (e, &iter, bm, BM_EDGES_OF_MESH) {
-    med->v1 = BM_elem_index_get(e->v1);
-    med->v2 = BM_elem_index_get(e->v2);
-
-    med->flag = BM_edge_flag_to_mflag(e);
-
-    BM_elem_index_set(e, i); /* set_inline */
-
-    /* Copy over custom-data. */
-    CustomData_from_bmesh_block(&bm->edata, &me->edata, e->head.data, i);
-
-    bmesh_quick_edgedraw_flag(med, e);
-
-    if (cd_edge_crease_offset != -1) {
-      med->crease = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_crease_offset);
-    }
-    if (cd_edge_bweight_offset != -1) {
-      med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_bweight_offset);
-    }
-
-    i++;
-    med++;
-    BM_CHECK_ELEMENT(e);
-  }
-  bm->elem_index_dirty &= ~BM_EDGE;
-
-  i = 0;
-  j = 0;
-  BM_ITER_MESH (f, &iter, bm, BM_FACES_OF_MESH) {
-    BMLoop *l_iter, *l_first;
-    mpoly->loopstart = j;
-    mpoly->totloop = f->len;
-    mpoly->mat_nr = f->mat_nr;
-    mpoly->flag = BM_face_flag_to_mflag(f);
-
-    l_iter = l_first = BM_FACE_FIRST_LOOP(f);
-    do {
-      mloop->e = BM_elem_index_get(l_iter->e);
-      mloop->v = BM_elem_index_get(l_iter->v);
-
-      /* Copy over custom-data. */
-      CustomData_from_bmesh_block(&bm->ldata, &me->ldata, l_iter->head.data, j);
-
-      j++;
-      mloop++;
-      BM_CHECK_ELEMENT(l_iter);
-      BM_CHECK_ELEMENT(l_iter->e);
-      BM_CHECK_ELEMENT(l_iter->v);
-    } while ((l_iter = l_iter->next) != l_first);
-
-    if (f == bm->act_face) {
-      me->act_face = i;
-    }
-
-    /* Copy over custom-data. */
-    CustomData_from_bmesh_block(&bm->pdata, &me->pdata, f->head.data, i);
-
-    i++;
-    mpoly++;
-    BM_CHECK_ELEMENT(f);
+  BMToMeshData data = {
+      .bm = bm,
+      .me = me,
+      .cd_vert_bweight_offset = cd_vert_bweight_offset,
+      .cd_edge_bweight_offset = cd_edge_bweight_offset,
+      .cd_edge_crease_offset = cd_edge_crease_offset,
+      .use_edgedraw_angle = true,
+  };
+  bm_to_mesh_elems(&data);
+
+  if (bm->act_face) {
+    me->act_face = BM_elem_index_get(bm->act_face);
   }
 
   /* Patch hook indices and vertex parents. */
@@ -1039,117 +1219,25 @@ void BM_mesh_bm_to_me_for_eval(BMesh *bm, Mesh *me, const CustomData_MeshMasks *
 
   BKE_mesh_update_customdata_pointers(me, false);
 
-  BMIter iter;
-  BMVert *eve;
-  BMEdge *eed;
-  BMFace *efa;
-  MVert *mvert = me->mvert;
-  MEdge *medge = me->medge;
-  MLoop *mloop = me->mloop;
-  MPoly *mpoly = me->mpoly;
-  int *index, add_orig;
-  unsigned int i, j;
-
-  const int cd_vert_bweight_offset = CustomData_get_offset(&bm->vdata, CD_BWEIGHT);
-  const int cd_edge_bweight_offset = CustomData_get_offset(&bm->edata, CD_BWEIGHT);
-  const int cd_edge_crease_offset = CustomData_get_offset(&bm->edata, CD_CREASE);
-
   me->runtime.deformed_only = true;
 
   /* Don't add origindex layer if one already exists. */
-  add_orig = !CustomData_has_layer(&bm->pdata, CD_ORIGINDEX);
-
-  index = CustomData_get_layer(&me->vdata, CD_ORIGINDEX);
-
-  BM_ITER_MESH_INDEX (eve, &iter, bm, BM_VERTS_OF_MESH, i) {
-    MVert *mv = &mvert[i];
-
-    copy_v3_v3(mv->co, eve->co);
-
-    BM_elem_index_set(eve, i); /* set_inline */
-
-    normal_float_to_short_v3(mv->no, eve->no);
-
-    mv->flag = BM_vert_flag_to_mflag(eve);
-
-    if (cd_vert_bweight_offset != -1) {
-      mv->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(eve, cd_vert_bweight_offset);
-    }
-
-    if (add_orig) {
-      *index++ = i;
-    }
-
-    CustomData_from_bmesh_block(&bm->vdata, &me->vdata, eve->head.data, i);
-  }
-  bm->elem_index_dirty &= ~BM_VERT;
-
-  index = CustomData_get_layer(&me->edata, CD_ORIGINDEX);
-  BM_ITER_MESH_INDEX (eed, &iter, bm, BM_EDGES_OF_MESH, i) {
-    MEdge *med = &medge[i];
-
-    BM_elem_index_set(eed, i); /* set_inline */
-
-    med->v1 = BM_elem_index_get(eed->v1);
-    med->v2 = BM_elem_index_get(eed->v2);
-
-    med->flag = BM_edge_flag_to_mflag(eed);
-
-    /* Handle this differently to editmode switching,
-     * only enable draw for single user edges rather than calculating angle. */
-    if ((med->flag & ME_EDGEDRAW) == 0) {
-      if (eed->l && eed->l == eed->l->radial_next) {
-        med->flag |= ME_EDGEDRAW;
-      }
-    }
-
-    if (cd_edge_crease_offset != -1) {
-      med->crease = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(eed, cd_edge_crease_offset);
-    }
-    if (cd_edge_bweight_offset != -1) {
-      med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(eed, cd_edge_bweight_offset);
-    }
-
-    CustomData_from_bmesh_block(&bm->edata, &me->edata, eed->head.data, i);
-    if (add_orig) {
-      *index++ = i;
-    }
-  }
-  bm->elem_index_dirty &= ~BM_EDGE;
-
-  index = CustomData_get_layer(&me->pdata, CD_ORIGINDEX);
-  j = 0;
-  BM_ITER_MESH_INDEX (efa, &iter, bm, BM_FACES_OF_MESH, i) {
-    BMLoop *l_iter;
-    BMLoop *l_first;
-    MPoly *mp = &mpoly[i];
-
-    BM_elem_index_set(efa, i); /* set_inline */
-
-    mp->totloop = efa->len;
-    mp->flag = BM_face_flag_to_mflag(efa);
-    mp->loopstart = j;
-    mp->mat_nr = efa->mat_nr;
-
-    l_iter = l_first = BM_FACE_FIRST_LOOP(efa);
-    do {
-      mloop->v = BM_elem_index_get(l_iter->v);
-      mloop->e = BM_elem_index_get(l_iter->e);
-      CustomData_from_bmesh_block(&bm->ldata, &me->ldata, l_iter->head.data, j);
-
-      BM_elem_index_set(l_iter, j); /* set_inline */
-
-      j++;
-      mloop++;
-    } while ((l_iter = l_iter->next) != l_first);
-
-    CustomData_from_bmesh_block(&bm->pdata, &me->pdata, efa->head.data, i);
-
-    if (add_orig) {
-      *index++ = i;
-    }
+  const bool add_orig = !CustomData_has_layer(&bm->pdata, CD_ORIGINDEX);
+
+  BMToMeshData data = {
+      .bm = bm,
+      .me = me,
+      .cd_vert_bweight_offset = CustomData_get_offset(&bm->vdata, CD_BWEIGHT),
+      .cd_edge_bweight_offset = CustomData_get_offset(&bm->edata, CD_BWEIGHT),
+      .cd_edge_crease_offset = CustomData_get_offset(&bm->edata, CD_CREASE),
+      .use_edgedraw_angle = false,
+  };
+  if (add_orig) {
+    data.vert_origindex = CustomData_get_layer(&me->vdata, CD_ORIGINDEX);
+    data.edge_origindex = CustomData_get_layer(&me->edata, CD_ORIGINDEX);
+    data.poly_origindex = CustomData_get_layer(&me->pdata, CD_ORIGINDEX);
   }
-  bm->elem_index_dirty &= ~(BM_FACE | BM_LOOP);
+  bm_to_mesh_elems(&data);
 
   me->cd_flag = BM_mesh_cd_flag_from_bmesh(bm);
 }
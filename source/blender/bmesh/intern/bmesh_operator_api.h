@@ -660,6 +660,20 @@ bool BMO_iter_map_value_bool(BMOIter *iter);
        ele; \
        BM_CHECK_TYPE_ELEM_ASSIGN(ele) = BMO_iter_step(iter), i_++)
 
+/**
+ * Parallel iteration over element buffer slots,
+ * for operators handling each element independently of the others.
+ */
+typedef void (*BMOSlotBufferParallelFunc)(void *__restrict userdata,
+                                          BMElem *ele,
+                                          const int index);
+
+void BMO_slot_buffer_iter_parallel(BMOpSlot slot_args[BMO_OP_MAX_SLOTS],
+                                   const char *slot_name,
+                                   const char restrictmask,
+                                   BMOSlotBufferParallelFunc func,
+                                   void *userdata);
+
 extern const int BMO_OPSLOT_TYPEINFO[BMO_OP_SLOT_TOTAL_TYPES];
 
 int BMO_opcode_from_opname(const char *opname);
@@ -27,6 +27,7 @@
 #include "BLI_memarena.h"
 #include "BLI_mempool.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -1559,6 +1560,59 @@ bool BMO_iter_map_value_bool(BMOIter *iter)
   return **((bool **)iter->val);
 }
 
+typedef struct BMOSlotBufferParallelData {
+  void **buf;
+  char restrictmask;
+  BMOSlotBufferParallelFunc func;
+  void *userdata;
+} BMOSlotBufferParallelData;
+
+static void bmo_slot_buffer_iter_parallel_cb(void *__restrict userdata,
+                                             const int index,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BMOSlotBufferParallelData *data = userdata;
+  BMHeader *ele = data->buf[index];
+
+  if (data->restrictmask & ele->htype) {
+    data->func(data->userdata, (BMElem *)ele, index);
+  }
+}
+
+/**
+ * Call \a func for all elements of an element buffer slot matching \a restrictmask,
+ * threaded when the buffer is big enough.
+ *
+ * Only use this when elements can be handled independently of each other,
+ * the index passed to \a func is the index of the element in the buffer.
+ */
+void BMO_slot_buffer_iter_parallel(BMOpSlot slot_args[BMO_OP_MAX_SLOTS],
+                                   const char *slot_name,
+                                   const char restrictmask,
+                                   BMOSlotBufferParallelFunc func,
+                                   void *userdata)
+{
+  BMOpSlot *slot = BMO_slot_get(slot_args, slot_name);
+  BLI_assert(slot->slot_type == BMO_OP_SLOT_ELEMENT_BUF);
+  BLI_assert(restrictmask & slot->slot_subtype.elem);
+
+  if (slot->len == 0) {
+    return;
+  }
+
+  BMOSlotBufferParallelData data = {
+      .buf = slot->data.buf,
+      .restrictmask = restrictmask,
+      .func = func,
+      .userdata = userdata,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (slot->len >= BM_OMP_LIMIT);
+  BLI_task_parallel_range(0, slot->len, &data, bmo_slot_buffer_iter_parallel_cb, &settings);
+}
+
 /* error system */
 typedef struct BMOpError {
   struct BMOpError *next, *prev;
@@ -46,10 +46,17 @@ void bmo_create_vert_exec(BMesh *bm, BMOperator *op)
   BMO_slot_buffer_from_enabled_flag(bm, op, op->slots_out, "vert.out", BM_VERT, ELE_NEW);
 }
 
+static void bmo_transform_vert_cb(void *__restrict userdata,
+                                  BMElem *ele,
+                                  const int UNUSED(index))
+{
+  const float(*mat)[4] = userdata;
+  BMVert *v = (BMVert *)ele;
+  mul_m4_v3(mat, v->co);
+}
+
 void bmo_transform_exec(BMesh *UNUSED(bm), BMOperator *op)
 {
-  BMOIter iter;
-  BMVert *v;
   float mat[4][4], mat_space[4][4], imat_space[4][4];
 
   BMO_slot_mat4_get(op->slots_in, "matrix", mat);
@@ -60,9 +67,7 @@ void bmo_transform_exec(BMesh *UNUSED(bm), BMOperator *op)
     mul_m4_series(mat, imat_space, mat, mat_space);
   }
 
-  BMO_ITER (v, &iter, op->slots_in, "verts", BM_VERT) {
-    mul_m4_v3(mat, v->co);
-  }
+  BMO_slot_buffer_iter_parallel(op->slots_in, "verts", BM_VERT, bmo_transform_vert_cb, mat);
 }
 
 void bmo_translate_exec(BMesh *bm, BMOperator *op)
@@ -351,143 +356,169 @@ void bmo_region_extend_exec(BMesh *bm, BMOperator *op)
   BMO_slot_buffer_from_enabled_flag(bm, op, op->slots_out, "geom.out", BM_ALL_NOLOOP, SEL_FLAG);
 }
 
-void bmo_smooth_vert_exec(BMesh *UNUSED(bm), BMOperator *op)
+typedef struct SmoothVertData {
+  float (*cos)[3];
+  float clip_dist;
+  float fac;
+  bool use_clip[3];
+  bool use_axis[3];
+} SmoothVertData;
+
+static void bmo_smooth_vert_calc_cb(void *__restrict userdata,
+                                    BMElem *ele,
+                                    const int index)
 {
-  BMOIter siter;
+  const SmoothVertData *data = userdata;
+  BMVert *v = (BMVert *)ele;
   BMIter iter;
-  BMVert *v;
   BMEdge *e;
-  float(*cos)[3] = MEM_mallocN(sizeof(*cos) * BMO_slot_buffer_count(op->slots_in, "verts"),
-                               __func__);
-  float *co, *co2, clip_dist = BMO_slot_float_get(op->slots_in, "clip_dist");
-  const float fac = BMO_slot_float_get(op->slots_in, "factor");
-  int i, j, clipx, clipy, clipz;
-  int xaxis, yaxis, zaxis;
-
-  clipx = BMO_slot_bool_get(op->slots_in, "mirror_clip_x");
-  clipy = BMO_slot_bool_get(op->slots_in, "mirror_clip_y");
-  clipz = BMO_slot_bool_get(op->slots_in, "mirror_clip_z");
-
-  xaxis = BMO_slot_bool_get(op->slots_in, "use_axis_x");
-  yaxis = BMO_slot_bool_get(op->slots_in, "use_axis_y");
-  zaxis = BMO_slot_bool_get(op->slots_in, "use_axis_z");
-
-  i = 0;
-  BMO_ITER (v, &siter, op->slots_in, "verts", BM_VERT) {
-
-    co = cos[i];
-    zero_v3(co);
-
-    j = 0;
-    BM_ITER_ELEM (e, &iter, v, BM_EDGES_OF_VERT) {
-      co2 = BM_edge_other_vert(e, v)->co;
-      add_v3_v3v3(co, co, co2);
-      j += 1;
-    }
-
-    if (!j) {
-      copy_v3_v3(co, v->co);
-      i++;
-      continue;
-    }
+  float *co = data->cos[index];
+  int j = 0;
 
-    mul_v3_fl(co, 1.0f / (float)j);
-    interp_v3_v3v3(co, v->co, co, fac);
+  zero_v3(co);
 
-    if (clipx && fabsf(v->co[0]) <= clip_dist) {
-      co[0] = 0.0f;
-    }
-    if (clipy && fabsf(v->co[1]) <= clip_dist) {
-      co[1] = 0.0f;
-    }
-    if (clipz && fabsf(v->co[2]) <= clip_dist) {
-      co[2] = 0.0f;
-    }
+  BM_ITER_ELEM (e, &iter, v, BM_EDGES_OF_VERT) {
+    const float *co2 = BM_edge_other_vert(e, v)->co;
+    add_v3_v3v3(co, co, co2);
+    j += 1;
+  }
 
-    i++;
+  if (!j) {
+    copy_v3_v3(co, v->co);
+    return;
   }
 
-  i = 0;
-  BMO_ITER (v, &siter, op->slots_in, "verts", BM_VERT) {
-    if (xaxis) {
-      v->co[0] = cos[i][0];
-    }
-    if (yaxis) {
-      v->co[1] = cos[i][1];
-    }
-    if (zaxis) {
-      v->co[2] = cos[i][2];
+  mul_v3_fl(co, 1.0f / (float)j);
+  interp_v3_v3v3(co, v->co, co, data->fac);
+
+  for (int axis = 0; axis < 3; axis++) {
+    if (data->use_clip[axis] && fabsf(v->co[axis]) <= data->clip_dist) {
+      co[axis] = 0.0f;
     }
+  }
+}
+
+static void bmo_smooth_vert_apply_cb(void *__restrict userdata,
+                                     BMElem *ele,
+                                     const int index)
+{
+  const SmoothVertData *data = userdata;
+  BMVert *v = (BMVert *)ele;
 
-    i++;
+  for (int axis = 0; axis < 3; axis++) {
+    if (data->use_axis[axis]) {
+      v->co[axis] = data->cos[index][axis];
+    }
   }
+}
 
-  MEM_freeN(cos);
+void bmo_smooth_vert_exec(BMesh *UNUSED(bm), BMOperator *op)
+{
+  SmoothVertData data = {
+      .cos = MEM_mallocN(sizeof(*data.cos) * BMO_slot_buffer_count(op->slots_in, "verts"),
+                         __func__),
+      .clip_dist = BMO_slot_float_get(op->slots_in, "clip_dist"),
+      .fac = BMO_slot_float_get(op->slots_in, "factor"),
+      .use_clip =
+          {
+              BMO_slot_bool_get(op->slots_in, "mirror_clip_x"),
+              BMO_slot_bool_get(op->slots_in, "mirror_clip_y"),
+              BMO_slot_bool_get(op->slots_in, "mirror_clip_z"),
+          },
+      .use_axis =
+          {
+              BMO_slot_bool_get(op->slots_in, "use_axis_x"),
+              BMO_slot_bool_get(op->slots_in, "use_axis_y"),
+              BMO_slot_bool_get(op->slots_in, "use_axis_z"),
+          },
+  };
+
+  /* All new locations are computed before moving any vertex, since they depend on neighbors. */
+  BMO_slot_buffer_iter_parallel(op->slots_in, "verts", BM_VERT, bmo_smooth_vert_calc_cb, &data);
+  BMO_slot_buffer_iter_parallel(op->slots_in, "verts", BM_VERT, bmo_smooth_vert_apply_cb, &data);
+
+  MEM_freeN(data.cos);
 }
 
 /**************************************************************************** *
  * Cycle UVs for a face
  **************************************************************************** */
 
-void bmo_rotate_uvs_exec(BMesh *bm, BMOperator *op)
-{
-  BMOIter fs_iter; /* selected faces iterator */
-  BMFace *fs;      /* current face */
-  BMIter l_iter;   /* iteration loop */
-
-  const bool use_ccw = BMO_slot_bool_get(op->slots_in, "use_ccw");
-  const int cd_loop_uv_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPUV);
-
-  if (cd_loop_uv_offset != -1) {
-    BMO_ITER (fs, &fs_iter, op->slots_in, "faces", BM_FACE) {
-      if (use_ccw == false) { /* same loops direction */
-        BMLoop *lf;           /* current face loops */
-        MLoopUV *f_luv;       /* first face loop uv */
-        float p_uv[2];        /* previous uvs */
-        float t_uv[2];        /* tmp uvs */
-
-        int n = 0;
-        BM_ITER_ELEM (lf, &l_iter, fs, BM_LOOPS_OF_FACE) {
-          /* current loop uv is the previous loop uv */
-          MLoopUV *luv = BM_ELEM_CD_GET_VOID_P(lf, cd_loop_uv_offset);
-          if (n == 0) {
-            f_luv = luv;
-            copy_v2_v2(p_uv, luv->uv);
-          }
-          else {
-            copy_v2_v2(t_uv, luv->uv);
-            copy_v2_v2(luv->uv, p_uv);
-            copy_v2_v2(p_uv, t_uv);
-          }
-          n++;
-        }
+typedef struct FaceLoopDataOpData {
+  int cd_loop_offset;
+  bool use_ccw;
+} FaceLoopDataOpData;
 
-        copy_v2_v2(f_luv->uv, p_uv);
+static void bm_face_rotate_uvs(BMFace *fs, const int cd_loop_uv_offset, const bool use_ccw)
+{
+  BMIter l_iter; /* iteration loop */
+
+  if (use_ccw == false) { /* same loops direction */
+    BMLoop *lf;           /* current face loops */
+    MLoopUV *f_luv;       /* first face loop uv */
+    float p_uv[2];        /* previous uvs */
+    float t_uv[2];        /* tmp uvs */
+
+    int n = 0;
+    BM_ITER_ELEM (lf, &l_iter, fs, BM_LOOPS_OF_FACE) {
+      /* current loop uv is the previous loop uv */
+      MLoopUV *luv = BM_ELEM_CD_GET_VOID_P(lf, cd_loop_uv_offset);
+      if (n == 0) {
+        f_luv = luv;
+        copy_v2_v2(p_uv, luv->uv);
       }
-      else {            /* counter loop direction */
-        BMLoop *lf;     /* current face loops */
-        MLoopUV *p_luv; /* previous loop uv */
-        MLoopUV *luv;
-        float t_uv[2]; /* current uvs */
-
-        int n = 0;
-        BM_ITER_ELEM (lf, &l_iter, fs, BM_LOOPS_OF_FACE) {
-          /* previous loop uv is the current loop uv */
-          luv = BM_ELEM_CD_GET_VOID_P(lf, cd_loop_uv_offset);
-          if (n == 0) {
-            p_luv = luv;
-            copy_v2_v2(t_uv, luv->uv);
-          }
-          else {
-            copy_v2_v2(p_luv->uv, luv->uv);
-            p_luv = luv;
-          }
-          n++;
-        }
+      else {
+        copy_v2_v2(t_uv, luv->uv);
+        copy_v2_v2(luv->uv, p_uv);
+        copy_v2_v2(p_uv, t_uv);
+      }
+      n++;
+    }
 
-        copy_v2_v2(luv->uv, t_uv);
+    copy_v2_v2(f_luv->uv, p_uv);
+  }
+  else {            /* counter loop direction */
+    BMLoop *lf;     /* current face loops */
+    MLoopUV *p_luv; /* previous loop uv */
+    MLoopUV *luv;
+    float t_uv[2]; /* current uvs */
+
+    int n = 0;
+    BM_ITER_ELEM (lf, &l_iter, fs, BM_LOOPS_OF_FACE) {
+      /* previous loop uv is the current loop uv */
+      luv = BM_ELEM_CD_GET_VOID_P(lf, cd_loop_uv_offset);
+      if (n == 0) {
+        p_luv = luv;
+        copy_v2_v2(t_uv, luv->uv);
       }
+      else {
+        copy_v2_v2(p_luv->uv, luv->uv);
+        p_luv = luv;
+      }
+      n++;
     }
+
+    copy_v2_v2(luv->uv, t_uv);
+  }
+}
+
+static void bmo_rotate_uvs_face_cb(void *__restrict userdata,
+                                   BMElem *ele,
+                                   const int UNUSED(index))
+{
+  const FaceLoopDataOpData *data = userdata;
+  bm_face_rotate_uvs((BMFace *)ele, data->cd_loop_offset, data->use_ccw);
+}
+
+void bmo_rotate_uvs_exec(BMesh *bm, BMOperator *op)
+{
+  FaceLoopDataOpData data = {
+      .cd_loop_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPUV),
+      .use_ccw = BMO_slot_bool_get(op->slots_in, "use_ccw"),
+  };
+
+  if (data.cd_loop_offset != -1) {
+    BMO_slot_buffer_iter_parallel(op->slots_in, "faces", BM_FACE, bmo_rotate_uvs_face_cb, &data);
   }
 }
 
@@ -515,16 +546,23 @@ static void bm_face_reverse_uvs(BMFace *f, const int cd_loop_uv_offset)
     copy_v2_v2(luv->uv, uvs[(f->len - i - 1)]);
   }
 }
+
+static void bmo_reverse_uvs_face_cb(void *__restrict userdata,
+                                    BMElem *ele,
+                                    const int UNUSED(index))
+{
+  const FaceLoopDataOpData *data = userdata;
+  bm_face_reverse_uvs((BMFace *)ele, data->cd_loop_offset);
+}
+
 void bmo_reverse_uvs_exec(BMesh *bm, BMOperator *op)
 {
-  BMOIter iter;
-  BMFace *f;
-  const int cd_loop_uv_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPUV);
+  FaceLoopDataOpData data = {
+      .cd_loop_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPUV),
+  };
 
-  if (cd_loop_uv_offset != -1) {
-    BMO_ITER (f, &iter, op->slots_in, "faces", BM_FACE) {
-      bm_face_reverse_uvs(f, cd_loop_uv_offset);
-    }
+  if (data.cd_loop_offset != -1) {
+    BMO_slot_buffer_iter_parallel(op->slots_in, "faces", BM_FACE, bmo_reverse_uvs_face_cb, &data);
   }
 }
 
@@ -532,65 +570,77 @@ void bmo_reverse_uvs_exec(BMesh *bm, BMOperator *op)
  * Cycle colors for a face
  **************************************************************************** */
 
-void bmo_rotate_colors_exec(BMesh *bm, BMOperator *op)
+static void bm_face_rotate_colors(BMFace *fs, const int cd_loop_color_offset, const bool use_ccw)
 {
-  BMOIter fs_iter; /* selected faces iterator */
-  BMFace *fs;      /* current face */
-  BMIter l_iter;   /* iteration loop */
-
-  const bool use_ccw = BMO_slot_bool_get(op->slots_in, "use_ccw");
-  const int cd_loop_color_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPCOL);
-
-  if (cd_loop_color_offset != -1) {
-    BMO_ITER (fs, &fs_iter, op->slots_in, "faces", BM_FACE) {
-      if (use_ccw == false) { /* same loops direction */
-        BMLoop *lf;           /* current face loops */
-        MLoopCol *f_lcol;     /* first face loop color */
-        MLoopCol p_col;       /* previous color */
-        MLoopCol t_col;       /* tmp color */
-
-        int n = 0;
-        BM_ITER_ELEM (lf, &l_iter, fs, BM_LOOPS_OF_FACE) {
-          /* current loop color is the previous loop color */
-          MLoopCol *lcol = BM_ELEM_CD_GET_VOID_P(lf, cd_loop_color_offset);
-          if (n == 0) {
-            f_lcol = lcol;
-            p_col = *lcol;
-          }
-          else {
-            t_col = *lcol;
-            *lcol = p_col;
-            p_col = t_col;
-          }
-          n++;
-        }
-
-        *f_lcol = p_col;
+  BMIter l_iter; /* iteration loop */
+
+  if (use_ccw == false) { /* same loops direction */
+    BMLoop *lf;           /* current face loops */
+    MLoopCol *f_lcol;     /* first face loop color */
+    MLoopCol p_col;       /* previous color */
+    MLoopCol t_col;       /* tmp color */
+
+    int n = 0;
+    BM_ITER_ELEM (lf, &l_iter, fs, BM_LOOPS_OF_FACE) {
+      /* current loop color is the previous loop color */
+      MLoopCol *lcol = BM_ELEM_CD_GET_VOID_P(lf, cd_loop_color_offset);
+      if (n == 0) {
+        f_lcol = lcol;
+        p_col = *lcol;
       }
-      else {              /* counter loop direction */
-        BMLoop *lf;       /* current face loops */
-        MLoopCol *p_lcol; /* previous loop color */
-        MLoopCol *lcol;
-        MLoopCol t_col; /* current color */
-
-        int n = 0;
-        BM_ITER_ELEM (lf, &l_iter, fs, BM_LOOPS_OF_FACE) {
-          /* previous loop color is the current loop color */
-          lcol = BM_ELEM_CD_GET_VOID_P(lf, cd_loop_color_offset);
-          if (n == 0) {
-            p_lcol = lcol;
-            t_col = *lcol;
-          }
-          else {
-            *p_lcol = *lcol;
-            p_lcol = lcol;
-          }
-          n++;
-        }
+      else {
+        t_col = *lcol;
+        *lcol = p_col;
+        p_col = t_col;
+      }
+      n++;
+    }
 
-        *lcol = t_col;
+    *f_lcol = p_col;
+  }
+  else {              /* counter loop direction */
+    BMLoop *lf;       /* current face loops */
+    MLoopCol *p_lcol; /* previous loop color */
+    MLoopCol *lcol;
+    MLoopCol t_col; /* current color */
+
+    int n = 0;
+    BM_ITER_ELEM (lf, &l_iter, fs, BM_LOOPS_OF_FACE) {
+      /* previous loop color is the current loop color */
+      lcol = BM_ELEM_CD_GET_VOID_P(lf, cd_loop_color_offset);
+      if (n == 0) {
+        p_lcol = lcol;
+        t_col = *lcol;
       }
+      else {
+        *p_lcol = *lcol;
+        p_lcol = lcol;
+      }
+      n++;
     }
+
+    *lcol = t_col;
+  }
+}
+
+static void bmo_rotate_colors_face_cb(void *__restrict userdata,
+                                      BMElem *ele,
+                                      const int UNUSED(index))
+{
+  const FaceLoopDataOpData *data = userdata;
+  bm_face_rotate_colors((BMFace *)ele, data->cd_loop_offset, data->use_ccw);
+}
+
+void bmo_rotate_colors_exec(BMesh *bm, BMOperator *op)
+{
+  FaceLoopDataOpData data = {
+      .cd_loop_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPCOL),
+      .use_ccw = BMO_slot_bool_get(op->slots_in, "use_ccw"),
+  };
+
+  if (data.cd_loop_offset != -1) {
+    BMO_slot_buffer_iter_parallel(
+        op->slots_in, "faces", BM_FACE, bmo_rotate_colors_face_cb, &data);
   }
 }
 
@@ -617,15 +667,23 @@ static void bm_face_reverse_colors(BMFace *f, const int cd_loop_color_offset)
     *lcol = cols[(f->len - i - 1)];
   }
 }
+
+static void bmo_reverse_colors_face_cb(void *__restrict userdata,
+                                       BMElem *ele,
+                                       const int UNUSED(index))
+{
+  const FaceLoopDataOpData *data = userdata;
+  bm_face_reverse_colors((BMFace *)ele, data->cd_loop_offset);
+}
+
 void bmo_reverse_colors_exec(BMesh *bm, BMOperator *op)
 {
-  BMOIter iter;
-  BMFace *f;
-  const int cd_loop_color_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPCOL);
+  FaceLoopDataOpData data = {
+      .cd_loop_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPCOL),
+  };
 
-  if (cd_loop_color_offset != -1) {
-    BMO_ITER (f, &iter, op->slots_in, "faces", BM_FACE) {
-      bm_face_reverse_colors(f, cd_loop_color_offset);
-    }
+  if (data.cd_loop_offset != -1) {
+    BMO_slot_buffer_iter_parallel(
+        op->slots_in, "faces", BM_FACE, bmo_reverse_colors_face_cb, &data);
   }
 }
@@ -0,0 +1,144 @@
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BLI_math.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_customdata.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
+
+#include "bmesh.h"
+
+#include "bmesh_mesh_convert_test_util.hh"
+
+/* Large enough for #BM_mesh_bm_to_me to convert vertices, edges and faces in threads. */
+#define GRID_RES 150
+
+TEST(bmesh_mesh_convert, BMeshToMesh)
+{
+  BMesh *bm = bm_grid_create(GRID_RES);
+  ASSERT_GE(bm->totvert, BM_OMP_LIMIT);
+  ASSERT_GE(bm->totedge, BM_OMP_LIMIT);
+  ASSERT_GE(bm->totface, BM_OMP_LIMIT);
+  BM_mesh_active_face_set(bm, BM_face_at_index_find(bm, 7));
+
+  Mesh me;
+  mesh_init(&me);
+  bm_to_mesh(bm, &me);
+
+  EXPECT_EQ(me.totvert, bm->totvert);
+  EXPECT_EQ(me.totedge, bm->totedge);
+  EXPECT_EQ(me.totloop, bm->totloop);
+  EXPECT_EQ(me.totpoly, bm->totface);
+  EXPECT_EQ(me.act_face, 7);
+
+  const float *vert_floats = (const float *)CustomData_get_layer(&me.vdata, CD_PROP_FLOAT);
+  const MLoopUV *mloopuv = (const MLoopUV *)CustomData_get_layer(&me.ldata, CD_MLOOPUV);
+  ASSERT_NE(vert_floats, nullptr);
+  ASSERT_NE(mloopuv, nullptr);
+
+  const int cd_float_offset = CustomData_get_offset(&bm->vdata, CD_PROP_FLOAT);
+  const int cd_uv_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPUV);
+
+  BMIter iter;
+  BMVert *v;
+  int i;
+  BM_ITER_MESH_INDEX (v, &iter, bm, BM_VERTS_OF_MESH, i) {
+    EXPECT_EQ(BM_elem_index_get(v), i);
+    EXPECT_V3_NEAR(me.mvert[i].co, v->co, 0.0f);
+    EXPECT_EQ(vert_floats[i], BM_ELEM_CD_GET_FLOAT(v, cd_float_offset));
+  }
+
+  BMEdge *e;
+  BM_ITER_MESH_INDEX (e, &iter, bm, BM_EDGES_OF_MESH, i) {
+    EXPECT_EQ(BM_elem_index_get(e), i);
+    EXPECT_EQ(me.medge[i].v1, BM_elem_index_get(e->v1));
+    EXPECT_EQ(me.medge[i].v2, BM_elem_index_get(e->v2));
+  }
+
+  BMFace *f;
+  int loop_index = 0;
+  BM_ITER_MESH_INDEX (f, &iter, bm, BM_FACES_OF_MESH, i) {
+    EXPECT_EQ(me.mpoly[i].loopstart, loop_index);
+    EXPECT_EQ(me.mpoly[i].totloop, f->len);
+    EXPECT_EQ(me.mpoly[i].flag, BM_face_flag_to_mflag(f));
+
+    BMIter liter;
+    BMLoop *l;
+    BM_ITER_ELEM (l, &liter, f, BM_LOOPS_OF_FACE) {
+      EXPECT_EQ(BM_elem_index_get(l), loop_index);
+      EXPECT_EQ(me.mloop[loop_index].v, BM_elem_index_get(l->v));
+      EXPECT_EQ(me.mloop[loop_index].e, BM_elem_index_get(l->e));
+      const MLoopUV *luv = (const MLoopUV *)BM_ELEM_CD_GET_VOID_P(l, cd_uv_offset);
+      EXPECT_EQ(mloopuv[loop_index].uv[0], luv->uv[0]);
+      EXPECT_EQ(mloopuv[loop_index].uv[1], luv->uv[1]);
+      loop_index++;
+    }
+  }
+  EXPECT_EQ(bm->elem_index_dirty, 0);
+
+  /* Converting back and forth gives the same mesh. */
+  BMesh *bm_copy = bm_from_mesh(&me);
+  Mesh me_copy;
+  mesh_init(&me_copy);
+  bm_to_mesh(bm_copy, &me_copy);
+
+  ASSERT_EQ(me_copy.totvert, me.totvert);
+  ASSERT_EQ(me_copy.totedge, me.totedge);
+  ASSERT_EQ(me_copy.totloop, me.totloop);
+  ASSERT_EQ(me_copy.totpoly, me.totpoly);
+  for (i = 0; i < me.totvert; i++) {
+    EXPECT_V3_NEAR(me_copy.mvert[i].co, me.mvert[i].co, 0.0f);
+    EXPECT_EQ(me_copy.mvert[i].flag, me.mvert[i].flag);
+  }
+  EXPECT_EQ(memcmp(me_copy.medge, me.medge, sizeof(MEdge) * me.totedge), 0);
+  EXPECT_EQ(memcmp(me_copy.mloop, me.mloop, sizeof(MLoop) * me.totloop), 0);
+  EXPECT_EQ(memcmp(me_copy.mpoly, me.mpoly, sizeof(MPoly) * me.totpoly), 0);
+  EXPECT_EQ(memcmp(CustomData_get_layer(&me_copy.ldata, CD_MLOOPUV),
+                   mloopuv,
+                   sizeof(MLoopUV) * me.totloop),
+            0);
+
+  mesh_free(&me_copy);
+  BM_mesh_free(bm_copy);
+  mesh_free(&me);
+  BM_mesh_free(bm);
+}
+
+TEST(bmesh_mesh_convert, BMeshToMeshForEval)
+{
+  BMesh *bm = bm_grid_create(GRID_RES);
+  ASSERT_GE(bm->totface, BM_OMP_LIMIT);
+
+  Mesh me;
+  mesh_init(&me);
+  BM_mesh_bm_to_me_for_eval(bm, &me, NULL);
+
+  const int *vert_origindex = (const int *)CustomData_get_layer(&me.vdata, CD_ORIGINDEX);
+  const int *edge_origindex = (const int *)CustomData_get_layer(&me.edata, CD_ORIGINDEX);
+  const int *poly_origindex = (const int *)CustomData_get_layer(&me.pdata, CD_ORIGINDEX);
+  for (int i = 0; i < me.totvert; i++) {
+    EXPECT_EQ(vert_origindex[i], i);
+  }
+  for (int i = 0; i < me.totedge; i++) {
+    EXPECT_EQ(edge_origindex[i], i);
+  }
+  for (int i = 0; i < me.totpoly; i++) {
+    EXPECT_EQ(poly_origindex[i], i);
+  }
+
+  Mesh me_edit;
+  mesh_init(&me_edit);
+  bm_to_mesh(bm, &me_edit);
+  EXPECT_EQ(memcmp(me.mloop, me_edit.mloop, sizeof(MLoop) * me.totloop), 0);
+  EXPECT_EQ(memcmp(me.mpoly, me_edit.mpoly, sizeof(MPoly) * me.totpoly), 0);
+
+  mesh_free(&me_edit);
+  mesh_free(&me);
+  BM_mesh_free(bm);
+}
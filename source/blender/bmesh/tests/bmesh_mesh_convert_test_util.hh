@@ -0,0 +1,117 @@
+#pragma once
+
+/** \file
+ * \ingroup bmesh
+ *
+ * Meshes shared by the BMesh conversion unit and performance tests.
+ */
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BLI_math.h"
+
+#include "BKE_customdata.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
+
+#include "bmesh.h"
+
+/**
+ * Grid of `res * res` quads, every second quad split into two triangles,
+ * with a vertex float layer and a loop UV layer.
+ */
+static BMesh *bm_grid_create(const int res)
+{
+  BMeshCreateParams bm_params = {0};
+  BMesh *bm = BM_mesh_create(&bm_mesh_allocsize_default, &bm_params);
+
+  BM_data_layer_add(bm, &bm->vdata, CD_PROP_FLOAT);
+  BM_data_layer_add(bm, &bm->ldata, CD_MLOOPUV);
+  const int cd_float_offset = CustomData_get_offset(&bm->vdata, CD_PROP_FLOAT);
+  const int cd_uv_offset = CustomData_get_offset(&bm->ldata, CD_MLOOPUV);
+
+  BMVert **verts = (BMVert **)MEM_mallocN(sizeof(*verts) * (res + 1) * (res + 1), __func__);
+  for (int y = 0; y <= res; y++) {
+    for (int x = 0; x <= res; x++) {
+      const float co[3] = {(float)x, (float)y, sinf((float)(x + y))};
+      BMVert *v = BM_vert_create(bm, co, NULL, BM_CREATE_NOP);
+      BM_ELEM_CD_SET_FLOAT(v, cd_float_offset, (float)(x * y));
+      verts[y * (res + 1) + x] = v;
+    }
+  }
+
+  for (int y = 0; y < res; y++) {
+    for (int x = 0; x < res; x++) {
+      BMVert *v1 = verts[y * (res + 1) + x];
+      BMVert *v2 = verts[y * (res + 1) + x + 1];
+      BMVert *v3 = verts[(y + 1) * (res + 1) + x + 1];
+      BMVert *v4 = verts[(y + 1) * (res + 1) + x];
+      if ((x + y) % 2) {
+        BMVert *quad[4] = {v1, v2, v3, v4};
+        BM_face_create_verts(bm, quad, 4, NULL, BM_CREATE_NOP, true);
+      }
+      else {
+        BMVert *tri_a[3] = {v1, v2, v3};
+        BMVert *tri_b[3] = {v1, v3, v4};
+        BM_face_create_verts(bm, tri_a, 3, NULL, BM_CREATE_NOP, true);
+        BMFace *f = BM_face_create_verts(bm, tri_b, 3, NULL, BM_CREATE_NOP, true);
+        BM_elem_flag_enable(f, BM_ELEM_SMOOTH);
+      }
+    }
+  }
+  MEM_freeN(verts);
+
+  BMIter iter, liter;
+  BMFace *f;
+  BMLoop *l;
+  BM_ITER_MESH (f, &iter, bm, BM_FACES_OF_MESH) {
+    BM_ITER_ELEM (l, &liter, f, BM_LOOPS_OF_FACE) {
+      MLoopUV *luv = (MLoopUV *)BM_ELEM_CD_GET_VOID_P(l, cd_uv_offset);
+      luv->uv[0] = l->v->co[0] / (float)res;
+      luv->uv[1] = l->v->co[1] / (float)res;
+    }
+  }
+
+  BM_mesh_normals_update(bm);
+  return bm;
+}
+
+static void mesh_init(Mesh *me)
+{
+  memset(me, 0, sizeof(*me));
+  CustomData_reset(&me->vdata);
+  CustomData_reset(&me->edata);
+  CustomData_reset(&me->fdata);
+  CustomData_reset(&me->ldata);
+  CustomData_reset(&me->pdata);
+}
+
+static void mesh_free(Mesh *me)
+{
+  CustomData_free(&me->vdata, me->totvert);
+  CustomData_free(&me->edata, me->totedge);
+  CustomData_free(&me->fdata, me->totface);
+  CustomData_free(&me->ldata, me->totloop);
+  CustomData_free(&me->pdata, me->totpoly);
+  MEM_SAFE_FREE(me->mselect);
+  BKE_mesh_runtime_clear_geometry(me);
+}
+
+static void bm_to_mesh(BMesh *bm, Mesh *me)
+{
+  BMeshToMeshParams params = {0};
+  BM_mesh_bm_to_me(NULL, bm, me, &params);
+}
+
+static BMesh *bm_from_mesh(const Mesh *me)
+{
+  BMeshCreateParams bm_create_params = {0};
+  BMesh *bm = BM_mesh_create(&bm_mesh_allocsize_default, &bm_create_params);
+  BMeshFromMeshParams bm_from_me_params = {0};
+  bm_from_me_params.calc_face_normal = true;
+  BM_mesh_bm_from_me(bm, me, &bm_from_me_params);
+  return bm;
+}
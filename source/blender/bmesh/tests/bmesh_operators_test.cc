@@ -0,0 +1,144 @@
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math.h"
+#include "BLI_utildefines.h"
+
+#include "bmesh.h"
+
+/* Large enough for #BMO_slot_buffer_iter_parallel to use threads. */
+#define GRID_RES 150
+
+/** Grid of `res * res` quads with tool flags, as needed to run operators. */
+static BMesh *bm_grid_create(const int res)
+{
+  BMeshCreateParams bm_params = {0};
+  bm_params.use_toolflags = true;
+  BMesh *bm = BM_mesh_create(&bm_mesh_allocsize_default, &bm_params);
+
+  BMVert **verts = (BMVert **)MEM_mallocN(sizeof(*verts) * (res + 1) * (res + 1), __func__);
+  for (int y = 0; y <= res; y++) {
+    for (int x = 0; x <= res; x++) {
+      const float co[3] = {(float)x, (float)y, sinf((float)(x * y))};
+      verts[y * (res + 1) + x] = BM_vert_create(bm, co, NULL, BM_CREATE_NOP);
+    }
+  }
+
+  for (int y = 0; y < res; y++) {
+    for (int x = 0; x < res; x++) {
+      BMVert *quad[4] = {verts[y * (res + 1) + x],
+                         verts[y * (res + 1) + x + 1],
+                         verts[(y + 1) * (res + 1) + x + 1],
+                         verts[(y + 1) * (res + 1) + x]};
+      BM_face_create_verts(bm, quad, 4, NULL, BM_CREATE_NOP, true);
+    }
+  }
+  MEM_freeN(verts);
+
+  BM_mesh_elem_index_ensure(bm, BM_VERT);
+  BM_mesh_elem_table_ensure(bm, BM_VERT);
+  return bm;
+}
+
+typedef struct IterParallelData {
+  BMElem **visited;
+  int *visit_count;
+} IterParallelData;
+
+static void bm_iter_parallel_cb(void *__restrict userdata, BMElem *ele, const int index)
+{
+  IterParallelData *data = (IterParallelData *)userdata;
+  /* Each index is handed to exactly one task, so no atomics are needed. */
+  data->visited[index] = ele;
+  data->visit_count[index]++;
+}
+
+TEST(bmesh_operators, slot_buffer_iter_parallel)
+{
+  BMesh *bm = bm_grid_create(GRID_RES);
+
+  BMOperator op;
+  BMO_op_init(bm, &op, BMO_FLAG_DEFAULTS, "region_extend");
+  BMO_slot_buffer_from_all(bm, &op, op.slots_in, "geom", BM_VERT | BM_FACE);
+
+  BMOpSlot *slot = BMO_slot_get(op.slots_in, "geom");
+  const int len = slot->len;
+  ASSERT_EQ(len, bm->totvert + bm->totface);
+  ASSERT_GE(bm->totvert, BM_OMP_LIMIT);
+
+  IterParallelData data;
+  data.visited = (BMElem **)MEM_callocN(sizeof(*data.visited) * len, __func__);
+  data.visit_count = (int *)MEM_callocN(sizeof(*data.visit_count) * len, __func__);
+
+  BMO_slot_buffer_iter_parallel(op.slots_in, "geom", BM_VERT, bm_iter_parallel_cb, &data);
+
+  /* Every vertex is visited once with its buffer index, faces are skipped. */
+  BMElem **buf = (BMElem **)slot->data.buf;
+  for (int i = 0; i < len; i++) {
+    if (buf[i]->head.htype == BM_VERT) {
+      EXPECT_EQ(data.visited[i], buf[i]);
+      EXPECT_EQ(data.visit_count[i], 1);
+    }
+    else {
+      EXPECT_EQ(data.visited[i], (BMElem *)NULL);
+      EXPECT_EQ(data.visit_count[i], 0);
+    }
+  }
+
+  MEM_freeN(data.visited);
+  MEM_freeN(data.visit_count);
+  BMO_op_finish(bm, &op);
+  BM_mesh_free(bm);
+}
+
+TEST(bmesh_operators, smooth_vert_matches_serial)
+{
+  BMesh *bm = bm_grid_create(GRID_RES);
+  ASSERT_GE(bm->totvert, BM_OMP_LIMIT);
+
+  const float fac = 0.5f;
+  const float clip_dist = 0.001f;
+
+  /* Serial reference, computed from the original coordinates. */
+  float(*cos_expect)[3] = (float(*)[3])MEM_mallocN(sizeof(*cos_expect) * bm->totvert, __func__);
+  for (int i = 0; i < bm->totvert; i++) {
+    BMVert *v = bm->vtable[i];
+    BMIter iter;
+    BMEdge *e;
+    float avg[3] = {0.0f, 0.0f, 0.0f};
+    int j = 0;
+
+    BM_ITER_ELEM (e, &iter, v, BM_EDGES_OF_VERT) {
+      add_v3_v3(avg, BM_edge_other_vert(e, v)->co);
+      j++;
+    }
+    mul_v3_fl(avg, 1.0f / (float)j);
+
+    /* Mirror clip on X, and Z is left untouched. */
+    float *co = cos_expect[i];
+    interp_v3_v3v3(co, v->co, avg, fac);
+    if (fabsf(v->co[0]) <= clip_dist) {
+      co[0] = 0.0f;
+    }
+    co[2] = v->co[2];
+  }
+
+  BMO_op_callf(bm,
+               BMO_FLAG_DEFAULTS,
+               "smooth_vert verts=%av factor=%f mirror_clip_x=%b clip_dist=%f "
+               "use_axis_x=%b use_axis_y=%b use_axis_z=%b",
+               fac,
+               true,
+               clip_dist,
+               true,
+               true,
+               false);
+
+  for (int i = 0; i < bm->totvert; i++) {
+    EXPECT_V3_NEAR(bm->vtable[i]->co, cos_expect[i], 1e-6f);
+  }
+
+  MEM_freeN(cos_expect);
+  BM_mesh_free(bm);
+}
@@ -0,0 +1,44 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "PIL_time.h"
+
+#include "bmesh_mesh_convert_test_util.hh"
+
+#define NUM_RUN_AVERAGED 3
+
+TEST(bmesh_mesh_convert, edit_mode_round_trip)
+{
+  BMesh *bm_grid = bm_grid_create(1000);
+  Mesh me;
+  mesh_init(&me);
+  bm_to_mesh(bm_grid, &me);
+  BM_mesh_free(bm_grid);
+
+  double time_from_me = 0.0, time_to_me = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    /* Enter edit-mode. */
+    double time_start = PIL_check_seconds_timer();
+    BMesh *bm = bm_from_mesh(&me);
+    time_from_me += PIL_check_seconds_timer() - time_start;
+
+    /* Exit edit-mode. */
+    time_start = PIL_check_seconds_timer();
+    bm_to_mesh(bm, &me);
+    time_to_me += PIL_check_seconds_timer() - time_start;
+
+    BM_mesh_free(bm);
+  }
+
+  printf("BM_mesh_bm_from_me, %d verts, %d polys: %.3f ms\n",
+         me.totvert,
+         me.totpoly,
+         time_from_me / NUM_RUN_AVERAGED * 1000.0);
+  printf("BM_mesh_bm_to_me, %d verts, %d polys: %.3f ms\n",
+         me.totvert,
+         me.totpoly,
+         time_to_me / NUM_RUN_AVERAGED * 1000.0);
+
+  mesh_free(&me);
+}
@@ -622,6 +622,38 @@ static void mesh_batch_cache_discard_uvedit_select(MeshBatchCache *cache)
   cache->batch_ready &= ~MBC_EDITUV;
 }
 
+static void mesh_batch_cache_tag_deform(MeshBatchCache *cache)
+{
+  /* Only buffers depending on vertex positions are extracted again. They are tagged instead of
+   * discarded so the batches using them stay valid and the GPU buffers are updated in place.
+   * Index buffers, UVs, vertex colors, weights, edit flags and selection indices are kept. */
+  FOREACH_MESH_BUFFER_CACHE (cache, mbufcache) {
+    GPUVertBuf *vbos[] = {
+        mbufcache->vbo.pos_nor,
+        mbufcache->vbo.lnor,
+        mbufcache->vbo.edge_fac,
+        mbufcache->vbo.tan,
+        mbufcache->vbo.stretch_area,
+        mbufcache->vbo.stretch_angle,
+        mbufcache->vbo.mesh_analysis,
+        mbufcache->vbo.fdots_pos,
+        mbufcache->vbo.fdots_nor,
+        mbufcache->vbo.skin_roots,
+    };
+    for (int i = 0; i < ARRAY_SIZE(vbos); i++) {
+      if (vbos[i] != NULL) {
+        GPU_vertbuf_tag_dirty(vbos[i]);
+      }
+    }
+  }
+  cache->tot_area = 0.0f;
+  cache->tot_uv_area = 0.0f;
+
+  /* Every batch not drawn from UV data only reads at least one of these buffers. */
+  cache->batch_ready &= (MBC_EDITUV &
+                         ~(MBC_EDITUV_FACES_STRETCH_AREA | MBC_EDITUV_FACES_STRETCH_ANGLE));
+}
+
 void DRW_mesh_batch_cache_dirty_tag(Mesh *me, eMeshBatchDirtyMode mode)
 {
   MeshBatchCache *cache = me->runtime.batch_cache;
@@ -687,6 +719,9 @@ void DRW_mesh_batch_cache_dirty_tag(Mesh *me, eMeshBatchDirtyMode mode)
       GPU_BATCH_DISCARD_SAFE(cache->batch.edituv_fdots);
       cache->batch_ready &= ~MBC_EDITUV;
       break;
+    case BKE_MESH_BATCH_DIRTY_DEFORM:
+      mesh_batch_cache_tag_deform(cache);
+      break;
     default:
       BLI_assert(0);
   }
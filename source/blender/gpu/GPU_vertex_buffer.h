@@ -72,6 +72,7 @@ GPUVertBuf *GPU_vertbuf_create_with_format_ex(const GPUVertFormat *, GPUUsageTyp
 
 void GPU_vertbuf_clear(GPUVertBuf *verts);
 void GPU_vertbuf_discard(GPUVertBuf *);
+void GPU_vertbuf_tag_dirty(GPUVertBuf *verts);
 
 /* Avoid GPUVertBuf datablock being free but not its data. */
 void GPU_vertbuf_handle_ref_add(GPUVertBuf *verts);
@@ -161,6 +161,16 @@ void GPU_vertbuf_discard(GPUVertBuf *verts)
   unwrap(verts)->reference_remove();
 }
 
+/**
+ * Mark the content as outdated without freeing anything: the buffer reports itself as not
+ * initialized until the next #GPU_vertbuf_init_with_format, but keeps its GPU allocation so
+ * batches referencing it stay valid and the new data is uploaded in place.
+ */
+void GPU_vertbuf_tag_dirty(GPUVertBuf *verts)
+{
+  unwrap(verts)->flag &= ~GPU_VERTBUF_INIT;
+}
+
 void GPU_vertbuf_handle_ref_add(GPUVertBuf *verts)
 {
   unwrap(verts)->reference_add();
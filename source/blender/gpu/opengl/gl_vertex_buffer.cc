@@ -45,6 +45,7 @@ void GLVertBuf::release_data(void)
     GLContext::buf_free(vbo_id_);
     vbo_id_ = 0;
     memory_usage -= vbo_size_;
+    vbo_size_ = 0;
   }
 
   MEM_SAFE_FREE(data);
@@ -91,6 +92,8 @@ void GLVertBuf::bind(void)
   glBindBuffer(GL_ARRAY_BUFFER, vbo_id_);
 
   if (flag & GPU_VERTBUF_DATA_DIRTY) {
+    /* The buffer may be filled again in place (see #GPU_vertbuf_tag_dirty). */
+    memory_usage -= vbo_size_;
     vbo_size_ = this->size_used_get();
     /* Orphan the vbo to avoid sync then upload data. */
     glBufferData(GL_ARRAY_BUFFER, vbo_size_, NULL, to_gl(usage_));
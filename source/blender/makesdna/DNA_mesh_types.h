@@ -125,7 +125,13 @@ typedef struct Mesh_Runtime {
    */
   char wrapper_type_finalize;
 
-  char _pad[4];
+  /**
+   * Set when the draw cache was inherited from the previous evaluation of the same object and
+   * only vertex positions changed since (see #BKE_MESH_BATCH_DIRTY_DEFORM).
+   */
+  char batch_cache_deform_update;
+
+  char _pad[3];
 
   /** Needed in case we need to lazily initialize the mesh. */
   CustomData_MeshMasks cd_mask_extra;
@@ -47,6 +47,7 @@
 #include "BKE_scene.h"
 
 #include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
 #include "DEG_depsgraph_debug.h"
 #include "DEG_depsgraph_query.h"
 
@@ -148,6 +149,11 @@ void RE_engine_free(RenderEngine *engine)
   }
 #endif
 
+  /* Dependency graph kept around for persistent data. */
+  if (engine->depsgraph) {
+    DEG_graph_free(engine->depsgraph);
+  }
+
   BLI_mutex_end(&engine->update_render_passes_mutex);
 
   MEM_freeN(engine);
@@ -599,13 +605,44 @@ RenderData *RE_engine_get_render_data(Render *re)
 }
 
 /* Depsgraph */
+
+/* With persistent data the dependency graph is kept between renders, so that only data
+ * changed since the previous frame is tagged for update and needs to be synced again. */
+static bool engine_keep_depsgraph(RenderEngine *engine)
+{
+  return (engine->re->r.mode & R_PERSISTENT_DATA) && !(engine->re->r.scemode & R_BUTS_PREVIEW);
+}
+
+static void engine_depsgraph_free(RenderEngine *engine)
+{
+  DEG_graph_free(engine->depsgraph);
+
+  engine->depsgraph = NULL;
+}
+
 static void engine_depsgraph_init(RenderEngine *engine, ViewLayer *view_layer)
 {
   Main *bmain = engine->re->main;
   Scene *scene = engine->re->scene;
 
-  engine->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
-  DEG_debug_name_set(engine->depsgraph, "RENDER");
+  if (engine->depsgraph) {
+    if (DEG_get_bmain(engine->depsgraph) != bmain ||
+        DEG_get_input_scene(engine->depsgraph) != scene) {
+      /* Completely different data, nothing can be reused. */
+      engine_depsgraph_free(engine);
+    }
+    else if (DEG_get_input_view_layer(engine->depsgraph) != view_layer) {
+      /* Reuse the graph for another view layer, objects shared between view layers keep
+       * their evaluated copies. */
+      DEG_graph_replace_owners(engine->depsgraph, bmain, scene, view_layer);
+      DEG_graph_tag_relations_update(engine->depsgraph);
+    }
+  }
+
+  if (engine->depsgraph == NULL) {
+    engine->depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_RENDER);
+    DEG_debug_name_set(engine->depsgraph, "RENDER");
+  }
 
   if (engine->re->r.scemode & R_BUTS_PREVIEW) {
     Depsgraph *depsgraph = engine->depsgraph;
@@ -619,11 +656,20 @@ static void engine_depsgraph_init(RenderEngine *engine, ViewLayer *view_layer)
   }
 }
 
-static void engine_depsgraph_free(RenderEngine *engine)
+static void engine_depsgraph_exit(RenderEngine *engine)
 {
-  DEG_graph_free(engine->depsgraph);
+  if (engine->depsgraph == NULL) {
+    return;
+  }
 
-  engine->depsgraph = NULL;
+  if (engine_keep_depsgraph(engine)) {
+    /* The engine has handled all updates for this render, so the next render only sees
+     * changes made after it. */
+    DEG_ids_clear_recalc(engine->re->main, engine->depsgraph);
+  }
+  else {
+    engine_depsgraph_free(engine);
+  }
 }
 
 void RE_engine_frame_set(RenderEngine *engine, int frame, float subframe)
@@ -699,6 +745,10 @@ bool RE_bake_engine(Render *re,
   BLI_rw_mutex_unlock(&re->partsmutex);
 
   if (type->bake) {
+    /* Baking uses the dependency graph of the caller. */
+    if (engine->depsgraph) {
+      engine_depsgraph_free(engine);
+    }
     engine->depsgraph = depsgraph;
 
     /* update is only called so we create the engine.session */
@@ -891,7 +941,7 @@ int RE_engine_render(Render *re, int do_all)
         DRW_render_gpencil(engine, engine->depsgraph);
       }
 
-      engine_depsgraph_free(engine);
+      engine_depsgraph_exit(engine);
 
       if (RE_engine_test_break(engine)) {
         break;
@@ -983,7 +1033,7 @@ void RE_engine_free_blender_memory(RenderEngine *engine)
    *
    * TODO(sergey): Find better solution for this.
    */
-  if (DRW_render_check_grease_pencil(engine->depsgraph)) {
+  if (DRW_render_check_grease_pencil(engine->depsgraph) || engine_keep_depsgraph(engine)) {
     return;
   }
   DEG_graph_free(engine->depsgraph);
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+# Apache License, Version 2.0
+
+# Render a small scene in full and as two sample ranges, merge the ranges with
+# cycles_merge, and compare the render passes of the merged and full renders.
+
+import argparse
+import os
+import subprocess
+import sys
+
+SCENE = """<cycles>
+<camera width="64" height="48" />
+<transform translate="0 1 -6" rotate="10 1 0 0">
+	<camera type="perspective" fov="0.7" />
+</transform>
+
+{settings}
+
+<background>
+	<background name="bg" strength="0.5" color="0.8 0.85 1.0" />
+	<connect from="bg background" to="output surface" />
+</background>
+
+<shader name="ground">
+	<checker_texture name="checker" scale="4.0" color1="0.8 0.8 0.8" color2="0.2 0.2 0.2" />
+	<diffuse_bsdf name="ground_closure" />
+	<connect from="checker color" to="ground_closure color" />
+	<connect from="ground_closure bsdf" to="output surface" />
+</shader>
+
+<light type="distant" dir="-0.3 -1 0.5" strength="3 3 3" angle="0.05" />
+
+<state shader="ground">
+	<mesh P="-5 -1 -5  5 -1 -5  5 -1 5  -5 -1 5  -1 -1 0  1 -1 0  1 1 0  -1 1 0"
+	      nverts="4 4" verts="0 3 2 1  4 5 6 7" />
+</state>
+</cycles>
+"""
+
+ADAPTIVE_SETTINGS = """<integrator sampling_pattern="pmj" adaptive_threshold="0.05" />
+<film use_adaptive_sampling="true" />"""
+
+SAMPLES = 16
+
+
+def create_argparse():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("-cycles", nargs=1)
+    parser.add_argument("-merge", nargs=1)
+    parser.add_argument("-idiff", nargs=1)
+    parser.add_argument("-outdir", nargs=1)
+    return parser
+
+
+def render(cycles, scene_filepath, output_filepath, sample_range=None):
+    command = [
+        cycles,
+        "--background",
+        "--quiet",
+        "--samples", str(SAMPLES),
+        "--denoising-passes",
+        "--output", output_filepath]
+    if sample_range:
+        command += [
+            "--range-start-sample", str(sample_range[0]),
+            "--range-num-samples", str(sample_range[1])]
+    command.append(scene_filepath)
+    completed = subprocess.run(command)
+    return completed.returncode == 0 and os.path.exists(output_filepath)
+
+
+def merge(cycles_merge, input_filepaths, output_filepath):
+    command = [cycles_merge, "--output", output_filepath] + input_filepaths
+    completed = subprocess.run(command)
+    return completed.returncode == 0 and os.path.exists(output_filepath)
+
+
+def run_test(args, name, settings, fail, failpercent):
+    cycles = args.cycles[0]
+    cycles_merge = args.merge[0]
+    idiff = args.idiff[0]
+    output_dir = args.outdir[0]
+
+    scene_filepath = os.path.join(output_dir, name + "_scene.xml")
+    full_filepath = os.path.join(output_dir, name + "_full.exr")
+    range_filepaths = [
+        os.path.join(output_dir, name + "_range_a.exr"),
+        os.path.join(output_dir, name + "_range_b.exr")]
+    merged_filepath = os.path.join(output_dir, name + "_merged.exr")
+
+    with open(scene_filepath, "w") as scene_file:
+        scene_file.write(SCENE.format(settings=settings))
+
+    for filepath in [full_filepath, merged_filepath] + range_filepaths:
+        if os.path.exists(filepath):
+            os.remove(filepath)
+
+    if not render(cycles, scene_filepath, full_filepath):
+        print("FAILED: %s full render" % name)
+        return False
+
+    # Unequal ranges, so wrong weighting of the renders shows in the merged image.
+    sample_ranges = [(0, 5), (5, SAMPLES - 5)]
+    for sample_range, filepath in zip(sample_ranges, range_filepaths):
+        if not render(cycles, scene_filepath, filepath, sample_range):
+            print("FAILED: %s render of samples %d to %d" %
+                  (name, sample_range[0], sample_range[0] + sample_range[1]))
+            return False
+
+    if not merge(cycles_merge, range_filepaths, merged_filepath):
+        print("FAILED: %s merge" % name)
+        return False
+
+    # Compares all passes, the merged image must match the full render.
+    command = [
+        idiff,
+        "-fail", str(fail),
+        "-failpercent", str(failpercent),
+        full_filepath,
+        merged_filepath]
+    completed = subprocess.run(command)
+    if completed.returncode > 1:
+        print("FAILED: %s merged render differs from full render" % name)
+        return False
+
+    return True
+
+
+def main():
+    parser = create_argparse()
+    args = parser.parse_args()
+
+    os.makedirs(args.outdir[0], exist_ok=True)
+
+    # Both use the same samples, so only allow tiny differences.
+    if not run_test(args, "merge", "", 0.01, 0.1):
+        return False
+    # Pixels may stop at different samples in the ranges than in the full render,
+    # only allow differences in the order of the adaptive sampling threshold.
+    if not run_test(args, "merge_adaptive", ADAPTIVE_SETTINGS, 0.1, 2):
+        return False
+
+    print("PASSED")
+    return True
+
+
+if __name__ == "__main__":
+    sys.exit(not main())
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+# Apache License, Version 2.0
+
+# Render a small scene with two local network servers, and compare the result
+# with a local CPU render of the same scene.
+
+import argparse
+import os
+import socket
+import subprocess
+import sys
+import time
+
+SCENE = """<cycles>
+<camera width="64" height="48" />
+<transform translate="0 1 -6" rotate="10 1 0 0">
+	<camera type="perspective" fov="0.7" />
+</transform>
+
+<background>
+	<background name="bg" strength="0.5" color="0.8 0.85 1.0" />
+	<connect from="bg background" to="output surface" />
+</background>
+
+<shader name="ground">
+	<checker_texture name="checker" scale="4.0" color1="0.8 0.8 0.8" color2="0.2 0.2 0.2" />
+	<diffuse_bsdf name="ground_closure" />
+	<connect from="checker color" to="ground_closure color" />
+	<connect from="ground_closure bsdf" to="output surface" />
+</shader>
+
+<light type="distant" dir="-0.3 -1 0.5" strength="3 3 3" angle="0.05" />
+
+<state shader="ground">
+	<mesh P="-5 -1 -5  5 -1 -5  5 -1 5  -5 -1 5  -1 -1 0  1 -1 0  1 1 0  -1 1 0"
+	      nverts="4 4" verts="0 3 2 1  4 5 6 7" />
+</state>
+</cycles>
+"""
+
+
+def create_argparse():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("-cycles", nargs=1)
+    parser.add_argument("-server", nargs=1)
+    parser.add_argument("-idiff", nargs=1)
+    parser.add_argument("-outdir", nargs=1)
+    return parser
+
+
+def find_free_port():
+    with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as sock:
+        sock.bind(("127.0.0.1", 0))
+        return sock.getsockname()[1]
+
+
+def wait_for_server(port, timeout=30.0):
+    end_time = time.time() + timeout
+    while time.time() < end_time:
+        try:
+            with socket.create_connection(("127.0.0.1", port), timeout=1.0):
+                return True
+        except OSError:
+            time.sleep(0.1)
+    return False
+
+
+def render(cycles, scene_filepath, output_filepath, device, env=None):
+    command = [
+        cycles,
+        "--background",
+        "--quiet",
+        "--device", device,
+        "--samples", "16",
+        "--output", output_filepath,
+        scene_filepath]
+    completed = subprocess.run(command, env=env)
+    return completed.returncode == 0 and os.path.exists(output_filepath)
+
+
+def main():
+    parser = create_argparse()
+    args = parser.parse_args()
+
+    cycles = args.cycles[0]
+    server = args.server[0]
+    idiff = args.idiff[0]
+    output_dir = args.outdir[0]
+
+    os.makedirs(output_dir, exist_ok=True)
+    scene_filepath = os.path.join(output_dir, "network_scene.xml")
+    local_filepath = os.path.join(output_dir, "network_local.png")
+    network_filepath = os.path.join(output_dir, "network_remote.png")
+
+    with open(scene_filepath, "w") as scene_file:
+        scene_file.write(SCENE)
+
+    for filepath in (local_filepath, network_filepath):
+        if os.path.exists(filepath):
+            os.remove(filepath)
+
+    if not render(cycles, scene_filepath, local_filepath, "CPU"):
+        print("FAILED: local CPU render")
+        return False
+
+    ports = [find_free_port(), find_free_port()]
+    servers = [subprocess.Popen([server, "--port", str(port)]) for port in ports]
+
+    try:
+        for port in ports:
+            if not wait_for_server(port):
+                print("FAILED: server on port %d did not start" % port)
+                return False
+
+        env = os.environ.copy()
+        env["CYCLES_NETWORK_SERVERS"] = ",".join("127.0.0.1:%d" % port for port in ports)
+        if not render(cycles, scene_filepath, network_filepath, "NETWORK", env):
+            print("FAILED: network render")
+            return False
+    finally:
+        for process in servers:
+            process.kill()
+            process.wait()
+
+    # Both renders use the same sampling pattern, so only allow tiny differences.
+    command = [
+        idiff,
+        "-fail", "0.01",
+        "-failpercent", "0.1",
+        local_filepath,
+        network_filepath]
+    completed = subprocess.run(command)
+    if completed.returncode > 1:
+        print("FAILED: network render differs from local CPU render")
+        return False
+
+    print("PASSED")
+    return True
+
+
+if __name__ == "__main__":
+    sys.exit(not main())